@@ -43,10 +43,17 @@ public:
                mem::SharedPtr<logging::Logger> logger =
                        mem::SharedPtr<logging::Logger>());
 
+    /*
+     *  \param memoryMapVBM If true, the file is memory mapped and each VBM
+     *         parameter is only pulled out of it (and byte swapped) the
+     *         first time it's accessed, rather than reading the whole VBM
+     *         up front.
+     */
     CPHDReader(const std::string& fromFile,
                size_t numThreads,
                mem::SharedPtr<logging::Logger> logger =
-                       mem::SharedPtr<logging::Logger>());
+                       mem::SharedPtr<logging::Logger>(),
+               bool memoryMapVBM = false);
 
     size_t getNumChannels() const
     {
@@ -130,9 +137,14 @@ private:
     std::auto_ptr<VBM> mVBM;
     std::auto_ptr<Wideband> mWideband;
 
+    // The VBM is read from 'mappedFile' if it's set
+    // The wideband is opened by 'pathname' if it's set
     void initialize(mem::SharedPtr<io::SeekableInputStream> inStream,
                     size_t numThreads,
-                    mem::SharedPtr<logging::Logger> logger);
+                    mem::SharedPtr<logging::Logger> logger,
+                    mem::SharedPtr<six::MemoryMappedFile> mappedFile =
+                            mem::SharedPtr<six::MemoryMappedFile>(),
+                    const std::string& pathname = std::string());
 
 };
 }
@@ -27,6 +27,11 @@
 #include <vector>
 
 #include <sys/Conf.h>
+#include <mem/ScopedArray.h>
+#include <mem/SharedPtr.h>
+#include <mt/RequestQueue.h>
+#include <mt/ThreadGroup.h>
+#include <sys/Mutex.h>
 #include <cphd/Metadata.h>
 #include <types/RowCol.h>
 #include <io/FileOutputStream.h>
@@ -57,13 +62,21 @@ public:
      *         filled in internally. All other data must be provided.
      *  \param numThreads The number of threads to use for processing.
      *  \param scratchSpaceSize The maximum size of internal scratch space
-     *         that may be used if byte swapping is necessary.
+     *         that may be used if byte swapping is necessary.  It's split
+     *         in two so that one half can be written to disk while the
+     *         other is being swapped.
      *         Default is 4 MB
      */
     CPHDWriter(const Metadata& metadata,
                size_t numThreads = 0,
                size_t scratchSpaceSize = 4 * 1024 * 1024);
 
+    /*
+     *  \func Destructor
+     *  \brief Finishes writing any data that's still queued up
+     */
+    ~CPHDWriter();
+
     /*
      *  \func addImage
      *  \brief Pushes a new image to the file for writing. This only works with
@@ -77,6 +90,10 @@ public:
      *  \param dims The dimensions of the image.
      *  \param vbmData The vector based metadata. This should have data
      *         equal to: dims.row * metadata.data.getNumBytesVBM.
+     *
+     *  Only the pointers are held on to, so every image must stay around
+     *  until write() is called.  For large collections, use writeMetadata
+     *  and the block-wise writeCPHDData instead.
      */
     template <typename T>
     void addImage(const T* image,
@@ -117,11 +134,39 @@ public:
      *  \param numElements The number of elements in data. Treat the data
      *         as complex when computing the size (do not multiply by 2
      *         for correct byte swapping this is done internally).
+     *
+     *  The data is copied before this returns, so the buffer may be reused
+     *  right away, but it may not have reached the file until the next
+     *  call to close().
      */
     template <typename T>
     void writeCPHDData(const T* data,
                        size_t numElements);
 
+    /*
+     *  \func writeCPHDData
+     *  \brief Writes a block of vectors from one channel straight to their
+     *         place in the file.  writeMetadata must have been called
+     *         first, which lays out the whole file from the metadata.
+     *         Blocks may then be written in any order, and from several
+     *         threads at once, so only a block's worth of data needs to be
+     *         in memory at a time.  Every vector of every channel must be
+     *         written before the file is closed.  Don't mix this with the
+     *         sequential writeCPHDData in the same file.
+     *
+     *  \param data The vectors to write (numVectors * the channel's number
+     *         of samples elements)
+     *  \param channel The 0-based channel the vectors belong to
+     *  \param firstVector The 0-based index of the first vector within the
+     *         channel
+     *  \param numVectors The number of vectors in data
+     */
+    template <typename T>
+    void writeCPHDData(const T* data,
+                       size_t channel,
+                       size_t firstVector,
+                       size_t numVectors);
+
     /*
      *  \func write
      *  \brief Writes the CPHD file to disk. This should only be called
@@ -137,13 +182,12 @@ public:
                const std::string& classification = "",
                const std::string& releaseInfo = "");
 
-    void close()
-    {
-        if (mFile.isOpen())
-        {
-            mFile.close();
-        }
-    }
+    /*
+     *  \func close
+     *  \brief Waits for all queued data to be written, then closes the
+     *         file.  Throws if any of the data couldn't be written.
+     */
+    void close();
 
 private:
     void writeMetadata(size_t vbmSize,
@@ -157,6 +201,11 @@ private:
     void writeCPHDDataImpl(const sys::ubyte* data,
                            size_t size);
 
+    void writeCPHDDataImpl(const sys::ubyte* data,
+                           size_t channel,
+                           size_t firstVector,
+                           size_t numVectors);
+
     class DataWriter
     {
     public:
@@ -169,11 +218,23 @@ private:
                                 size_t numElements,
                                 size_t elementSize) = 0;
 
+        //! Wait until everything passed in so far is in the stream
+        virtual void flush()
+        {
+        }
+
     protected:
         io::FileOutputStream& mStream;
         const size_t mNumThreads;
     };
 
+    /*
+     *  Byte swaps each chunk of data while copying it into one half of the
+     *  scratch space, and hands it off to a writer thread so the next chunk
+     *  can be swapped into the other half while this one's being written.
+     *  The swapping threads and the writer thread are started once and live
+     *  as long as the DataWriter.
+     */
     class DataWriterLittleEndian : public DataWriter
     {
     public:
@@ -181,13 +242,39 @@ private:
                                size_t numThreads,
                                size_t scratchSize);
 
+        virtual ~DataWriterLittleEndian();
+
         virtual void operator()(const sys::ubyte* data,
                                 size_t numElements,
                                 size_t elementSize);
 
+        virtual void flush();
+
+    private:
+        struct Chunk;
+        struct SwapRequest;
+        class SwapRunnable;
+        class WriteRunnable;
+
+        void swap(const sys::ubyte* input,
+                  size_t numElements,
+                  size_t elementSize,
+                  sys::ubyte* output);
+
+        // Waits for an empty chunk, throwing if an earlier write failed
+        Chunk* getEmptyChunk();
+
     private:
-        const size_t mScratchSize;
-        const mem::ScopedArray<sys::byte> mScratch;
+        const size_t mChunkSize;
+        std::vector<mem::SharedPtr<Chunk> > mChunks;
+        mt::RequestQueue<Chunk*> mEmptyChunks;
+        mt::RequestQueue<Chunk*> mFullChunks;
+        mt::ThreadGroup mWriteThread;
+
+        std::vector<SwapRequest> mSwapRequests;
+        mt::RequestQueue<SwapRequest*> mPendingSwaps;
+        mt::RequestQueue<SwapRequest*> mFinishedSwaps;
+        mt::ThreadGroup mSwapThreads;
     };
 
     class DataWriterBigEndian : public DataWriter
@@ -215,6 +302,12 @@ private:
 
     size_t mCPHDSize;
     size_t mVBMSize;
+
+    // Where each channel's wideband starts in the file
+    std::vector<sys::Off_T> mChannelOffsets;
+
+    // Guards the file position for the block-wise writes
+    sys::Mutex mFileMutex;
 };
 }
 
@@ -0,0 +1,256 @@
+/* =========================================================================
+ * This file is part of cphd-c++
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2017, MDA Information Systems LLC
+ *
+ * cphd-c++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __CPHD_PULSE_STREAM_H__
+#define __CPHD_PULSE_STREAM_H__
+
+#include <complex>
+#include <string>
+#include <vector>
+
+#include <sys/Conf.h>
+#include <sys/AtomicCounter.h>
+#include <mem/BufferView.h>
+#include <mem/SharedPtr.h>
+#include <mt/RequestQueue.h>
+#include <mt/ThreadGroup.h>
+#include <cphd/VBM.h>
+#include <cphd/Wideband.h>
+
+namespace cphd
+{
+class CPHDReader;
+
+/*!
+ *  \class PulseBlock
+ *  \brief A block of consecutive vectors from one channel, as handed out by
+ *  PulseStream.  Along with the wideband, it provides the matching slice of
+ *  the VBM.
+ */
+class PulseBlock
+{
+public:
+    //! 0-based channel the vectors are from
+    size_t getChannel() const
+    {
+        return mChannel;
+    }
+
+    //! 0-based index within the channel of the first vector in the block
+    size_t getFirstVector() const
+    {
+        return mFirstVector;
+    }
+
+    size_t getNumVectors() const
+    {
+        return mNumVectors;
+    }
+
+    size_t getNumSamples() const
+    {
+        return mNumSamples;
+    }
+
+    /*!
+     * Only available with PulseStream::RAW output
+     *
+     * \return The samples as they're stored in the file, but in native byte
+     * order (getNumVectors() * getNumSamples() complex samples)
+     */
+    mem::BufferView<const sys::ubyte> getRawData() const;
+
+    /*!
+     * Only available with PulseStream::PROMOTED or PulseStream::SCALED output
+     *
+     * \return The samples as complex floats
+     * (getNumVectors() * getNumSamples() of them)
+     */
+    mem::BufferView<const std::complex<float> > getData() const;
+
+    /*!
+     * Get one VBM parameter for just the vectors in this block.  For
+     * example, getVBM(&cphd::VBM::getTxPositions) returns
+     * getNumVectors() * 3 values.  Throws if the VBM doesn't have the
+     * parameter.
+     *
+     * \param getter One of VBM's bulk getters
+     *
+     * \return The parameter's values for the vectors in this block
+     */
+    mem::BufferView<const double> getVBM(
+            mem::BufferView<const double> (VBM::*getter)(size_t) const) const;
+
+private:
+    friend class PulseStream;
+
+    PulseBlock(const VBM& vbm,
+               size_t channel,
+               size_t numSamples,
+               size_t numChannelVectors);
+
+    // Noncopyable
+    PulseBlock(const PulseBlock& );
+    const PulseBlock& operator=(const PulseBlock& );
+
+private:
+    const VBM& mVBM;
+    const size_t mChannel;
+    const size_t mNumSamples;
+    const size_t mNumChannelVectors;
+    size_t mFirstVector;
+    size_t mNumVectors;
+    size_t mElementSize;
+    bool mRaw;
+
+    // Holds the raw samples, or is scratch space for the conversion
+    std::vector<sys::ubyte> mBuffer;
+    std::vector<std::complex<float> > mData;
+    std::vector<double> mScaleFactors;
+
+    // Set if the block couldn't be read
+    std::string mError;
+};
+
+/*!
+ *  \class PulseStream
+ *  \brief Hands out a range of a channel's vectors a block at a time
+ *
+ *  A background thread reads (and byte swaps and scales or promotes as
+ *  requested) up to numPrefetchBlocks blocks ahead of the caller, so that
+ *  processing one block overlaps reading the next ones:
+ *
+ *  \code
+    cphd::PulseStream stream(reader, channel, cphd::PulseStream::SCALED,
+                             numVectorsPerBlock);
+    while (const cphd::PulseBlock* block = stream.next())
+    {
+        process(block->getData(), block->getVBM(&cphd::VBM::getTxTimes));
+    }
+ *  \endcode
+ *
+ *  The stream reads through the reader's Wideband, so the reader must
+ *  outlive it, and nothing else may read from the reader's Wideband until
+ *  the stream is destroyed.
+ */
+class PulseStream
+{
+public:
+    //! What each block holds
+    enum OutputType
+    {
+        //! Samples as stored in the file (but byte swapped)
+        RAW,
+
+        //! Samples promoted to complex floats
+        PROMOTED,
+
+        //! Samples promoted to complex floats and scaled by the VBM AmpSF
+        SCALED
+    };
+
+    /*!
+     * Starts prefetching the first blocks
+     *
+     * \param reader Reader to stream from
+     * \param channel 0-based channel
+     * \param outputType What each block should hold.  SCALED requires the
+     * VBM to have AmpSF.
+     * \param numVectorsPerBlock Number of vectors per block.  The last block
+     * may have fewer.
+     * \param numPrefetchBlocks Maximum number of blocks to read ahead of the
+     * caller.  If 0, each block is read when it's asked for.
+     * \param firstVector 0-based first vector to stream (inclusive)
+     * \param lastVector 0-based last vector to stream (inclusive).  Use
+     * Wideband::ALL to stream all vectors.
+     * \param firstSample 0-based first sample to read (inclusive)
+     * \param lastSample 0-based last sample to read (inclusive).  Use
+     * Wideband::ALL to read all samples.
+     * \param numThreads Number of threads to use for endian swapping and
+     * scaling each block
+     */
+    PulseStream(CPHDReader& reader,
+                size_t channel,
+                OutputType outputType,
+                size_t numVectorsPerBlock,
+                size_t numPrefetchBlocks = 2,
+                size_t firstVector = 0,
+                size_t lastVector = Wideband::ALL,
+                size_t firstSample = 0,
+                size_t lastSample = Wideband::ALL,
+                size_t numThreads = 1);
+
+    //! Stops any prefetching that's still going on
+    ~PulseStream();
+
+    //! \return The total number of blocks the stream will hand out
+    size_t getNumBlocks() const
+    {
+        return mNumBlocks;
+    }
+
+    /*!
+     * Get the next block, waiting for it to be read if necessary.  The block
+     * is only valid until the next call to next() or until the stream is
+     * destroyed.  Throws if the block couldn't be read.
+     *
+     * \return The next block, or NULL once all blocks have been handed out
+     */
+    const PulseBlock* next();
+
+private:
+    // Reads blocks ahead of the caller on its own thread
+    class PrefetchRunnable;
+
+    void readBlock(size_t blockNum, PulseBlock& block);
+
+    // Noncopyable
+    PulseStream(const PulseStream& );
+    const PulseStream& operator=(const PulseStream& );
+
+private:
+    Wideband& mWideband;
+    const VBM& mVBM;
+    const size_t mChannel;
+    const OutputType mOutputType;
+    const size_t mNumVectorsPerBlock;
+    const size_t mFirstVector;
+    const size_t mFirstSample;
+    const size_t mLastSample;
+    const size_t mNumThreads;
+    const bool mPrefetch;
+    size_t mNumVectors;
+    size_t mNumBlocks;
+
+    std::vector<mem::SharedPtr<PulseBlock> > mBlocks;
+    mt::RequestQueue<PulseBlock*> mEmptyBlocks;
+    mt::RequestQueue<PulseBlock*> mFilledBlocks;
+    mt::ThreadGroup mThreads;
+    sys::AtomicCounter mStop;
+
+    // The block the caller currently has
+    PulseBlock* mCurrentBlock;
+    size_t mNextBlock;
+};
+}
+
+#endif
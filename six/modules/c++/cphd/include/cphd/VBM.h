@@ -25,9 +25,13 @@
 
 #include <vector>
 
+#include <sys/AtomicCounter.h>
 #include <sys/Conf.h>
+#include <sys/Mutex.h>
 #include <io/SeekableStreams.h>
-#include <mem/ScopedCopyablePtr.h>
+#include <mem/BufferView.h>
+#include <mem/SharedPtr.h>
+#include <six/MemoryMappedFile.h>
 #include <cphd/Types.h>
 #include <cphd/Data.h>
 #include <cphd/VectorParameters.h>
@@ -38,6 +42,10 @@ namespace cphd
 //  It contains the cphd::Data structure (for channel and vector sizes),
 //  the cphd::VectorParameters info (for the map of available VBM entries)
 //  and the VBP data itself
+//
+//  The VBP data is stored by column: each channel holds one contiguous array
+//  per parameter, so all of a channel's values of a parameter can be had at
+//  once through the bulk getters (e.g. getTxTimes()).
 
 class VBM
 {
@@ -130,6 +138,31 @@ public:
     void setDeltaTOA0(double value, size_t channel, size_t vector);
     void setTOASS(double value, size_t channel, size_t vector);
 
+    /*
+     *  Bulk getters, returning every vector's value of a parameter for a
+     *  channel.  The values are contiguous and in vector order; positions
+     *  are stored as X, Y, Z for each vector, so their views hold
+     *  3 * numVectors values.  As with the single value getters, asking for
+     *  a parameter this VBM doesn't have throws.
+     *
+     *  The views point into the VBM, so they're only valid as long as it is
+     *  and until clearAmpSF() is called.
+     */
+    mem::BufferView<const double> getTxTimes(size_t channel) const;
+    mem::BufferView<const double> getTxPositions(size_t channel) const;
+    mem::BufferView<const double> getRcvTimes(size_t channel) const;
+    mem::BufferView<const double> getRcvPositions(size_t channel) const;
+    mem::BufferView<const double> getSRPTimes(size_t channel) const;
+    mem::BufferView<const double> getSRPPositions(size_t channel) const;
+    mem::BufferView<const double> getTropoSRPs(size_t channel) const;
+    mem::BufferView<const double> getAmpSFs(size_t channel) const;
+    mem::BufferView<const double> getFx0s(size_t channel) const;
+    mem::BufferView<const double> getFxSSs(size_t channel) const;
+    mem::BufferView<const double> getFx1s(size_t channel) const;
+    mem::BufferView<const double> getFx2s(size_t channel) const;
+    mem::BufferView<const double> getDeltaTOA0s(size_t channel) const;
+    mem::BufferView<const double> getTOASSs(size_t channel) const;
+
     // More convenience functions
 
     /*
@@ -147,7 +180,7 @@ public:
     // Returns the number channels for the VBM.
     size_t getNumChannels() const
     {
-        return mData.size();
+        return mChannels.size();
     }
 
     void clearAmpSF();
@@ -185,6 +218,23 @@ public:
                     sys::Off_T sizeVBM,
                     size_t numThreads);
 
+    /*
+     *  \func load
+     *  \brief Same as above, but rather than reading the VBM up front, each
+     *         parameter of a channel is pulled out of the memory mapped file
+     *         (and byte swapped) the first time it's accessed.  This VBM
+     *         keeps a reference to the mapped file.
+     *
+     *  \param file The mapped CPHD file
+     *  \param startVBM Offset to the VBM in the file
+     *  \param sizeVBM Size of the VBM in the file
+     *
+     *  \return The number of bytes in the VBM
+     */
+    sys::Off_T load(mem::SharedPtr<six::MemoryMappedFile> file,
+                    sys::Off_T startVBM,
+                    sys::Off_T sizeVBM);
+
     /*
      *  \func getVBMdata
      *  \brief This will return a contiguous buffer all the VBM data.
@@ -214,15 +264,7 @@ public:
      */
     size_t getVBMsize(size_t channel) const;
 
-    bool operator==(const VBM& other) const
-    {
-        return mSRPTimeEnabled == other.mSRPTimeEnabled &&
-               mTropoSRPEnabled == other.mTropoSRPEnabled &&
-               mAmpSFEnabled == other.mAmpSFEnabled &&
-               mDomainType == other.mDomainType &&
-               mNumBytesPerVector == other.mNumBytesPerVector &&
-               mData == other.mData;
-    }
+    bool operator==(const VBM& other) const;
 
     bool operator!=(const VBM& vbm) const
     {
@@ -230,80 +272,161 @@ public:
     }
 
 private:
-    struct FrequencyParameters
+    // The VBP parameters, in the order they're laid out in each vector
+    enum Field
     {
-        FrequencyParameters();
+        TX_TIME,
+        TX_POS,
+        RCV_TIME,
+        RCV_POS,
+        SRP_TIME,
+        SRP_POS,
+        TROPO_SRP,
+        AMP_SF,
+        FX0,
+        FX_SS,
+        FX1,
+        FX2,
+        DELTA_TOA0,
+        TOA_SS,
+        NUM_FIELDS
+    };
 
-        bool operator==(const FrequencyParameters& other) const
+    // Set once a field has been pulled out of the memory map.  It's only
+    // set under the map's mutex, after the values are in place, so readers
+    // that see it set can skip the lock.  Copies take the current state.
+    class LoadedFlag
+    {
+    public:
+        LoadedFlag()
         {
-            return fx0 == other.fx0 &&
-                   fxSS == other.fxSS &&
-                   fx1 == other.fx1 &&
-                   fx2 == other.fx2;
         }
 
-        bool operator!=(const FrequencyParameters& other) const
+        LoadedFlag(const LoadedFlag& other)
         {
-            return !((*this) == other);
+            if (other.isSet())
+            {
+                set();
+            }
         }
 
-        double fx0;
-        double fxSS;
-        double fx1;
-        double fx2;
-    };
+        LoadedFlag& operator=(const LoadedFlag& other)
+        {
+            if (other.isSet())
+            {
+                set();
+            }
+            else
+            {
+                clear();
+            }
+            return *this;
+        }
 
-    struct TOAParameters
-    {
-        TOAParameters();
+        bool isSet() const
+        {
+            return mCounter.get() != 0;
+        }
 
-        bool operator==(const TOAParameters& other) const
+        void set()
         {
-            return deltaTOA0 == other.deltaTOA0 &&
-                   toaSS == other.toaSS;
+            if (!isSet())
+            {
+                mCounter.increment();
+            }
         }
 
-        bool operator!=(const TOAParameters& other) const
+        void clear()
         {
-            return !((*this) == other);
+            if (isSet())
+            {
+                mCounter.decrement();
+            }
         }
 
-        double deltaTOA0;
-        double toaSS;
+    private:
+        sys::AtomicCounter mCounter;
     };
 
-    struct VectorBasedParameters
+    struct ChannelData
     {
-        VectorBasedParameters(bool srpTimeEnabled,
-                              bool tropoSrpEnabled,
-                              bool ampSFEnabled, 
-                              DomainType domainType);
-
-        size_t getNumBytes() const;
+        ChannelData() :
+            numVectors(0),
+            mapped(NULL)
+        {
+        }
 
-        void getData(sys::ubyte* data) const;
+        size_t numVectors;
 
-        void setData(const sys::byte* data);
+        // One array per field, with getFieldSize(field) values per vector.
+        // Fields this VBM doesn't have are left empty.  When the VBM is
+        // memory mapped, fields are empty until they're first accessed.
+        mutable std::vector<double> fields[NUM_FIELDS];
+        mutable LoadedFlag loaded[NUM_FIELDS];
 
-        bool operator==(const VectorBasedParameters& other) const;
+        // This channel's raw (big endian) VBM when memory mapped
+        const sys::ubyte* mapped;
+    };
 
-        bool operator!=(const VectorBasedParameters& other) const
-        {
-            return !((*this) == other);
-        }
+    struct MappedFile
+    {
+        mem::SharedPtr<six::MemoryMappedFile> file;
 
-        double txTime;
-        Vector3 txPos;
-        double rcvTime;
-        Vector3 rcvPos;
-        double srpTime;
-        Vector3 srpPos;
-        double tropoSrp;
-        double ampSF;
-        mem::ScopedCopyablePtr<FrequencyParameters> frequencyParameters;
-        mem::ScopedCopyablePtr<TOAParameters> toaParameters;
+        // Guards pulling fields out of the map
+        sys::Mutex mutex;
     };
 
+    // Number of doubles the field takes up for each vector
+    static size_t getFieldSize(Field field)
+    {
+        return (field == TX_POS || field == RCV_POS || field == SRP_POS) ?
+                3 : 1;
+    }
+
+    bool haveField(Field field) const;
+
+    // Byte offset of the field within each vector
+    size_t getFieldOffset(Field field) const;
+
+    size_t computeNumBytesPerVector() const;
+
+    // Returns the field's values for the channel, pulling them out of the
+    // memory mapped file if needed.  Throws with 'errorMessage' if this VBM
+    // doesn't have the field.
+    std::vector<double>& getField(Field field,
+                                  size_t channel,
+                                  const char* errorMessage) const;
+
+    mem::BufferView<const double> getFieldView(Field field,
+                                               size_t channel,
+                                               const char* errorMessage) const;
+
+    double getValue(Field field,
+                    size_t channel,
+                    size_t vector,
+                    const char* errorMessage) const;
+
+    Vector3 getVector(Field field, size_t channel, size_t vector) const;
+
+    void setValue(double value,
+                  Field field,
+                  size_t channel,
+                  size_t vector,
+                  const char* errorMessage);
+
+    void setVector(const Vector3& value,
+                   Field field,
+                   size_t channel,
+                   size_t vector);
+
+    // Copies each vector's values (in native byte order) into the fields
+    void setChannelData(size_t channel, const sys::byte* data);
+
+    // Pulls all fields out of the memory mapped file and releases it
+    void unmap();
+
+    void verifyChannel(size_t channel) const;
+
     void verifyChannelVector(size_t channel, size_t vector) const;
 
     void setupInitialData(size_t numChannels,
@@ -315,9 +438,11 @@ private:
     DomainType mDomainType;
     size_t mNumBytesPerVector;
 
-    // One vector of VectorBasedParameters per channel.
-    // Then one VectorBasedParameter per vector.
-    std::vector<std::vector<VectorBasedParameters> > mData;
+    std::vector<ChannelData> mChannels;
+
+    // Only set when loaded from a memory mapped file.  Copies of this VBM
+    // share it.
+    mem::SharedPtr<MappedFile> mMappedFile;
 
     friend std::ostream& operator<< (std::ostream& os, const VBM& d);
 };
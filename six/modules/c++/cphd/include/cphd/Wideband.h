@@ -25,6 +25,7 @@
 
 #include <string>
 #include <complex>
+#include <vector>
 
 #include <sys/Conf.h>
 #include <cphd/Data.h>
@@ -48,6 +49,9 @@ public:
     static const size_t ALL;
 
     /*
+     * Opening by pathname allows readChannels() to read channels in
+     * parallel
+     *
      * \param pathname Input CPHD pathname
      * \param data Data section from CPHD
      * \param startWB CPHD header keyword "CPHD_BYTE_OFFSET"
@@ -112,6 +116,8 @@ public:
               mem::ScopedArray<sys::ubyte>& data);
 
     // Same as above but also applies a per-vector scale factor
+    // The scratch buffer must be large enough to hold the entire region as
+    // stored in the file (numVectors * numSamples * elementSize)
     void read(size_t channel,
               size_t firstVector,
               size_t lastVector,
@@ -122,6 +128,56 @@ public:
               const mem::BufferView<sys::ubyte>& scratch,
               const mem::BufferView<std::complex<float> >& data);
 
+    /*
+     * Same as above but without needing a scratch buffer for the whole
+     * region.  The region is read a block of vectors at a time (about
+     * READ_BLOCK_SIZE bytes each) into a small ring of internal buffers.
+     * One thread reads blocks while the calling thread byte swaps and
+     * scales or promotes the blocks that are ready into 'data'.
+     */
+    void read(size_t channel,
+              size_t firstVector,
+              size_t lastVector,
+              size_t firstSample,
+              size_t lastSample,
+              const std::vector<double>& vectorScaleFactors,
+              size_t numThreads,
+              const mem::BufferView<std::complex<float> >& data);
+
+    /*
+     * Read the same vector(s) and sample(s) from several channels
+     * Performs endian swapping if necessary
+     *
+     * If this object was constructed from a pathname, the channels are read
+     * in parallel, with each thread reading through its own handle to the
+     * file.  These handles are kept and reused by subsequent calls.
+     * Otherwise, the channels are read one after another.
+     *
+     * \param channels 0-based channels to read
+     * \param firstVector 0-based first vector to read (inclusive)
+     * \param lastVector 0-based last vector to read (inclusive).  Use ALL to
+     * read all vectors of each channel
+     * \param firstSample 0-based first sample to read (inclusive)
+     * \param lastSample 0-based last sample to read (inclusive).  Use ALL to
+     * read all samples of each channel
+     * \param numThreads Maximum number of channels to read at once
+     * \param data One buffer per channel, each of which must be sized as for
+     * read()
+     */
+    void readChannels(const std::vector<size_t>& channels,
+                      size_t firstVector,
+                      size_t lastVector,
+                      size_t firstSample,
+                      size_t lastSample,
+                      size_t numThreads,
+                      const std::vector<mem::BufferView<sys::ubyte> >& data);
+
+    //! Approximate number of bytes read at a time by the block-wise read
+    static const size_t READ_BLOCK_SIZE;
+
+    //! Number of blocks the block-wise read keeps in flight
+    static const size_t NUM_READ_BLOCKS;
+
     // Same as above but for a raw pointer
     // The pointer needs to be preallocated. Use getBufferDims for this.
     void read(size_t channel,
@@ -174,11 +230,41 @@ private:
                   size_t lastVector,
                   size_t firstSample,
                   size_t lastSample,
-                  void* data);
+                  void* data)
+    {
+        readImpl(*mInStream, channel, firstVector, lastVector, firstSample,
+                 lastSample, data);
+    }
+
+    // Same as above but reads through 'inStream'
+    void readImpl(io::SeekableInputStream& inStream,
+                  size_t channel,
+                  size_t firstVector,
+                  size_t lastVector,
+                  size_t firstSample,
+                  size_t lastSample,
+                  void* data) const;
 
     static
     bool allOnes(const std::vector<double>& vectorScaleFactors);
 
+    // Checks the inputs to the scaled reads
+    void checkScaledReadInputs(
+            size_t channel,
+            size_t firstVector,
+            size_t& lastVector,
+            size_t firstSample,
+            size_t& lastSample,
+            const std::vector<double>& vectorScaleFactors,
+            const mem::BufferView<std::complex<float> >& data,
+            types::RowCol<size_t>& dims) const;
+
+    // Reads blocks of vectors for the block-wise read on its own thread
+    class ReadBlocksRunnable;
+
+    // Reads a group of channels for readChannels()
+    class ReadChannelsRunnable;
+
 private:
     // Noncopyable
     Wideband(const Wideband& );
@@ -186,6 +272,11 @@ private:
 
 private:
     const mem::SharedPtr<io::SeekableInputStream> mInStream;
+
+    // Only set when constructed from a pathname, in which case we're able
+    // to open additional handles to the file for readChannels()
+    const std::string mPathname;
+    std::vector<mem::SharedPtr<io::SeekableInputStream> > mChannelStreams;
     cphd::Data mData;                 // contains numChan, numVectors
     const sys::Off_T mWBOffset;       // offset in bytes to start of wideband
     const size_t mWBSize;             // total size in bytes of wideband
@@ -23,30 +23,15 @@
 #include <sys/Conf.h>
 #include <mt/ThreadPlanner.h>
 #include <mt/ThreadGroup.h>
+#include <six/ByteSwap.h>
 #include <cphd/ByteSwap.h>
 
+// The actual swapping and converting is done by the six kernels, which pick
+// SSE2, SSSE3, or AVX2 code at runtime.  Note that we never treat the
+// swapped input as a float before it's swapped - the compiler may change a
+// byte-swapped float value into a valid IEEE value along the way.
 namespace
 {
-// TODO: Maybe this should go in sys/Conf.h
-//       It's more flexible in that it properly handles float's - you can't
-//       just call sys::byteSwap(floatVal) because the compiler may change the
-//       byte-swapped float value into a valid IEEE value beforehand.
-// TODO: If we're really looking to optimize this, could specialize it for
-//       sizes of 2, 4, and 8 to eliminate the for loop
-template <typename T>
-inline
-void byteSwap(const void* in, T& out)
-{
-    const sys::ubyte* const inPtr = static_cast<const sys::ubyte*>(in);
-    sys::ubyte* const outPtr = reinterpret_cast<sys::ubyte*>(&out);
-
-    for (size_t ii = 0, jj = sizeof(T) - 1; ii < jj; ++ii, --jj)
-    {
-        outPtr[ii] = inPtr[jj];
-        outPtr[jj] = inPtr[ii];
-    }
-}
-
 class ByteSwapRunnable : public sys::Runnable
 {
 public:
@@ -55,19 +40,19 @@ public:
                      size_t startElement,
                      size_t numElements) :
         mBuffer(static_cast<sys::byte*>(buffer) + startElement * elemSize),
-        mElemSize(static_cast<unsigned short>(elemSize)),
+        mElemSize(elemSize),
         mNumElements(numElements)
     {
     }
 
     virtual void run()
     {
-        sys::byteSwap(mBuffer, mElemSize, mNumElements);
+        six::byteSwap(mBuffer, mElemSize, mNumElements);
     }
 
 private:
     sys::byte* const mBuffer;
-    const unsigned short mElemSize;
+    const size_t mElemSize;
     const size_t mNumElements;
 };
 
@@ -89,26 +74,11 @@ public:
 
     virtual void run()
     {
-        InT real(0);
-        InT imag(0);
-
-        for (size_t row = 0, inIdx = 0, outIdx = 0; row < mDims.row; ++row)
-        {
-            for (size_t col = 0;
-                 col < mDims.col;
-                 ++col, inIdx += sizeof(std::complex<InT>), ++outIdx)
-            {
-                // Have to be careful here - can't treat mInput as a
-                // std::complex<InT> directly in case InT is a float (see
-                // explanation in byteSwap() comments)
-                const sys::ubyte* const input = mInput + inIdx;
-                byteSwap(input, real);
-                byteSwap(input + sizeof(InT), imag);
-
-                mOutput[outIdx] = std::complex<float>(real,
-                                                      imag);
-            }
-        }
+        // The real and imaginary parts are each an InT
+        six::byteSwapAndPromote(mInput,
+                                sizeof(InT),
+                                mDims.area() * 2,
+                                reinterpret_cast<float*>(mOutput));
     }
 
 private:
@@ -138,28 +108,18 @@ public:
 
     virtual void run()
     {
-        InT real(0);
-        InT imag(0);
+        // The real and imaginary parts are each an InT
+        const size_t numValuesPerRow = mDims.col * 2;
+        const size_t numBytesPerRow = numValuesPerRow * sizeof(InT);
 
-        for (size_t row = 0, inIdx = 0, outIdx = 0; row < mDims.row; ++row)
+        for (size_t row = 0; row < mDims.row; ++row)
         {
-            const double scaleFactor(mScaleFactors[row]);
-
-            for (size_t col = 0;
-                 col < mDims.col;
-                 ++col, inIdx += sizeof(std::complex<InT>), ++outIdx)
-            {
-                // Have to be careful here - can't treat mInput as a
-                // std::complex<InT> directly in case InT is a float (see
-                // explanation in byteSwap() comments)
-                const sys::ubyte* const input = mInput + inIdx;
-                byteSwap(input, real);
-                byteSwap(input + sizeof(InT), imag);
-
-                mOutput[outIdx] = std::complex<float>(
-                        static_cast<float>(real * scaleFactor),
-                        static_cast<float>(imag * scaleFactor));
-            }
+            six::byteSwapAndScale(
+                    mInput + row * numBytesPerRow,
+                    sizeof(InT),
+                    numValuesPerRow,
+                    mScaleFactors[row],
+                    reinterpret_cast<float*>(mOutput + row * mDims.col));
         }
     }
 
@@ -254,9 +214,7 @@ void byteSwap(void* buffer,
 {
     if (numThreads <= 1)
     {
-        sys::byteSwap(buffer,
-                      static_cast<unsigned short>(elemSize),
-                      numElements);
+        six::byteSwap(buffer, elemSize, numElements);
     }
     else
     {
@@ -42,15 +42,25 @@ CPHDReader::CPHDReader(mem::SharedPtr<io::SeekableInputStream> inStream,
 
 CPHDReader::CPHDReader(const std::string& fromFile,
                        size_t numThreads,
-                       mem::SharedPtr<logging::Logger> logger)
+                       mem::SharedPtr<logging::Logger> logger,
+                       bool memoryMapVBM)
 {
+    mem::SharedPtr<six::MemoryMappedFile> mappedFile;
+    if (memoryMapVBM)
+    {
+        mappedFile.reset(new six::MemoryMappedFile(fromFile));
+    }
+
     initialize(mem::SharedPtr<io::SeekableInputStream>(
-        new io::FileInputStream(fromFile)), numThreads, logger);
+        new io::FileInputStream(fromFile)), numThreads, logger, mappedFile,
+        fromFile);
 }
 
 void CPHDReader::initialize(mem::SharedPtr<io::SeekableInputStream> inStream,
                             size_t numThreads,
-                            mem::SharedPtr<logging::Logger> logger)
+                            mem::SharedPtr<logging::Logger> logger,
+                            mem::SharedPtr<six::MemoryMappedFile> mappedFile,
+                            const std::string& pathname)
 {
     mFileHeader.read(*inStream);
 
@@ -71,14 +81,33 @@ void CPHDReader::initialize(mem::SharedPtr<io::SeekableInputStream> inStream,
 
     // Load the VBP into memory
     mVBM.reset(new VBM(mMetadata->data, mMetadata->vectorParameters));
-    mVBM->load(*inStream,
-               mFileHeader.getVBMoffset(),
-               mFileHeader.getVBMsize(),
-               numThreads);
+    if (mappedFile.get())
+    {
+        mVBM->load(mappedFile,
+                   mFileHeader.getVBMoffset(),
+                   mFileHeader.getVBMsize());
+    }
+    else
+    {
+        mVBM->load(*inStream,
+                   mFileHeader.getVBMoffset(),
+                   mFileHeader.getVBMsize(),
+                   numThreads);
+    }
 
     // Setup for wideband reading
-    mWideband.reset(new Wideband(inStream, mMetadata->data,
-                                 mFileHeader.getCPHDoffset(),
-                                 mFileHeader.getCPHDsize()));
+    // Given the pathname, it's able to read multiple channels in parallel
+    if (pathname.empty())
+    {
+        mWideband.reset(new Wideband(inStream, mMetadata->data,
+                                     mFileHeader.getCPHDoffset(),
+                                     mFileHeader.getCPHDsize()));
+    }
+    else
+    {
+        mWideband.reset(new Wideband(pathname, mMetadata->data,
+                                     mFileHeader.getCPHDoffset(),
+                                     mFileHeader.getCPHDsize()));
+    }
 }
 }
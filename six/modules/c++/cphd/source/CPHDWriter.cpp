@@ -20,12 +20,15 @@
  *
  */
 
+#include <algorithm>
+
 #include <except/Exception.h>
+#include <mt/CriticalSection.h>
+#include <six/ByteSwap.h>
 #include <cphd/CPHDWriter.h>
 #include <cphd/CPHDXMLControl.h>
 #include <cphd/Utilities.h>
 #include <cphd/FileHeader.h>
-#include <cphd/ByteSwap.h>
 
 namespace cphd
 {
@@ -40,14 +43,213 @@ CPHDWriter::DataWriter::~DataWriter()
 {
 }
 
+// One half of the scratch space
+struct CPHDWriter::DataWriterLittleEndian::Chunk
+{
+    Chunk(size_t size) :
+        data(new sys::ubyte[size]),
+        size(0)
+    {
+    }
+
+    const mem::ScopedArray<sys::ubyte> data;
+    size_t size;
+
+    // Set by the writer thread if this chunk or an earlier one couldn't be
+    // written
+    std::string error;
+};
+
+// A piece of a chunk for one of the swapping threads
+struct CPHDWriter::DataWriterLittleEndian::SwapRequest
+{
+    const sys::ubyte* input;
+    size_t numElements;
+    size_t elementSize;
+    sys::ubyte* output;
+};
+
+class CPHDWriter::DataWriterLittleEndian::SwapRunnable : public sys::Runnable
+{
+public:
+    SwapRunnable(DataWriterLittleEndian& writer) :
+        mWriter(writer)
+    {
+    }
+
+    virtual void run()
+    {
+        while (true)
+        {
+            SwapRequest* request;
+            mWriter.mPendingSwaps.dequeue(request);
+            if (request == NULL)
+            {
+                return;
+            }
+
+            six::byteSwap(request->input,
+                          request->elementSize,
+                          request->numElements,
+                          request->output);
+            mWriter.mFinishedSwaps.enqueue(request);
+        }
+    }
+
+private:
+    DataWriterLittleEndian& mWriter;
+};
+
+class CPHDWriter::DataWriterLittleEndian::WriteRunnable : public sys::Runnable
+{
+public:
+    WriteRunnable(DataWriterLittleEndian& writer) :
+        mWriter(writer)
+    {
+    }
+
+    virtual void run()
+    {
+        // Once a write fails, the rest are skipped so the file doesn't end
+        // up with a hole in it
+        std::string error;
+        while (true)
+        {
+            Chunk* chunk;
+            mWriter.mFullChunks.dequeue(chunk);
+            if (chunk == NULL)
+            {
+                return;
+            }
+
+            if (error.empty())
+            {
+                try
+                {
+                    mWriter.mStream.write(
+                            reinterpret_cast<const sys::byte*>(
+                                    chunk->data.get()),
+                            chunk->size);
+                }
+                catch (const except::Exception& ex)
+                {
+                    error = ex.getMessage();
+                }
+                catch (const std::exception& ex)
+                {
+                    error = ex.what();
+                }
+            }
+
+            chunk->error = error;
+            mWriter.mEmptyChunks.enqueue(chunk);
+        }
+    }
+
+private:
+    DataWriterLittleEndian& mWriter;
+};
+
 CPHDWriter::DataWriterLittleEndian::DataWriterLittleEndian(
         io::FileOutputStream& stream,
         size_t numThreads,
         size_t scratchSize) :
     DataWriter(stream, numThreads),
-    mScratchSize(scratchSize),
-    mScratch(new sys::byte[mScratchSize])
+    // Keep each chunk a multiple of the largest element size (8 bytes for
+    // the VBM) so an element never straddles two chunks
+    mChunkSize(std::max<size_t>(scratchSize / 2 / 8 * 8, 8)),
+    mSwapRequests(mNumThreads)
 {
+    for (size_t ii = 0; ii < 2; ++ii)
+    {
+        mem::SharedPtr<Chunk> chunk(new Chunk(mChunkSize));
+        mChunks.push_back(chunk);
+        mEmptyChunks.enqueue(chunk.get());
+    }
+
+    mWriteThread.createThread(new WriteRunnable(*this));
+
+    // The calling thread swaps a piece too
+    for (size_t ii = 1; ii < mNumThreads; ++ii)
+    {
+        mSwapThreads.createThread(new SwapRunnable(*this));
+    }
+}
+
+CPHDWriter::DataWriterLittleEndian::~DataWriterLittleEndian()
+{
+    // The writer thread finishes off anything still queued before it sees
+    // the NULL
+    mFullChunks.enqueue(NULL);
+    for (size_t ii = 1; ii < mNumThreads; ++ii)
+    {
+        mPendingSwaps.enqueue(NULL);
+    }
+
+    try
+    {
+        mWriteThread.joinAll();
+        mSwapThreads.joinAll();
+    }
+    catch (...)
+    {
+        // Make sure we don't throw out of the destructor
+    }
+}
+
+void CPHDWriter::DataWriterLittleEndian::swap(const sys::ubyte* input,
+                                              size_t numElements,
+                                              size_t elementSize,
+                                              sys::ubyte* output)
+{
+    // Not worth waking up the other threads for small amounts of data
+    static const size_t MIN_ELEMENTS_PER_THREAD = 16384;
+    const size_t numThreads = std::max<size_t>(std::min(
+            mNumThreads, numElements / MIN_ELEMENTS_PER_THREAD), 1);
+
+    const size_t numElementsPerThread = numElements / numThreads;
+    for (size_t ii = 0; ii < numThreads; ++ii)
+    {
+        const size_t offset = ii * numElementsPerThread * elementSize;
+        SwapRequest& request = mSwapRequests[ii];
+        request.input = input + offset;
+        request.numElements = (ii == numThreads - 1) ?
+                numElements - ii * numElementsPerThread :
+                numElementsPerThread;
+        request.elementSize = elementSize;
+        request.output = output + offset;
+
+        if (ii > 0)
+        {
+            mPendingSwaps.enqueue(&request);
+        }
+    }
+
+    six::byteSwap(mSwapRequests[0].input,
+                  elementSize,
+                  mSwapRequests[0].numElements,
+                  mSwapRequests[0].output);
+
+    for (size_t ii = 1; ii < numThreads; ++ii)
+    {
+        SwapRequest* request;
+        mFinishedSwaps.dequeue(request);
+    }
+}
+
+CPHDWriter::DataWriterLittleEndian::Chunk*
+CPHDWriter::DataWriterLittleEndian::getEmptyChunk()
+{
+    Chunk* chunk;
+    mEmptyChunks.dequeue(chunk);
+    if (!chunk->error.empty())
+    {
+        // Leave the error in place so later writes fail too
+        mEmptyChunks.enqueue(chunk);
+        throw except::Exception(Ctxt(
+                "Failed to write CPHD data: " + chunk->error));
+    }
+    return chunk;
 }
 
 void CPHDWriter::DataWriterLittleEndian::operator()(
@@ -61,20 +263,45 @@ void CPHDWriter::DataWriterLittleEndian::operator()(
     while (dataProcessed < dataSize)
     {
         const size_t dataToProcess =
-                std::min(mScratchSize, dataSize - dataProcessed);
+                std::min(mChunkSize, dataSize - dataProcessed);
+
+        // Swap while copying, so the data's only touched once.  Meanwhile
+        // the writer thread may still be writing the other chunk.
+        Chunk* const chunk = getEmptyChunk();
+        swap(data + dataProcessed,
+             dataToProcess / elementSize,
+             elementSize,
+             chunk->data.get());
+        chunk->size = dataToProcess;
+        mFullChunks.enqueue(chunk);
 
-        memcpy(mScratch.get(),
-               data + dataProcessed,
-               dataToProcess);
+        dataProcessed += dataToProcess;
+    }
+}
 
-        byteSwap(mScratch.get(),
-                 elementSize,
-                 dataToProcess / elementSize,
-                 mNumThreads);
+void CPHDWriter::DataWriterLittleEndian::flush()
+{
+    // Both chunks are only empty once everything's been written
+    std::vector<Chunk*> chunks(mChunks.size());
+    for (size_t ii = 0; ii < chunks.size(); ++ii)
+    {
+        mEmptyChunks.dequeue(chunks[ii]);
+    }
 
-        mStream.write(mScratch.get(), dataToProcess);
+    std::string error;
+    for (size_t ii = 0; ii < chunks.size(); ++ii)
+    {
+        if (error.empty())
+        {
+            error = chunks[ii]->error;
+        }
+        mEmptyChunks.enqueue(chunks[ii]);
+    }
 
-        dataProcessed += dataToProcess;
+    if (!error.empty())
+    {
+        throw except::Exception(Ctxt(
+                "Failed to write CPHD data: " + error));
     }
 }
 
@@ -117,6 +344,21 @@ CPHDWriter::CPHDWriter(const Metadata& metadata,
     }
 }
 
+CPHDWriter::~CPHDWriter()
+{
+    // Let the data writer finish up while the file's still open
+    mDataWriter.reset();
+}
+
+void CPHDWriter::close()
+{
+    mDataWriter->flush();
+    if (mFile.isOpen())
+    {
+        mFile.close();
+    }
+}
+
 template <typename T>
 void CPHDWriter::addImage(const T* image,
                           const types::RowCol<size_t>& dims,
@@ -183,6 +425,16 @@ void CPHDWriter::writeMetadata(size_t vbmSize,
 
     // set header size, final step before write
     header.set(xmlMetadata.size(), vbmSize, cphdSize);
+
+    mChannelOffsets.resize(mMetadata.data.getNumChannels());
+    sys::Off_T offset = header.getCPHDoffset();
+    for (size_t ii = 0; ii < mChannelOffsets.size(); ++ii)
+    {
+        mChannelOffsets[ii] = offset;
+        offset += static_cast<sys::Off_T>(mMetadata.data.getNumVectors(ii)) *
+                mMetadata.data.getNumSamples(ii) * mElementSize;
+    }
+
     mFile.write(header.toString().c_str(), header.size());
     mFile.write("\f\n", 2);
     mFile.write(xmlMetadata.c_str(), xmlMetadata.size());
@@ -214,6 +466,71 @@ void CPHDWriter::writeCPHDDataImpl(const sys::ubyte* data,
     (*mDataWriter)(data, size * 2, mElementSize / 2);
 }
 
+void CPHDWriter::writeCPHDDataImpl(const sys::ubyte* data,
+                                   size_t channel,
+                                   size_t firstVector,
+                                   size_t numVectors)
+{
+    if (!mFile.isOpen() || mChannelOffsets.empty())
+    {
+        throw except::Exception(Ctxt(
+                "writeMetadata must be called before writing blocks"));
+    }
+    if (channel >= mChannelOffsets.size())
+    {
+        throw except::Exception(Ctxt("Invalid channel number"));
+    }
+    if (firstVector + numVectors > mMetadata.data.getNumVectors(channel))
+    {
+        throw except::Exception(Ctxt(
+                "Block goes past the last vector in channel " +
+                str::toString(channel)));
+    }
+
+    const size_t numBytesPerVector =
+            mMetadata.data.getNumSamples(channel) * mElementSize;
+    const size_t numBytes = numVectors * numBytesPerVector;
+    sys::Off_T offset = mChannelOffsets[channel] +
+            static_cast<sys::Off_T>(firstVector) * numBytesPerVector;
+
+    // Nothing to swap for big endian systems or 8-bit samples
+    if (sys::isBigEndianSystem() || mElementSize == 2)
+    {
+        mt::CriticalSection<sys::Mutex> crit(&mFileMutex);
+        mFile.seek(offset, io::Seekable::START);
+        mFile.write(reinterpret_cast<const sys::byte*>(data), numBytes);
+        return;
+    }
+
+    // Each caller swaps into its own scratch space so only the writes
+    // themselves are serialized.  The real and imaginary parts are swapped
+    // separately.
+    const size_t scratchSize = std::min(
+            numBytes, std::max<size_t>(mScratchSpaceSize / 8 * 8, 8));
+    const mem::ScopedArray<sys::ubyte> scratch(new sys::ubyte[scratchSize]);
+    const size_t swapSize = mElementSize / 2;
+
+    for (size_t dataProcessed = 0; dataProcessed < numBytes; )
+    {
+        const size_t dataToProcess =
+                std::min(scratchSize, numBytes - dataProcessed);
+        six::byteSwap(data + dataProcessed,
+                      swapSize,
+                      dataToProcess / swapSize,
+                      scratch.get());
+
+        {
+            mt::CriticalSection<sys::Mutex> crit(&mFileMutex);
+            mFile.seek(offset, io::Seekable::START);
+            mFile.write(reinterpret_cast<const sys::byte*>(scratch.get()),
+                        dataToProcess);
+        }
+
+        dataProcessed += dataToProcess;
+        offset += dataToProcess;
+    }
+}
+
 void CPHDWriter::writeMetadata(const std::string& pathname,
                                const VBM& vbm,
                                const std::string& classification,
@@ -222,6 +539,7 @@ void CPHDWriter::writeMetadata(const std::string& pathname,
     // Update the number of bytes per VBP
     mMetadata.data.numBytesVBP = vbm.getNumBytesVBP();
 
+    mDataWriter->flush();
     mFile.create(pathname);
 
     const size_t numChannels = vbm.getNumChannels();
@@ -246,6 +564,9 @@ void CPHDWriter::writeMetadata(const std::string& pathname,
             writeVBMData(&vbmData[0], ii);
         }
     }
+
+    // Make sure the VBM's in place in case blocks are written next
+    mDataWriter->flush();
 }
 
 template <typename T>
@@ -275,10 +596,47 @@ void CPHDWriter::writeCPHDData<std::complex<float> >(
         const std::complex<float>* data,
         size_t numElements);
 
+template <typename T>
+void CPHDWriter::writeCPHDData(const T* data,
+                               size_t channel,
+                               size_t firstVector,
+                               size_t numVectors)
+{
+    if (mElementSize != sizeof(T))
+    {
+        throw except::Exception(Ctxt(
+                "Incorrect buffer data type used for metadata!"));
+    }
+    writeCPHDDataImpl(reinterpret_cast<const sys::ubyte*>(data),
+                      channel, firstVector, numVectors);
+}
+
+template
+void CPHDWriter::writeCPHDData<std::complex<sys::Int8_T> >(
+        const std::complex<sys::Int8_T>* data,
+        size_t channel,
+        size_t firstVector,
+        size_t numVectors);
+
+template
+void CPHDWriter::writeCPHDData<std::complex<sys::Int16_T> >(
+        const std::complex<sys::Int16_T>* data,
+        size_t channel,
+        size_t firstVector,
+        size_t numVectors);
+
+template
+void CPHDWriter::writeCPHDData<std::complex<float> >(
+        const std::complex<float>* data,
+        size_t channel,
+        size_t firstVector,
+        size_t numVectors);
+
 void CPHDWriter::write(const std::string& pathname,
                        const std::string& classification,
                        const std::string& releaseInfo)
 {
+    mDataWriter->flush();
     mFile.create(pathname);
 
     writeMetadata(mVBMSize, mCPHDSize, classification, releaseInfo);
@@ -295,6 +653,6 @@ void CPHDWriter::write(const std::string& pathname,
         writeCPHDDataImpl(mCPHDData[ii], cphdDataSize);
     }
 
-    mFile.close();
+    close();
 }
 }
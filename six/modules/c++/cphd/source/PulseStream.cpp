@@ -0,0 +1,302 @@
+/* =========================================================================
+ * This file is part of cphd-c++
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2017, MDA Information Systems LLC
+ *
+ * cphd-c++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <algorithm>
+
+#include <except/Exception.h>
+#include <cphd/CPHDReader.h>
+#include <cphd/PulseStream.h>
+
+namespace cphd
+{
+PulseBlock::PulseBlock(const VBM& vbm,
+                       size_t channel,
+                       size_t numSamples,
+                       size_t numChannelVectors) :
+    mVBM(vbm),
+    mChannel(channel),
+    mNumSamples(numSamples),
+    mNumChannelVectors(numChannelVectors),
+    mFirstVector(0),
+    mNumVectors(0),
+    mElementSize(0),
+    mRaw(false)
+{
+}
+
+mem::BufferView<const sys::ubyte> PulseBlock::getRawData() const
+{
+    if (!mRaw)
+    {
+        throw except::Exception(Ctxt(
+                "Raw data is only available with RAW output"));
+    }
+
+    return mem::BufferView<const sys::ubyte>(
+            &mBuffer[0], mNumVectors * mNumSamples * mElementSize);
+}
+
+mem::BufferView<const std::complex<float> > PulseBlock::getData() const
+{
+    if (mRaw)
+    {
+        throw except::Exception(Ctxt(
+                "Complex float data is not available with RAW output"));
+    }
+
+    return mem::BufferView<const std::complex<float> >(
+            &mData[0], mNumVectors * mNumSamples);
+}
+
+mem::BufferView<const double> PulseBlock::getVBM(
+        mem::BufferView<const double> (VBM::*getter)(size_t) const) const
+{
+    const mem::BufferView<const double> values = (mVBM.*getter)(mChannel);
+    const size_t numValuesPerVector = values.size / mNumChannelVectors;
+    return mem::BufferView<const double>(
+            values.data + mFirstVector * numValuesPerVector,
+            mNumVectors * numValuesPerVector);
+}
+
+class PulseStream::PrefetchRunnable : public sys::Runnable
+{
+public:
+    PrefetchRunnable(PulseStream& stream) :
+        mStream(stream)
+    {
+    }
+
+    virtual void run()
+    {
+        for (size_t blockNum = 0; blockNum < mStream.mNumBlocks; ++blockNum)
+        {
+            PulseBlock* block;
+            mStream.mEmptyBlocks.dequeue(block);
+            if (block == NULL || mStream.mStop.get() != 0)
+            {
+                return;
+            }
+
+            mStream.readBlock(blockNum, *block);
+            mStream.mFilledBlocks.enqueue(block);
+
+            // Once a block fails there's no point in reading the rest
+            if (!block->mError.empty())
+            {
+                return;
+            }
+        }
+    }
+
+private:
+    PulseStream& mStream;
+};
+
+PulseStream::PulseStream(CPHDReader& reader,
+                         size_t channel,
+                         OutputType outputType,
+                         size_t numVectorsPerBlock,
+                         size_t numPrefetchBlocks,
+                         size_t firstVector,
+                         size_t lastVector,
+                         size_t firstSample,
+                         size_t lastSample,
+                         size_t numThreads) :
+    mWideband(reader.getWideband()),
+    mVBM(reader.getVBM()),
+    mChannel(channel),
+    mOutputType(outputType),
+    mNumVectorsPerBlock(numVectorsPerBlock),
+    mFirstVector(firstVector),
+    mFirstSample(firstSample),
+    mLastSample(lastSample),
+    mNumThreads(numThreads),
+    mPrefetch(numPrefetchBlocks > 0),
+    mNumVectors(0),
+    mNumBlocks(0),
+    mCurrentBlock(NULL),
+    mNextBlock(0)
+{
+    if (channel >= reader.getNumChannels())
+    {
+        throw except::Exception(Ctxt("Invalid channel number"));
+    }
+
+    if (numVectorsPerBlock == 0)
+    {
+        throw except::Exception(Ctxt("Need at least one vector per block"));
+    }
+
+    if (outputType == SCALED && !mVBM.haveAmpSF())
+    {
+        throw except::Exception(Ctxt(
+                "Scaled output requires AmpSF in the VBM"));
+    }
+
+    const types::RowCol<size_t> dims = mWideband.getBufferDims(
+            channel, firstVector, lastVector, firstSample, lastSample);
+    mNumVectors = dims.row;
+    mNumBlocks = (mNumVectors + numVectorsPerBlock - 1) / numVectorsPerBlock;
+
+    // The caller holds on to one block while we fill the others
+    const size_t numBlocks = std::min(numPrefetchBlocks + 1, mNumBlocks);
+    const size_t numVectors = std::min(numVectorsPerBlock, mNumVectors);
+    const size_t numPixels = numVectors * dims.col;
+    const size_t elementSize = reader.getNumBytesPerSample();
+
+    // Float samples can be read straight into the output if they don't need
+    // to be scaled
+    const bool needBuffer = (outputType != PROMOTED ||
+                             elementSize != sizeof(std::complex<float>));
+
+    for (size_t ii = 0; ii < numBlocks; ++ii)
+    {
+        mem::SharedPtr<PulseBlock> block(new PulseBlock(
+                mVBM, channel, dims.col, reader.getNumVectors(channel)));
+        block->mElementSize = elementSize;
+        block->mRaw = (outputType == RAW);
+        if (needBuffer)
+        {
+            block->mBuffer.resize(numPixels * elementSize);
+        }
+        if (outputType != RAW)
+        {
+            block->mData.resize(numPixels);
+        }
+
+        mBlocks.push_back(block);
+        mEmptyBlocks.enqueue(block.get());
+    }
+
+    if (mPrefetch && mNumBlocks > 0)
+    {
+        mThreads.createThread(new PrefetchRunnable(*this));
+    }
+}
+
+PulseStream::~PulseStream()
+{
+    // Tell the prefetch thread to stop, waking it up if it's waiting for an
+    // empty block
+    mStop.increment();
+    mEmptyBlocks.enqueue(NULL);
+
+    try
+    {
+        mThreads.joinAll();
+    }
+    catch (...)
+    {
+        // Make sure we don't throw out of the destructor
+    }
+}
+
+void PulseStream::readBlock(size_t blockNum, PulseBlock& block)
+{
+    const size_t vector = blockNum * mNumVectorsPerBlock;
+    block.mFirstVector = mFirstVector + vector;
+    block.mNumVectors = std::min(mNumVectorsPerBlock, mNumVectors - vector);
+    block.mError.clear();
+
+    const size_t lastVector = block.mFirstVector + block.mNumVectors - 1;
+    const mem::BufferView<sys::ubyte> buffer(
+            block.mBuffer.empty() ? NULL : &block.mBuffer[0],
+            block.mBuffer.size());
+
+    try
+    {
+        if (mOutputType == RAW)
+        {
+            mWideband.read(mChannel, block.mFirstVector, lastVector,
+                           mFirstSample, mLastSample, mNumThreads, buffer);
+        }
+        else
+        {
+            // Wideband::read() wants exactly one scale factor per vector
+            std::vector<double>& scaleFactors = block.mScaleFactors;
+            scaleFactors.resize(block.mNumVectors);
+            if (mOutputType == SCALED)
+            {
+                const mem::BufferView<const double> ampSFs =
+                        block.getVBM(&VBM::getAmpSFs);
+                std::copy(ampSFs.data, ampSFs.data + ampSFs.size,
+                          scaleFactors.begin());
+            }
+            else
+            {
+                std::fill(scaleFactors.begin(), scaleFactors.end(), 1.0);
+            }
+
+            mWideband.read(mChannel, block.mFirstVector, lastVector,
+                           mFirstSample, mLastSample, scaleFactors,
+                           mNumThreads, buffer,
+                           mem::BufferView<std::complex<float> >(
+                                   &block.mData[0], block.mData.size()));
+        }
+    }
+    catch (const except::Exception& ex)
+    {
+        block.mError = ex.getMessage();
+    }
+    catch (const std::exception& ex)
+    {
+        block.mError = ex.what();
+    }
+}
+
+const PulseBlock* PulseStream::next()
+{
+    if (mCurrentBlock != NULL)
+    {
+        mEmptyBlocks.enqueue(mCurrentBlock);
+        mCurrentBlock = NULL;
+    }
+
+    if (mNextBlock >= mNumBlocks)
+    {
+        return NULL;
+    }
+
+    PulseBlock* block;
+    if (mPrefetch)
+    {
+        mFilledBlocks.dequeue(block);
+    }
+    else
+    {
+        mEmptyBlocks.dequeue(block);
+        readBlock(mNextBlock, *block);
+    }
+
+    mCurrentBlock = block;
+    ++mNextBlock;
+
+    if (!block->mError.empty())
+    {
+        // Nothing past this block will be read
+        mNextBlock = mNumBlocks;
+        throw except::Exception(Ctxt(block->mError));
+    }
+
+    return block;
+}
+}
@@ -23,243 +23,13 @@
 #include <sstream>
 #include <string.h>
 
+#include <mt/CriticalSection.h>
 #include <six/Init.h>
 #include <cphd/ByteSwap.h>
 #include <cphd/VBM.h>
 
-namespace
-{
-inline void setData(const sys::byte*& data,
-                    double& dest)
-{
-    memcpy(&dest, data, sizeof(double));
-    data += sizeof(double); 
-}
-
-inline void setData(const sys::byte*& data,
-                    cphd::Vector3& dest)
-{
-    setData(data, dest[0]);
-    setData(data, dest[1]);
-    setData(data, dest[2]);
-}
-
-inline void getData(double value,
-                    sys::ubyte*& dest)
-{
-    memcpy(dest, &value, sizeof(double));
-    dest += sizeof(double);
-}
-
-inline void getData(const cphd::Vector3& value,
-                    sys::ubyte*& dest)
-{
-    getData(value[0], dest);
-    getData(value[1], dest);
-    getData(value[2], dest);
-}
-}
-
 namespace cphd
 {
-VBM::FrequencyParameters::FrequencyParameters() :
-    fx0(0.0),
-    fxSS(0.0),
-    fx1(0.0),
-    fx2(0.0)
-{
-}
-
-VBM::TOAParameters::TOAParameters() :
-    deltaTOA0(0.0),
-    toaSS(0.0)
-{
-}
-
-VBM::VectorBasedParameters::VectorBasedParameters(
-        bool srpTimeEnabled,
-        bool tropoSrpEnabled,
-        bool ampSFEnabled,
-        DomainType domainType) :
-    txTime(0.0),
-    txPos(0.0),
-    rcvTime(0.0),
-    rcvPos(0.0),
-    srpTime(srpTimeEnabled ? 0.0 : six::Init::undefined<double>()),
-    srpPos(0.0),
-    tropoSrp(tropoSrpEnabled ? 0.0 : six::Init::undefined<double>()),
-    ampSF(ampSFEnabled ? 0.0 : six::Init::undefined<double>()),
-    frequencyParameters(domainType == DomainType::FX ?
-            new FrequencyParameters() : NULL),
-    toaParameters(domainType == DomainType::TOA ?
-            new TOAParameters() : NULL)
-{
-}
-
-size_t VBM::VectorBasedParameters::getNumBytes() const
-{
-    size_t ret = 11 * sizeof(double);
-    if (!six::Init::isUndefined<double>(srpTime))
-    {
-        ret += sizeof(srpTime);
-    }
-    if (!six::Init::isUndefined<double>(tropoSrp))
-    {
-        ret += sizeof(tropoSrp);
-    }
-    if (!six::Init::isUndefined<double>(ampSF))
-    {
-        ret += sizeof(ampSF);
-    }
-
-    if (frequencyParameters.get())
-    {
-        ret += sizeof(FrequencyParameters);
-    }
-    else if (toaParameters.get())
-    {
-        ret += sizeof(TOAParameters);
-    }
-    return ret;
-}
-
-void VBM::VectorBasedParameters::getData(sys::ubyte* data) const
-{
-    //! This uses memcpy's here because on Sun these addresses may not be
-    //  8 byte aligned. So trying to derefence data as a double results in
-    //  a crash.
-    ::getData(txTime, data);
-    ::getData(txPos, data);
-    ::getData(rcvTime, data);
-    ::getData(rcvPos, data);
-    if (!six::Init::isUndefined<double>(srpTime))
-    {
-        ::getData(srpTime, data);
-    }
-    ::getData(srpPos, data);
-    if (!six::Init::isUndefined<double>(tropoSrp))
-    {
-        ::getData(tropoSrp, data);
-    }
-    if (!six::Init::isUndefined<double>(ampSF))
-    {
-        ::getData(ampSF, data);
-    }
-    if (frequencyParameters.get())
-    {
-        ::getData(frequencyParameters->fx0, data);
-        ::getData(frequencyParameters->fxSS, data);
-        ::getData(frequencyParameters->fx1, data);
-        ::getData(frequencyParameters->fx2, data);
-    }
-    else if (toaParameters.get())
-    {
-        ::getData(toaParameters->deltaTOA0, data);
-        ::getData(toaParameters->toaSS, data);
-    }
-}
-
-void VBM::VectorBasedParameters::setData(const sys::byte* data)
-{
-    //! This uses memcpy's here because on Sun these addresses may not be
-    //  8 byte aligned. So trying to derefence data as a double results in
-    //  a crash.
-    ::setData(data, txTime);
-    ::setData(data, txPos);
-    ::setData(data, rcvTime);
-    ::setData(data, rcvPos);
-    if (!six::Init::isUndefined<double>(srpTime))
-    {
-        ::setData(data, srpTime);
-    }
-    ::setData(data, srpPos);
-    if (!six::Init::isUndefined<double>(tropoSrp))
-    {
-        ::setData(data, tropoSrp);
-    }
-    if (!six::Init::isUndefined<double>(ampSF))
-    {
-        ::setData(data, ampSF);
-    }
-    if (frequencyParameters.get())
-    {
-        ::setData(data, frequencyParameters->fx0);
-        ::setData(data, frequencyParameters->fxSS);
-        ::setData(data, frequencyParameters->fx1);
-        ::setData(data, frequencyParameters->fx2);
-    }
-    else if (toaParameters.get())
-    {
-        ::setData(data, toaParameters->deltaTOA0);
-        ::setData(data, toaParameters->toaSS);
-    }
-}
-
-bool VBM::VectorBasedParameters::operator==(
-        const VBM::VectorBasedParameters& other) const
-{
-    if (txTime != other.txTime ||
-        txPos != other.txPos ||
-        rcvTime != other.rcvTime ||
-        rcvPos != other.rcvPos ||
-        srpPos != other.srpPos)
-    {
-        return false;
-    }
-
-    if (!six::Init::isUndefined<double>(srpTime) ||
-        !six::Init::isUndefined<double>(other.srpTime))
-    {
-        if (srpTime != other.srpTime)
-        {
-            return false;
-        }
-    }
-
-    if (!six::Init::isUndefined<double>(tropoSrp) ||
-        !six::Init::isUndefined<double>(other.tropoSrp))
-    {
-        if (tropoSrp != other.tropoSrp)
-        {
-            return false;
-        }
-    }
-
-    if (!six::Init::isUndefined<double>(ampSF) ||
-        !six::Init::isUndefined<double>(other.ampSF))
-    {
-        if (ampSF != other.ampSF)
-        {
-            return false;
-        }
-    }
-
-    if (frequencyParameters.get() && other.frequencyParameters.get())
-    {
-        if (*frequencyParameters != *other.frequencyParameters)
-        {
-            return false;
-        }
-    }
-    else if (frequencyParameters.get() || other.frequencyParameters.get())
-    {
-        return false;
-    }
-
-    if (toaParameters.get() && other.toaParameters.get())
-    {
-        if (*toaParameters != *other.toaParameters)
-        {
-            return false;
-        }
-    }
-    else if (toaParameters.get() || other.toaParameters.get())
-    {
-        return false;
-    }
-    return true;
-}
-
 VBM::VBM() :
     mSRPTimeEnabled(false),
     mTropoSRPEnabled(false),
@@ -276,27 +46,22 @@ VBM::VBM(const Data& data, const VectorParameters &vp) :
     mDomainType(vp.fxParameters.get() ? DomainType::FX :
             vp.toaParameters.get() ? DomainType::TOA : DomainType::NOT_SET),
     mNumBytesPerVector(data.getNumBytesVBP()),
-    mData(data.numCPHDChannels)
+    mChannels(data.numCPHDChannels)
 {
-    const VectorBasedParameters copy(mSRPTimeEnabled,
-                                     mTropoSRPEnabled,
-                                     mAmpSFEnabled,
-                                     mDomainType);
-
+    std::vector<size_t> numVectors(data.numCPHDChannels);
     for (size_t ii = 0; ii < data.numCPHDChannels; ++ii)
     {
-        mData[ii].resize(data.getNumVectors(ii), copy);
+        numVectors[ii] = data.getNumVectors(ii);
     }
+    setupInitialData(data.numCPHDChannels, numVectors);
 
-    if (!mData.empty() && !mData[0].empty())
+    // The file may allot more bytes per vector than we need
+    const size_t numBytesVBP = data.getNumBytesVBP();
+    if (!mChannels.empty() && mChannels[0].numVectors > 0 &&
+        !six::Init::isUndefined<size_t>(numBytesVBP) &&
+        numBytesVBP > mNumBytesPerVector)
     {
-        const size_t calculateBytesPerVector =
-                mData[0][0].getNumBytes();
-        if (six::Init::isUndefined<size_t>(mNumBytesPerVector) ||
-            calculateBytesPerVector > mNumBytesPerVector)
-        {
-            mNumBytesPerVector = calculateBytesPerVector;
-        }
+        mNumBytesPerVector = numBytesVBP;
     }
 }
 
@@ -311,7 +76,7 @@ VBM::VBM(size_t numChannels,
     mAmpSFEnabled(ampSFEnabled),
     mDomainType(domainType),
     mNumBytesPerVector(0),
-    mData(numChannels)
+    mChannels(numChannels)
 {
     setupInitialData(numChannels, numVectors);
 }
@@ -328,7 +93,7 @@ VBM::VBM(size_t numChannels,
     mAmpSFEnabled(ampSFEnabled),
     mDomainType(domainType),
     mNumBytesPerVector(0),
-    mData(numChannels)
+    mChannels(numChannels)
 {
     //! Make sure there is enough data for each channel
     if (numChannels != data.size())
@@ -341,28 +106,219 @@ VBM::VBM(size_t numChannels,
     setupInitialData(numChannels, numVectors);
 
     //! For each channel
-    for (size_t ii = 0; ii < mData.size(); ++ii)
+    for (size_t ii = 0; ii < mChannels.size(); ++ii)
+    {
+        setChannelData(ii, static_cast<const sys::byte*>(data[ii]));
+    }
+}
+
+bool VBM::haveField(Field field) const
+{
+    switch (field)
     {
-        const sys::byte* ptr = static_cast<const sys::byte*>(data[ii]);
+    case SRP_TIME:
+        return mSRPTimeEnabled;
+    case TROPO_SRP:
+        return mTropoSRPEnabled;
+    case AMP_SF:
+        return mAmpSFEnabled;
+    case FX0:
+    case FX_SS:
+    case FX1:
+    case FX2:
+        return (mDomainType == DomainType::FX);
+    case DELTA_TOA0:
+    case TOA_SS:
+        return (mDomainType == DomainType::TOA);
+    default:
+        return true;
+    }
+}
 
-        //! For each vector
-        for (size_t jj = 0;
-             jj < mData[ii].size();
-             ++jj, ptr += mNumBytesPerVector)
+size_t VBM::getFieldOffset(Field field) const
+{
+    size_t offset(0);
+    for (size_t ii = 0; ii < static_cast<size_t>(field); ++ii)
+    {
+        const Field previous = static_cast<Field>(ii);
+        if (haveField(previous))
         {
-            mData[ii][jj].setData(ptr);
+            offset += getFieldSize(previous) * sizeof(double);
         }
     }
+    return offset;
 }
 
-void VBM::verifyChannelVector(size_t channel, size_t vector) const
+size_t VBM::computeNumBytesPerVector() const
 {
-    if (channel >= mData.size())
+    return getFieldOffset(NUM_FIELDS);
+}
+
+std::vector<double>& VBM::getField(Field field,
+                                   size_t channel,
+                                   const char* errorMessage) const
+{
+    if (!haveField(field))
+    {
+        throw except::Exception(Ctxt(errorMessage));
+    }
+
+    const ChannelData& channelData = mChannels[channel];
+    std::vector<double>& values = channelData.fields[field];
+
+    // Only the first access to a mapped field needs the lock
+    LoadedFlag& loaded = channelData.loaded[field];
+    if (mMappedFile.get() && !loaded.isSet())
+    {
+        mt::CriticalSection<sys::Mutex> crit(&mMappedFile->mutex);
+        if (!loaded.isSet())
+        {
+            if (values.empty() && channelData.mapped)
+            {
+                // Gather this field from each vector, then swap them all at
+                // once
+                const size_t fieldSize = getFieldSize(field);
+                values.resize(channelData.numVectors * fieldSize);
+
+                const sys::ubyte* src =
+                        channelData.mapped + getFieldOffset(field);
+                for (size_t ii = 0;
+                     ii < channelData.numVectors;
+                     ++ii, src += mNumBytesPerVector)
+                {
+                    memcpy(&values[ii * fieldSize], src,
+                           fieldSize * sizeof(double));
+                }
+
+                // Input CPHD is always Big Endian; swap to Little Endian if
+                // necessary
+                if (!sys::isBigEndianSystem() && !values.empty())
+                {
+                    byteSwap(&values[0], sizeof(double), values.size(), 1);
+                }
+            }
+            loaded.set();
+        }
+    }
+
+    return values;
+}
+
+mem::BufferView<const double>
+VBM::getFieldView(Field field, size_t channel, const char* errorMessage) const
+{
+    verifyChannel(channel);
+    const std::vector<double>& values =
+            getField(field, channel, errorMessage);
+    return mem::BufferView<const double>(
+            values.empty() ? NULL : &values[0], values.size());
+}
+
+double VBM::getValue(Field field,
+                     size_t channel,
+                     size_t vector,
+                     const char* errorMessage) const
+{
+    verifyChannelVector(channel, vector);
+    return getField(field, channel, errorMessage)[vector];
+}
+
+Vector3 VBM::getVector(Field field, size_t channel, size_t vector) const
+{
+    verifyChannelVector(channel, vector);
+    const double* const values =
+            &getField(field, channel, "Invalid position.")[vector * 3];
+
+    Vector3 ret;
+    ret[0] = values[0];
+    ret[1] = values[1];
+    ret[2] = values[2];
+    return ret;
+}
+
+void VBM::setValue(double value,
+                   Field field,
+                   size_t channel,
+                   size_t vector,
+                   const char* errorMessage)
+{
+    verifyChannelVector(channel, vector);
+    getField(field, channel, errorMessage)[vector] = value;
+}
+
+void VBM::setVector(const Vector3& value,
+                    Field field,
+                    size_t channel,
+                    size_t vector)
+{
+    verifyChannelVector(channel, vector);
+    double* const values =
+            &getField(field, channel, "Invalid position.")[vector * 3];
+    values[0] = value[0];
+    values[1] = value[1];
+    values[2] = value[2];
+}
+
+void VBM::setChannelData(size_t channel, const sys::byte* data)
+{
+    //! This uses memcpy's here because on Sun these addresses may not be
+    //  8 byte aligned. So trying to derefence data as a double results in
+    //  a crash.
+    ChannelData& channelData = mChannels[channel];
+    for (size_t ii = 0; ii < NUM_FIELDS; ++ii)
+    {
+        const Field field = static_cast<Field>(ii);
+        if (haveField(field))
+        {
+            const size_t fieldSize = getFieldSize(field);
+            std::vector<double>& values = channelData.fields[field];
+            values.resize(channelData.numVectors * fieldSize);
+
+            const sys::byte* src = data + getFieldOffset(field);
+            for (size_t jj = 0;
+                 jj < channelData.numVectors;
+                 ++jj, src += mNumBytesPerVector)
+            {
+                memcpy(&values[jj * fieldSize], src,
+                       fieldSize * sizeof(double));
+            }
+        }
+    }
+}
+
+void VBM::unmap()
+{
+    if (mMappedFile.get())
+    {
+        for (size_t ii = 0; ii < mChannels.size(); ++ii)
+        {
+            for (size_t jj = 0; jj < NUM_FIELDS; ++jj)
+            {
+                const Field field = static_cast<Field>(jj);
+                if (haveField(field))
+                {
+                    getField(field, ii, "");
+                }
+            }
+            mChannels[ii].mapped = NULL;
+        }
+        mMappedFile.reset();
+    }
+}
+
+void VBM::verifyChannel(size_t channel) const
+{
+    if (channel >= mChannels.size())
     {
         throw except::Exception(Ctxt(
                 "Invalid channel number: " + str::toString<size_t>(channel)));
     }
-    if (vector >= mData[channel].size())
+}
+
+void VBM::verifyChannelVector(size_t channel, size_t vector) const
+{
+    verifyChannel(channel);
+    if (vector >= mChannels[channel].numVectors)
     {
         throw except::Exception(Ctxt(
                 "Invalid vector number: " + str::toString<size_t>(vector)));
@@ -377,273 +333,249 @@ void VBM::setupInitialData(size_t numChannels,
         throw except::Exception(Ctxt("Invalid numVectors parameter: "
                 "You must pass a vector sized to the number of channels"));
     }
-    const VectorBasedParameters copy(mSRPTimeEnabled,
-                                     mTropoSRPEnabled,
-                                     mAmpSFEnabled,
-                                     mDomainType);
 
     for (size_t ii = 0; ii < numChannels; ++ii)
     {
-        mData[ii].resize(numVectors[ii], copy);
+        ChannelData& channelData = mChannels[ii];
+        channelData.numVectors = numVectors[ii];
+        for (size_t jj = 0; jj < NUM_FIELDS; ++jj)
+        {
+            const Field field = static_cast<Field>(jj);
+            if (haveField(field))
+            {
+                channelData.fields[field].resize(
+                        numVectors[ii] * getFieldSize(field), 0.0);
+            }
+        }
     }
 
-    if (!mData.empty() && !mData[0].empty())
+    if (!mChannels.empty() && mChannels[0].numVectors > 0)
     {
-        mNumBytesPerVector = mData[0][0].getNumBytes();
+        mNumBytesPerVector = computeNumBytesPerVector();
     }
 }
 
 double VBM::getTxTime(size_t channel, size_t vector) const
 {
-    verifyChannelVector(channel, vector);
-    return mData[channel][vector].txTime;
+    return getValue(TX_TIME, channel, vector, "Invalid TxTime.");
 }
 
 Vector3 VBM::getTxPos(size_t channel, size_t vector) const
 {
-    verifyChannelVector(channel, vector);
-    return mData[channel][vector].txPos;
+    return getVector(TX_POS, channel, vector);
 }
 
 double VBM::getRcvTime(size_t channel, size_t vector) const
 {
-    verifyChannelVector(channel, vector);
-    return mData[channel][vector].rcvTime;
+    return getValue(RCV_TIME, channel, vector, "Invalid RcvTime.");
 }
 
 Vector3 VBM::getRcvPos(size_t channel, size_t vector) const
 {
-    verifyChannelVector(channel, vector);
-    return mData[channel][vector].rcvPos;
+    return getVector(RCV_POS, channel, vector);
 }
 
 double VBM::getSRPTime(size_t channel, size_t vector) const
 {
-    verifyChannelVector(channel, vector);
-    if (!mSRPTimeEnabled)
-    {
-        throw except::Exception(Ctxt("Invalid SRP time."));
-    }
-    return mData[channel][vector].srpTime;
+    return getValue(SRP_TIME, channel, vector, "Invalid SRP time.");
 }
 
 Vector3 VBM::getSRPPos(size_t channel, size_t vector) const
 {
-    verifyChannelVector(channel, vector);
-    return mData[channel][vector].srpPos;
+    return getVector(SRP_POS, channel, vector);
 }
 
 double VBM::getTropoSRP(size_t channel, size_t vector) const
 {
-    verifyChannelVector(channel, vector);
-    if (!mTropoSRPEnabled)
-    {
-        throw except::Exception(Ctxt("Invalid TropoSRP."));
-    }
-    return mData[channel][vector].tropoSrp;
+    return getValue(TROPO_SRP, channel, vector, "Invalid TropoSRP.");
 }
 
 double VBM::getAmpSF(size_t channel, size_t vector) const
 {
-    verifyChannelVector(channel, vector);
-    if (!mAmpSFEnabled)
-    {
-        throw except::Exception(Ctxt("Invalid AmpSF."));
-    }
-    return mData[channel][vector].ampSF;
+    return getValue(AMP_SF, channel, vector, "Invalid AmpSF.");
 }
 
 double VBM::getFx0(size_t channel, size_t vector) const
 {
-    verifyChannelVector(channel, vector);
-    if (mDomainType != DomainType::FX)
-    {
-        throw except::Exception(Ctxt("Invalid Fx0."));
-    }
-    return mData[channel][vector].frequencyParameters->fx0;
+    return getValue(FX0, channel, vector, "Invalid Fx0.");
 }
 
 double VBM::getFxSS(size_t channel, size_t vector) const
 {
-    verifyChannelVector(channel, vector);
-    if (mDomainType != DomainType::FX)
-    {
-        throw except::Exception(Ctxt("Invalid FxSS."));
-    }
-    return mData[channel][vector].frequencyParameters->fxSS;
+    return getValue(FX_SS, channel, vector, "Invalid FxSS.");
 }
 
 double VBM::getFx1(size_t channel, size_t vector) const
 {
-    verifyChannelVector(channel, vector);
-    if (mDomainType != DomainType::FX)
-    {
-        throw except::Exception(Ctxt("Invalid Fx1."));
-    }
-    return mData[channel][vector].frequencyParameters->fx1;
+    return getValue(FX1, channel, vector, "Invalid Fx1.");
 }
 
 double VBM::getFx2(size_t channel, size_t vector) const
 {
-    verifyChannelVector(channel, vector);
-    if (mDomainType != DomainType::FX)
-    {
-        throw except::Exception(Ctxt("Invalid Fx2."));
-    }
-    return mData[channel][vector].frequencyParameters->fx2;
+    return getValue(FX2, channel, vector, "Invalid Fx2.");
 }
 
 double VBM::getDeltaTOA0(size_t channel, size_t vector) const
 {
-    verifyChannelVector(channel, vector);
-    if (mDomainType != DomainType::TOA)
-    {
-        throw except::Exception(Ctxt("Invalid DeltaTOA0."));
-    }
-    return mData[channel][vector].toaParameters->deltaTOA0;
+    return getValue(DELTA_TOA0, channel, vector, "Invalid DeltaTOA0.");
 }
 
 double VBM::getTOASS(size_t channel, size_t vector) const
 {
-    verifyChannelVector(channel, vector);
-    if (mDomainType != DomainType::TOA)
-    {
-        throw except::Exception(Ctxt("Invalid TOA_SS."));
-    }
-    return mData[channel][vector].toaParameters->toaSS;
+    return getValue(TOA_SS, channel, vector, "Invalid TOA_SS.");
 }
 
 void VBM::setTxTime(double value, size_t channel, size_t vector)
 {
-    verifyChannelVector(channel, vector);
-    mData[channel][vector].txTime = value;
+    setValue(value, TX_TIME, channel, vector, "Invalid TxTime.");
 }
 
 void VBM::setTxPos(const Vector3& value, size_t channel, size_t vector)
 {
-    verifyChannelVector(channel, vector);
-    mData[channel][vector].txPos = value;
+    setVector(value, TX_POS, channel, vector);
 }
 
 void VBM::setRcvTime(double value, size_t channel, size_t vector)
 {
-    verifyChannelVector(channel, vector);
-    mData[channel][vector].rcvTime = value;
+    setValue(value, RCV_TIME, channel, vector, "Invalid RcvTime.");
 }
 
 void VBM::setRcvPos(const Vector3& value, size_t channel, size_t vector)
 {
-    verifyChannelVector(channel, vector);
-    mData[channel][vector].rcvPos = value;
+    setVector(value, RCV_POS, channel, vector);
 }
 
 void VBM::setSRPTime(double value, size_t channel, size_t vector)
 {
-    verifyChannelVector(channel, vector);
-    if (!mSRPTimeEnabled)
-    {
-        throw except::Exception(Ctxt("Invalid SRPTime."));
-    }
-    mData[channel][vector].srpTime = value;
+    setValue(value, SRP_TIME, channel, vector, "Invalid SRPTime.");
 }
 
 void VBM::setSRPPos(const Vector3& value, size_t channel, size_t vector)
 {
-    verifyChannelVector(channel, vector);
-    mData[channel][vector].srpPos = value;
+    setVector(value, SRP_POS, channel, vector);
 }
 
 void VBM::setTropoSRP(double value, size_t channel, size_t vector)
 {
-    verifyChannelVector(channel, vector);
-    if (!mTropoSRPEnabled)
-    {
-        throw except::Exception(Ctxt("Invalid TropoSRP."));
-    }
-    mData[channel][vector].tropoSrp = value;
+    setValue(value, TROPO_SRP, channel, vector, "Invalid TropoSRP.");
 }
 
 void VBM::setAmpSF(double value, size_t channel, size_t vector)
 {
-    verifyChannelVector(channel, vector);
-    if (!mAmpSFEnabled)
-    {
-        throw except::Exception(Ctxt("Invalid AmpSF."));
-    }
-    mData[channel][vector].ampSF = value;
+    setValue(value, AMP_SF, channel, vector, "Invalid AmpSF.");
 }
 
 void VBM::setFx0(double value, size_t channel, size_t vector)
 {
-    verifyChannelVector(channel, vector);
-    if (mDomainType != DomainType::FX)
-    {
-        throw except::Exception(Ctxt("Invalid Fx0."));
-    }
-    mData[channel][vector].frequencyParameters->fx0 = value;
+    setValue(value, FX0, channel, vector, "Invalid Fx0.");
 }
 
 void VBM::setFxSS(double value, size_t channel, size_t vector)
 {
-    verifyChannelVector(channel, vector);
-    if (mDomainType != DomainType::FX)
-    {
-        throw except::Exception(Ctxt("Invalid FxSS."));
-    }
-    mData[channel][vector].frequencyParameters->fxSS = value;
+    setValue(value, FX_SS, channel, vector, "Invalid FxSS.");
 }
 
 void VBM::setFx1(double value, size_t channel, size_t vector)
 {
-    verifyChannelVector(channel, vector);
-    if (mDomainType != DomainType::FX)
-    {
-        throw except::Exception(Ctxt("Invalid Fx1."));
-    }
-    mData[channel][vector].frequencyParameters->fx1 = value;
+    setValue(value, FX1, channel, vector, "Invalid Fx1.");
 }
 
 void VBM::setFx2(double value, size_t channel, size_t vector)
 {
-    verifyChannelVector(channel, vector);
-    if (mDomainType != DomainType::FX)
-    {
-        throw except::Exception(Ctxt("Invalid Fx2."));
-    }
-    mData[channel][vector].frequencyParameters->fx2 = value;
+    setValue(value, FX2, channel, vector, "Invalid Fx2.");
 }
 
 void VBM::setDeltaTOA0(double value, size_t channel, size_t vector)
 {
-    verifyChannelVector(channel, vector);
-    if (mDomainType != DomainType::TOA)
-    {
-        throw except::Exception(Ctxt("Invalid DeltaTOA0."));
-    }
-    mData[channel][vector].toaParameters->deltaTOA0 = value;
+    setValue(value, DELTA_TOA0, channel, vector, "Invalid DeltaTOA0.");
 }
 
 void VBM::setTOASS(double value, size_t channel, size_t vector)
 {
-    verifyChannelVector(channel, vector);
-    if (mDomainType != DomainType::TOA)
-    {
-        throw except::Exception(Ctxt("Invalid TOA_SS."));
-    }
-    mData[channel][vector].toaParameters->toaSS = value;
+    setValue(value, TOA_SS, channel, vector, "Invalid TOA_SS.");
+}
+
+mem::BufferView<const double> VBM::getTxTimes(size_t channel) const
+{
+    return getFieldView(TX_TIME, channel, "Invalid TxTime.");
+}
+
+mem::BufferView<const double> VBM::getTxPositions(size_t channel) const
+{
+    return getFieldView(TX_POS, channel, "Invalid TxPos.");
+}
+
+mem::BufferView<const double> VBM::getRcvTimes(size_t channel) const
+{
+    return getFieldView(RCV_TIME, channel, "Invalid RcvTime.");
+}
+
+mem::BufferView<const double> VBM::getRcvPositions(size_t channel) const
+{
+    return getFieldView(RCV_POS, channel, "Invalid RcvPos.");
+}
+
+mem::BufferView<const double> VBM::getSRPTimes(size_t channel) const
+{
+    return getFieldView(SRP_TIME, channel, "Invalid SRP time.");
+}
+
+mem::BufferView<const double> VBM::getSRPPositions(size_t channel) const
+{
+    return getFieldView(SRP_POS, channel, "Invalid SRPPos.");
+}
+
+mem::BufferView<const double> VBM::getTropoSRPs(size_t channel) const
+{
+    return getFieldView(TROPO_SRP, channel, "Invalid TropoSRP.");
+}
+
+mem::BufferView<const double> VBM::getAmpSFs(size_t channel) const
+{
+    return getFieldView(AMP_SF, channel, "Invalid AmpSF.");
+}
+
+mem::BufferView<const double> VBM::getFx0s(size_t channel) const
+{
+    return getFieldView(FX0, channel, "Invalid Fx0.");
+}
+
+mem::BufferView<const double> VBM::getFxSSs(size_t channel) const
+{
+    return getFieldView(FX_SS, channel, "Invalid FxSS.");
+}
+
+mem::BufferView<const double> VBM::getFx1s(size_t channel) const
+{
+    return getFieldView(FX1, channel, "Invalid Fx1.");
+}
+
+mem::BufferView<const double> VBM::getFx2s(size_t channel) const
+{
+    return getFieldView(FX2, channel, "Invalid Fx2.");
+}
+
+mem::BufferView<const double> VBM::getDeltaTOA0s(size_t channel) const
+{
+    return getFieldView(DELTA_TOA0, channel, "Invalid DeltaTOA0.");
+}
+
+mem::BufferView<const double> VBM::getTOASSs(size_t channel) const
+{
+    return getFieldView(TOA_SS, channel, "Invalid TOA_SS.");
 }
 
 void VBM::clearAmpSF()
 {
     if (mAmpSFEnabled)
     {
+        // The remaining fields will no longer line up with the file
+        unmap();
+
         // Remove all the data corresponding to ampSF
-        for (size_t ii = 0; ii < mData.size(); ++ii)
+        for (size_t ii = 0; ii < mChannels.size(); ++ii)
         {
-            for (size_t jj = 0; jj < mData[ii].size(); ++jj)
-            {
-                mData[ii][jj].ampSF = six::Init::undefined<double>();
-            }
+            std::vector<double>().swap(mChannels[ii].fields[AMP_SF]);
         }
 
         mAmpSFEnabled = false;
@@ -666,20 +598,74 @@ void VBM::getVBMdata(size_t channel,
 {
     verifyChannelVector(channel, 0);
     const size_t numBytes = getNumBytesVBP();
-    sys::ubyte* ptr = static_cast<sys::ubyte*>(data);
+    const size_t numVectors = mChannels[channel].numVectors;
+
+    // Vectors may be padded out to more bytes than the fields take up
+    const size_t numFieldBytes = computeNumBytesPerVector();
+    if (numBytes > numFieldBytes)
+    {
+        sys::ubyte* ptr = static_cast<sys::ubyte*>(data) + numFieldBytes;
+        for (size_t jj = 0; jj < numVectors; ++jj, ptr += numBytes)
+        {
+            memset(ptr, 0, numBytes - numFieldBytes);
+        }
+    }
 
-    for (size_t ii = 0;
-         ii < mData[channel].size();
-         ++ii, ptr += numBytes)
+    for (size_t ii = 0; ii < NUM_FIELDS; ++ii)
     {
-        mData[channel][ii].getData(ptr);
+        const Field field = static_cast<Field>(ii);
+        if (haveField(field))
+        {
+            const size_t fieldSize = getFieldSize(field);
+            const std::vector<double>& values = getField(field, channel, "");
+
+            sys::ubyte* ptr =
+                    static_cast<sys::ubyte*>(data) + getFieldOffset(field);
+            for (size_t jj = 0; jj < numVectors; ++jj, ptr += numBytes)
+            {
+                memcpy(ptr, &values[jj * fieldSize],
+                       fieldSize * sizeof(double));
+            }
+        }
     }
 }
 
 size_t VBM::getVBMsize(size_t channel) const
 {
     verifyChannelVector(channel, 0);
-    return getNumBytesVBP() * mData[channel].size();
+    return getNumBytesVBP() * mChannels[channel].numVectors;
+}
+
+bool VBM::operator==(const VBM& other) const
+{
+    if (mSRPTimeEnabled != other.mSRPTimeEnabled ||
+        mTropoSRPEnabled != other.mTropoSRPEnabled ||
+        mAmpSFEnabled != other.mAmpSFEnabled ||
+        mDomainType != other.mDomainType ||
+        mNumBytesPerVector != other.mNumBytesPerVector ||
+        mChannels.size() != other.mChannels.size())
+    {
+        return false;
+    }
+
+    for (size_t ii = 0; ii < mChannels.size(); ++ii)
+    {
+        if (mChannels[ii].numVectors != other.mChannels[ii].numVectors)
+        {
+            return false;
+        }
+
+        for (size_t jj = 0; jj < NUM_FIELDS; ++jj)
+        {
+            const Field field = static_cast<Field>(jj);
+            if (haveField(field) &&
+                getField(field, ii, "") != other.getField(field, ii, ""))
+            {
+                return false;
+            }
+        }
+    }
+    return true;
 }
 
 void VBM::updateVectorParameters(VectorParameters& vp) const
@@ -728,7 +714,7 @@ sys::Off_T VBM::load(io::SeekableInputStream& inStream,
     size_t numBytesIn(0);
 
     // Compute the VBM size per channel (channels aren't necessarily the same size)
-    for (size_t ii = 0; ii < mData.size(); ++ii)
+    for (size_t ii = 0; ii < mChannels.size(); ++ii)
     {
         numBytesIn += getVBMsize(ii);
     }
@@ -743,14 +729,15 @@ sys::Off_T VBM::load(io::SeekableInputStream& inStream,
 
     const bool swapToLittleEndian = !(sys::isBigEndianSystem());
 
+    unmap();
+
     // Seek to start of VBM
     size_t totalBytesRead(0);
     inStream.seek(startVBM, io::Seekable::START);
     std::vector<sys::ubyte> data;
-    const size_t numBytesPerVector = getNumBytesVBP();
 
     // Read the data for each channel
-    for (size_t ii = 0; ii < mData.size(); ++ii)
+    for (size_t ii = 0; ii < mChannels.size(); ++ii)
     {
         data.resize(getVBMsize(ii));
         //std::vector<sys::ubyte>& data(mVBMdata[ii]);
@@ -776,41 +763,103 @@ sys::Off_T VBM::load(io::SeekableInputStream& inStream,
                          numThreads);
             }
 
-            sys::byte* ptr = buf;
-            for (size_t jj = 0; jj < mData[ii].size(); ++jj, ptr += numBytesPerVector)
-            {
-                mData[ii][jj].setData(ptr);
-            }
+            setChannelData(ii, buf);
         }
     }
 
     return totalBytesRead;
 }
 
+sys::Off_T VBM::load(mem::SharedPtr<six::MemoryMappedFile> file,
+                     sys::Off_T startVBM,
+                     sys::Off_T sizeVBM)
+{
+    size_t numBytesIn(0);
+    for (size_t ii = 0; ii < mChannels.size(); ++ii)
+    {
+        numBytesIn += getVBMsize(ii);
+    }
+
+    if (numBytesIn != static_cast<size_t>(sizeVBM))
+    {
+        std::ostringstream oss;
+        oss << "VBM::load: calculated VBM size(" << numBytesIn
+            << ") != header VB_DATA_SIZE(" << sizeVBM << ")";
+        throw except::Exception(Ctxt(oss.str()));
+    }
+
+    if (static_cast<sys::Uint64_T>(startVBM + sizeVBM) > file->getSize())
+    {
+        throw except::Exception(Ctxt("VBM extends past the end of the file"));
+    }
+
+    unmap();
+    mMappedFile.reset(new MappedFile());
+    mMappedFile->file = file;
+
+    const sys::ubyte* ptr = file->getData() + startVBM;
+    for (size_t ii = 0; ii < mChannels.size(); ++ii)
+    {
+        ChannelData& channelData = mChannels[ii];
+        channelData.mapped = ptr;
+        ptr += getVBMsize(ii);
+
+        // These will be pulled from the map as they're needed
+        for (size_t jj = 0; jj < NUM_FIELDS; ++jj)
+        {
+            std::vector<double>().swap(channelData.fields[jj]);
+            channelData.loaded[jj].clear();
+        }
+    }
+
+    return sizeVBM;
+}
+
 std::ostream& operator<< (std::ostream& os, const VBM& d)
 {
     os << "VBM::" << "\n";
 
-    if (d.mData.empty())
+    if (d.mChannels.empty())
     {
         os << "  mData : (empty)\n";
     }
     else
     {
-        for (size_t ii = 0; ii < d.mData.size(); ++ii)
+        for (size_t ii = 0; ii < d.mChannels.size(); ++ii)
         {
             os << "[" << ii << "] mVBMsize: " << d.getVBMsize(ii) << "\n";
         }
 
-        for (size_t ii = 0; ii < d.mData.size(); ++ii)
+        // In the order of VBM::Field
+        static const char* const FIELD_NAMES[] =
         {
-            if (d.mData[0].empty())
+            "TxTime", "TxPos", "RcvTime", "RcvPos", "SRPTime", "SRPPos",
+            "TropoSRP", "AmpSF", "Fx0", "Fx_SS", "Fx1", "Fx2", "DeltaTOA0",
+            "TOA_SS"
+        };
+
+        for (size_t ii = 0; ii < d.mChannels.size(); ++ii)
+        {
+            if (d.mChannels[ii].numVectors == 0)
             {
                 os << "[" << ii << "] mData: (empty)\n";
+                continue;
             }
-            else
+
+            for (size_t jj = 0; jj < VBM::NUM_FIELDS; ++jj)
             {
-                os << "[" << ii << "] mData: " << &d.mData[ii] << "\n";
+                const VBM::Field field = static_cast<VBM::Field>(jj);
+                if (d.haveField(field))
+                {
+                    const std::vector<double>& values =
+                            d.getField(field, ii, "");
+                    os << "[" << ii << "] " << FIELD_NAMES[jj] << ":";
+                    for (size_t kk = 0; kk < values.size(); ++kk)
+                    {
+                        os << " " << values[kk];
+                    }
+                    os << "\n";
+                }
             }
         }
     }
@@ -20,10 +20,12 @@
  *
  */
 
+#include <algorithm>
 #include <limits>
 #include <sstream>
 
 #include <sys/Conf.h>
+#include <mt/RequestQueue.h>
 #include <mt/ThreadGroup.h>
 #include <mt/ThreadPlanner.h>
 #include <except/Exception.h>
@@ -226,17 +228,232 @@ void scale(const void* input,
                 "Unexpected element size " + str::toString(elementSize)));
     }
 }
+
+// Byte swaps if necessary and either scales (if scaleFactors is set) or
+// promotes 'input' into 'output'
+void convert(const void* input,
+             size_t elementSize,
+             const types::RowCol<size_t>& dims,
+             const double* scaleFactors,
+             size_t numThreads,
+             std::complex<float>* output)
+{
+    const bool swap = !sys::isBigEndianSystem() && elementSize > 2;
+    if (scaleFactors)
+    {
+        if (swap)
+        {
+            cphd::byteSwapAndScale(input, elementSize, dims, scaleFactors,
+                                   numThreads, output);
+        }
+        else
+        {
+            scale(input, elementSize, dims, scaleFactors, numThreads,
+                  output);
+        }
+    }
+    else
+    {
+        if (swap)
+        {
+            cphd::byteSwapAndPromote(input, elementSize, dims, numThreads,
+                                     output);
+        }
+        else
+        {
+            promote(input, elementSize, dims, numThreads, output);
+        }
+    }
+}
+
+struct VectorBlock
+{
+    sys::ubyte* buffer;
+
+    // Vectors in the block, relative to the start of the region
+    size_t firstVector;
+    size_t numVectors;
+
+    // Set if the block couldn't be read
+    std::string error;
+};
+
+// Converts a block that's been read into its spot in the output
+void convertBlock(const VectorBlock& block,
+                  size_t elementSize,
+                  size_t numSamples,
+                  const double* scaleFactors,
+                  size_t numThreads,
+                  std::complex<float>* output)
+{
+    convert(block.buffer,
+            elementSize,
+            types::RowCol<size_t>(block.numVectors, numSamples),
+            scaleFactors ? scaleFactors + block.firstVector : NULL,
+            numThreads,
+            output + block.firstVector * numSamples);
+}
 }
 
 namespace cphd
 {
 const size_t Wideband::ALL = std::numeric_limits<size_t>::max();
+const size_t Wideband::READ_BLOCK_SIZE = 1024 * 1024;
+const size_t Wideband::NUM_READ_BLOCKS = 3;
+
+class Wideband::ReadBlocksRunnable : public sys::Runnable
+{
+public:
+    ReadBlocksRunnable(Wideband& wideband,
+                       size_t channel,
+                       size_t firstVector,
+                       size_t numVectors,
+                       size_t firstSample,
+                       size_t lastSample,
+                       size_t numVectorsPerBlock,
+                       mt::RequestQueue<VectorBlock*>& emptyBlocks,
+                       mt::RequestQueue<VectorBlock*>& filledBlocks) :
+        mWideband(wideband),
+        mChannel(channel),
+        mFirstVector(firstVector),
+        mNumVectors(numVectors),
+        mFirstSample(firstSample),
+        mLastSample(lastSample),
+        mNumVectorsPerBlock(numVectorsPerBlock),
+        mEmptyBlocks(emptyBlocks),
+        mFilledBlocks(filledBlocks)
+    {
+    }
+
+    virtual void run()
+    {
+        bool failed = false;
+        for (size_t vector = 0;
+             vector < mNumVectors;
+             vector += mNumVectorsPerBlock)
+        {
+            VectorBlock* block;
+            mEmptyBlocks.dequeue(block);
+            block->firstVector = vector;
+            block->numVectors =
+                    std::min(mNumVectorsPerBlock, mNumVectors - vector);
+
+            // Once a block fails there's no point in reading the rest
+            if (!failed)
+            {
+                try
+                {
+                    const size_t firstVector = mFirstVector + vector;
+                    mWideband.readImpl(mChannel,
+                                       firstVector,
+                                       firstVector + block->numVectors - 1,
+                                       mFirstSample,
+                                       mLastSample,
+                                       block->buffer);
+                }
+                catch (const except::Exception& ex)
+                {
+                    block->error = ex.getMessage();
+                }
+                catch (const std::exception& ex)
+                {
+                    block->error = ex.what();
+                }
+                catch (...)
+                {
+                    block->error = "Unknown error reading vectors";
+                }
+                failed = !block->error.empty();
+            }
+
+            mFilledBlocks.enqueue(block);
+        }
+    }
+
+private:
+    Wideband& mWideband;
+    const size_t mChannel;
+    const size_t mFirstVector;
+    const size_t mNumVectors;
+    const size_t mFirstSample;
+    const size_t mLastSample;
+    const size_t mNumVectorsPerBlock;
+    mt::RequestQueue<VectorBlock*>& mEmptyBlocks;
+    mt::RequestQueue<VectorBlock*>& mFilledBlocks;
+};
+
+class Wideband::ReadChannelsRunnable : public sys::Runnable
+{
+public:
+    ReadChannelsRunnable(const Wideband& wideband,
+                         io::SeekableInputStream& inStream,
+                         const std::vector<size_t>& channels,
+                         size_t firstVector,
+                         const std::vector<size_t>& lastVectors,
+                         size_t firstSample,
+                         const std::vector<size_t>& lastSamples,
+                         const std::vector<mem::BufferView<sys::ubyte> >& data,
+                         size_t startChannel,
+                         size_t numChannels) :
+        mWideband(wideband),
+        mInStream(inStream),
+        mChannels(channels),
+        mFirstVector(firstVector),
+        mLastVectors(lastVectors),
+        mFirstSample(firstSample),
+        mLastSamples(lastSamples),
+        mData(data),
+        mStartChannel(startChannel),
+        mNumChannels(numChannels)
+    {
+    }
+
+    virtual void run()
+    {
+        const size_t elementSize = mWideband.mElementSize;
+        for (size_t ii = mStartChannel;
+             ii < mStartChannel + mNumChannels;
+             ++ii)
+        {
+            mWideband.readImpl(mInStream,
+                               mChannels[ii],
+                               mFirstVector,
+                               mLastVectors[ii],
+                               mFirstSample,
+                               mLastSamples[ii],
+                               mData[ii].data);
+
+            // Byte swap to little endian if necessary
+            // Element size is half elementSize because it's complex
+            if (!sys::isBigEndianSystem() && elementSize > 2)
+            {
+                const size_t numPixels =
+                        (mLastVectors[ii] - mFirstVector + 1) *
+                        (mLastSamples[ii] - mFirstSample + 1);
+                byteSwap(mData[ii].data, elementSize / 2, numPixels * 2, 1);
+            }
+        }
+    }
+
+private:
+    const Wideband& mWideband;
+    io::SeekableInputStream& mInStream;
+    const std::vector<size_t>& mChannels;
+    const size_t mFirstVector;
+    const std::vector<size_t>& mLastVectors;
+    const size_t mFirstSample;
+    const std::vector<size_t>& mLastSamples;
+    const std::vector<mem::BufferView<sys::ubyte> >& mData;
+    const size_t mStartChannel;
+    const size_t mNumChannels;
+};
 
 Wideband::Wideband(const std::string& pathname,
                    const cphd::Data& data,
                    sys::Off_T startWB,
                    sys::Off_T sizeWB) :
     mInStream(new io::FileInputStream(pathname)),
+    mPathname(pathname),
     mData(data),
     mWBOffset(startWB),
     mWBSize(sizeWB),
@@ -344,12 +561,13 @@ void Wideband::checkReadInputs(size_t channel,
     dims.col = lastSample - firstSample + 1;
 }
 
-void Wideband::readImpl(size_t channel,
+void Wideband::readImpl(io::SeekableInputStream& inStream,
+                        size_t channel,
                         size_t firstVector,
                         size_t lastVector,
                         size_t firstSample,
                         size_t lastSample,
-                        void* data)
+                        void* data) const
 {
     types::RowCol<size_t> dims;
     checkReadInputs(channel, firstVector, lastVector, firstSample, lastSample,
@@ -363,8 +581,8 @@ void Wideband::readImpl(size_t channel,
     if (dims.col == mData.getNumSamples(channel))
     {
         // Life is easy - can do a single seek and read
-        mInStream->seek(inOffset, io::FileInputStream::START);
-        mInStream->read(dataPtr, dims.row * dims.col * mElementSize);
+        inStream.seek(inOffset, io::FileInputStream::START);
+        inStream.read(dataPtr, dims.row * dims.col * mElementSize);
     }
     else
     {
@@ -376,8 +594,8 @@ void Wideband::readImpl(size_t channel,
 
         for (size_t row = 0; row < dims.row; ++row)
         {
-            mInStream->seek(inOffset, io::FileInputStream::START);
-            mInStream->read(dataPtr, bytesPerVectorAOI);
+            inStream.seek(inOffset, io::FileInputStream::START);
+            inStream.read(dataPtr, bytesPerVectorAOI);
             dataPtr += bytesPerVectorAOI;
             inOffset += bytesPerVectorFile;
         }
@@ -438,6 +656,96 @@ void Wideband::read(size_t channel,
          mem::BufferView<sys::ubyte>(data.get(), bufSize));
 }
 
+void Wideband::readChannels(
+        const std::vector<size_t>& channels,
+        size_t firstVector,
+        size_t lastVector,
+        size_t firstSample,
+        size_t lastSample,
+        size_t numThreads,
+        const std::vector<mem::BufferView<sys::ubyte> >& data)
+{
+    if (data.size() != channels.size())
+    {
+        std::ostringstream ostr;
+        ostr << "Expected " << channels.size() << " buffers but got "
+             << data.size();
+        throw except::Exception(Ctxt(ostr.str()));
+    }
+
+    // Sanity checks
+    // ALL may mean something different for each channel
+    std::vector<size_t> lastVectors(channels.size(), lastVector);
+    std::vector<size_t> lastSamples(channels.size(), lastSample);
+    for (size_t ii = 0; ii < channels.size(); ++ii)
+    {
+        if (channels[ii] >= mOffsets.size())
+        {
+            throw except::Exception(Ctxt("Invalid channel number"));
+        }
+
+        types::RowCol<size_t> dims;
+        checkReadInputs(channels[ii], firstVector, lastVectors[ii],
+                        firstSample, lastSamples[ii], dims);
+
+        const size_t minSize = dims.row * dims.col * mElementSize;
+        if (data[ii].size < minSize)
+        {
+            std::ostringstream ostr;
+            ostr << "Need at least " << minSize << " bytes for channel "
+                 << channels[ii] << " but only got " << data[ii].size;
+            throw except::Exception(Ctxt(ostr.str()));
+        }
+    }
+
+    // We can only read in parallel if we're able to open more handles to
+    // the file
+    const size_t numWorkers = mPathname.empty() ?
+            1 : std::min(std::max<size_t>(numThreads, 1), channels.size());
+
+    if (numWorkers <= 1)
+    {
+        ReadChannelsRunnable(*this, *mInStream, channels, firstVector,
+                             lastVectors, firstSample, lastSamples, data,
+                             0, channels.size()).run();
+        return;
+    }
+
+    // The first thread reads through mInStream
+    while (mChannelStreams.size() < numWorkers - 1)
+    {
+        mChannelStreams.push_back(mem::SharedPtr<io::SeekableInputStream>(
+                new io::FileInputStream(mPathname)));
+    }
+
+    mt::ThreadGroup threads;
+    const mt::ThreadPlanner planner(channels.size(), numWorkers);
+
+    size_t threadNum(0);
+    size_t startChannel(0);
+    size_t numChannelsThisThread(0);
+    while (planner.getThreadInfo(threadNum,
+                                 startChannel,
+                                 numChannelsThisThread))
+    {
+        io::SeekableInputStream& inStream = (threadNum == 0) ?
+                *mInStream : *mChannelStreams[threadNum - 1];
+        threads.createThread(new ReadChannelsRunnable(*this,
+                                                      inStream,
+                                                      channels,
+                                                      firstVector,
+                                                      lastVectors,
+                                                      firstSample,
+                                                      lastSamples,
+                                                      data,
+                                                      startChannel,
+                                                      numChannelsThisThread));
+        ++threadNum;
+    }
+
+    threads.joinAll();
+}
+
 bool Wideband::allOnes(const std::vector<double>& vectorScaleFactors)
 {
     for (size_t ii = 0; ii < vectorScaleFactors.size(); ++ii)
@@ -451,6 +759,37 @@ bool Wideband::allOnes(const std::vector<double>& vectorScaleFactors)
     return true;
 }
 
+void Wideband::checkScaledReadInputs(
+        size_t channel,
+        size_t firstVector,
+        size_t& lastVector,
+        size_t firstSample,
+        size_t& lastSample,
+        const std::vector<double>& vectorScaleFactors,
+        const mem::BufferView<std::complex<float> >& data,
+        types::RowCol<size_t>& dims) const
+{
+    checkReadInputs(channel, firstVector, lastVector, firstSample, lastSample,
+                    dims);
+
+    if (vectorScaleFactors.size() != dims.row)
+    {
+        std::ostringstream ostr;
+        ostr << "Expected " << dims.row << " vector scale factors but got "
+             << vectorScaleFactors.size();
+        throw except::Exception(Ctxt(ostr.str()));
+    }
+
+    const size_t numPixels(dims.row * dims.col);
+    if (data.size < numPixels)
+    {
+        std::ostringstream ostr;
+        ostr << "Need at least " << numPixels << " pixels but only got "
+             << data.size;
+        throw except::Exception(Ctxt(ostr.str()));
+    }
+}
+
 void Wideband::read(size_t channel,
                     size_t firstVector,
                     size_t lastVector,
@@ -463,16 +802,8 @@ void Wideband::read(size_t channel,
 {
     // Sanity checks
     types::RowCol<size_t> dims;
-    checkReadInputs(channel, firstVector, lastVector, firstSample, lastSample,
-                    dims);
-
-    if (vectorScaleFactors.size() != dims.row)
-    {
-        std::ostringstream ostr;
-        ostr << "Expected " << dims.row << " vector scale factors but got "
-             << vectorScaleFactors.size();
-        throw except::Exception(Ctxt(ostr.str()));
-    }
+    checkScaledReadInputs(channel, firstVector, lastVector, firstSample,
+                          lastSample, vectorScaleFactors, data, dims);
 
     if (dims.row == 0)
     {
@@ -485,15 +816,8 @@ void Wideband::read(size_t channel,
 
     const size_t numPixels(dims.row * dims.col);
 
-    if (data.size < numPixels)
-    {
-        std::ostringstream ostr;
-        ostr << "Need at least " << numPixels << " pixels but only got "
-             << data.size;
-        throw except::Exception(Ctxt(ostr.str()));
-    }
-
-    if (needToScale)
+    // We need to convert the output to floating-point data
+    if (needToScale || mElementSize != 8)
     {
         const size_t minScratchSize = numPixels * mElementSize;
         if (scratch.size < minScratchSize)
@@ -504,56 +828,162 @@ void Wideband::read(size_t channel,
             throw except::Exception(Ctxt(ostr.str()));
         }
 
-        // TODO: If we wanted to get fancy here, we could do this in blocks so
-        //       that we wouldn't need as big of a scratch buffer
-
         // Perform the read into the scratch buffer
         readImpl(channel, firstVector, lastVector, firstSample, lastSample,
                  scratch.data);
 
-        // Byte swap to little endian if necessary
-        if (!sys::isBigEndianSystem() && mElementSize > 2)
-        {
-            // Need to endian swap and then scale
-            byteSwapAndScale(scratch.data, mElementSize, dims,
-                             &vectorScaleFactors[0], numThreads, data.data);
-        }
-        else
-        {
-            // Just need to scale
-            scale(scratch.data, mElementSize, dims, &vectorScaleFactors[0],
-                  numThreads, data.data);
-        }
+        // Byte swap to little endian if necessary and scale or promote
+        convert(scratch.data, mElementSize, dims,
+                needToScale ? &vectorScaleFactors[0] : NULL,
+                numThreads, data.data);
     }
-    // We need to convert the output to floating-point data
-    else if (mElementSize != 8)
+    else
     {
-        // Perform the read into the scratch buffer
+        // Perform the read directly into the output buffer
         readImpl(channel, firstVector, lastVector, firstSample, lastSample,
-                 scratch.data);
+                 data.data);
 
+        // Byte swap to little endian if necessary
+        // Element size is half mElementSize because it's complex
         if (!sys::isBigEndianSystem() && mElementSize > 2)
         {
-            byteSwapAndPromote(scratch.data, mElementSize, dims, numThreads,
-                    data.data);
+            byteSwap(data.data, mElementSize / 2, numPixels * 2, numThreads);
         }
-        else
+    }
+}
+
+void Wideband::read(size_t channel,
+                    size_t firstVector,
+                    size_t lastVector,
+                    size_t firstSample,
+                    size_t lastSample,
+                    const std::vector<double>& vectorScaleFactors,
+                    size_t numThreads,
+                    const mem::BufferView<std::complex<float> >& data)
+{
+    // Sanity checks
+    types::RowCol<size_t> dims;
+    checkScaledReadInputs(channel, firstVector, lastVector, firstSample,
+                          lastSample, vectorScaleFactors, data, dims);
+
+    if (dims.row == 0)
+    {
+        return;
+    }
+
+    const bool needToScale(!allOnes(vectorScaleFactors));
+    if (!needToScale && mElementSize == 8)
+    {
+        // The output is the same as what's in the file, so there's no need
+        // for any scratch space
+        read(channel, firstVector, lastVector, firstSample, lastSample,
+             vectorScaleFactors, numThreads, mem::BufferView<sys::ubyte>(),
+             data);
+        return;
+    }
+
+    const size_t numBytesPerVector = dims.col * mElementSize;
+    const size_t numVectorsPerBlock = std::min(
+            dims.row, std::max<size_t>(READ_BLOCK_SIZE / numBytesPerVector, 1));
+    const size_t numBlocks =
+            (dims.row + numVectorsPerBlock - 1) / numVectorsPerBlock;
+    const size_t numBuffers = std::min(NUM_READ_BLOCKS, numBlocks);
+    const size_t numBytesPerBlock = numVectorsPerBlock * numBytesPerVector;
+
+    std::vector<sys::ubyte> scratch(numBuffers * numBytesPerBlock);
+    std::vector<VectorBlock> blocks(numBuffers);
+
+    const double* const scaleFactors =
+            needToScale ? &vectorScaleFactors[0] : NULL;
+
+    if (numBuffers == 1)
+    {
+        // Just read and convert each block in turn
+        VectorBlock& block = blocks[0];
+        block.buffer = &scratch[0];
+        for (size_t vector = 0;
+             vector < dims.row;
+             vector += numVectorsPerBlock)
         {
-            promote(scratch.data, mElementSize, dims, numThreads, data.data);
+            block.firstVector = vector;
+            block.numVectors = std::min(numVectorsPerBlock, dims.row - vector);
+            readImpl(channel,
+                     firstVector + vector,
+                     firstVector + vector + block.numVectors - 1,
+                     firstSample,
+                     lastSample,
+                     block.buffer);
+            convertBlock(block, mElementSize, dims.col, scaleFactors,
+                         numThreads, data.data);
         }
+        return;
     }
-    else
+
+    mt::RequestQueue<VectorBlock*> emptyBlocks;
+    mt::RequestQueue<VectorBlock*> filledBlocks;
+    for (size_t ii = 0; ii < numBuffers; ++ii)
     {
-        // Perform the read directly into the output buffer
-        readImpl(channel, firstVector, lastVector, firstSample, lastSample,
-                 data.data);
+        blocks[ii].buffer = &scratch[ii * numBytesPerBlock];
+        emptyBlocks.enqueue(&blocks[ii]);
+    }
 
-        // Byte swap to little endian if necessary
-        // Element size is half mElementSize because it's complex
-        if (!sys::isBigEndianSystem() && mElementSize > 2)
+    mt::ThreadGroup threads;
+    threads.createThread(new ReadBlocksRunnable(*this,
+                                                channel,
+                                                firstVector,
+                                                dims.row,
+                                                firstSample,
+                                                lastSample,
+                                                numVectorsPerBlock,
+                                                emptyBlocks,
+                                                filledBlocks));
+
+    // Even after a failure, keep taking blocks so the reading thread can
+    // finish up.  Nothing may escape this loop, or the reading thread would
+    // be left waiting on an empty block forever and the ThreadGroup would
+    // never finish joining it.
+    std::string error;
+    for (size_t ii = 0; ii < numBlocks; ++ii)
+    {
+        VectorBlock* block;
+        filledBlocks.dequeue(block);
+
+        if (error.empty())
         {
-            byteSwap(data.data, mElementSize / 2, numPixels * 2, numThreads);
+            if (!block->error.empty())
+            {
+                error = block->error;
+            }
+            else
+            {
+                try
+                {
+                    convertBlock(*block, mElementSize, dims.col, scaleFactors,
+                                 numThreads, data.data);
+                }
+                catch (const except::Exception& ex)
+                {
+                    error = ex.getMessage();
+                }
+                catch (const std::exception& ex)
+                {
+                    error = ex.what();
+                }
+                catch (...)
+                {
+                    error = "Unknown error converting vectors";
+                }
+            }
         }
+
+        emptyBlocks.enqueue(block);
+    }
+
+    threads.joinAll();
+
+    if (!error.empty())
+    {
+        throw except::Exception(Ctxt(error));
     }
 }
 
@@ -0,0 +1,83 @@
+/* =========================================================================
+ * This file is part of cphd-c++
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2017, MDA Information Systems LLC
+ *
+ * cphd-c++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __CPHD_TEST_UTILITIES_H__
+#define __CPHD_TEST_UTILITIES_H__
+
+#include <string>
+
+#include <str/Convert.h>
+#include <cphd/Metadata.h>
+#include <types/RowCol.h>
+
+// The least metadata that CPHDWriter will write and CPHDReader will read
+// back: 'numChannels' channels of 'dims' samples each, with a stepped SRP
+// and no optional VBM parameters
+inline cphd::Metadata createMetadata(
+        size_t numChannels,
+        const types::RowCol<size_t>& dims,
+        cphd::SampleType sampleType,
+        cphd::DomainType domainType = cphd::DomainType::FX)
+{
+    cphd::Metadata metadata;
+    metadata.data.numCPHDChannels = numChannels;
+    for (size_t ii = 0; ii < numChannels; ++ii)
+    {
+        metadata.data.arraySize.push_back(
+                cphd::ArraySize(dims.row, dims.col));
+    }
+    metadata.data.sampleType = sampleType;
+    metadata.collectionInformation.radarMode = cphd::RadarModeType::SPOTLIGHT;
+    for (size_t ii = 0; ii < six::LatLonAltCorners::NUM_CORNERS; ++ii)
+    {
+        metadata.global.imageArea.acpCorners.getCorner(ii).setLat(0.0);
+        metadata.global.imageArea.acpCorners.getCorner(ii).setLon(0.0);
+        metadata.global.imageArea.acpCorners.getCorner(ii).setAlt(0.0);
+    }
+
+    // This writes without a channel parameter but won't read
+    metadata.channel.parameters.push_back(cphd::ChannelParameters());
+    metadata.srp.srpType = cphd::SRPType::STEPPED;
+    metadata.global.domainType = domainType;
+    if (domainType == cphd::DomainType::FX)
+    {
+        metadata.vectorParameters.fxParameters.reset(
+                new cphd::FxParameters());
+    }
+    else
+    {
+        metadata.vectorParameters.toaParameters.reset(
+                new cphd::TOAParameters());
+    }
+    return metadata;
+}
+
+// Elapsed time and throughput, for benchmarks to print
+inline std::string getThroughput(size_t numBytes, double elapsedMS)
+{
+    const double mbPerSec =
+            (numBytes / (1024.0 * 1024.0)) / (elapsedMS / 1000.0);
+    return str::toString(elapsedMS) + " ms, " + str::toString(mbPerSec) +
+            " MB/s";
+}
+
+#endif
@@ -0,0 +1,321 @@
+/* =========================================================================
+ * This file is part of cphd-c++
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2017, MDA Information Systems LLC
+ *
+ * cphd-c++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// Micro-benchmark for cphd::byteSwap(), byteSwapAndPromote(), and
+// byteSwapAndScale()
+// Runs each on CI2, CI4, and CF8 samples, checks that they match a simple
+// per-element implementation, and reports the throughput of both
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <memory>
+#include <vector>
+
+#include <except/Exception.h>
+#include <sys/StopWatch.h>
+#include <cphd/ByteSwap.h>
+#include <types/RowCol.h>
+#include <cli/ArgumentParser.h>
+
+#include "TestUtilities.h"
+
+namespace
+{
+// Swaps one value a byte at a time
+template <typename T>
+void byteSwap(const sys::ubyte* in, T& out)
+{
+    sys::ubyte* const outPtr = reinterpret_cast<sys::ubyte*>(&out);
+    for (size_t ii = 0; ii < sizeof(T); ++ii)
+    {
+        outPtr[ii] = in[sizeof(T) - 1 - ii];
+    }
+}
+
+template <typename InT>
+void byteSwapAndScaleSimple(const sys::ubyte* input,
+                            const types::RowCol<size_t>& dims,
+                            const double* scaleFactors,
+                            std::complex<float>* output)
+{
+    InT real(0);
+    InT imag(0);
+    for (size_t row = 0, idx = 0; row < dims.row; ++row)
+    {
+        const double scaleFactor = scaleFactors ? scaleFactors[row] : 1.0;
+        for (size_t col = 0; col < dims.col; ++col, ++idx)
+        {
+            const sys::ubyte* const in = input + idx * 2 * sizeof(InT);
+            byteSwap(in, real);
+            byteSwap(in + sizeof(InT), imag);
+            output[idx] = std::complex<float>(
+                    static_cast<float>(real * scaleFactor),
+                    static_cast<float>(imag * scaleFactor));
+        }
+    }
+}
+
+void byteSwapAndScaleSimple(const sys::ubyte* input,
+                            size_t elementSize,
+                            const types::RowCol<size_t>& dims,
+                            const double* scaleFactors,
+                            std::complex<float>* output)
+{
+    switch (elementSize)
+    {
+    case 2:
+        byteSwapAndScaleSimple<sys::Int8_T>(input, dims, scaleFactors, output);
+        break;
+    case 4:
+        byteSwapAndScaleSimple<sys::Int16_T>(input, dims, scaleFactors,
+                                             output);
+        break;
+    case 8:
+        byteSwapAndScaleSimple<float>(input, dims, scaleFactors, output);
+        break;
+    }
+}
+
+void byteSwapSimple(sys::ubyte* buffer, size_t elemSize, size_t numElements)
+{
+    for (size_t ii = 0; ii < numElements; ++ii, buffer += elemSize)
+    {
+        for (size_t jj = 0, kk = elemSize - 1; jj < kk; ++jj, --kk)
+        {
+            std::swap(buffer[jj], buffer[kk]);
+        }
+    }
+}
+
+class Benchmark
+{
+public:
+    Benchmark(size_t elementSize,
+              const types::RowCol<size_t>& dims,
+              size_t numThreads,
+              size_t numIterations) :
+        mElementSize(elementSize),
+        mDims(dims),
+        mNumThreads(numThreads),
+        mNumIterations(numIterations),
+        mNumBytes(dims.area() * elementSize),
+        mInput(mNumBytes),
+        mBuffer(mNumBytes),
+        mScaleFactors(dims.row),
+        mOutput(dims.area()),
+        mExpected(dims.area()),
+        mSuccess(true)
+    {
+        // Keep the floats finite by only varying the low bytes of each
+        // big endian value
+        for (size_t ii = 0; ii < mNumBytes; ++ii)
+        {
+            const size_t byte = ii % (mElementSize / 2);
+            mInput[ii] = (mElementSize == 8 && byte < 2) ?
+                    static_cast<sys::ubyte>(0x40 + byte) :
+                    static_cast<sys::ubyte>(ii * 7 + 3);
+        }
+
+        for (size_t ii = 0; ii < mScaleFactors.size(); ++ii)
+        {
+            mScaleFactors[ii] = 0.5 + ii * 0.25;
+        }
+    }
+
+    void run()
+    {
+        const std::string name = (mElementSize == 2) ? "CI2" :
+                (mElementSize == 4) ? "CI4" : "CF8";
+
+        // Byte swap in place
+        double simpleMS = 0.0;
+        double newMS = 0.0;
+        for (size_t ii = 0; ii < mNumIterations; ++ii)
+        {
+            std::vector<sys::ubyte> expected(mInput);
+            sys::RealTimeStopWatch stopWatch;
+            stopWatch.start();
+            byteSwapSimple(&expected[0], mElementSize / 2,
+                           mDims.area() * 2);
+            simpleMS += stopWatch.stop();
+
+            mBuffer = mInput;
+            stopWatch.start();
+            cphd::byteSwap(&mBuffer[0], mElementSize / 2, mDims.area() * 2,
+                           mNumThreads);
+            newMS += stopWatch.stop();
+
+            if (mBuffer != expected)
+            {
+                std::cerr << name << " byteSwap() DOES NOT MATCH\n";
+                mSuccess = false;
+            }
+        }
+        report(name + " byteSwap", simpleMS, newMS);
+
+        runConversion(name + " byteSwapAndPromote", NULL);
+        runConversion(name + " byteSwapAndScale", &mScaleFactors[0]);
+    }
+
+    bool success() const
+    {
+        return mSuccess;
+    }
+
+private:
+    void runConversion(const std::string& name, const double* scaleFactors)
+    {
+        double simpleMS = 0.0;
+        double newMS = 0.0;
+        for (size_t ii = 0; ii < mNumIterations; ++ii)
+        {
+            sys::RealTimeStopWatch stopWatch;
+            stopWatch.start();
+            byteSwapAndScaleSimple(&mInput[0], mElementSize, mDims,
+                                   scaleFactors, &mExpected[0]);
+            simpleMS += stopWatch.stop();
+
+            stopWatch.start();
+            if (scaleFactors)
+            {
+                cphd::byteSwapAndScale(&mInput[0], mElementSize, mDims,
+                                       scaleFactors, mNumThreads,
+                                       &mOutput[0]);
+            }
+            else
+            {
+                cphd::byteSwapAndPromote(&mInput[0], mElementSize, mDims,
+                                         mNumThreads, &mOutput[0]);
+            }
+            newMS += stopWatch.stop();
+
+            if (::memcmp(&mOutput[0], &mExpected[0],
+                         mOutput.size() * sizeof(mOutput[0])))
+            {
+                std::cerr << name << "() DOES NOT MATCH\n";
+                mSuccess = false;
+            }
+        }
+        report(name, simpleMS, newMS);
+    }
+
+    void report(const std::string& name, double simpleMS, double newMS)
+    {
+        const size_t numBytes = mNumBytes * mNumIterations;
+        std::cout << name << ": per-element "
+                  << getThroughput(numBytes, simpleMS) << "; kernels "
+                  << getThroughput(numBytes, newMS) << "\n";
+    }
+
+private:
+    const size_t mElementSize;
+    const types::RowCol<size_t> mDims;
+    const size_t mNumThreads;
+    const size_t mNumIterations;
+    const size_t mNumBytes;
+    std::vector<sys::ubyte> mInput;
+    std::vector<sys::ubyte> mBuffer;
+    std::vector<double> mScaleFactors;
+    std::vector<std::complex<float> > mOutput;
+    std::vector<std::complex<float> > mExpected;
+    bool mSuccess;
+};
+}
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        // Parse the command line
+        cli::ArgumentParser parser;
+        parser.setDescription(
+                "Benchmark the CPHD byte swapping and conversion kernels.");
+        parser.addArgument("-t --threads",
+                           "Specify the number of threads to use",
+                           cli::STORE,
+                           "threads",
+                           "NUM")->setDefault(1);
+        parser.addArgument("-i --iterations",
+                           "Number of times to run each kernel",
+                           cli::STORE,
+                           "iterations",
+                           "NUM")->setDefault(10);
+        // Odd number of columns so the SIMD loops have a tail to handle
+        parser.addArgument("--rows",
+                           "Specify the number of vectors",
+                           cli::STORE,
+                           "rows",
+                           "NUM")->setDefault(1024);
+        parser.addArgument("--cols",
+                           "Specify the number of samples per vector",
+                           cli::STORE,
+                           "cols",
+                           "NUM")->setDefault(2047);
+        const std::auto_ptr<cli::Results> options(parser.parse(argc, argv));
+
+        const size_t numThreads = options->get<size_t>("threads");
+        const size_t numIterations = options->get<size_t>("iterations");
+        const types::RowCol<size_t> dims(options->get<size_t>("rows"),
+                                         options->get<size_t>("cols"));
+
+        bool success = true;
+        for (size_t elementSize = 2; elementSize <= 8; elementSize *= 2)
+        {
+            Benchmark benchmark(elementSize, dims, numThreads, numIterations);
+            benchmark.run();
+            if (!benchmark.success())
+            {
+                success = false;
+            }
+        }
+
+        if (success)
+        {
+            std::cout << "All tests pass!\n";
+        }
+        else
+        {
+            std::cerr << "Some tests FAIL!\n";
+        }
+
+        return (success ? 0 : 1);
+    }
+    catch (const std::exception& ex)
+    {
+        std::cerr << "Caught std::exception: " << ex.what() << std::endl;
+        return 1;
+    }
+    catch (const except::Exception& ex)
+    {
+        std::cerr << "Caught except::Exception: " << ex.getMessage()
+                  << std::endl;
+        return 1;
+    }
+    catch (...)
+    {
+        std::cerr << "Caught unknown exception\n";
+        return 1;
+    }
+}
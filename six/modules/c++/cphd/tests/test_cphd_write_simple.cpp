@@ -29,6 +29,8 @@
 #include <types/RowCol.h>
 #include <cli/ArgumentParser.h>
 
+#include "TestUtilities.h"
+
 int main(int argc, char** argv)
 {
     try
@@ -78,47 +80,9 @@ int main(int argc, char** argv)
         const std::vector<std::complex<float> > data(
                 dims.area(), std::complex<float>(0.0f, 0.0f));
 
-        cphd::Metadata metadata;
-
-        metadata.data.numCPHDChannels = numChannels;
-        for (size_t ii = 0; ii < numChannels; ++ii)
-        {
-            metadata.data.arraySize.push_back(
-                    cphd::ArraySize(dims.row, dims.col));
-        }
-
-        //! Must set the sample type (complex<float>)
-        metadata.data.sampleType = cphd::SampleType::RE32F_IM32F;
-
-        //! We must have a radar mode set
-        metadata.collectionInformation.radarMode = cphd::RadarModeType::SPOTLIGHT;
-
-        //! We must have corners set
-        for (size_t ii = 0; ii < six::LatLonAltCorners::NUM_CORNERS; ++ii)
-        {
-            metadata.global.imageArea.acpCorners.getCorner(ii).setLat(0.0);
-            metadata.global.imageArea.acpCorners.getCorner(ii).setLon(0.0);
-            metadata.global.imageArea.acpCorners.getCorner(ii).setAlt(0.0);
-        }
-
-        //! Add a channel parameter. This will write without this but it will
-        //  not read.
-        cphd::ChannelParameters param;
-        metadata.channel.parameters.push_back(param);
-
-        //! We must set SRP Type
-        metadata.srp.srpType = cphd::SRPType::STEPPED;
-
-        //! We must set domain parameters
-        metadata.global.domainType = domainType;
-        if (domainType == cphd::DomainType::FX)
-        {
-            metadata.vectorParameters.fxParameters.reset(new cphd::FxParameters());
-        }
-        else
-        {
-            metadata.vectorParameters.toaParameters.reset(new cphd::TOAParameters());
-        }
+        //! Complex float samples
+        const cphd::Metadata metadata = createMetadata(
+                numChannels, dims, cphd::SampleType::RE32F_IM32F, domainType);
 
         cphd::VBM vbm(numChannels,
                       numVectors,
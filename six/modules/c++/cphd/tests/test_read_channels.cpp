@@ -0,0 +1,233 @@
+/* =========================================================================
+ * This file is part of cphd-c++
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2017, MDA Information Systems LLC
+ *
+ * cphd-c++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// Test program for Wideband::readChannels()
+// Writes out a multi-channel CPHD, then reads every channel one after another
+// and with readChannels() using varying numbers of threads, checks that they
+// match, and reports the aggregate throughput of each
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <memory>
+
+#include <except/Exception.h>
+#include <sys/StopWatch.h>
+#include <io/TempFile.h>
+#include <mem/ScopedArray.h>
+#include <cphd/CPHDReader.h>
+#include <cphd/CPHDWriter.h>
+#include <types/RowCol.h>
+#include <cli/ArgumentParser.h>
+
+#include "TestUtilities.h"
+
+namespace
+{
+void writeCPHD(const std::string& pathname,
+               size_t numChannels,
+               const types::RowCol<size_t>& dims)
+{
+    const cphd::Metadata metadata = createMetadata(
+            numChannels, dims, cphd::SampleType::RE16I_IM16I);
+
+    const cphd::VBM vbm(numChannels,
+                        std::vector<size_t>(numChannels, dims.row),
+                        false,
+                        false,
+                        false,
+                        metadata.global.domainType);
+
+    cphd::CPHDWriter writer(metadata, 1);
+    writer.writeMetadata(pathname, vbm);
+
+    std::vector<std::complex<sys::Int16_T> > data(dims.area());
+    for (size_t ii = 0; ii < numChannels; ++ii)
+    {
+        for (size_t jj = 0; jj < data.size(); ++jj)
+        {
+            data[jj] = std::complex<sys::Int16_T>(
+                    static_cast<sys::Int16_T>(ii * 1000 + jj % 1000),
+                    static_cast<sys::Int16_T>(jj % 30000));
+        }
+        writer.writeCPHDData(&data[0], data.size());
+    }
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        // Parse the command line
+        cli::ArgumentParser parser;
+        parser.setDescription(
+                "Compare reading CPHD channels sequentially and in parallel.");
+        parser.addArgument("-t --threads",
+                           "Maximum number of threads to read with",
+                           cli::STORE,
+                           "threads",
+                           "NUM")->setDefault(4);
+        parser.addArgument("-c --channels",
+                           "Specify the number of channels to write",
+                           cli::STORE,
+                           "channels",
+                           "NUM")->setDefault(4);
+        parser.addArgument("--rows",
+                           "Specify the number of rows per channel",
+                           cli::STORE,
+                           "rows",
+                           "NUM")->setDefault(1024);
+        parser.addArgument("--cols",
+                           "Specify the number of cols per channel",
+                           cli::STORE,
+                           "cols",
+                           "NUM")->setDefault(1024);
+        const std::auto_ptr<cli::Results> options(parser.parse(argc, argv));
+
+        const size_t maxNumThreads = options->get<size_t>("threads");
+        const size_t numChannels = options->get<size_t>("channels");
+        const types::RowCol<size_t> dims(options->get<size_t>("rows"),
+                                         options->get<size_t>("cols"));
+
+        io::TempFile tempfile;
+        writeCPHD(tempfile.pathname(), numChannels, dims);
+
+        cphd::CPHDReader reader(tempfile.pathname(), 1);
+        cphd::Wideband& wideband = reader.getWideband();
+
+        const size_t channelSize = dims.area() * reader.getNumBytesPerSample();
+        const size_t totalSize = channelSize * numChannels;
+        std::vector<size_t> channels;
+        std::vector<mem::BufferView<sys::ubyte> > expected;
+        std::vector<mem::BufferView<sys::ubyte> > buffers;
+        const mem::ScopedArray<sys::ubyte> expectedData(
+                new sys::ubyte[totalSize]);
+        const mem::ScopedArray<sys::ubyte> data(new sys::ubyte[totalSize]);
+        for (size_t ii = 0; ii < numChannels; ++ii)
+        {
+            channels.push_back(ii);
+            expected.push_back(mem::BufferView<sys::ubyte>(
+                    expectedData.get() + ii * channelSize, channelSize));
+            buffers.push_back(mem::BufferView<sys::ubyte>(
+                    data.get() + ii * channelSize, channelSize));
+        }
+
+        sys::RealTimeStopWatch stopWatch;
+        stopWatch.start();
+        for (size_t ii = 0; ii < numChannels; ++ii)
+        {
+            wideband.read(ii, 0, cphd::Wideband::ALL, 0, cphd::Wideband::ALL,
+                          1, expected[ii]);
+        }
+        std::cout << "Sequential read of " << numChannels << " channels: "
+                  << getThroughput(totalSize, stopWatch.stop()) << "\n";
+
+        bool success = true;
+        for (size_t numThreads = 1;
+             numThreads <= maxNumThreads;
+             numThreads *= 2)
+        {
+            std::fill(data.get(), data.get() + totalSize, 0);
+
+            sys::RealTimeStopWatch parallelStopWatch;
+            parallelStopWatch.start();
+            wideband.readChannels(channels, 0, cphd::Wideband::ALL,
+                                  0, cphd::Wideband::ALL, numThreads,
+                                  buffers);
+            const double elapsedMS = parallelStopWatch.stop();
+
+            std::cout << "readChannels() with " << numThreads
+                      << " threads: " << getThroughput(totalSize, elapsedMS)
+                      << "\n";
+
+            if (::memcmp(data.get(), expectedData.get(), totalSize))
+            {
+                std::cerr << "readChannels() with " << numThreads
+                          << " threads DOES NOT MATCH\n";
+                success = false;
+            }
+        }
+
+        // A subset of the vectors and samples from some of the channels
+        if (numChannels > 1 && dims.row > 10 && dims.col > 10)
+        {
+            std::vector<size_t> someChannels;
+            std::vector<mem::BufferView<sys::ubyte> > someBuffers;
+            const size_t regionSize =
+                    7 * (dims.col - 5) * reader.getNumBytesPerSample();
+            std::vector<sys::ubyte> expectedRegion(regionSize);
+            for (size_t ii = 1; ii < numChannels; ii += 2)
+            {
+                someChannels.push_back(ii);
+                someBuffers.push_back(buffers[ii]);
+            }
+
+            wideband.readChannels(someChannels, 3, 9, 4, dims.col - 2,
+                                  maxNumThreads, someBuffers);
+
+            for (size_t ii = 0; ii < someChannels.size(); ++ii)
+            {
+                wideband.read(someChannels[ii], 3, 9, 4, dims.col - 2, 1,
+                              mem::BufferView<sys::ubyte>(
+                                      &expectedRegion[0], regionSize));
+                if (::memcmp(someBuffers[ii].data, &expectedRegion[0],
+                             regionSize))
+                {
+                    std::cerr << "Partial readChannels() of channel "
+                              << someChannels[ii] << " DOES NOT MATCH\n";
+                    success = false;
+                }
+            }
+        }
+
+        if (success)
+        {
+            std::cout << "All tests pass!\n";
+        }
+        else
+        {
+            std::cerr << "Some tests FAIL!\n";
+        }
+
+        return (success ? 0 : 1);
+    }
+    catch (const std::exception& ex)
+    {
+        std::cerr << "Caught std::exception: " << ex.what() << std::endl;
+        return 1;
+    }
+    catch (const except::Exception& ex)
+    {
+        std::cerr << "Caught except::Exception: " << ex.getMessage()
+                  << std::endl;
+        return 1;
+    }
+    catch (...)
+    {
+        std::cerr << "Caught unknown exception\n";
+        return 1;
+    }
+}
@@ -34,6 +34,7 @@
 #include <io/TempFile.h>
 
 #include "TestCase.h"
+#include "../tests/TestUtilities.h"
 
 namespace
 {
@@ -75,51 +76,22 @@ void writeCPHD(const std::string& outPathname, size_t numThreads,
     const size_t numChannels = 1;
     const std::vector<size_t> numVectors(numChannels, dims.row);
 
-    cphd::Metadata metadata;
-
-    metadata.data.numCPHDChannels = numChannels;
-    for (size_t ii = 0; ii < metadata.data.numCPHDChannels; ++ii)
-    {
-        metadata.data.arraySize.push_back(
-                cphd::ArraySize(dims.row, dims.col));
-    }
-
     //! Must set the sample type
+    cphd::SampleType sampleType;
     if (sizeof(writeData[0]) == 2)
     {
-        metadata.data.sampleType = cphd::SampleType::RE08I_IM08I;
+        sampleType = cphd::SampleType::RE08I_IM08I;
     }
     else if (sizeof(writeData[0]) == 4)
     {
-        metadata.data.sampleType = cphd::SampleType::RE16I_IM16I;
+        sampleType = cphd::SampleType::RE16I_IM16I;
     }
     else if (sizeof(writeData[0]) == 8)
     {
-        metadata.data.sampleType = cphd::SampleType::RE32F_IM32F;
-    }
-
-    //! We must have a radar mode set
-    metadata.collectionInformation.radarMode = cphd::RadarModeType::SPOTLIGHT;
-
-    //! We must have corners set
-    for (size_t ii = 0; ii < six::LatLonAltCorners::NUM_CORNERS; ++ii)
-    {
-        metadata.global.imageArea.acpCorners.getCorner(ii).setLat(0.0);
-        metadata.global.imageArea.acpCorners.getCorner(ii).setLon(0.0);
-        metadata.global.imageArea.acpCorners.getCorner(ii).setAlt(0.0);
+        sampleType = cphd::SampleType::RE32F_IM32F;
     }
-
-    //! Add a channel parameter. This will write without this but it will
-    //  not read.
-    cphd::ChannelParameters param;
-    metadata.channel.parameters.push_back(param);
-
-    //! We must set SRP Type
-    metadata.srp.srpType = cphd::SRPType::STEPPED;
-
-    //! We must set domain parameters
-    metadata.global.domainType = cphd::DomainType::FX;
-    metadata.vectorParameters.fxParameters.reset(new cphd::FxParameters());
+    const cphd::Metadata metadata =
+            createMetadata(numChannels, dims, sampleType);
 
     cphd::VBM vbm(numChannels,
                   numVectors,
@@ -140,19 +112,28 @@ std::vector<std::complex<float> > checkData(const std::string& pathname,
         size_t numThreads,
         const std::vector<double>& scaleFactors,
         bool scale,
-        const types::RowCol<size_t>& dims)
+        const types::RowCol<size_t>& dims,
+        bool blockWise)
 {
     cphd::CPHDReader reader(pathname, numThreads);
     cphd::Wideband& wideband = reader.getWideband();
     std::vector<std::complex<float> > readData(dims.area());
-
-    size_t sizeInBytes = readData.size() * sizeof(readData[0]);
-    mem::ScopedArray<sys::ubyte> scratchData(new sys::ubyte[sizeInBytes]);
-    mem::BufferView<sys::ubyte> scratch(scratchData.get(), sizeInBytes);
     mem::BufferView<std::complex<float> > data(&readData[0], readData.size());
 
-    wideband.read(0, 0, cphd::Wideband::ALL, 0, cphd::Wideband::ALL,
-            scaleFactors, numThreads, scratch, data);
+    if (blockWise)
+    {
+        wideband.read(0, 0, cphd::Wideband::ALL, 0, cphd::Wideband::ALL,
+                scaleFactors, numThreads, data);
+    }
+    else
+    {
+        size_t sizeInBytes = readData.size() * sizeof(readData[0]);
+        mem::ScopedArray<sys::ubyte> scratchData(new sys::ubyte[sizeInBytes]);
+        mem::BufferView<sys::ubyte> scratch(scratchData.get(), sizeInBytes);
+
+        wideband.read(0, 0, cphd::Wideband::ALL, 0, cphd::Wideband::ALL,
+                scaleFactors, numThreads, scratch, data);
+    }
 
     return readData;
 }
@@ -182,18 +163,24 @@ bool compareVectors(const std::vector<std::complex<float> >& readData,
 }
 
 template<typename T>
-bool runTest(bool scale, const std::vector<std::complex<T> >& writeData)
+bool runTest(bool scale,
+             const std::vector<std::complex<T> >& writeData,
+             const types::RowCol<size_t>& dims =
+                     types::RowCol<size_t>(128, 128))
 {
     io::TempFile tempfile;
     const size_t numThreads = sys::OS().getNumCPUs();
-    const types::RowCol<size_t> dims(128, 128);
     const std::vector<double> scaleFactors =
             generateScaleFactors(dims.row, scale);
     writeCPHD(tempfile.pathname(), numThreads, dims, writeData);
     const std::vector<std::complex<float> > readData =
             checkData(tempfile.pathname(), numThreads, scaleFactors,
-            scale, dims);
-    return compareVectors(readData, writeData, scaleFactors, scale);
+            scale, dims, false);
+    const std::vector<std::complex<float> > blockData =
+            checkData(tempfile.pathname(), numThreads, scaleFactors,
+            scale, dims, true);
+    return compareVectors(readData, writeData, scaleFactors, scale) &&
+           compareVectors(blockData, writeData, scaleFactors, scale);
 }
 
 TEST_CASE(testUnscaledInt8)
@@ -248,6 +235,25 @@ TEST_CASE(testScaledFloat)
     const bool scale = true;
     TEST_ASSERT(runTest(scale, writeData));
 }
+
+// Large enough that the block-wise read takes several blocks
+TEST_CASE(testUnscaledInt8Blocks)
+{
+    const types::RowCol<size_t> dims(1500, 1000);
+    const std::vector<std::complex<sys::Int8_T> > writeData =
+            generateData<sys::Int8_T>(dims.area());
+    const bool scale = false;
+    TEST_ASSERT(runTest(scale, writeData, dims));
+}
+
+TEST_CASE(testScaledInt16Blocks)
+{
+    const types::RowCol<size_t> dims(1500, 1000);
+    const std::vector<std::complex<sys::Int16_T> > writeData =
+            generateData<sys::Int16_T>(dims.area());
+    const bool scale = true;
+    TEST_ASSERT(runTest(scale, writeData, dims));
+}
 }
 
 int main(int argc, char** argv)
@@ -260,6 +266,8 @@ int main(int argc, char** argv)
         TEST_CHECK(testScaledInt16);
         TEST_CHECK(testUnscaledFloat);
         TEST_CHECK(testScaledFloat);
+        TEST_CHECK(testUnscaledInt8Blocks);
+        TEST_CHECK(testScaledInt16Blocks);
         return 0;
     }
     catch (const std::exception& ex)
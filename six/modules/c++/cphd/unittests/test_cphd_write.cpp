@@ -20,6 +20,9 @@
  *
  */
 
+#include <algorithm>
+
+#include <mt/ThreadGroup.h>
 #include <cphd/CPHDWriter.h>
 #include <cphd/CPHDReader.h>
 #include <types/RowCol.h>
@@ -391,6 +394,30 @@ void runCPHDTest(const std::string& testName,
     TEST_ASSERT_EQ(metadata, reader.getMetadata());
     TEST_ASSERT_EQ(vbm, reader.getVBM());
 
+    // Pull the VBM out of a memory map instead, one parameter at a time
+    {
+        const cphd::CPHDReader mappedReader(
+                FILE_NAME, NUM_THREADS, mem::SharedPtr<logging::Logger>(),
+                true);
+        const cphd::VBM& mappedVBM = mappedReader.getVBM();
+        for (size_t ii = 0; ii < NUM_IMAGES; ++ii)
+        {
+            const mem::BufferView<const double> txTimes =
+                    mappedVBM.getTxTimes(ii);
+            TEST_ASSERT_EQ(txTimes.size, vbm.getTxTimes(ii).size);
+            for (size_t jj = 0; jj < txTimes.size; ++jj)
+            {
+                TEST_ASSERT_EQ(txTimes.data[jj], vbm.getTxTime(ii, jj));
+            }
+        }
+
+        // A copy takes the fields already pulled out and pulls out the rest
+        // itself
+        const cphd::VBM copiedVBM(mappedVBM);
+        TEST_ASSERT_EQ(vbm, copiedVBM);
+        TEST_ASSERT_EQ(vbm, mappedVBM);
+    }
+
     std::vector<sys::ubyte> readVBM;
     for (size_t ii = 0; ii < NUM_IMAGES; ++ii)
     {
@@ -413,6 +440,181 @@ void runCPHDTest(const std::string& testName,
     }
 }
 
+TEST_CASE(testWriteInPieces)
+{
+    cphd::Metadata metadata;
+    buildRandomMetadata(metadata);
+    addFXParams(metadata);
+    metadata.data.numCPHDChannels = NUM_IMAGES;
+    const cphd::VBM vbm(metadata.data, metadata.vectorParameters);
+
+    std::vector<std::vector<std::complex<float> > >data(NUM_IMAGES);
+    {
+        // A tiny scratch space so each piece is split over several chunks,
+        // and the writer's destroyed without calling close()
+        cphd::CPHDWriter writer(metadata, 3, 1000);
+        writer.writeMetadata(FILE_NAME, vbm);
+
+        std::vector<std::complex<float> > piece;
+        for (size_t ii = 0; ii < NUM_IMAGES; ++ii)
+        {
+            data[ii].resize(metadata.getNumVectors(ii) *
+                            metadata.getNumSamples(ii));
+            for (size_t jj = 0; jj < data[ii].size(); ++jj)
+            {
+                data[ii][jj] = std::complex<float>(
+                        getRandomReal(), getRandomReal());
+            }
+
+            // The piece is overwritten right after each write
+            for (size_t jj = 0; jj < data[ii].size(); jj += piece.size())
+            {
+                piece.assign(data[ii].begin() + jj,
+                             data[ii].begin() + std::min(
+                                     jj + 7777, data[ii].size()));
+                writer.writeCPHDData(&piece[0], piece.size());
+                std::fill(piece.begin(), piece.end(),
+                          std::complex<float>(0.0f, 0.0f));
+            }
+        }
+    }
+
+    cphd::CPHDReader reader(FILE_NAME, NUM_THREADS);
+    for (size_t ii = 0; ii < NUM_IMAGES; ++ii)
+    {
+        mem::ScopedArray<sys::ubyte> readData;
+        reader.getWideband().read(ii,
+                                  0, cphd::Wideband::ALL,
+                                  0, cphd::Wideband::ALL,
+                                  NUM_THREADS, readData);
+
+        const std::complex<float>* readBuffer =
+                reinterpret_cast<std::complex<float>* >(readData.get());
+        for (size_t jj = 0; jj < data[ii].size(); ++jj)
+        {
+            TEST_ASSERT_EQ(readBuffer[jj], data[ii][jj]);
+        }
+    }
+}
+
+// Writes every nth block of vectors, starting from the end
+class WriteBlocksRunnable : public sys::Runnable
+{
+public:
+    WriteBlocksRunnable(cphd::CPHDWriter& writer,
+                        const std::vector<std::complex<float> >& data,
+                        size_t channel,
+                        const types::RowCol<size_t>& dims,
+                        size_t numVectorsPerBlock,
+                        size_t firstBlock,
+                        size_t blockStep) :
+        mWriter(writer),
+        mData(data),
+        mChannel(channel),
+        mDims(dims),
+        mNumVectorsPerBlock(numVectorsPerBlock),
+        mFirstBlock(firstBlock),
+        mBlockStep(blockStep)
+    {
+    }
+
+    virtual void run()
+    {
+        const size_t numBlocks =
+                (mDims.row + mNumVectorsPerBlock - 1) / mNumVectorsPerBlock;
+        for (size_t block = mFirstBlock; block < numBlocks;
+             block += mBlockStep)
+        {
+            const size_t firstVector =
+                    (numBlocks - 1 - block) * mNumVectorsPerBlock;
+            const size_t numVectors = std::min(mNumVectorsPerBlock,
+                                               mDims.row - firstVector);
+
+            // Only a block's worth is handed to the writer
+            const std::vector<std::complex<float> > blockData(
+                    mData.begin() + firstVector * mDims.col,
+                    mData.begin() + (firstVector + numVectors) * mDims.col);
+            mWriter.writeCPHDData(&blockData[0], mChannel, firstVector,
+                                  numVectors);
+        }
+    }
+
+private:
+    cphd::CPHDWriter& mWriter;
+    const std::vector<std::complex<float> >& mData;
+    const size_t mChannel;
+    const types::RowCol<size_t> mDims;
+    const size_t mNumVectorsPerBlock;
+    const size_t mFirstBlock;
+    const size_t mBlockStep;
+};
+
+TEST_CASE(testWriteBlocks)
+{
+    cphd::Metadata metadata;
+    buildRandomMetadata(metadata);
+    addTOAParams(metadata);
+    metadata.data.numCPHDChannels = NUM_IMAGES;
+    const cphd::VBM vbm(metadata.data, metadata.vectorParameters);
+
+    std::vector<std::vector<std::complex<float> > >data(NUM_IMAGES);
+    {
+        // Small scratch space so blocks go out in several pieces
+        cphd::CPHDWriter writer(metadata, 1, 10000);
+        writer.writeMetadata(FILE_NAME, vbm);
+
+        // Channels are written backwards, a few threads to a channel
+        static const size_t NUM_WRITE_THREADS = 3;
+        mt::ThreadGroup threads;
+        for (size_t ii = NUM_IMAGES; ii > 0; --ii)
+        {
+            const size_t channel = ii - 1;
+            const types::RowCol<size_t> dims(
+                    metadata.getNumVectors(channel),
+                    metadata.getNumSamples(channel));
+            data[channel].resize(dims.area());
+            for (size_t jj = 0; jj < data[channel].size(); ++jj)
+            {
+                data[channel][jj] = std::complex<float>(
+                        getRandomReal(), getRandomReal());
+            }
+
+            for (size_t jj = 0; jj < NUM_WRITE_THREADS; ++jj)
+            {
+                threads.createThread(new WriteBlocksRunnable(
+                        writer, data[channel], channel, dims, 17,
+                        jj, NUM_WRITE_THREADS));
+            }
+        }
+        threads.joinAll();
+
+        TEST_EXCEPTION(writer.writeCPHDData(&data[0][0], NUM_IMAGES, 0, 1));
+        TEST_EXCEPTION(writer.writeCPHDData(
+                &data[0][0], 0, metadata.getNumVectors(0), 1));
+
+        writer.close();
+    }
+
+    cphd::CPHDReader reader(FILE_NAME, NUM_THREADS);
+    TEST_ASSERT_EQ(metadata, reader.getMetadata());
+    TEST_ASSERT_EQ(vbm, reader.getVBM());
+    for (size_t ii = 0; ii < NUM_IMAGES; ++ii)
+    {
+        mem::ScopedArray<sys::ubyte> readData;
+        reader.getWideband().read(ii,
+                                  0, cphd::Wideband::ALL,
+                                  0, cphd::Wideband::ALL,
+                                  NUM_THREADS, readData);
+
+        const std::complex<float>* readBuffer =
+                reinterpret_cast<std::complex<float>* >(readData.get());
+        for (size_t jj = 0; jj < data[ii].size(); ++jj)
+        {
+            TEST_ASSERT_EQ(readBuffer[jj], data[ii][jj]);
+        }
+    }
+}
+
 TEST_CASE(testWriteFXOneWay)
 {
     cphd::Metadata metadata;
@@ -461,6 +663,8 @@ int main(int , char** )
     TEST_CHECK(testWriteFXTwoWay);
     TEST_CHECK(testWriteTOAOneWay);
     TEST_CHECK(testWriteTOATwoWay);
+    TEST_CHECK(testWriteInPieces);
+    TEST_CHECK(testWriteBlocks);
     sys::OS().remove(FILE_NAME);
     return 0;
 }
@@ -0,0 +1,260 @@
+/* =========================================================================
+ * This file is part of cphd-c++
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2017, MDA Information Systems LLC
+ *
+ * cphd-c++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <complex>
+#include <string>
+#include <vector>
+
+#include <cphd/CPHDReader.h>
+#include <cphd/CPHDWriter.h>
+#include <cphd/PulseStream.h>
+#include <io/TempFile.h>
+#include <types/RowCol.h>
+
+#include "TestCase.h"
+#include "../tests/TestUtilities.h"
+
+namespace
+{
+const types::RowCol<size_t> DIMS(100, 50);
+
+std::complex<sys::Int16_T> getSample(size_t vector, size_t sample)
+{
+    return std::complex<sys::Int16_T>(
+            static_cast<sys::Int16_T>(vector * 100 + sample),
+            -static_cast<sys::Int16_T>(sample));
+}
+
+double getAmpSF(size_t vector)
+{
+    return 0.5 * vector + 1.0;
+}
+
+double getTxTime(size_t vector)
+{
+    return 0.25 * vector;
+}
+
+// Writes out a single channel Int16 CPHD with AmpSF
+void writeCPHD(const std::string& pathname)
+{
+    cphd::Metadata metadata =
+            createMetadata(1, DIMS, cphd::SampleType::RE16I_IM16I);
+
+    cphd::VBM vbm(1,
+                  std::vector<size_t>(1, DIMS.row),
+                  false,
+                  false,
+                  true,
+                  metadata.global.domainType);
+    for (size_t ii = 0; ii < DIMS.row; ++ii)
+    {
+        vbm.setTxTime(getTxTime(ii), 0, ii);
+        vbm.setAmpSF(getAmpSF(ii), 0, ii);
+    }
+    vbm.updateVectorParameters(metadata.vectorParameters);
+
+    std::vector<std::complex<sys::Int16_T> > data(DIMS.area());
+    for (size_t ii = 0, idx = 0; ii < DIMS.row; ++ii)
+    {
+        for (size_t jj = 0; jj < DIMS.col; ++jj, ++idx)
+        {
+            data[idx] = getSample(ii, jj);
+        }
+    }
+
+    cphd::CPHDWriter writer(metadata, 1);
+    writer.writeMetadata(pathname, vbm);
+    writer.writeCPHDData(&data[0], data.size());
+}
+
+// Streams the vectors and samples in the given range and makes sure each
+// block matches what was written
+bool checkStream(cphd::PulseStream::OutputType outputType,
+                 size_t numVectorsPerBlock,
+                 size_t numPrefetchBlocks,
+                 size_t firstVector,
+                 size_t lastVector,
+                 size_t firstSample,
+                 size_t lastSample)
+{
+    io::TempFile tempfile;
+    writeCPHD(tempfile.pathname());
+
+    cphd::CPHDReader reader(tempfile.pathname(), 1);
+    cphd::PulseStream stream(reader, 0, outputType, numVectorsPerBlock,
+                             numPrefetchBlocks, firstVector, lastVector,
+                             firstSample, lastSample, 2);
+
+    const size_t numVectors = lastVector - firstVector + 1;
+    const size_t numSamples = lastSample - firstSample + 1;
+    if (stream.getNumBlocks() !=
+            (numVectors + numVectorsPerBlock - 1) / numVectorsPerBlock)
+    {
+        return false;
+    }
+
+    size_t vector = firstVector;
+    while (const cphd::PulseBlock* block = stream.next())
+    {
+        if (block->getFirstVector() != vector ||
+            block->getNumSamples() != numSamples ||
+            block->getNumVectors() == 0 ||
+            block->getNumVectors() > numVectorsPerBlock)
+        {
+            return false;
+        }
+
+        const mem::BufferView<const double> txTimes =
+                block->getVBM(&cphd::VBM::getTxTimes);
+        if (txTimes.size != block->getNumVectors())
+        {
+            return false;
+        }
+
+        const std::complex<sys::Int16_T>* raw = NULL;
+        const std::complex<float>* data = NULL;
+        if (outputType == cphd::PulseStream::RAW)
+        {
+            raw = reinterpret_cast<const std::complex<sys::Int16_T>*>(
+                    block->getRawData().data);
+        }
+        else
+        {
+            data = block->getData().data;
+        }
+
+        for (size_t ii = 0, idx = 0; ii < block->getNumVectors(); ++ii)
+        {
+            const size_t thisVector = vector + ii;
+            if (txTimes.data[ii] != getTxTime(thisVector))
+            {
+                return false;
+            }
+
+            const double scale = (outputType == cphd::PulseStream::SCALED) ?
+                    getAmpSF(thisVector) : 1.0;
+            for (size_t jj = 0; jj < numSamples; ++jj, ++idx)
+            {
+                const std::complex<sys::Int16_T> expected =
+                        getSample(thisVector, firstSample + jj);
+                if (raw)
+                {
+                    if (raw[idx] != expected)
+                    {
+                        return false;
+                    }
+                }
+                else if (data[idx].real() != expected.real() * scale ||
+                         data[idx].imag() != expected.imag() * scale)
+                {
+                    return false;
+                }
+            }
+        }
+
+        vector += block->getNumVectors();
+    }
+
+    return (vector == lastVector + 1 && stream.next() == NULL);
+}
+
+TEST_CASE(testRaw)
+{
+    TEST_ASSERT(checkStream(cphd::PulseStream::RAW, 7, 2,
+                            0, DIMS.row - 1, 0, DIMS.col - 1));
+}
+
+TEST_CASE(testPromoted)
+{
+    TEST_ASSERT(checkStream(cphd::PulseStream::PROMOTED, 16, 3,
+                            0, DIMS.row - 1, 0, DIMS.col - 1));
+}
+
+TEST_CASE(testScaled)
+{
+    TEST_ASSERT(checkStream(cphd::PulseStream::SCALED, 10, 1,
+                            0, DIMS.row - 1, 0, DIMS.col - 1));
+}
+
+TEST_CASE(testSubRegion)
+{
+    TEST_ASSERT(checkStream(cphd::PulseStream::SCALED, 9, 2,
+                            13, 71, 5, 30));
+    TEST_ASSERT(checkStream(cphd::PulseStream::RAW, 200, 2,
+                            13, 71, 5, 30));
+}
+
+TEST_CASE(testNoPrefetch)
+{
+    TEST_ASSERT(checkStream(cphd::PulseStream::SCALED, 11, 0,
+                            2, 97, 0, DIMS.col - 1));
+}
+
+TEST_CASE(testStopEarly)
+{
+    io::TempFile tempfile;
+    writeCPHD(tempfile.pathname());
+
+    cphd::CPHDReader reader(tempfile.pathname(), 1);
+    {
+        cphd::PulseStream stream(reader, 0, cphd::PulseStream::PROMOTED, 3);
+        TEST_ASSERT(stream.next() != NULL);
+        TEST_ASSERT(stream.next() != NULL);
+    }
+
+    // The wideband is usable again once the stream's gone
+    std::vector<std::complex<float> > data(DIMS.col);
+    reader.getWideband().read(0, 50, 50, 0, cphd::Wideband::ALL,
+                              std::vector<double>(1, 1.0), 1,
+                              mem::BufferView<std::complex<float> >(
+                                      &data[0], data.size()));
+    TEST_ASSERT_EQ(data[3].real(), getSample(50, 3).real());
+}
+
+TEST_CASE(testInvalidInputs)
+{
+    io::TempFile tempfile;
+    writeCPHD(tempfile.pathname());
+
+    cphd::CPHDReader reader(tempfile.pathname(), 1);
+    TEST_EXCEPTION(cphd::PulseStream(reader, 1, cphd::PulseStream::RAW, 3));
+    TEST_EXCEPTION(cphd::PulseStream(reader, 0, cphd::PulseStream::RAW, 0));
+    TEST_EXCEPTION(cphd::PulseStream(reader, 0, cphd::PulseStream::RAW, 3,
+                                     2, 0, DIMS.row));
+
+    cphd::PulseStream stream(reader, 0, cphd::PulseStream::RAW, 3);
+    TEST_EXCEPTION(stream.next()->getData());
+}
+}
+
+int main(int , char** )
+{
+    TEST_CHECK(testRaw);
+    TEST_CHECK(testPromoted);
+    TEST_CHECK(testScaled);
+    TEST_CHECK(testSubRegion);
+    TEST_CHECK(testNoPrefetch);
+    TEST_CHECK(testStopEarly);
+    TEST_CHECK(testInvalidInputs);
+    return 0;
+}
@@ -20,6 +20,8 @@
  *
  */
 
+#include <sstream>
+
 #include <cphd/VBM.h>
 
 #include "TestCase.h"
@@ -225,6 +227,69 @@ TEST_CASE(testVbmCopy)
     TEST_ASSERT_EQ(vbmToa, vbmToaCopy);
 }
 
+TEST_CASE(testVbmBulkGetters)
+{
+    std::vector<size_t> numVectors(NUM_CHANNELS);
+    for (size_t ii = 0; ii < NUM_CHANNELS; ++ii)
+    {
+        numVectors[ii] = NUM_VECTORS + ii;
+    }
+
+    cphd::VBM vbm(NUM_CHANNELS,
+                  numVectors,
+                  true,
+                  false,
+                  true,
+                  cphd::DomainType::FX);
+
+    for (size_t channel = 0; channel < NUM_CHANNELS; ++channel)
+    {
+        for (size_t vector = 0; vector < numVectors[channel]; ++vector)
+        {
+            vbm.setTxTime(getRandom(), channel, vector);
+            vbm.setRcvPos(getRandomVector3(), channel, vector);
+            vbm.setAmpSF(getRandom(), channel, vector);
+            vbm.setFx2(getRandom(), channel, vector);
+        }
+    }
+
+    for (size_t channel = 0; channel < NUM_CHANNELS; ++channel)
+    {
+        const mem::BufferView<const double> txTimes =
+                vbm.getTxTimes(channel);
+        const mem::BufferView<const double> rcvPositions =
+                vbm.getRcvPositions(channel);
+        const mem::BufferView<const double> ampSFs = vbm.getAmpSFs(channel);
+        const mem::BufferView<const double> fx2s = vbm.getFx2s(channel);
+
+        TEST_ASSERT_EQ(txTimes.size, numVectors[channel]);
+        TEST_ASSERT_EQ(rcvPositions.size, numVectors[channel] * 3);
+        TEST_ASSERT_EQ(ampSFs.size, numVectors[channel]);
+        TEST_ASSERT_EQ(fx2s.size, numVectors[channel]);
+
+        for (size_t vector = 0; vector < numVectors[channel]; ++vector)
+        {
+            TEST_ASSERT_EQ(txTimes.data[vector],
+                           vbm.getTxTime(channel, vector));
+            const cphd::Vector3 rcvPos = vbm.getRcvPos(channel, vector);
+            TEST_ASSERT_EQ(rcvPositions.data[vector * 3], rcvPos[0]);
+            TEST_ASSERT_EQ(rcvPositions.data[vector * 3 + 1], rcvPos[1]);
+            TEST_ASSERT_EQ(rcvPositions.data[vector * 3 + 2], rcvPos[2]);
+            TEST_ASSERT_EQ(ampSFs.data[vector],
+                           vbm.getAmpSF(channel, vector));
+            TEST_ASSERT_EQ(fx2s.data[vector], vbm.getFx2(channel, vector));
+        }
+
+        TEST_EXCEPTION(vbm.getTropoSRPs(channel));
+        TEST_EXCEPTION(vbm.getTOASSs(channel));
+    }
+    TEST_EXCEPTION(vbm.getTxTimes(NUM_CHANNELS));
+
+    vbm.clearAmpSF();
+    TEST_EXCEPTION(vbm.getAmpSFs(0));
+    TEST_ASSERT_EQ(vbm.getFx2s(0).data[0], vbm.getFx2(0, 0));
+}
+
 TEST_CASE(testDataConstructor)
 {
     std::vector<std::vector<double> > actualData(NUM_CHANNELS);
@@ -289,6 +354,57 @@ TEST_CASE(testDataConstructor)
         }
     }
 }
+
+TEST_CASE(testPaddedVectors)
+{
+    // The file allots more bytes per vector than the fields need
+    cphd::Data data;
+    data.numCPHDChannels = 1;
+    data.arraySize.push_back(cphd::ArraySize(NUM_VECTORS, 4));
+    data.setNumBytesVBP(200);
+    cphd::VBM vbm(data, cphd::VectorParameters());
+    TEST_ASSERT_EQ(vbm.getNumBytesVBP(), static_cast<size_t>(200));
+
+    for (size_t ii = 0; ii < NUM_VECTORS; ++ii)
+    {
+        vbm.setTxTime(getRandom(), 0, ii);
+        vbm.setTxPos(getRandomVector3(), 0, ii);
+        vbm.setRcvTime(getRandom(), 0, ii);
+        vbm.setRcvPos(getRandomVector3(), 0, ii);
+        vbm.setSRPPos(getRandomVector3(), 0, ii);
+    }
+
+    // TxTime, TxPos, RcvTime, RcvPos and SRPPos take up the first 88 bytes
+    // of each vector and the rest must come out zeroed
+    std::vector<sys::ubyte> buffer(vbm.getVBMsize(0), 0xFF);
+    vbm.getVBMdata(0, &buffer[0]);
+    for (size_t ii = 0; ii < NUM_VECTORS; ++ii)
+    {
+        for (size_t jj = 88; jj < 200; ++jj)
+        {
+            TEST_ASSERT_EQ(buffer[ii * 200 + jj], 0);
+        }
+    }
+}
+
+TEST_CASE(testVbmPrint)
+{
+    cphd::VBM vbm(1,
+                  std::vector<size_t>(1, 2),
+                  false,
+                  false,
+                  false,
+                  cphd::DomainType::TOA);
+    vbm.setTxTime(1.5, 0, 0);
+    vbm.setTxTime(2.5, 0, 1);
+
+    std::ostringstream stream;
+    stream << vbm;
+    TEST_ASSERT(stream.str().find("[0] TxTime: 1.5 2.5\n") !=
+                std::string::npos);
+    TEST_ASSERT(stream.str().find("[0] DeltaTOA0:") != std::string::npos);
+    TEST_ASSERT(stream.str().find("[0] Fx0:") == std::string::npos);
+}
 }
 
 int main(int , char** )
@@ -298,7 +414,10 @@ int main(int , char** )
     TEST_CHECK(testVbmToa);
     TEST_CHECK(testVbmThrow);
     TEST_CHECK(testVbmCopy);
+    TEST_CHECK(testVbmBulkGetters);
     TEST_CHECK(testDataConstructor);
+    TEST_CHECK(testPaddedVectors);
+    TEST_CHECK(testVbmPrint);
     return 0;
 }
 
@@ -21,8 +21,9 @@
  */
 
 /*
- * This program gets a rough output plane from the SICD, and writes it as
- * an SIO. No filtering is done. As a result, the output plane contains
+ * This program projects the SICD's image data to the output plane with
+ * six::sicd::Orthorectifier and writes its amplitude as an SIO.  No
+ * filtering is done. As a result, the output plane contains
  * some massive values that skew the image. Therefore, when viewing the
  * image, you will have to mitigate this. When viewing in MATLAB,
  * for example, this may be done by
@@ -32,39 +33,33 @@
 
 #include <cli/ArgumentParser.h>
 #include <cli/Results.h>
-#include <math/Round.h>
+#include <mem/ScopedArray.h>
 #include <sio/lite/FileWriter.h>
-#include <scene/ProjectionPolynomialFitter.h>
+#include <six/NITFReadControl.h>
 #include <six/XMLControl.h>
 #include <six/XMLControlFactory.h>
-#include <six/sicd/AreaPlaneUtility.h>
 #include <six/sicd/ComplexXMLControl.h>
-#include <six/sicd/Utilities.h>
+#include <six/sicd/Orthorectifier.h>
 #include "utils.h"
 
 namespace
 {
-void findOutputToSlantPolynomials(const six::sicd::ComplexData& complexData,
-        size_t polyOrderX, size_t polyOrderY,
-        six::Poly2D& toSlantRow, six::Poly2D& toSlantCol)
+six::sicd::Orthorectifier::Interpolation
+getInterpolation(const std::string& name)
 {
-    std::auto_ptr<scene::ProjectionPolynomialFitter> polynomialFitter(
-            six::sicd::Utilities::getPolynomialFitter(complexData));
-    const six::RowColDouble sampleSpacing(
-            complexData.grid->row->sampleSpacing,
-            complexData.grid->col->sampleSpacing);
-    const six::RowColDouble offset(
-            complexData.imageData->firstRow,
-            complexData.imageData->firstCol);
-    polynomialFitter->fitOutputToSlantPolynomials(
-            offset,
-            complexData.imageData->scpPixel,
-            complexData.imageData->scpPixel,
-            sampleSpacing,
-            polyOrderX,
-            polyOrderY,
-            toSlantRow,
-            toSlantCol);
+    if (name == "nearest")
+    {
+        return six::sicd::Orthorectifier::NEAREST;
+    }
+    if (name == "bilinear")
+    {
+        return six::sicd::Orthorectifier::BILINEAR;
+    }
+    if (name == "sinc")
+    {
+        return six::sicd::Orthorectifier::SINC;
+    }
+    throw except::Exception(Ctxt("Unknown interpolation " + name));
 }
 }
 
@@ -84,6 +79,13 @@ int main(int argc, char** argv)
         parser.addArgument("-y --polyOrderY", "Order for y-direction polynomials",
                            cli::STORE, "polyOrderY", "POLY_ORDER_Y", 1, 1)->
                            setDefault(3);
+        parser.addArgument("-i --interpolation",
+                           "Interpolation (nearest, bilinear, or sinc)",
+                           cli::STORE, "interpolation", "METHOD", 1, 1)->
+                           setDefault("nearest");
+        parser.addArgument("-t --threads", "Number of threads to use",
+                           cli::STORE, "threads", "NUM", 1, 1)->
+                           setDefault(1);
         parser.addArgument("input", "Input SICD", cli::STORE, "input", "INPUT",
                             1, 1);
         parser.addArgument("output", "Output SIO Pathname", cli::STORE,
@@ -95,6 +97,9 @@ int main(int argc, char** argv)
         const std::string outputPathname(options->get<std::string>("output"));
         const size_t polyOrderX(options->get<size_t>("polyOrderX"));
         const size_t polyOrderY(options->get<size_t>("polyOrderY"));
+        const six::sicd::Orthorectifier::Interpolation interpolation(
+                getInterpolation(options->get<std::string>("interpolation")));
+        const size_t numThreads(options->get<size_t>("threads"));
         std::vector<std::string> schemaPaths;
         getSchemaPaths(*options, "--schema", "schema", schemaPaths);
 
@@ -102,59 +107,22 @@ int main(int argc, char** argv)
         registry.addCreator(six::DataType::COMPLEX,
                 new six::XMLControlCreatorT<six::sicd::ComplexXMLControl>());
 
-        std::auto_ptr<six::sicd::ComplexData> complexData;
-        std::vector<std::complex<float> > buffer;
-        six::sicd::Utilities::readSicd(sicdPathname, schemaPaths, complexData,
-                buffer);
-
-        // Derive AreaPlane if not defined
-        if (!six::sicd::AreaPlaneUtility::hasAreaPlane(*complexData))
-        {
-            six::sicd::AreaPlaneUtility::setAreaPlane(*complexData);
-        }
-        const six::sicd::AreaPlane& plane =
-                *complexData->radarCollection->area->plane;
-
-        // Grab outputToSlant plane polynomials
-        six::Poly2D toSlantRow;
-        six::Poly2D toSlantCol;
-        findOutputToSlantPolynomials(*complexData, polyOrderX, polyOrderY,
-                toSlantRow, toSlantCol);
+        six::NITFReadControl reader;
+        reader.setXMLControlRegistry(&registry);
+        reader.load(sicdPathname, schemaPaths);
 
-        toSlantRow = toSlantRow.flipXY();
-        toSlantCol = toSlantCol.flipXY();
-        mem::ScopedArray<float> outputArray(new float[
-                plane.xDirection->elements * plane.yDirection->elements]);
-        // Iterate over output plane, grabbing the appropriate input point
-        for (size_t outRow = 0; outRow < plane.xDirection->elements; ++outRow)
-        {
-            const six::Poly1D rowPoly = toSlantRow.atY(outRow);
-            const six::Poly1D colPoly = toSlantCol.atY(outRow);
-            for (size_t outCol = 0;
-                    outCol < plane.yDirection->elements; ++outCol)
-            {
-                const size_t outIdx = (outRow * plane.yDirection->elements) +
-                        outCol;
-                const double inRowInitial = rowPoly(outCol);
-                const double inColInitial = colPoly(outCol);
-                if (inRowInitial < 0 || inColInitial < 0)
-                {
-                    // Out of bounds values just get assigned to 0
-                    outputArray[outIdx] = 0;
-                    continue;
-                }
-                const size_t inRow = math::round(inRowInitial);
-                const size_t inCol = math::round(inColInitial);
-                const size_t inIdx = (inRow * complexData->getNumCols()) +
-                        inCol;
-                const float outputValue = inIdx >= buffer.size() ? 0 :
-                        std::abs(buffer[inIdx]);
-                outputArray[outIdx] = outputValue;
-            }
-        }
+        // The input pixels are read a block of output rows at a time
+        six::sicd::Orthorectifier orthorectifier(
+                reader, interpolation, numThreads,
+                six::sicd::Orthorectifier::DEFAULT_ROWS_PER_BLOCK,
+                polyOrderX, polyOrderY);
+        const types::RowCol<size_t> outputDims =
+                orthorectifier.getOutputDims();
+        mem::ScopedArray<float> outputArray(new float[outputDims.area()]);
+        orthorectifier.getAmplitude(0, outputDims.row, outputArray.get());
 
         sio::lite::FileWriter writer(outputPathname);
-        writer.write(plane.xDirection->elements, plane.yDirection->elements,
+        writer.write(outputDims.row, outputDims.col,
                 sizeof(float), sio::lite::FileHeader::FLOAT, outputArray.get());
 
         return 0;
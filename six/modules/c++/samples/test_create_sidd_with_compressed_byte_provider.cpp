@@ -25,10 +25,11 @@
  * This test serves as an example to show how one can use CompressedSIDDByteProvider
  * to create a SIDD with J2K compression.
  *
- * While this demonstrates use of CompressedSIDDByteProvider, the module for
- * actually compressing the image data is not a part of SIX. Actual data will
- * be uncompressed. Search for COMPRESSION comments to see an explanation
- * of what will change with a compressor.
+ * By default, the image data is passed through uncompressed to show what the
+ * byte provider expects.  Search for COMPRESSION comments to see an
+ * explanation of what will change with a compressor.  With --compress, the
+ * image is J2K compressed with CompressedSIDDEncoder instead (this requires
+ * SIX to be built with J2K support).
  */
 
 #include <import/cli.h>
@@ -40,8 +41,10 @@
 #include <nitf/Record.hpp>
 #include <six/Types.h>
 #include <six/sidd/CompressedSIDDByteProvider.h>
+#include <six/sidd/CompressedSIDDEncoder.h>
 #include <six/sidd/DerivedData.h>
 #include <six/sidd/DerivedXMLControl.h>
+#include <six/sidd/J2KBlockCompressor.h>
 #include <six/sidd/Utilities.h>
 #include <types/RowCol.h>
 #include <string>
@@ -1005,7 +1008,42 @@ createData(const types::RowCol<size_t>& dims)
     return data;
 }
 
-void writeSIDD(const std::string& filename, bool shouldCompress)
+void writeBuffers(const nitf::NITFBufferList& buffers,
+                  const std::string& filename)
+{
+    io::FileOutputStream outputStream(filename);
+    for (size_t ii = 0; ii < buffers.mBuffers.size(); ++ii)
+    {
+        outputStream.write(
+                static_cast<const sys::byte*>(buffers.mBuffers[ii].mData),
+                buffers.mBuffers[ii].mNumBytes);
+    }
+}
+
+void writeCompressedSIDD(const std::string& filename)
+{
+    std::auto_ptr<six::sidd::DerivedData> data = createData(
+            types::RowCol<size_t>(NITRO_IMAGE.height, NITRO_IMAGE.width));
+
+    // Compress 32x32 blocks losslessly on a couple threads.  The encoder
+    // provides the bytesPerBlock and compressed bytes for the byte provider.
+    const size_t blockSize = 32;
+    const six::sidd::J2KBlockCompressor compressor(*data, blockSize,
+                                                   blockSize);
+    six::sidd::CompressedSIDDEncoder encoder(*data, compressor, blockSize,
+                                             blockSize, 2);
+    encoder.encode(NITRO_IMAGE.data);
+
+    const std::auto_ptr<six::sidd::CompressedSIDDByteProvider> byteProvider =
+            encoder.createByteProvider(std::vector<std::string>());
+    nitf::Off fileOffset;
+    nitf::NITFBufferList buffers;
+    byteProvider->getBytes(encoder.getCompressedData(), 0, NITRO_IMAGE.height,
+                           fileOffset, buffers);
+    writeBuffers(buffers, filename);
+}
+
+void writeSIDD(const std::string& filename)
 {
     const size_t NUM_BANDS = 1;
     /*
@@ -1051,13 +1089,7 @@ void writeSIDD(const std::string& filename, bool shouldCompress)
     nitf::NITFBufferList buffers;
     byteProvider.getBytes(NITRO_IMAGE.data, 0, NITRO_IMAGE.height,
             fileOffset, buffers);
-    io::FileOutputStream outputStream(filename);
-    for (size_t ii = 0; ii < buffers.mBuffers.size(); ++ii)
-    {
-        outputStream.write(
-                static_cast<const sys::byte*>(buffers.mBuffers[ii].mData),
-                buffers.mBuffers[ii].mNumBytes);
-    }
+    writeBuffers(buffers, filename);
 }
 
 bool testRead(const std::string& pathname)
@@ -1101,15 +1133,17 @@ int main(int argc, char **argv)
             "OUTPUT", 1, 1, true)->setDefault("test_create.nitf");
 
         std::auto_ptr<cli::Results> options(parser.parse(argc, argv));
-        // We can't actually compress. This is just for illustration.
         const bool shouldCompress(options->get<bool>("shouldCompress"));
+        const std::string outname(options->get<std::string>("output"));
+
         if (shouldCompress)
         {
-            throw except::Exception(Ctxt("Compression not implemented"));
+            // Reading it back would need a J2K decompressor
+            writeCompressedSIDD(outname);
+            return 0;
         }
-        const std::string outname(options->get<std::string>("output"));
 
-        writeSIDD(outname, shouldCompress);
+        writeSIDD(outname);
         if (testRead(outname))
         {
             return 0;
@@ -0,0 +1,71 @@
+/* =========================================================================
+ * This file is part of scene-c++
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2014, MDA Information Systems LLC
+ *
+ * scene-c++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __SCENE_ELEVATION_MODEL_H__
+#define __SCENE_ELEVATION_MODEL_H__
+
+#include <stddef.h>
+
+namespace scene
+{
+/*!
+ *  \class ElevationModel
+ *  \brief A source of terrain heights, such as a DEM, for projecting image
+ *  points onto the terrain (see ProjectionModel::imageToScene())
+ *
+ *  Implementations must be safe to call from several threads at once.
+ */
+class ElevationModel
+{
+public:
+    virtual ~ElevationModel();
+
+    /*!
+     * Get the terrain height at a point.  Throws if the point isn't covered
+     * by the model.
+     *
+     * \param lat Latitude in degrees
+     * \param lon Longitude in degrees
+     *
+     * \return Height in meters above the WGS-84 ellipsoid
+     */
+    virtual double getHeight(double lat, double lon) const = 0;
+
+    /*!
+     * Batch version of getHeight().  The default implementation just calls
+     * getHeight() for each point, but implementations can take advantage of
+     * nearby points sharing the same data.
+     *
+     * \param lats numPoints latitudes in degrees
+     * \param lons numPoints longitudes in degrees
+     * \param numPoints Number of points
+     * \param heights [output] numPoints heights in meters above the WGS-84
+     * ellipsoid
+     */
+    virtual void getHeights(const double* lats,
+                            const double* lons,
+                            size_t numPoints,
+                            double* heights) const;
+};
+}
+
+#endif
@@ -31,6 +31,8 @@
 
 namespace scene
 {
+class ElevationModel;
+
 class ProjectionModel
 {
 public:
@@ -204,6 +206,106 @@ public:
                          double heightThreshold = 1.0,
                          size_t maxNumIters = 3) const;
 
+    /*!
+     * Projects onto the terrain given by an elevation model, such as a DEM
+     *
+     * This searches along the R/Rdot contour for the height where it meets
+     * the terrain.  Each step projects to a constant height surface as the
+     * overloading above does, then looks up the terrain height there.  Until
+     * the search has found points both above and below the terrain, the
+     * next height to try is the terrain height it just looked up.  After
+     * that, the terrain crossing is narrowed down between them.  Where the
+     * contour crosses the terrain more than once (layover), whichever
+     * crossing the search finds first is returned.
+     *
+     *  \param imageGridPoint A point (meters) in the image surface
+     *  (continuous)
+     *  \param elevation Terrain heights.  It must cover the area being
+     *  projected to.
+     *  \param delta Delta values to apply for the adjustable parameters
+     *  \param heightThreshold Height threshold (meters).  The search stops
+     *  once the point on the contour is this close to the terrain height.
+     *  Must be positive.
+     *  \param maxNumIters Maximum number of terrain heights to look up.
+     *  Throws if the search hasn't converged by then.
+     *
+     *  \return A scene (ground) point in 3 space on the terrain
+     */
+    Vector3 imageToScene(const types::RowCol<double>& imageGridPoint,
+                         const ElevationModel& elevation,
+                         const AdjustableParams& delta = AdjustableParams(),
+                         double heightThreshold = 1.0,
+                         size_t maxNumIters = 20) const;
+
+    /*!
+     *  Batch versions of the projections above.  Each takes and returns
+     *  numPoints points as separate arrays of each coordinate, and gives
+     *  the same results as calling the single point version on each point.
+     *
+     *  Points are projected in blocks.  The TimeCOA and ARP polynomials are
+     *  evaluated over a whole block with their coefficients pulled out
+     *  once, and the ground plane intersection math runs over the block in
+     *  loops that the compiler can vectorize.  Blocks are split across
+     *  numThreads threads.
+     *
+     *  If any point fails to project, the exception the single point
+     *  version would throw is thrown, and the outputs are incomplete.
+     */
+
+    //! Batch version of imageToScene() onto a ground plane
+    //  \param oTimeCOA [output] Optional array of numPoints TimeCOAs
+    void imageToScene(const double* rows,
+                      const double* cols,
+                      size_t numPoints,
+                      const Vector3& groundRefPoint,
+                      const Vector3& groundPlaneNormal,
+                      double* sceneX,
+                      double* sceneY,
+                      double* sceneZ,
+                      size_t numThreads = 1,
+                      const AdjustableParams& delta = AdjustableParams(),
+                      double* oTimeCOA = NULL) const;
+
+    //! Batch version of imageToScene() onto a constant height surface
+    void imageToScene(const double* rows,
+                      const double* cols,
+                      size_t numPoints,
+                      double height,
+                      double* sceneX,
+                      double* sceneY,
+                      double* sceneZ,
+                      size_t numThreads = 1,
+                      const AdjustableParams& delta = AdjustableParams(),
+                      double heightThreshold = 1.0,
+                      size_t maxNumIters = 3) const;
+
+    //! Batch version of imageToScene() onto the terrain.  The points still
+    //  searching in each block look up their terrain heights together
+    //  through ElevationModel::getHeights().
+    void imageToScene(const double* rows,
+                      const double* cols,
+                      size_t numPoints,
+                      const ElevationModel& elevation,
+                      double* sceneX,
+                      double* sceneY,
+                      double* sceneZ,
+                      size_t numThreads = 1,
+                      const AdjustableParams& delta = AdjustableParams(),
+                      double heightThreshold = 1.0,
+                      size_t maxNumIters = 20) const;
+
+    //! Batch version of sceneToImage()
+    //  \param oTimeCOA [output] Optional array of numPoints TimeCOAs
+    void sceneToImage(const double* sceneX,
+                      const double* sceneY,
+                      const double* sceneZ,
+                      size_t numPoints,
+                      double* rows,
+                      double* cols,
+                      size_t numThreads = 1,
+                      const AdjustableParams& delta = AdjustableParams(),
+                      double* oTimeCOA = NULL) const;
+
     math::linear::MatrixMxN<2, 2> slantToImagePartials(
             const types::RowCol<double>& imageGridPoint,
             double delta = 0.0001) const;
@@ -363,6 +465,85 @@ protected:
 
     AdjustableParams mAdjustableParams;
     Errors mErrors;
+
+private:
+    // Number of points the batch methods project at a time
+    enum { BATCH_BLOCK_SIZE = 256 };
+
+    // R/Rdot contours, along with the TimeCOA and adjusted ARP position and
+    // velocity they were computed from, for a block of points
+    struct ContourBlock
+    {
+        double timeCOA[BATCH_BLOCK_SIZE];
+        double r[BATCH_BLOCK_SIZE];
+        double rDot[BATCH_BLOCK_SIZE];
+        double arpX[BATCH_BLOCK_SIZE];
+        double arpY[BATCH_BLOCK_SIZE];
+        double arpZ[BATCH_BLOCK_SIZE];
+        double velX[BATCH_BLOCK_SIZE];
+        double velY[BATCH_BLOCK_SIZE];
+        double velZ[BATCH_BLOCK_SIZE];
+    };
+
+    struct BatchPolys;
+    struct BatchArgs;
+    class ProjectBlocksRunnable;
+
+    typedef void (ProjectionModel::*ProjectBlockFunc)(const BatchArgs& args,
+                                                      size_t start,
+                                                      size_t numPoints) const;
+
+    void projectBatch(ProjectBlockFunc func,
+                      const BatchArgs& args,
+                      size_t numPoints,
+                      size_t numThreads) const;
+
+    void imageToPlaneBlock(const BatchArgs& args,
+                           size_t start,
+                           size_t numPoints) const;
+
+    void imageToHeightBlock(const BatchArgs& args,
+                            size_t start,
+                            size_t numPoints) const;
+
+    void imageToElevationBlock(const BatchArgs& args,
+                               size_t start,
+                               size_t numPoints) const;
+
+    void sceneToImageBlock(const BatchArgs& args,
+                           size_t start,
+                           size_t numPoints) const;
+
+    // Computes the contours for up to BATCH_BLOCK_SIZE points
+    void computeContours(const BatchPolys& polys,
+                         const double* rows,
+                         const double* cols,
+                         size_t numPoints,
+                         const AdjustableParams& delta,
+                         ContourBlock& contours) const;
+
+    // Batch version of contourToGroundPlane().  Each plane is given as
+    // arrays of x, y, and z.  A stride of 0 uses the same plane for every
+    // point.
+    void contourToGroundPlane(const ContourBlock& contours,
+                              size_t numPoints,
+                              const double* const groundPlaneNormal[3],
+                              size_t normalStride,
+                              const double* const groundRefPoint[3],
+                              size_t refStride,
+                              double* const groundPoint[3]) const;
+
+    // Steps 2 through 7 of imageToScene() onto a constant height surface,
+    // starting from the contour
+    Vector3 contourToHeight(double r,
+                            double rDot,
+                            const Vector3& arpCOA,
+                            const Vector3& velCOA,
+                            double height,
+                            Vector3 groundPlaneNormal,
+                            Vector3 groundRefPoint,
+                            double heightThreshold,
+                            size_t maxNumIters) const;
 };
 
 class ProjectionModelWithImageVectors : public ProjectionModel
@@ -0,0 +1,200 @@
+/* =========================================================================
+ * This file is part of scene-c++
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2014, MDA Information Systems LLC
+ *
+ * scene-c++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __SCENE_TILED_ELEVATION_MODEL_H__
+#define __SCENE_TILED_ELEVATION_MODEL_H__
+
+#include <list>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <sys/Conf.h>
+#include <sys/ConditionVar.h>
+#include <sys/Mutex.h>
+#include <mem/SharedPtr.h>
+#include <io/FileInputStream.h>
+#include <types/RowCol.h>
+#include <scene/Types.h>
+#include <scene/ElevationModel.h>
+
+namespace scene
+{
+/*!
+ *  \class TiledElevationModel
+ *  \brief An elevation model on a regular lat/lon grid of posts, read in
+ *  tiles as they're needed
+ *
+ *  Rows of posts run south from the north west corner, and columns run
+ *  east.  Heights between posts are bilinearly interpolated.  Tiles are
+ *  kept in a least recently used cache, so memory is bounded by
+ *  maxNumTiles no matter how big the grid is.  Subclasses provide the
+ *  posts by implementing readPosts().
+ */
+class TiledElevationModel : public ElevationModel
+{
+public:
+    /*!
+     * \param northWest Lat/lon in degrees of the north west post
+     * \param spacing Spacing between posts in degrees, in latitude (row)
+     * and longitude (col)
+     * \param numPosts Number of posts in each direction.  Must be at least
+     * 2 each way.
+     * \param tileSize Number of posts along each side of a tile
+     * \param maxNumTiles Maximum number of tiles to keep in memory
+     */
+    TiledElevationModel(const LatLon& northWest,
+                        const types::RowCol<double>& spacing,
+                        const types::RowCol<size_t>& numPosts,
+                        size_t tileSize = 256,
+                        size_t maxNumTiles = 64);
+
+    virtual ~TiledElevationModel();
+
+    virtual double getHeight(double lat, double lon) const;
+
+    //! Looks up the tile only when the points move on to a new one
+    virtual void getHeights(const double* lats,
+                            const double* lons,
+                            size_t numPoints,
+                            double* heights) const;
+
+    //! Number of tiles read so far, counting tiles read again after they
+    //  were dropped from the cache
+    size_t getNumTilesRead() const;
+
+protected:
+    /*!
+     * Read a block of posts.  Reads happen one at a time, so
+     * implementations don't need to do any locking of their own, but the
+     * cache isn't locked during them, so cached tiles can still be used.
+     *
+     * \param firstPost First post to read
+     * \param numPosts Number of posts to read in each direction
+     * \param heights [output] numPosts.area() heights in meters above the
+     * WGS-84 ellipsoid, row by row
+     */
+    virtual void readPosts(const types::RowCol<size_t>& firstPost,
+                           const types::RowCol<size_t>& numPosts,
+                           float* heights) const = 0;
+
+private:
+    struct Tile;
+    typedef std::list<std::pair<size_t, mem::SharedPtr<const Tile> > >
+            TileList;
+
+    // Finds the tile a point is in, along with the point's fractional
+    // post position in the grid
+    size_t getTileIndex(double lat,
+                        double lon,
+                        types::RowCol<double>& post) const;
+
+    mem::SharedPtr<const Tile> getTile(size_t tileIndex) const;
+
+    static double interpolate(const Tile& tile,
+                              const types::RowCol<double>& post);
+
+    // Noncopyable
+    TiledElevationModel(const TiledElevationModel& );
+    const TiledElevationModel& operator=(const TiledElevationModel& );
+
+private:
+    const LatLon mNorthWest;
+    const types::RowCol<double> mSpacing;
+    const types::RowCol<size_t> mNumPosts;
+    const size_t mTileSize;
+    const size_t mMaxNumTiles;
+    types::RowCol<size_t> mNumTiles;
+
+    // Guards the cache
+    mutable sys::Mutex mMutex;
+
+    // Most recently used first
+    mutable TileList mTiles;
+    mutable std::map<size_t, TileList::iterator> mTileMap;
+    mutable size_t mNumTilesRead;
+
+    // Tiles being read, and a signal for whoever is waiting on them
+    mutable std::set<size_t> mPendingTiles;
+    mutable sys::ConditionVar mTileRead;
+
+    // Makes readPosts() calls one at a time
+    mutable sys::Mutex mReadMutex;
+};
+
+/*!
+ *  \class RawElevationModel
+ *  \brief Reads elevation posts from a headerless file, stored row by row
+ *  starting from the north west post.  DEMs in other formats can be
+ *  supported by deriving from TiledElevationModel.
+ */
+class RawElevationModel : public TiledElevationModel
+{
+public:
+    //! How each post is stored
+    enum SampleType
+    {
+        INT16,
+        FLOAT32
+    };
+
+    /*!
+     * \param pathname File to read from
+     * \param sampleType How each post is stored
+     * \param bigEndian Whether the posts are stored big endian
+     * \param northWest Lat/lon in degrees of the north west post
+     * \param spacing Spacing between posts in degrees, in latitude (row)
+     * and longitude (col)
+     * \param numPosts Number of posts in each direction
+     * \param heightOffset Added to each post.  For data relative to mean sea
+     * level, this can be the geoid separation over a small area.
+     * \param tileSize Number of posts along each side of a tile
+     * \param maxNumTiles Maximum number of tiles to keep in memory
+     */
+    RawElevationModel(const std::string& pathname,
+                      SampleType sampleType,
+                      bool bigEndian,
+                      const LatLon& northWest,
+                      const types::RowCol<double>& spacing,
+                      const types::RowCol<size_t>& numPosts,
+                      double heightOffset = 0.0,
+                      size_t tileSize = 256,
+                      size_t maxNumTiles = 64);
+
+protected:
+    virtual void readPosts(const types::RowCol<size_t>& firstPost,
+                           const types::RowCol<size_t>& numPosts,
+                           float* heights) const;
+
+private:
+    mutable io::FileInputStream mFile;
+    const SampleType mSampleType;
+    const size_t mSampleSize;
+    const bool mSwap;
+    const size_t mNumCols;
+    const double mHeightOffset;
+    mutable std::vector<sys::ubyte> mBuffer;
+};
+}
+
+#endif
@@ -0,0 +1,41 @@
+/* =========================================================================
+ * This file is part of scene-c++
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2014, MDA Information Systems LLC
+ *
+ * scene-c++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "scene/ElevationModel.h"
+
+namespace scene
+{
+ElevationModel::~ElevationModel()
+{
+}
+
+void ElevationModel::getHeights(const double* lats,
+                                const double* lons,
+                                size_t numPoints,
+                                double* heights) const
+{
+    for (size_t ii = 0; ii < numPoints; ++ii)
+    {
+        heights[ii] = getHeight(lats[ii], lons[ii]);
+    }
+}
+}
@@ -20,11 +20,16 @@
  *
  */
 
+#include <algorithm>
 #include <limits>
 
+#include <sys/Runnable.h>
+#include <mt/ThreadGroup.h>
+#include <mt/ThreadPlanner.h>
 #include <math/Utilities.h>
 #include "scene/ProjectionModel.h"
 #include "scene/ECEFToLLATransform.h"
+#include "scene/ElevationModel.h"
 #include "scene/Utilities.h"
 
 namespace
@@ -33,6 +38,10 @@ const double EARTH_ROTATION_RATE = 0.000072921150; // Radians / sec
 
 const double DELTA_GP_MAX = 0.0000001;
 
+// Iterations used for each constant height projection while searching for
+// the terrain
+const size_t TERRAIN_HEIGHT_ITERS = 3;
+
 // TODO: Should this be a static method instead?
 scene::Vector3 computeUnitVector(const scene::LatLonAlt& latLon)
 {
@@ -49,6 +58,223 @@ scene::Vector3 computeUnitVector(const scene::LatLonAlt& latLon)
     return unitVector;
 }
 
+void checkHeightParams(double heightThreshold, size_t maxNumIters)
+{
+    // Sanity checks
+    if (heightThreshold <= 0)
+    {
+        throw except::Exception(Ctxt("Height threshold must be positive"));
+    }
+
+    if (maxNumIters < 1)
+    {
+        throw except::Exception(Ctxt(
+                "Max number of iterations must be positive"));
+    }
+}
+
+// Searches for the height where an R/Rdot contour meets the terrain, given
+// the difference between the terrain height and each height tried.  Once
+// there are heights on both sides of the terrain, this uses the Illinois
+// variant of regula falsi to close in on it.
+class TerrainSearch
+{
+public:
+    TerrainSearch() :
+        mHaveBelow(false),
+        mHaveAbove(false),
+        mLastSide(0),
+        mBelow(0.0),
+        mBelowDiff(0.0),
+        mAbove(0.0),
+        mAboveDiff(0.0)
+    {
+    }
+
+    // diff is the terrain height minus 'height'.  Returns the next height to
+    // try.
+    double next(double height, double diff)
+    {
+        if (diff > 0.0)
+        {
+            // The contour is below the terrain here
+            mHaveBelow = true;
+            mBelow = height;
+            mBelowDiff = diff;
+            if (mLastSide < 0)
+            {
+                mAboveDiff /= 2.0;
+            }
+            mLastSide = -1;
+        }
+        else
+        {
+            mHaveAbove = true;
+            mAbove = height;
+            mAboveDiff = diff;
+            if (mLastSide > 0)
+            {
+                mBelowDiff /= 2.0;
+            }
+            mLastSide = 1;
+        }
+
+        if (!(mHaveBelow && mHaveAbove))
+        {
+            return height + diff;
+        }
+
+        return mBelow -
+                mBelowDiff * (mAbove - mBelow) / (mAboveDiff - mBelowDiff);
+    }
+
+private:
+    bool mHaveBelow;
+    bool mHaveAbove;
+    int mLastSide;
+    double mBelow;
+    double mBelowDiff;
+    double mAbove;
+    double mAboveDiff;
+};
+
+// Geodetic ground plane at the given height below the SCP
+void computeHeightPlane(const scene::Vector3& scp,
+                        double height,
+                        scene::Vector3& groundPlaneNormal,
+                        scene::Vector3& groundRefPoint)
+{
+    const scene::ECEFToLLATransform ecefToLatLon;
+    const scene::LatLonAlt scpLatLon = ecefToLatLon.transform(scp);
+    groundPlaneNormal = computeUnitVector(scpLatLon);
+
+    groundRefPoint = scp + (height - scpLatLon.getAlt()) * groundPlaneNormal;
+}
+
+// Coefficients of a 2D polynomial pulled out so that it can be evaluated over
+// many points at once.  The terms are summed in the same order as
+// math::poly::TwoD does.
+class BatchTwoD
+{
+public:
+    BatchTwoD(const math::poly::TwoD<double>& poly) :
+        mOrderX(poly.orderX()),
+        mOrderY(poly.orderY()),
+        mCoef((mOrderX + 1) * (mOrderY + 1))
+    {
+        for (size_t ii = 0, idx = 0; ii <= mOrderX; ++ii)
+        {
+            const math::poly::OneD<double> polyY = poly[ii];
+            for (size_t jj = 0; jj <= mOrderY; ++jj, ++idx)
+            {
+                mCoef[idx] = polyY[jj];
+            }
+        }
+    }
+
+    // 'scratch' must hold 3 * numPoints values
+    void operator()(const double* x,
+                    const double* y,
+                    size_t numPoints,
+                    double* output,
+                    double* scratch) const
+    {
+        double* const xPwr = scratch;
+        double* const yPwr = scratch + numPoints;
+        std::fill_n(output, numPoints, 0.0);
+        std::fill_n(xPwr, numPoints, 1.0);
+
+        for (size_t ii = 0; ii <= mOrderX; ++ii)
+        {
+            const double* const coef = &mCoef[ii * (mOrderY + 1)];
+            std::fill_n(yPwr, numPoints, 1.0);
+
+            // Evaluate this row's polynomial in y into 'output' scaled by
+            // x^ii as we go
+            double* const rowValue = yPwr + numPoints;
+            for (size_t pt = 0; pt < numPoints; ++pt)
+            {
+                rowValue[pt] = 0.0;
+            }
+            for (size_t jj = 0; jj <= mOrderY; ++jj)
+            {
+                const double c = coef[jj];
+                for (size_t pt = 0; pt < numPoints; ++pt)
+                {
+                    rowValue[pt] += c * yPwr[pt];
+                    yPwr[pt] *= y[pt];
+                }
+            }
+
+            for (size_t pt = 0; pt < numPoints; ++pt)
+            {
+                output[pt] += rowValue[pt] * xPwr[pt];
+                xPwr[pt] *= x[pt];
+            }
+        }
+    }
+
+private:
+    const size_t mOrderX;
+    const size_t mOrderY;
+    std::vector<double> mCoef;
+};
+
+// Coefficients of a 1D polynomial of vectors pulled out so that it can be
+// evaluated over many points at once.  The terms are summed in the same order
+// as math::poly::OneD does.
+class BatchOneD3
+{
+public:
+    BatchOneD3(const math::poly::OneD<scene::Vector3>& poly) :
+        mCoefX(poly.size()),
+        mCoefY(poly.size()),
+        mCoefZ(poly.size())
+    {
+        for (size_t ii = 0; ii < poly.size(); ++ii)
+        {
+            const scene::Vector3 coef = poly[ii];
+            mCoefX[ii] = coef[0];
+            mCoefY[ii] = coef[1];
+            mCoefZ[ii] = coef[2];
+        }
+    }
+
+    // 'scratch' must hold numPoints values
+    void operator()(const double* t,
+                    size_t numPoints,
+                    double* x,
+                    double* y,
+                    double* z,
+                    double* scratch) const
+    {
+        double* const tPwr = scratch;
+        std::fill_n(x, numPoints, 0.0);
+        std::fill_n(y, numPoints, 0.0);
+        std::fill_n(z, numPoints, 0.0);
+        std::fill_n(tPwr, numPoints, 1.0);
+
+        for (size_t ii = 0; ii < mCoefX.size(); ++ii)
+        {
+            const double cx = mCoefX[ii];
+            const double cy = mCoefY[ii];
+            const double cz = mCoefZ[ii];
+            for (size_t pt = 0; pt < numPoints; ++pt)
+            {
+                x[pt] += cx * tPwr[pt];
+                y[pt] += cy * tPwr[pt];
+                z[pt] += cz * tPwr[pt];
+                tPwr[pt] *= t[pt];
+            }
+        }
+    }
+
+private:
+    std::vector<double> mCoefX;
+    std::vector<double> mCoefY;
+    std::vector<double> mCoefZ;
+};
+
 template<typename PolyType>
 PolyType verboseDerivative(const PolyType& polynomial, const std::string& name)
 {
@@ -256,28 +482,15 @@ Vector3 ProjectionModel::imageToScene(
         double heightThreshold,
         size_t maxNumIters) const
 {
-    // Sanity checks
-    if (heightThreshold <= 0)
-    {
-        throw except::Exception(Ctxt("Height threshold must be positive"));
-    }
-
-    if (maxNumIters < 1)
-    {
-        throw except::Exception(Ctxt(
-                "Max number of iterations must be positive"));
-    }
+    checkHeightParams(heightThreshold, maxNumIters);
 
     // 1. Compute the geodetic ground plane normal at the SCP
     //    Note that this is different than the value passed in to the other
     //    imageToScene() overloading which is the spherical earth GPN (see
     //    section 5.1 for details)
-    const ECEFToLLATransform ecefToLatLon;
-    const LatLonAlt scpLatLon = ecefToLatLon.transform(mSCP);
-    Vector3 groundPlaneNormal = computeUnitVector(scpLatLon);
-
-    Vector3 groundRefPoint =
-            mSCP + (height - scpLatLon.getAlt()) * groundPlaneNormal;
+    Vector3 groundPlaneNormal;
+    Vector3 groundRefPoint;
+    computeHeightPlane(mSCP, height, groundPlaneNormal, groundRefPoint);
 
     // Compute contour just once
     double r;
@@ -292,6 +505,39 @@ Vector3 ProjectionModel::imageToScene(
     // Adjustable parameters do not affect Rdot
     imageToSceneAdjustment(delta, timeCOA, r, arpCOA, velCOA);
 
+    return contourToHeight(r, rDot, arpCOA, velCOA, height,
+                           groundPlaneNormal, groundRefPoint,
+                           heightThreshold, maxNumIters);
+}
+
+Vector3 ProjectionModel::imageToScene(
+        const types::RowCol<double>& imageGridPoint,
+        const ElevationModel& elevation,
+        const AdjustableParams& delta,
+        double heightThreshold,
+        size_t maxNumIters) const
+{
+    // The batch version has to look up terrain heights point by point
+    // anyway, so a single point is just a batch of one
+    Vector3 scenePoint;
+    imageToScene(&imageGridPoint.row, &imageGridPoint.col, 1, elevation,
+                 &scenePoint[0], &scenePoint[1], &scenePoint[2],
+                 1, delta, heightThreshold, maxNumIters);
+    return scenePoint;
+}
+
+Vector3 ProjectionModel::contourToHeight(double r,
+                                         double rDot,
+                                         const Vector3& arpCOA,
+                                         const Vector3& velCOA,
+                                         double height,
+                                         Vector3 groundPlaneNormal,
+                                         Vector3 groundRefPoint,
+                                         double heightThreshold,
+                                         size_t maxNumIters) const
+{
+    const ECEFToLLATransform ecefToLatLon;
+
     Vector3 gppECEF;
     Vector3 uUP;
     double deltaHeight(std::numeric_limits<double>::max());
@@ -738,6 +984,694 @@ math::linear::MatrixMxN<2, 2> ProjectionModel::getUnmodeledErrorCovariance(
     return returnMatrix;
 }
 
+// The model's polynomials, pulled out once per batch for all its blocks
+struct ProjectionModel::BatchPolys
+{
+    BatchPolys(const math::poly::TwoD<double>& timeCOAPoly,
+               const math::poly::OneD<Vector3>& arpPoly,
+               const math::poly::OneD<Vector3>& arpVelPoly) :
+        timeCOAPoly(timeCOAPoly),
+        arpPoly(arpPoly),
+        arpVelPoly(arpVelPoly)
+    {
+    }
+
+    const BatchTwoD timeCOAPoly;
+    const BatchOneD3 arpPoly;
+    const BatchOneD3 arpVelPoly;
+};
+
+struct ProjectionModel::BatchArgs
+{
+    BatchArgs() :
+        polys(NULL),
+        rows(NULL),
+        cols(NULL),
+        timeCOA(NULL),
+        delta(NULL),
+        elevation(NULL),
+        height(0.0),
+        heightThreshold(0.0),
+        maxNumIters(0)
+    {
+        sceneX = sceneY = sceneZ = NULL;
+        outSceneX = outSceneY = outSceneZ = NULL;
+        outRows = outCols = NULL;
+    }
+
+    // Set by projectBatch()
+    const BatchPolys* polys;
+
+    // Inputs
+    const double* rows;
+    const double* cols;
+    const double* sceneX;
+    const double* sceneY;
+    const double* sceneZ;
+
+    // Outputs
+    double* outSceneX;
+    double* outSceneY;
+    double* outSceneZ;
+    double* outRows;
+    double* outCols;
+    double* timeCOA;
+
+    const AdjustableParams* delta;
+    const ElevationModel* elevation;
+    Vector3 groundRefPoint;
+    Vector3 groundPlaneNormal;
+    double height;
+    double heightThreshold;
+    size_t maxNumIters;
+};
+
+class ProjectionModel::ProjectBlocksRunnable : public sys::Runnable
+{
+public:
+    ProjectBlocksRunnable(const ProjectionModel& model,
+                          ProjectBlockFunc func,
+                          const BatchArgs& args,
+                          size_t start,
+                          size_t numPoints) :
+        mModel(model),
+        mFunc(func),
+        mArgs(args),
+        mStart(start),
+        mNumPoints(numPoints)
+    {
+    }
+
+    virtual void run()
+    {
+        for (size_t ii = 0; ii < mNumPoints; ii += BATCH_BLOCK_SIZE)
+        {
+            (mModel.*mFunc)(mArgs,
+                            mStart + ii,
+                            std::min<size_t>(BATCH_BLOCK_SIZE,
+                                             mNumPoints - ii));
+        }
+    }
+
+private:
+    const ProjectionModel& mModel;
+    const ProjectBlockFunc mFunc;
+    const BatchArgs& mArgs;
+    const size_t mStart;
+    const size_t mNumPoints;
+};
+
+void ProjectionModel::projectBatch(ProjectBlockFunc func,
+                                   const BatchArgs& args,
+                                   size_t numPoints,
+                                   size_t numThreads) const
+{
+    const BatchPolys polys(mTimeCOAPoly, mARPPoly, mARPVelPoly);
+    BatchArgs blockArgs(args);
+    blockArgs.polys = &polys;
+
+    if (numThreads <= 1)
+    {
+        ProjectBlocksRunnable(*this, func, blockArgs, 0, numPoints).run();
+    }
+    else
+    {
+        mt::ThreadGroup threads;
+        const mt::ThreadPlanner planner(numPoints, numThreads);
+
+        size_t threadNum(0);
+        size_t startPoint(0);
+        size_t numPointsThisThread(0);
+        while (planner.getThreadInfo(threadNum++,
+                                     startPoint,
+                                     numPointsThisThread))
+        {
+            std::auto_ptr<sys::Runnable> projector(new ProjectBlocksRunnable(
+                    *this, func, blockArgs, startPoint, numPointsThisThread));
+            threads.createThread(projector);
+        }
+
+        threads.joinAll();
+    }
+}
+
+void ProjectionModel::computeContours(const BatchPolys& polys,
+                                      const double* rows,
+                                      const double* cols,
+                                      size_t numPoints,
+                                      const AdjustableParams& delta,
+                                      ContourBlock& contours) const
+{
+    double scratch[3 * BATCH_BLOCK_SIZE];
+    polys.timeCOAPoly(rows, cols, numPoints, contours.timeCOA, scratch);
+    polys.arpPoly(contours.timeCOA, numPoints,
+                  contours.arpX, contours.arpY, contours.arpZ, scratch);
+    polys.arpVelPoly(contours.timeCOA, numPoints,
+                     contours.velX, contours.velY, contours.velZ, scratch);
+
+    // With no adjustable parameters set, the adjustment adds nothing, so
+    // we can skip computing the RIC transforms for each point
+    bool adjust = (mErrors.mFrameType != FrameType::RIC_ECF &&
+                   mErrors.mFrameType != FrameType::RIC_ECI &&
+                   mErrors.mFrameType != FrameType::ECF);
+    for (size_t ii = 0; ii < AdjustableParams::NUM_PARAMS; ++ii)
+    {
+        if (mAdjustableParams[ii] != 0.0 || delta[ii] != 0.0)
+        {
+            adjust = true;
+        }
+    }
+
+    // The contour is specific to the IFP algorithm and grid type, so this
+    // has to go point by point
+    for (size_t pt = 0; pt < numPoints; ++pt)
+    {
+        const double timeCOA = contours.timeCOA[pt];
+        Vector3 arpCOA;
+        arpCOA[0] = contours.arpX[pt];
+        arpCOA[1] = contours.arpY[pt];
+        arpCOA[2] = contours.arpZ[pt];
+        Vector3 velCOA;
+        velCOA[0] = contours.velX[pt];
+        velCOA[1] = contours.velY[pt];
+        velCOA[2] = contours.velZ[pt];
+
+        computeContour(arpCOA, velCOA, timeCOA,
+                       types::RowCol<double>(rows[pt], cols[pt]),
+                       &contours.r[pt], &contours.rDot[pt]);
+
+        if (adjust)
+        {
+            imageToSceneAdjustment(delta, timeCOA, contours.r[pt],
+                                   arpCOA, velCOA);
+            contours.arpX[pt] = arpCOA[0];
+            contours.arpY[pt] = arpCOA[1];
+            contours.arpZ[pt] = arpCOA[2];
+            contours.velX[pt] = velCOA[0];
+            contours.velY[pt] = velCOA[1];
+            contours.velZ[pt] = velCOA[2];
+        }
+    }
+}
+
+void ProjectionModel::contourToGroundPlane(
+        const ContourBlock& contours,
+        size_t numPoints,
+        const double* const groundPlaneNormal[3],
+        size_t normalStride,
+        const double* const groundRefPoint[3],
+        size_t refStride,
+        double* const groundPoint[3]) const
+{
+    // This is the same math as the single point version, but with no
+    // branches so that it vectorizes.  Any point without a solution is
+    // flagged and then rerun through the single point version below so it
+    // throws the same exception.
+    bool valid = true;
+    for (size_t pt = 0; pt < numPoints; ++pt)
+    {
+        const double nx = groundPlaneNormal[0][pt * normalStride];
+        const double ny = groundPlaneNormal[1][pt * normalStride];
+        const double nz = groundPlaneNormal[2][pt * normalStride];
+        const double rCOA = contours.r[pt];
+        const double arpX = contours.arpX[pt];
+        const double arpY = contours.arpY[pt];
+        const double arpZ = contours.arpZ[pt];
+        const double velX = contours.velX[pt];
+        const double velY = contours.velY[pt];
+        const double velZ = contours.velZ[pt];
+
+        // Compute the ARP distance from the plane (ARP Z)
+        const double arpHeight =
+                (arpX - groundRefPoint[0][pt * refStride]) * nx +
+                (arpY - groundRefPoint[1][pt * refStride]) * ny +
+                (arpZ - groundRefPoint[2][pt * refStride]) * nz;
+
+        // Compute the ARP ground plane nadir
+        const double arpGroundX = arpX - nx * arpHeight;
+        const double arpGroundY = arpY - ny * arpHeight;
+        const double arpGroundZ = arpZ - nz * arpHeight;
+
+        // Compute the ground plane distance from the ARP nadir to
+        // the circle of constant range.
+        valid &= (std::abs(arpHeight) <= std::abs(rCOA));
+        const double groundRange =
+                std::sqrt(std::max(rCOA * rCOA - arpHeight * arpHeight, 0.0));
+
+        // Compute cos and sin of the grazing angle
+        const double cosGraz = groundRange / rCOA;
+        const double sinGraz = arpHeight / rCOA;
+
+        // Compute the velocity components normal to the ground
+        // plane and parallel to the ground plane
+        const double vz = velX * nx + velY * ny + velZ * nz;
+        const double vmag = std::sqrt(velX * velX + velY * velY + velZ * velZ);
+        valid &= (std::abs(vz) < std::abs(vmag));
+        const double vx = std::sqrt(std::max(vmag * vmag - vz * vz, 0.0));
+
+        // Orient the x direction in the ground plane such that
+        // vx > 0.  Compute unit vectors unitX and unitY
+        const double unitXX = (velX - nx * vz) / vx;
+        const double unitXY = (velY - ny * vz) / vx;
+        const double unitXZ = (velZ - nz * vz) / vx;
+        const double unitYX = ny * unitXZ - nz * unitXY;
+        const double unitYY = nz * unitXX - nx * unitXZ;
+        const double unitYZ = nx * unitXY - ny * unitXX;
+
+        // Compute the cosine of the azimuth angle to the ground
+        // plane point
+        const double cosAzimuth =
+                (-contours.rDot[pt] + vz * sinGraz) / (vx * cosGraz);
+        valid &= (cosAzimuth >= -1.0 && cosAzimuth <= 1.0);
+
+        const double sinAzimuth = mLookDir *
+                std::sqrt(std::max(1.0 - cosAzimuth * cosAzimuth, 0.0));
+
+        groundPoint[0][pt] = arpGroundX + unitXX * groundRange * cosAzimuth +
+                unitYX * groundRange * sinAzimuth;
+        groundPoint[1][pt] = arpGroundY + unitXY * groundRange * cosAzimuth +
+                unitYY * groundRange * sinAzimuth;
+        groundPoint[2][pt] = arpGroundZ + unitXZ * groundRange * cosAzimuth +
+                unitYZ * groundRange * sinAzimuth;
+    }
+
+    if (!valid)
+    {
+        for (size_t pt = 0; pt < numPoints; ++pt)
+        {
+            Vector3 normal;
+            Vector3 ref;
+            Vector3 arpCOA;
+            Vector3 velCOA;
+            for (size_t ii = 0; ii < 3; ++ii)
+            {
+                normal[ii] = groundPlaneNormal[ii][pt * normalStride];
+                ref[ii] = groundRefPoint[ii][pt * refStride];
+            }
+            arpCOA[0] = contours.arpX[pt];
+            arpCOA[1] = contours.arpY[pt];
+            arpCOA[2] = contours.arpZ[pt];
+            velCOA[0] = contours.velX[pt];
+            velCOA[1] = contours.velY[pt];
+            velCOA[2] = contours.velZ[pt];
+
+            contourToGroundPlane(contours.r[pt], contours.rDot[pt],
+                                 arpCOA, velCOA, normal, ref);
+        }
+    }
+}
+
+void ProjectionModel::imageToPlaneBlock(const BatchArgs& args,
+                                        size_t start,
+                                        size_t numPoints) const
+{
+    ContourBlock contours;
+    computeContours(*args.polys, args.rows + start, args.cols + start,
+                    numPoints, *args.delta, contours);
+
+    // Every point shares the same plane, so these have a stride of 0
+    const double normalValues[3] = { args.groundPlaneNormal[0],
+                                     args.groundPlaneNormal[1],
+                                     args.groundPlaneNormal[2] };
+    const double refValues[3] = { args.groundRefPoint[0],
+                                  args.groundRefPoint[1],
+                                  args.groundRefPoint[2] };
+    const double* const normal[3] = { &normalValues[0],
+                                      &normalValues[1],
+                                      &normalValues[2] };
+    const double* const ref[3] = { &refValues[0],
+                                   &refValues[1],
+                                   &refValues[2] };
+    double* const output[3] = { args.outSceneX + start,
+                                args.outSceneY + start,
+                                args.outSceneZ + start };
+    contourToGroundPlane(contours, numPoints, normal, 0, ref, 0, output);
+
+    if (args.timeCOA)
+    {
+        std::copy(contours.timeCOA, contours.timeCOA + numPoints,
+                  args.timeCOA + start);
+    }
+}
+
+void ProjectionModel::imageToHeightBlock(const BatchArgs& args,
+                                         size_t start,
+                                         size_t numPoints) const
+{
+    ContourBlock contours;
+    computeContours(*args.polys, args.rows + start, args.cols + start,
+                    numPoints, *args.delta, contours);
+
+    // Refining onto the height surface goes through lat/lon, which is
+    // inherently point by point
+    for (size_t pt = 0; pt < numPoints; ++pt)
+    {
+        Vector3 arpCOA;
+        arpCOA[0] = contours.arpX[pt];
+        arpCOA[1] = contours.arpY[pt];
+        arpCOA[2] = contours.arpZ[pt];
+        Vector3 velCOA;
+        velCOA[0] = contours.velX[pt];
+        velCOA[1] = contours.velY[pt];
+        velCOA[2] = contours.velZ[pt];
+
+        const Vector3 scenePoint = contourToHeight(
+                contours.r[pt], contours.rDot[pt], arpCOA, velCOA,
+                args.height, args.groundPlaneNormal, args.groundRefPoint,
+                args.heightThreshold, args.maxNumIters);
+
+        args.outSceneX[start + pt] = scenePoint[0];
+        args.outSceneY[start + pt] = scenePoint[1];
+        args.outSceneZ[start + pt] = scenePoint[2];
+    }
+}
+
+void ProjectionModel::imageToElevationBlock(const BatchArgs& args,
+                                            size_t start,
+                                            size_t numPoints) const
+{
+    ContourBlock contours;
+    computeContours(*args.polys, args.rows + start, args.cols + start,
+                    numPoints, *args.delta, contours);
+
+    // Every point starts at the SCP height and searches along its own
+    // contour.  The points still searching look up their terrain heights
+    // together each iteration.
+    TerrainSearch searches[BATCH_BLOCK_SIZE];
+    double heights[BATCH_BLOCK_SIZE];
+    size_t active[BATCH_BLOCK_SIZE];
+    for (size_t pt = 0; pt < numPoints; ++pt)
+    {
+        heights[pt] = args.height;
+        active[pt] = pt;
+    }
+    size_t numActive = numPoints;
+
+    const ECEFToLLATransform ecefToLatLon;
+    Vector3 scenePoints[BATCH_BLOCK_SIZE];
+    double lats[BATCH_BLOCK_SIZE];
+    double lons[BATCH_BLOCK_SIZE];
+    double terrainHeights[BATCH_BLOCK_SIZE];
+
+    for (size_t iter = 0; iter < args.maxNumIters && numActive > 0; ++iter)
+    {
+        for (size_t ii = 0; ii < numActive; ++ii)
+        {
+            const size_t pt = active[ii];
+            Vector3 arpCOA;
+            arpCOA[0] = contours.arpX[pt];
+            arpCOA[1] = contours.arpY[pt];
+            arpCOA[2] = contours.arpZ[pt];
+            Vector3 velCOA;
+            velCOA[0] = contours.velX[pt];
+            velCOA[1] = contours.velY[pt];
+            velCOA[2] = contours.velZ[pt];
+
+            // Only the reference point moves with the height
+            const Vector3 groundRefPoint = args.groundRefPoint +
+                    (heights[pt] - args.height) * args.groundPlaneNormal;
+
+            scenePoints[pt] = contourToHeight(
+                    contours.r[pt], contours.rDot[pt], arpCOA, velCOA,
+                    heights[pt], args.groundPlaneNormal, groundRefPoint,
+                    args.heightThreshold, TERRAIN_HEIGHT_ITERS);
+
+            const LatLonAlt latLon = ecefToLatLon.transform(scenePoints[pt]);
+            lats[ii] = latLon.getLat();
+            lons[ii] = latLon.getLon();
+        }
+
+        args.elevation->getHeights(lats, lons, numActive, terrainHeights);
+
+        size_t numStillActive = 0;
+        for (size_t ii = 0; ii < numActive; ++ii)
+        {
+            const size_t pt = active[ii];
+            const double diff = terrainHeights[ii] - heights[pt];
+            if (std::abs(diff) <= args.heightThreshold)
+            {
+                args.outSceneX[start + pt] = scenePoints[pt][0];
+                args.outSceneY[start + pt] = scenePoints[pt][1];
+                args.outSceneZ[start + pt] = scenePoints[pt][2];
+            }
+            else
+            {
+                heights[pt] = searches[pt].next(heights[pt], diff);
+                active[numStillActive++] = pt;
+            }
+        }
+        numActive = numStillActive;
+    }
+
+    if (numActive > 0)
+    {
+        throw except::Exception(Ctxt("Point failed to converge"));
+    }
+}
+
+void ProjectionModel::sceneToImageBlock(const BatchArgs& args,
+                                        size_t start,
+                                        size_t numPoints) const
+{
+    // Each point's ground plane is the spherical earth tangent plane at the
+    // point itself
+    double groundRefPoint[3][BATCH_BLOCK_SIZE];
+    double groundPlaneNormal[3][BATCH_BLOCK_SIZE];
+    double groundPlanePoint[3][BATCH_BLOCK_SIZE];
+    for (size_t pt = 0; pt < numPoints; ++pt)
+    {
+        Vector3 scenePoint;
+        scenePoint[0] = args.sceneX[start + pt];
+        scenePoint[1] = args.sceneY[start + pt];
+        scenePoint[2] = args.sceneZ[start + pt];
+
+        Vector3 normal(scenePoint);
+        normal.normalize();
+
+        for (size_t ii = 0; ii < 3; ++ii)
+        {
+            groundRefPoint[ii][pt] = scenePoint[ii];
+            groundPlaneNormal[ii][pt] = normal[ii];
+            groundPlanePoint[ii][pt] = scenePoint[ii];
+        }
+    }
+
+    // Points that haven't converged yet, packed down to the front each
+    // iteration
+    size_t active[BATCH_BLOCK_SIZE];
+    for (size_t pt = 0; pt < numPoints; ++pt)
+    {
+        active[pt] = pt;
+    }
+    size_t numActive = numPoints;
+
+    double rows[BATCH_BLOCK_SIZE];
+    double cols[BATCH_BLOCK_SIZE];
+    double activeNormal[3][BATCH_BLOCK_SIZE];
+    double activeRef[3][BATCH_BLOCK_SIZE];
+    double projected[3][BATCH_BLOCK_SIZE];
+    ContourBlock contours;
+
+    for (size_t iter = 0; iter < MAX_ITER && numActive > 0; ++iter)
+    {
+        for (size_t ii = 0; ii < numActive; ++ii)
+        {
+            const size_t pt = active[ii];
+
+            // We are projecting the ground plane point to the image
+            // plane point.
+            Vector3 gpp;
+            gpp[0] = groundPlanePoint[0][pt];
+            gpp[1] = groundPlanePoint[1][pt];
+            gpp[2] = groundPlanePoint[2][pt];
+
+            const double dist =
+                    (mSCP - gpp).dot(mImagePlaneNormal) * mScaleFactor;
+            const types::RowCol<double> imageGridPoint =
+                    computeImageCoordinates(gpp + mSlantPlaneNormal * dist);
+            rows[ii] = imageGridPoint.row;
+            cols[ii] = imageGridPoint.col;
+
+            for (size_t dim = 0; dim < 3; ++dim)
+            {
+                activeNormal[dim][ii] = groundPlaneNormal[dim][pt];
+                activeRef[dim][ii] = groundRefPoint[dim][pt];
+            }
+        }
+
+        // Find out if the scene points are the same as the guessed output
+        // of imageToScene
+        computeContours(*args.polys, rows, cols, numActive, *args.delta,
+                        contours);
+
+        const double* const normal[3] = { activeNormal[0],
+                                          activeNormal[1],
+                                          activeNormal[2] };
+        const double* const ref[3] = { activeRef[0],
+                                       activeRef[1],
+                                       activeRef[2] };
+        double* const output[3] = { projected[0],
+                                    projected[1],
+                                    projected[2] };
+        contourToGroundPlane(contours, numActive, normal, 1, ref, 1, output);
+
+        size_t numStillActive = 0;
+        for (size_t ii = 0; ii < numActive; ++ii)
+        {
+            const size_t pt = active[ii];
+            Vector3 diff;
+            for (size_t dim = 0; dim < 3; ++dim)
+            {
+                diff[dim] = groundRefPoint[dim][pt] - projected[dim][ii];
+            }
+
+            if (diff.norm() < DELTA_GP_MAX)
+            {
+                args.outRows[start + pt] = rows[ii];
+                args.outCols[start + pt] = cols[ii];
+                if (args.timeCOA)
+                {
+                    args.timeCOA[start + pt] = contours.timeCOA[ii];
+                }
+            }
+            else
+            {
+                // Otherwise we are not so lucky, add to our point
+                // the difference
+                for (size_t dim = 0; dim < 3; ++dim)
+                {
+                    groundPlanePoint[dim][pt] += diff[dim];
+                }
+                active[numStillActive++] = pt;
+            }
+        }
+        numActive = numStillActive;
+    }
+
+    if (numActive > 0)
+    {
+        throw except::Exception(Ctxt("Point failed to converge"));
+    }
+}
+
+void ProjectionModel::imageToScene(const double* rows,
+                                   const double* cols,
+                                   size_t numPoints,
+                                   const Vector3& groundRefPoint,
+                                   const Vector3& groundPlaneNormal,
+                                   double* sceneX,
+                                   double* sceneY,
+                                   double* sceneZ,
+                                   size_t numThreads,
+                                   const AdjustableParams& delta,
+                                   double* oTimeCOA) const
+{
+    BatchArgs args;
+    args.rows = rows;
+    args.cols = cols;
+    args.outSceneX = sceneX;
+    args.outSceneY = sceneY;
+    args.outSceneZ = sceneZ;
+    args.timeCOA = oTimeCOA;
+    args.delta = &delta;
+    args.groundRefPoint = groundRefPoint;
+    args.groundPlaneNormal = groundPlaneNormal;
+
+    projectBatch(&ProjectionModel::imageToPlaneBlock, args, numPoints,
+                 numThreads);
+}
+
+void ProjectionModel::imageToScene(const double* rows,
+                                   const double* cols,
+                                   size_t numPoints,
+                                   double height,
+                                   double* sceneX,
+                                   double* sceneY,
+                                   double* sceneZ,
+                                   size_t numThreads,
+                                   const AdjustableParams& delta,
+                                   double heightThreshold,
+                                   size_t maxNumIters) const
+{
+    checkHeightParams(heightThreshold, maxNumIters);
+
+    BatchArgs args;
+    args.rows = rows;
+    args.cols = cols;
+    args.outSceneX = sceneX;
+    args.outSceneY = sceneY;
+    args.outSceneZ = sceneZ;
+    args.delta = &delta;
+    args.height = height;
+    args.heightThreshold = heightThreshold;
+    args.maxNumIters = maxNumIters;
+
+    // The starting ground plane is the same for every point
+    computeHeightPlane(mSCP, height, args.groundPlaneNormal,
+                       args.groundRefPoint);
+
+    projectBatch(&ProjectionModel::imageToHeightBlock, args, numPoints,
+                 numThreads);
+}
+
+void ProjectionModel::imageToScene(const double* rows,
+                                   const double* cols,
+                                   size_t numPoints,
+                                   const ElevationModel& elevation,
+                                   double* sceneX,
+                                   double* sceneY,
+                                   double* sceneZ,
+                                   size_t numThreads,
+                                   const AdjustableParams& delta,
+                                   double heightThreshold,
+                                   size_t maxNumIters) const
+{
+    checkHeightParams(heightThreshold, maxNumIters);
+
+    BatchArgs args;
+    args.rows = rows;
+    args.cols = cols;
+    args.outSceneX = sceneX;
+    args.outSceneY = sceneY;
+    args.outSceneZ = sceneZ;
+    args.delta = &delta;
+    args.elevation = &elevation;
+    args.heightThreshold = heightThreshold;
+    args.maxNumIters = maxNumIters;
+
+    // Start the search at the SCP height
+    const ECEFToLLATransform ecefToLatLon;
+    args.height = ecefToLatLon.transform(mSCP).getAlt();
+    computeHeightPlane(mSCP, args.height, args.groundPlaneNormal,
+                       args.groundRefPoint);
+
+    projectBatch(&ProjectionModel::imageToElevationBlock, args, numPoints,
+                 numThreads);
+}
+
+void ProjectionModel::sceneToImage(const double* sceneX,
+                                   const double* sceneY,
+                                   const double* sceneZ,
+                                   size_t numPoints,
+                                   double* rows,
+                                   double* cols,
+                                   size_t numThreads,
+                                   const AdjustableParams& delta,
+                                   double* oTimeCOA) const
+{
+    BatchArgs args;
+    args.sceneX = sceneX;
+    args.sceneY = sceneY;
+    args.sceneZ = sceneZ;
+    args.outRows = rows;
+    args.outCols = cols;
+    args.timeCOA = oTimeCOA;
+    args.delta = &delta;
+
+    projectBatch(&ProjectionModel::sceneToImageBlock, args, numPoints,
+                 numThreads);
+}
+
 ProjectionModelWithImageVectors::ProjectionModelWithImageVectors(
     const Vector3& slantPlaneNormal,
     const Vector3& imagePlaneRowVector,
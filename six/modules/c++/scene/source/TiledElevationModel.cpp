@@ -0,0 +1,298 @@
+/* =========================================================================
+ * This file is part of scene-c++
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2014, MDA Information Systems LLC
+ *
+ * scene-c++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include <except/Exception.h>
+#include <mt/CriticalSection.h>
+#include <str/Convert.h>
+#include "scene/TiledElevationModel.h"
+
+namespace scene
+{
+// A tile overlaps its neighbors by one post so that every cell between four
+// posts is entirely within a single tile
+struct TiledElevationModel::Tile
+{
+    types::RowCol<size_t> firstPost;
+    types::RowCol<size_t> numPosts;
+    std::vector<float> heights;
+};
+
+TiledElevationModel::TiledElevationModel(
+        const LatLon& northWest,
+        const types::RowCol<double>& spacing,
+        const types::RowCol<size_t>& numPosts,
+        size_t tileSize,
+        size_t maxNumTiles) :
+    mNorthWest(northWest),
+    mSpacing(spacing),
+    mNumPosts(numPosts),
+    mTileSize(tileSize),
+    mMaxNumTiles(maxNumTiles),
+    mNumTilesRead(0),
+    mTileRead(&mMutex)
+{
+    if (numPosts.row < 2 || numPosts.col < 2)
+    {
+        throw except::Exception(Ctxt(
+                "Elevation model needs at least 2 posts in each direction"));
+    }
+    if (spacing.row <= 0.0 || spacing.col <= 0.0)
+    {
+        throw except::Exception(Ctxt("Post spacing must be positive"));
+    }
+    if (tileSize < 2 || maxNumTiles == 0)
+    {
+        throw except::Exception(Ctxt(
+                "Tiles must be at least 2 posts across, and at least one "
+                "must be cached"));
+    }
+
+    // The last post of one tile is the first post of the next
+    mNumTiles.row = (numPosts.row - 2) / (tileSize - 1) + 1;
+    mNumTiles.col = (numPosts.col - 2) / (tileSize - 1) + 1;
+}
+
+TiledElevationModel::~TiledElevationModel()
+{
+}
+
+size_t TiledElevationModel::getTileIndex(double lat,
+                                         double lon,
+                                         types::RowCol<double>& post) const
+{
+    post.row = (mNorthWest.getLat() - lat) / mSpacing.row;
+    post.col = (lon - mNorthWest.getLon()) / mSpacing.col;
+
+    // Written so that NaNs fail too
+    if (!(post.row >= 0.0 && post.row <= mNumPosts.row - 1 &&
+          post.col >= 0.0 && post.col <= mNumPosts.col - 1))
+    {
+        throw except::Exception(Ctxt(
+                "Lat/lon " + str::toString(lat) + ", " + str::toString(lon) +
+                " is outside of the elevation model"));
+    }
+
+    const size_t tileRow = std::min(
+            static_cast<size_t>(post.row) / (mTileSize - 1),
+            mNumTiles.row - 1);
+    const size_t tileCol = std::min(
+            static_cast<size_t>(post.col) / (mTileSize - 1),
+            mNumTiles.col - 1);
+    return tileRow * mNumTiles.col + tileCol;
+}
+
+mem::SharedPtr<const TiledElevationModel::Tile>
+TiledElevationModel::getTile(size_t tileIndex) const
+{
+    mt::CriticalSection<sys::Mutex> crit(&mMutex);
+
+    // If another thread is reading the tile, wait for it rather than
+    // reading it again
+    while (mPendingTiles.find(tileIndex) != mPendingTiles.end())
+    {
+        mTileRead.wait();
+    }
+
+    const std::map<size_t, TileList::iterator>::iterator mapIter =
+            mTileMap.find(tileIndex);
+    if (mapIter != mTileMap.end())
+    {
+        // Move it to the front
+        mTiles.splice(mTiles.begin(), mTiles, mapIter->second);
+        return mTiles.front().second;
+    }
+
+    // Read it with the cache unlocked
+    mPendingTiles.insert(tileIndex);
+    crit.manualUnlock();
+
+    mem::SharedPtr<Tile> tile(new Tile());
+    try
+    {
+        const size_t tileRow = tileIndex / mNumTiles.col;
+        const size_t tileCol = tileIndex % mNumTiles.col;
+        tile->firstPost.row = tileRow * (mTileSize - 1);
+        tile->firstPost.col = tileCol * (mTileSize - 1);
+        tile->numPosts.row = std::min(mTileSize,
+                                      mNumPosts.row - tile->firstPost.row);
+        tile->numPosts.col = std::min(mTileSize,
+                                      mNumPosts.col - tile->firstPost.col);
+        tile->heights.resize(tile->numPosts.area());
+
+        mt::CriticalSection<sys::Mutex> readCrit(&mReadMutex);
+        readPosts(tile->firstPost, tile->numPosts, &tile->heights[0]);
+    }
+    catch (...)
+    {
+        // Let the waiters try reading it themselves
+        crit.manualLock();
+        mPendingTiles.erase(tileIndex);
+        mTileRead.broadcast();
+        throw;
+    }
+
+    crit.manualLock();
+    mPendingTiles.erase(tileIndex);
+    mTileRead.broadcast();
+    ++mNumTilesRead;
+
+    if (mTiles.size() >= mMaxNumTiles)
+    {
+        // Anyone still using the tile keeps it alive until they're done
+        mTileMap.erase(mTiles.back().first);
+        mTiles.pop_back();
+    }
+
+    mTiles.push_front(std::make_pair(tileIndex,
+                                     mem::SharedPtr<const Tile>(tile)));
+    mTileMap[tileIndex] = mTiles.begin();
+    return mTiles.front().second;
+}
+
+double TiledElevationModel::interpolate(const Tile& tile,
+                                        const types::RowCol<double>& post)
+{
+    const double row = post.row - tile.firstPost.row;
+    const double col = post.col - tile.firstPost.col;
+
+    // Points on the last post fall in the last cell
+    const size_t row0 = std::min(static_cast<size_t>(row),
+                                 tile.numPosts.row - 2);
+    const size_t col0 = std::min(static_cast<size_t>(col),
+                                 tile.numPosts.col - 2);
+    const double rowFrac = row - row0;
+    const double colFrac = col - col0;
+
+    const float* const upper = &tile.heights[row0 * tile.numPosts.col + col0];
+    const float* const lower = upper + tile.numPosts.col;
+    const double top = upper[0] + colFrac * (upper[1] - upper[0]);
+    const double bottom = lower[0] + colFrac * (lower[1] - lower[0]);
+    return top + rowFrac * (bottom - top);
+}
+
+double TiledElevationModel::getHeight(double lat, double lon) const
+{
+    types::RowCol<double> post;
+    const size_t tileIndex = getTileIndex(lat, lon, post);
+    return interpolate(*getTile(tileIndex), post);
+}
+
+void TiledElevationModel::getHeights(const double* lats,
+                                     const double* lons,
+                                     size_t numPoints,
+                                     double* heights) const
+{
+    mem::SharedPtr<const Tile> tile;
+    size_t currentIndex = 0;
+    types::RowCol<double> post;
+    for (size_t ii = 0; ii < numPoints; ++ii)
+    {
+        const size_t tileIndex = getTileIndex(lats[ii], lons[ii], post);
+        if (tile.get() == NULL || tileIndex != currentIndex)
+        {
+            tile = getTile(tileIndex);
+            currentIndex = tileIndex;
+        }
+        heights[ii] = interpolate(*tile, post);
+    }
+}
+
+size_t TiledElevationModel::getNumTilesRead() const
+{
+    mt::CriticalSection<sys::Mutex> crit(&mMutex);
+    return mNumTilesRead;
+}
+
+RawElevationModel::RawElevationModel(const std::string& pathname,
+                                     SampleType sampleType,
+                                     bool bigEndian,
+                                     const LatLon& northWest,
+                                     const types::RowCol<double>& spacing,
+                                     const types::RowCol<size_t>& numPosts,
+                                     double heightOffset,
+                                     size_t tileSize,
+                                     size_t maxNumTiles) :
+    TiledElevationModel(northWest, spacing, numPosts, tileSize, maxNumTiles),
+    mFile(pathname),
+    mSampleType(sampleType),
+    mSampleSize(sampleType == INT16 ? sizeof(sys::Int16_T) : sizeof(float)),
+    mSwap(bigEndian != sys::isBigEndianSystem()),
+    mNumCols(numPosts.col),
+    mHeightOffset(heightOffset)
+{
+    const sys::Off_T fileSize = mFile.available();
+    if (fileSize < static_cast<sys::Off_T>(numPosts.area() * mSampleSize))
+    {
+        throw except::Exception(Ctxt(
+                pathname + " is too small for " +
+                str::toString(numPosts.row) + " x " +
+                str::toString(numPosts.col) + " posts"));
+    }
+}
+
+void RawElevationModel::readPosts(const types::RowCol<size_t>& firstPost,
+                                  const types::RowCol<size_t>& numPosts,
+                                  float* heights) const
+{
+    const size_t numBytesPerRow = numPosts.col * mSampleSize;
+    mBuffer.resize(numBytesPerRow);
+
+    for (size_t row = 0; row < numPosts.row; ++row)
+    {
+        const sys::Off_T offset = static_cast<sys::Off_T>(
+                (firstPost.row + row) * mNumCols + firstPost.col) *
+                mSampleSize;
+        mFile.seek(offset, io::Seekable::START);
+        mFile.read(&mBuffer[0], numBytesPerRow, true);
+
+        if (mSwap)
+        {
+            sys::byteSwap(&mBuffer[0],
+                          static_cast<unsigned short>(mSampleSize),
+                          numPosts.col);
+        }
+
+        float* const output = heights + row * numPosts.col;
+        if (mSampleType == INT16)
+        {
+            const sys::Int16_T* const input =
+                    reinterpret_cast<const sys::Int16_T*>(&mBuffer[0]);
+            for (size_t col = 0; col < numPosts.col; ++col)
+            {
+                output[col] = static_cast<float>(input[col] + mHeightOffset);
+            }
+        }
+        else
+        {
+            const float* const input =
+                    reinterpret_cast<const float*>(&mBuffer[0]);
+            for (size_t col = 0; col < numPosts.col; ++col)
+            {
+                output[col] = static_cast<float>(input[col] + mHeightOffset);
+            }
+        }
+    }
+}
+}
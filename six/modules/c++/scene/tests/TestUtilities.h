@@ -0,0 +1,96 @@
+/* =========================================================================
+ * This file is part of scene-c++
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2017, MDA Information Systems LLC
+ *
+ * scene-c++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __SCENE_TEST_UTILITIES_H__
+#define __SCENE_TEST_UTILITIES_H__
+
+#include <cmath>
+#include <memory>
+
+#include <import/scene.h>
+
+const double SCENE_LAT = 40.0;
+const double SCENE_LON = -100.0;
+
+inline bool isClose(double lhs, double rhs, double tolerance)
+{
+    return std::abs(lhs - rhs) <= tolerance;
+}
+
+// A synthetic side-looking collection over a scene in the central US, ARP at
+// 10 km altitude and 20 km north of the scene flying east at 200 m/s.  'scp'
+// is set to the scene center.
+inline std::auto_ptr<scene::ProjectionModel> createModel(scene::Vector3& scp)
+{
+    scp = scene::Utilities::latLonToECEF(
+            scene::LatLonAlt(SCENE_LAT, SCENE_LON, 0.0));
+
+    scene::Vector3 up(scp);
+    up.normalize();
+
+    scene::Vector3 east;
+    east[0] = -std::sin(SCENE_LON * M_PI / 180.0);
+    east[1] = std::cos(SCENE_LON * M_PI / 180.0);
+    east[2] = 0.0;
+    const scene::Vector3 north = math::linear::cross(up, east);
+
+    const double speed = 200.0;
+    const scene::Vector3 arp = scp + up * 10000.0 + north * 20000.0;
+    const scene::Vector3 vel = east * speed;
+
+    math::poly::OneD<scene::Vector3> arpPoly(1);
+    arpPoly[0] = arp;
+    arpPoly[1] = vel;
+
+    // Right looking
+    const int lookDir = -1;
+    scene::Vector3 slantPlaneNormal =
+            math::linear::cross(vel * lookDir, scp - arp);
+    slantPlaneNormal.normalize();
+
+    scene::Vector3 rowVector(scp - arp);
+    rowVector.normalize();
+    scene::Vector3 colVector =
+            math::linear::cross(slantPlaneNormal, rowVector);
+    colVector.normalize();
+
+    // The ARP passes broadside of each column at its own time
+    math::poly::TwoD<double> timeCOAPoly(0, 1);
+    timeCOAPoly[0][1] = colVector.dot(east) / speed;
+
+    return std::auto_ptr<scene::ProjectionModel>(
+            new scene::PlaneProjectionModel(slantPlaneNormal,
+                                            rowVector,
+                                            colVector,
+                                            scp,
+                                            arpPoly,
+                                            timeCOAPoly,
+                                            lookDir));
+}
+
+inline std::auto_ptr<scene::ProjectionModel> createModel()
+{
+    scene::Vector3 scp;
+    return createModel(scp);
+}
+
+#endif
@@ -0,0 +1,303 @@
+/* =========================================================================
+ * This file is part of scene-c++
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2017, MDA Information Systems LLC
+ *
+ * scene-c++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <iostream>
+#include <vector>
+
+#include <except/Exception.h>
+#include <sys/StopWatch.h>
+#include <import/scene.h>
+
+#include "TestUtilities.h"
+
+namespace
+{
+// Projects a grid of points through the batch APIs with varying numbers of
+// threads and makes sure they match the single point versions
+class Tester
+{
+public:
+    Tester(const scene::ProjectionModel& model,
+           const scene::Vector3& scp,
+           const scene::AdjustableParams& delta) :
+        mModel(model),
+        mDelta(delta),
+        mGroundRefPoint(scp),
+        mGroundPlaneNormal(scp),
+        mHeight(100.0),
+        mSuccess(true)
+    {
+        mGroundPlaneNormal.normalize();
+
+        static const size_t NUM_ROWS = 150;
+        static const size_t NUM_COLS = 200;
+        for (size_t row = 0; row < NUM_ROWS; ++row)
+        {
+            for (size_t col = 0; col < NUM_COLS; ++col)
+            {
+                mRows.push_back(-3000.0 + 6000.0 * row / NUM_ROWS);
+                mCols.push_back(-4000.0 + 8000.0 * col / NUM_COLS);
+            }
+        }
+
+        // Single point versions to compare against
+        sys::RealTimeStopWatch stopWatch;
+        stopWatch.start();
+        mPlane.resize(mRows.size());
+        mPlaneTimeCOA.resize(mRows.size());
+        for (size_t ii = 0; ii < mRows.size(); ++ii)
+        {
+            mPlane[ii] = mModel.imageToScene(
+                    types::RowCol<double>(mRows[ii], mCols[ii]),
+                    mGroundRefPoint, mGroundPlaneNormal, mDelta,
+                    &mPlaneTimeCOA[ii]);
+        }
+        mPlaneTime = stopWatch.stop();
+
+        stopWatch.clear();
+        stopWatch.start();
+        mHeightPoints.resize(mRows.size());
+        for (size_t ii = 0; ii < mRows.size(); ++ii)
+        {
+            mHeightPoints[ii] = mModel.imageToScene(
+                    types::RowCol<double>(mRows[ii], mCols[ii]),
+                    mHeight, mDelta);
+        }
+        mHeightTime = stopWatch.stop();
+
+        stopWatch.clear();
+        stopWatch.start();
+        mImagePoints.resize(mRows.size());
+        mImageTimeCOA.resize(mRows.size());
+        for (size_t ii = 0; ii < mRows.size(); ++ii)
+        {
+            mImagePoints[ii] = mModel.sceneToImage(mPlane[ii], mDelta,
+                                                   &mImageTimeCOA[ii]);
+        }
+        mImageTime = stopWatch.stop();
+
+        // Make sure the geometry is sane to begin with
+        for (size_t ii = 0; ii < mRows.size(); ++ii)
+        {
+            if (!isClose(mImagePoints[ii].row, mRows[ii], 1e-3) ||
+                !isClose(mImagePoints[ii].col, mCols[ii], 1e-3))
+            {
+                std::cerr << "Point " << ii << " does not round trip\n";
+                mSuccess = false;
+                break;
+            }
+        }
+    }
+
+    void test(size_t numThreads)
+    {
+        const size_t numPoints = mRows.size();
+        std::vector<double> x(numPoints);
+        std::vector<double> y(numPoints);
+        std::vector<double> z(numPoints);
+        std::vector<double> timeCOA(numPoints);
+
+        sys::RealTimeStopWatch stopWatch;
+        stopWatch.start();
+        mModel.imageToScene(&mRows[0], &mCols[0], numPoints,
+                            mGroundRefPoint, mGroundPlaneNormal,
+                            &x[0], &y[0], &z[0],
+                            numThreads, mDelta, &timeCOA[0]);
+        const double planeTime = stopWatch.stop();
+        compare("Ground plane", numThreads, mPlane, x, y, z);
+        compare("Ground plane TimeCOA", numThreads, mPlaneTimeCOA, timeCOA);
+
+        stopWatch.clear();
+        stopWatch.start();
+        mModel.imageToScene(&mRows[0], &mCols[0], numPoints, mHeight,
+                            &x[0], &y[0], &z[0], numThreads, mDelta);
+        const double heightTime = stopWatch.stop();
+        compare("Height", numThreads, mHeightPoints, x, y, z);
+
+        std::vector<double> rows(numPoints);
+        std::vector<double> cols(numPoints);
+        for (size_t ii = 0; ii < numPoints; ++ii)
+        {
+            x[ii] = mPlane[ii][0];
+            y[ii] = mPlane[ii][1];
+            z[ii] = mPlane[ii][2];
+        }
+        stopWatch.clear();
+        stopWatch.start();
+        mModel.sceneToImage(&x[0], &y[0], &z[0], numPoints,
+                            &rows[0], &cols[0],
+                            numThreads, mDelta, &timeCOA[0]);
+        const double imageTime = stopWatch.stop();
+        compare("Scene to image", numThreads, mImagePoints, rows, cols);
+        compare("Scene to image TimeCOA", numThreads, mImageTimeCOA, timeCOA);
+
+        std::cout << numThreads << " threads: ground plane "
+                  << planeTime << " ms (single point " << mPlaneTime
+                  << " ms), height " << heightTime << " ms (single point "
+                  << mHeightTime << " ms), scene to image " << imageTime
+                  << " ms (single point " << mImageTime << " ms)\n";
+    }
+
+    bool success() const
+    {
+        return mSuccess;
+    }
+
+private:
+    void fail(const std::string& name, size_t numThreads, size_t point)
+    {
+        std::cerr << name << " with " << numThreads << " threads "
+                  << "DOES NOT MATCH at point " << point << std::endl;
+        mSuccess = false;
+    }
+
+    void compare(const std::string& name,
+                 size_t numThreads,
+                 const std::vector<scene::Vector3>& expected,
+                 const std::vector<double>& x,
+                 const std::vector<double>& y,
+                 const std::vector<double>& z)
+    {
+        for (size_t ii = 0; ii < expected.size(); ++ii)
+        {
+            if (!isClose(x[ii], expected[ii][0], 1e-6) ||
+                !isClose(y[ii], expected[ii][1], 1e-6) ||
+                !isClose(z[ii], expected[ii][2], 1e-6))
+            {
+                fail(name, numThreads, ii);
+                return;
+            }
+        }
+    }
+
+    void compare(const std::string& name,
+                 size_t numThreads,
+                 const std::vector<types::RowCol<double> >& expected,
+                 const std::vector<double>& rows,
+                 const std::vector<double>& cols)
+    {
+        for (size_t ii = 0; ii < expected.size(); ++ii)
+        {
+            if (!isClose(rows[ii], expected[ii].row, 1e-6) ||
+                !isClose(cols[ii], expected[ii].col, 1e-6))
+            {
+                fail(name, numThreads, ii);
+                return;
+            }
+        }
+    }
+
+    void compare(const std::string& name,
+                 size_t numThreads,
+                 const std::vector<double>& expected,
+                 const std::vector<double>& actual)
+    {
+        for (size_t ii = 0; ii < expected.size(); ++ii)
+        {
+            if (!isClose(actual[ii], expected[ii], 1e-9))
+            {
+                fail(name, numThreads, ii);
+                return;
+            }
+        }
+    }
+
+private:
+    const scene::ProjectionModel& mModel;
+    const scene::AdjustableParams mDelta;
+    const scene::Vector3 mGroundRefPoint;
+    scene::Vector3 mGroundPlaneNormal;
+    const double mHeight;
+
+    std::vector<double> mRows;
+    std::vector<double> mCols;
+
+    std::vector<scene::Vector3> mPlane;
+    std::vector<double> mPlaneTimeCOA;
+    std::vector<scene::Vector3> mHeightPoints;
+    std::vector<types::RowCol<double> > mImagePoints;
+    std::vector<double> mImageTimeCOA;
+    double mPlaneTime;
+    double mHeightTime;
+    double mImageTime;
+
+    bool mSuccess;
+};
+
+bool runTests(const scene::AdjustableParams& delta)
+{
+    scene::Vector3 scp;
+    const std::auto_ptr<scene::ProjectionModel> model(createModel(scp));
+    Tester tester(*model, scp, delta);
+    for (size_t numThreads = 1; numThreads <= 8; numThreads *= 2)
+    {
+        tester.test(numThreads);
+    }
+
+    return tester.success();
+}
+}
+
+int main(int /*argc*/, char** /*argv*/)
+{
+    try
+    {
+        bool success = runTests(scene::AdjustableParams());
+
+        scene::AdjustableParams delta;
+        delta.mParams[scene::AdjustableParams::ARP_RADIAL] = 3.0;
+        delta.mParams[scene::AdjustableParams::ARP_IN_TRACK] = -2.0;
+        delta.mParams[scene::AdjustableParams::ARP_VEL_CROSS_TRACK] = 0.1;
+        delta.mParams[scene::AdjustableParams::RANGE_BIAS] = 1.5;
+        if (!runTests(delta))
+        {
+            success = false;
+        }
+
+        if (success)
+        {
+            std::cout << "All tests pass!\n";
+        }
+        else
+        {
+            std::cerr << "Some tests FAIL!\n";
+        }
+
+        return (success ? 0 : 1);
+    }
+    catch (const std::exception& ex)
+    {
+        std::cerr << "Caught std::exception: " << ex.what() << std::endl;
+        return 1;
+    }
+    catch (const except::Exception& ex)
+    {
+        std::cerr << "Caught except::Exception: " << ex.getMessage()
+                  << std::endl;
+        return 1;
+    }
+    catch (...)
+    {
+        std::cerr << "Caught unknown exception\n";
+        return 1;
+    }
+}
@@ -0,0 +1,271 @@
+/* =========================================================================
+ * This file is part of scene-c++
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2014, MDA Information Systems LLC
+ *
+ * scene-c++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// Test program for projecting onto the terrain with an ElevationModel
+// Writes out a DEM with a large hill on it, projects a grid of image points
+// onto it with the single point and batch versions of imageToScene(), and
+// checks that the points are on the terrain and round trip back to the
+// image
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include <except/Exception.h>
+#include <sys/StopWatch.h>
+#include <io/FileOutputStream.h>
+#include <io/TempFile.h>
+#include <import/scene.h>
+
+#include "TestUtilities.h"
+
+namespace
+{
+// DEM covering the scene with posts every 0.001 degrees
+const scene::LatLon DEM_NORTH_WEST(SCENE_LAT + 0.2, SCENE_LON - 0.3);
+const types::RowCol<double> DEM_SPACING(0.001, 0.001);
+const types::RowCol<size_t> DEM_NUM_POSTS(401, 601);
+
+// Writes out a big endian float DEM.  If 'flat', every post is at 'height',
+// otherwise there's a 1500 m hill on top of it in the middle of the scene.
+void writeDEM(const std::string& pathname, double height, bool flat)
+{
+    std::vector<float> posts(DEM_NUM_POSTS.area());
+    for (size_t row = 0, idx = 0; row < DEM_NUM_POSTS.row; ++row)
+    {
+        const double lat = DEM_NORTH_WEST.getLat() - row * DEM_SPACING.row;
+        for (size_t col = 0; col < DEM_NUM_POSTS.col; ++col, ++idx)
+        {
+            const double lon = DEM_NORTH_WEST.getLon() +
+                    col * DEM_SPACING.col;
+            const double dLat = (lat - SCENE_LAT) / 0.02;
+            const double dLon = (lon - SCENE_LON) / 0.03;
+            posts[idx] = static_cast<float>(flat ? height :
+                    height + 1500.0 * std::exp(-(dLat * dLat + dLon * dLon)));
+        }
+    }
+
+    if (!sys::isBigEndianSystem())
+    {
+        sys::byteSwap(&posts[0], sizeof(float), posts.size());
+    }
+
+    io::FileOutputStream outStream(pathname);
+    outStream.write(reinterpret_cast<const sys::byte*>(&posts[0]),
+                    posts.size() * sizeof(float));
+    outStream.close();
+}
+
+class Tester
+{
+public:
+    Tester() :
+        mModel(createModel()),
+        mSuccess(true)
+    {
+        static const size_t NUM_ROWS = 60;
+        static const size_t NUM_COLS = 80;
+        for (size_t row = 0; row < NUM_ROWS; ++row)
+        {
+            for (size_t col = 0; col < NUM_COLS; ++col)
+            {
+                mRows.push_back(-3000.0 + 6000.0 * row / NUM_ROWS);
+                mCols.push_back(-4000.0 + 8000.0 * col / NUM_COLS);
+            }
+        }
+    }
+
+    // A flat DEM should give the same answer as a constant height surface
+    void testFlat()
+    {
+        io::TempFile tempfile;
+        writeDEM(tempfile.pathname(), 250.0, true);
+        const scene::RawElevationModel dem(
+                tempfile.pathname(), scene::RawElevationModel::FLOAT32, true,
+                DEM_NORTH_WEST, DEM_SPACING, DEM_NUM_POSTS);
+
+        for (size_t ii = 0; ii < mRows.size(); ii += 7)
+        {
+            const types::RowCol<double> pt(mRows[ii], mCols[ii]);
+            const scene::Vector3 expected = mModel->imageToScene(pt, 250.0);
+            const scene::Vector3 actual = mModel->imageToScene(pt, dem);
+            if ((expected - actual).norm() > 1e-6)
+            {
+                fail("Flat DEM", ii);
+                return;
+            }
+        }
+    }
+
+    void testHill(size_t tileSize, size_t maxNumTiles)
+    {
+        io::TempFile tempfile;
+        writeDEM(tempfile.pathname(), 500.0, false);
+        const scene::RawElevationModel dem(
+                tempfile.pathname(), scene::RawElevationModel::FLOAT32, true,
+                DEM_NORTH_WEST, DEM_SPACING, DEM_NUM_POSTS, 0.0,
+                tileSize, maxNumTiles);
+
+        const scene::ECEFToLLATransform ecefToLatLon;
+        const double heightThreshold = 0.1;
+        std::vector<scene::Vector3> expected(mRows.size());
+
+        sys::RealTimeStopWatch stopWatch;
+        stopWatch.start();
+        for (size_t ii = 0; ii < mRows.size(); ++ii)
+        {
+            expected[ii] = mModel->imageToScene(
+                    types::RowCol<double>(mRows[ii], mCols[ii]), dem,
+                    scene::AdjustableParams(), heightThreshold);
+        }
+        const double singleTime = stopWatch.stop();
+
+        // The points need to be on the terrain and on the contour, so they
+        // project back to where they came from
+        for (size_t ii = 0; ii < mRows.size(); ++ii)
+        {
+            const scene::LatLonAlt latLon =
+                    ecefToLatLon.transform(expected[ii]);
+            const types::RowCol<double> imagePoint =
+                    mModel->sceneToImage(expected[ii]);
+            if (!isClose(latLon.getAlt(),
+                         dem.getHeight(latLon.getLat(), latLon.getLon()),
+                         heightThreshold) ||
+                !isClose(imagePoint.row, mRows[ii], 1e-3) ||
+                !isClose(imagePoint.col, mCols[ii], 1e-3))
+            {
+                fail("Hill", ii);
+                return;
+            }
+        }
+
+        const size_t numPoints = mRows.size();
+        std::vector<double> x(numPoints);
+        std::vector<double> y(numPoints);
+        std::vector<double> z(numPoints);
+        for (size_t numThreads = 1; numThreads <= 4; numThreads *= 2)
+        {
+            stopWatch.clear();
+            stopWatch.start();
+            mModel->imageToScene(&mRows[0], &mCols[0], numPoints, dem,
+                                 &x[0], &y[0], &z[0], numThreads,
+                                 scene::AdjustableParams(), heightThreshold);
+            const double batchTime = stopWatch.stop();
+
+            for (size_t ii = 0; ii < numPoints; ++ii)
+            {
+                if (x[ii] != expected[ii][0] ||
+                    y[ii] != expected[ii][1] ||
+                    z[ii] != expected[ii][2])
+                {
+                    fail("Batch hill", ii);
+                    return;
+                }
+            }
+
+            std::cout << "Tile size " << tileSize << ", " << maxNumTiles
+                      << " tiles cached, " << numThreads << " threads: "
+                      << batchTime << " ms (single point " << singleTime
+                      << " ms), " << dem.getNumTilesRead()
+                      << " tiles read so far\n";
+        }
+    }
+
+    void testOutside()
+    {
+        io::TempFile tempfile;
+        writeDEM(tempfile.pathname(), 0.0, true);
+        const scene::RawElevationModel dem(
+                tempfile.pathname(), scene::RawElevationModel::FLOAT32, true,
+                DEM_NORTH_WEST, DEM_SPACING, DEM_NUM_POSTS);
+
+        try
+        {
+            dem.getHeight(SCENE_LAT + 1.0, SCENE_LON);
+            std::cerr << "Point outside the DEM DID NOT THROW\n";
+            mSuccess = false;
+        }
+        catch (const except::Exception& )
+        {
+        }
+    }
+
+    bool success() const
+    {
+        return mSuccess;
+    }
+
+private:
+    void fail(const std::string& name, size_t point)
+    {
+        std::cerr << name << " FAILED at point " << point << std::endl;
+        mSuccess = false;
+    }
+
+private:
+    const std::auto_ptr<scene::ProjectionModel> mModel;
+    std::vector<double> mRows;
+    std::vector<double> mCols;
+    bool mSuccess;
+};
+}
+
+int main(int /*argc*/, char** /*argv*/)
+{
+    try
+    {
+        Tester tester;
+        tester.testFlat();
+        tester.testHill(256, 64);
+
+        // Small tiles with a cache that can't hold them all
+        tester.testHill(16, 4);
+        tester.testOutside();
+
+        if (tester.success())
+        {
+            std::cout << "All tests pass!\n";
+        }
+        else
+        {
+            std::cerr << "Some tests FAIL!\n";
+        }
+
+        return (tester.success() ? 0 : 1);
+    }
+    catch (const std::exception& ex)
+    {
+        std::cerr << "Caught std::exception: " << ex.what() << std::endl;
+        return 1;
+    }
+    catch (const except::Exception& ex)
+    {
+        std::cerr << "Caught except::Exception: " << ex.getMessage()
+                  << std::endl;
+        return 1;
+    }
+    catch (...)
+    {
+        std::cerr << "Caught unknown exception\n";
+        return 1;
+    }
+}
@@ -0,0 +1,185 @@
+/* =========================================================================
+ * This file is part of six.sicd-c++
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2017, MDA Information Systems LLC
+ *
+ * six.sicd-c++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __SIX_SICD_FAST_GEOLOCATOR_H__
+#define __SIX_SICD_FAST_GEOLOCATOR_H__
+
+#include <vector>
+
+#include <types/RowCol.h>
+#include <scene/Types.h>
+#include <scene/GridECEFTransform.h>
+#include <six/sicd/ComplexData.h>
+
+namespace six
+{
+namespace sicd
+{
+/*!
+ * \class FastGeoLocator
+ * \brief Approximates an exact pixel --> lat/lon/alt model by bilinearly
+ * interpolating it on a lattice of pixels
+ *
+ * The exact model is sampled once, at lattice nodes every N pixels.  N
+ * starts coarse and is halved until the interpolated locations at the center
+ * and edge midpoints of every lattice cell are within maxError meters of the
+ * exact model (or N is 1).  Geolocating a pixel then costs a handful of
+ * multiply-adds rather than a projection and an ECEF --> LLA conversion.
+ *
+ * Lat/lon/alt are interpolated directly, with longitude unwrapped so that
+ * images straddling the antimeridian interpolate correctly.  Returned
+ * longitudes are in [-180, 180).
+ */
+class FastGeoLocator
+{
+public:
+    /*!
+     * \class Model
+     * \brief The exact pixel --> ECEF model being approximated.  Must be
+     * callable from multiple threads at once.
+     */
+    class Model
+    {
+    public:
+        virtual ~Model()
+        {
+        }
+
+        virtual scene::Vector3 toECEF(
+                const types::RowCol<double>& pixel) const = 0;
+    };
+
+    //! Default error bound in meters
+    static const double DEFAULT_MAX_ERROR;
+
+    /*!
+     * Geolocates a SICD's slant plane pixels.  Slant plane pixels are
+     * projected to the ground plane the same way that
+     * SlantPlanePixelTransformer::toLLA() does.
+     *
+     * \param data SICD metadata
+     * \param maxError Error bound in meters
+     * \param numThreads Number of threads to sample the exact model with
+     */
+    FastGeoLocator(const ComplexData& data,
+                   double maxError = DEFAULT_MAX_ERROR,
+                   size_t numThreads = 1);
+
+    /*!
+     * Geolocates the pixels of an output plane grid (e.g. a SIDD's, via
+     * six::sidd::Utilities::getGridECEFTransform())
+     *
+     * \param transform Output plane row/col --> ECEF transform
+     * \param dims Dimensions of the output plane
+     * \param maxError Error bound in meters
+     * \param numThreads Number of threads to sample the exact model with
+     */
+    FastGeoLocator(const scene::GridECEFTransform& transform,
+                   const types::RowCol<size_t>& dims,
+                   double maxError = DEFAULT_MAX_ERROR,
+                   size_t numThreads = 1);
+
+    /*!
+     * Approximates any other model
+     *
+     * \param model Exact model.  Only used in the constructor.
+     * \param dims Dimensions of the image
+     * \param maxError Error bound in meters
+     * \param numThreads Number of threads to sample the exact model with
+     */
+    FastGeoLocator(const Model& model,
+                   const types::RowCol<size_t>& dims,
+                   double maxError = DEFAULT_MAX_ERROR,
+                   size_t numThreads = 1);
+
+    /*!
+     * \param pixel 0-based pixel location.  Pixels off of the image are
+     * extrapolated.
+     * \return Its approximate location
+     */
+    LatLonAlt geolocate(const RowColDouble& pixel) const;
+
+    /*!
+     * Geolocates every pixel in a range of rows
+     *
+     * \param firstRow 0-based first row
+     * \param numRows Number of rows
+     * \param lats [output] numRows * number of cols latitudes in degrees
+     * \param lons [output] numRows * number of cols longitudes in degrees
+     * \param alts [output] numRows * number of cols altitudes in meters.
+     * May be NULL.
+     */
+    void geolocate(size_t firstRow,
+                   size_t numRows,
+                   double* lats,
+                   double* lons,
+                   double* alts) const;
+
+    //! \return Number of pixels between lattice nodes
+    size_t getLatticeSpacing() const
+    {
+        return mSpacing;
+    }
+
+    /*!
+     * \return Largest error in meters found when checking the lattice.
+     * This is NaN if the exact model gave back NaNs.
+     */
+    double getMeasuredError() const
+    {
+        return mMeasuredError;
+    }
+
+private:
+    class SlantPlaneModel;
+    class GridModel;
+
+    // Samples the model at the lattice nodes or checks the lattice against
+    // it for a range of lattice rows
+    class SampleRunnable;
+
+    void initialize(const Model& model, double maxError, size_t numThreads);
+
+    void sample(const Model& model, size_t numThreads);
+
+    double check(const Model& model, size_t numThreads) const;
+
+    // Finds the lattice cell for a pixel and the fractional offset into it
+    size_t getCell(double pixel, size_t numNodes, double& frac) const;
+
+    LatLonAlt interpolate(double row, double col) const;
+
+private:
+    types::RowCol<size_t> mDims;
+    size_t mSpacing;
+    types::RowCol<size_t> mNumNodes;
+    double mMeasuredError;
+
+    // Lat/lon/alt at each lattice node.  Longitudes are unwrapped.
+    std::vector<double> mLats;
+    std::vector<double> mLons;
+    std::vector<double> mAlts;
+};
+}
+}
+
+#endif
@@ -53,7 +53,6 @@ struct ImageData
 
     /*!
      *  Indicates the pixel type and binary format of the data.
-     *  \todo We currently do not support AMP8I_PHS8I
      *
      */
     PixelType pixelType;
@@ -0,0 +1,288 @@
+/* =========================================================================
+ * This file is part of six.sicd-c++
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2017, MDA Information Systems LLC
+ *
+ * six.sicd-c++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __SIX_SICD_ORTHORECTIFIER_H__
+#define __SIX_SICD_ORTHORECTIFIER_H__
+
+#include <complex>
+#include <memory>
+#include <vector>
+
+#include <sys/Conf.h>
+#include <io/InputStream.h>
+#include <types/RowCol.h>
+#include <six/Types.h>
+#include <six/Enums.h>
+#include <six/NITFReadControl.h>
+#include <six/sicd/ComplexData.h>
+
+namespace six
+{
+namespace sicd
+{
+/*!
+ * \class Orthorectifier
+ * \brief Projects a SICD's slant plane image onto its output plane
+ * (RadarCollection.Area.Plane, derived if the SICD doesn't have one)
+ *
+ * Output pixels are mapped back to the slant plane with output --> slant
+ * polynomials and interpolated from the complex input pixels.  Output rows
+ * are produced a block at a time: for each block, only the slant plane
+ * region the block maps into (plus the interpolation kernel's support) is
+ * read, so memory use is bounded by the block size rather than the image
+ * size.  The rows of each block are split across threads.
+ *
+ * Output pixels that map outside of the slant plane image are set to 0.
+ *
+ * To write out a SIDD, either feed getAmplitude() blocks (after any remap)
+ * to a SIDDByteProvider, or hand an OrthorectifiedStream to
+ * NITFWriteControl::save() which will pull the rows through as it writes.
+ */
+class Orthorectifier
+{
+public:
+    //! How input pixels are interpolated
+    enum Interpolation
+    {
+        //! Closest input pixel
+        NEAREST,
+
+        //! 2x2 bilinear
+        BILINEAR,
+
+        //! 8x8 Hann windowed sinc
+        SINC
+    };
+
+    //! Default number of output rows per block
+    static const size_t DEFAULT_ROWS_PER_BLOCK;
+
+    /*!
+     * Reads the input pixels from a SICD as they're needed, fitting the
+     * output --> slant polynomials from its metadata
+     *
+     * \param reader Loaded reader for the SICD.  Must outlive this object.
+     * \param interpolation How to interpolate input pixels
+     * \param numThreads Number of threads to use for reading and
+     * interpolating
+     * \param numRowsPerBlock Number of output rows to produce at a time
+     * \param polyOrderX Order of the output --> slant polynomials in the
+     * output row direction
+     * \param polyOrderY Order of the output --> slant polynomials in the
+     * output col direction
+     */
+    Orthorectifier(NITFReadControl& reader,
+                   Interpolation interpolation,
+                   size_t numThreads = 1,
+                   size_t numRowsPerBlock = DEFAULT_ROWS_PER_BLOCK,
+                   size_t polyOrderX = 3,
+                   size_t polyOrderY = 3);
+
+    /*!
+     * Uses an image that's already in memory and caller-provided
+     * polynomials
+     *
+     * \param image Slant plane image.  Must outlive this object.
+     * \param inputDims Dimensions of image
+     * \param outputToSlantRow Pixel-based output --> slant row polynomial
+     * of (output row, output col)
+     * \param outputToSlantCol Pixel-based output --> slant col polynomial
+     * of (output row, output col)
+     * \param outputDims Dimensions of the output plane
+     * \param interpolation How to interpolate input pixels
+     * \param numThreads Number of threads to use for interpolating
+     * \param numRowsPerBlock Number of output rows to produce at a time
+     */
+    Orthorectifier(const std::complex<float>* image,
+                   const types::RowCol<size_t>& inputDims,
+                   const Poly2D& outputToSlantRow,
+                   const Poly2D& outputToSlantCol,
+                   const types::RowCol<size_t>& outputDims,
+                   Interpolation interpolation,
+                   size_t numThreads = 1,
+                   size_t numRowsPerBlock = DEFAULT_ROWS_PER_BLOCK);
+
+    ~Orthorectifier();
+
+    /*!
+     * Fits pixel-based output --> slant polynomials for a SICD's output
+     * plane.  This is what the NITFReadControl constructor uses.
+     *
+     * \param data SICD metadata
+     * \param polyOrderX Order of the polynomials in the output row direction
+     * \param polyOrderY Order of the polynomials in the output col direction
+     * \param outputToSlantRow [output] Output --> slant row polynomial of
+     * (output row, output col)
+     * \param outputToSlantCol [output] Output --> slant col polynomial of
+     * (output row, output col)
+     * \param outputDims [output] Dimensions of the output plane
+     */
+    static void fitOutputToSlantPolynomials(
+            const ComplexData& data,
+            size_t polyOrderX,
+            size_t polyOrderY,
+            Poly2D& outputToSlantRow,
+            Poly2D& outputToSlantCol,
+            types::RowCol<size_t>& outputDims);
+
+    //! \return The dimensions of the output plane
+    types::RowCol<size_t> getOutputDims() const
+    {
+        return mOutputDims;
+    }
+
+    /*!
+     * Orthorectifies a range of output rows
+     *
+     * \param firstRow 0-based first output row
+     * \param numRows Number of output rows
+     * \param output [output] numRows * getOutputDims().col pixels
+     */
+    void getPixels(size_t firstRow,
+                   size_t numRows,
+                   std::complex<float>* output);
+
+    /*!
+     * Same as above, but produces the amplitude of each pixel
+     */
+    void getAmplitude(size_t firstRow, size_t numRows, float* output);
+
+private:
+    // Supplies regions of the slant plane image
+    class Source;
+    class MemorySource;
+    class NITFSource;
+
+    // Interpolates a range of the current block's rows
+    class RowRunnable;
+
+    void initialize();
+
+    // Fills mRegion with the input pixels the block maps into
+    void loadRegion(size_t firstRow, size_t numRows);
+
+    void getBlock(size_t firstRow,
+                  size_t numRows,
+                  std::complex<float>* pixels,
+                  float* amplitude);
+
+    void runRows(bool findBounds,
+                 size_t firstRow,
+                 size_t numRows,
+                 std::complex<float>* pixels,
+                 float* amplitude);
+
+    // Computes the slant plane row and col of each pixel in an output row
+    void getSlantCoordinates(size_t outputRow,
+                             double* slantRows,
+                             double* slantCols) const;
+
+    // Noncopyable
+    Orthorectifier(const Orthorectifier& );
+    const Orthorectifier& operator=(const Orthorectifier& );
+
+private:
+    std::auto_ptr<Source> mSource;
+    types::RowCol<size_t> mInputDims;
+    types::RowCol<size_t> mOutputDims;
+    const Interpolation mInterpolation;
+    const size_t mNumThreads;
+    const size_t mNumRowsPerBlock;
+
+    // Flipped so that atY(output row) gives a polynomial in output col
+    Poly2D mToSlantRow;
+    Poly2D mToSlantCol;
+    std::vector<double> mOutputCols;
+
+    // Input pixels for the current block, padded by the kernel's support
+    // (replicating edge pixels where the padding falls off the image)
+    std::vector<std::complex<float> > mRegion;
+    std::vector<std::complex<float> > mScratch;
+    types::RowCol<sys::SSize_T> mRegionOffset;
+    types::RowCol<size_t> mRegionDims;
+
+    // Windowed sinc weights at each fractional offset
+    std::vector<float> mSincWeights;
+};
+
+/*!
+ * \class OrthorectifiedStream
+ * \brief Presents the output of an Orthorectifier as a stream of MONO8I or
+ * MONO16I pixels (in native byte order), one output block at a time
+ *
+ * This allows writing a SIDD straight from the slant plane without holding
+ * the whole output plane in memory:
+ *
+ * \code
+    six::sicd::OrthorectifiedStream stream(orthorectifier,
+                                           six::PixelType::MONO8I, scale);
+    six::SourceList sources(1, &stream);
+    writer.save(sources, outputPathname, schemaPaths);
+ * \endcode
+ *
+ * Each amplitude is linearly scaled, rounded and clamped to the pixel
+ * type's range.
+ */
+class OrthorectifiedStream : public io::InputStream
+{
+public:
+    /*!
+     * \param orthorectifier Orthorectifier to pull rows from.  Must outlive
+     * this object.
+     * \param pixelType MONO8I or MONO16I
+     * \param scale Amplitudes are multiplied by this before being converted
+     * \param numRowsPerBlock Number of output rows to convert at a time
+     */
+    OrthorectifiedStream(Orthorectifier& orthorectifier,
+                         PixelType pixelType,
+                         double scale,
+                         size_t numRowsPerBlock =
+                                 Orthorectifier::DEFAULT_ROWS_PER_BLOCK);
+
+    //! \return Number of bytes left in the stream
+    virtual sys::Off_T available();
+
+protected:
+    virtual sys::SSize_T readImpl(void* buffer, size_t len);
+
+private:
+    // Converts the next block of rows into mBuffer
+    void nextBlock();
+
+private:
+    Orthorectifier& mOrthorectifier;
+    const types::RowCol<size_t> mDims;
+    const size_t mNumBytesPerPixel;
+    const float mScale;
+    const size_t mNumRowsPerBlock;
+    const size_t mNumBytes;
+
+    size_t mNextRow;
+    size_t mPosition;
+    std::vector<float> mAmplitude;
+    std::vector<sys::ubyte> mBuffer;
+    size_t mBufferPosition;
+};
+}
+}
+
+#endif
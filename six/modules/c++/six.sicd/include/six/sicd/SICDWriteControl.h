@@ -23,10 +23,13 @@
 #ifndef __SIX_SICD_WRITE_CONTROL_H__
 #define __SIX_SICD_WRITE_CONTROL_H__
 
+#include <memory>
 #include <vector>
 
+#include <sys/Mutex.h>
 #include <types/RowCol.h>
 #include <six/NITFWriteControl.h>
+#include <six/PositionalFileWriter.h>
 #include <six/sicd/ComplexData.h>
 
 namespace six
@@ -99,6 +102,28 @@ public:
               const types::RowCol<size_t>& dims,
               bool restoreData = true);
 
+    /*!
+     * Thread-safe version of save().  Any number of threads may call this at
+     * once, each with a different, non-overlapping AOI of the image, and in
+     * any order.  The headers are written by whichever call comes first.
+     * After that, each call byte swaps its pixels in place (if needed) on the
+     * calling thread and writes them to explicit offsets in the file, so
+     * calls don't contend over a shared file position.
+     *
+     * Calls to this may not overlap with calls to save() or close().
+     *
+     * \param imageData The image data pixels to write (see save())
+     * \param offset The global offset in pixels as to where these pixels are
+     *     in the image (see save())
+     * \param dims The dimensions of the image data pixels
+     * \param restoreData Whether to swap the incoming data back afterwards
+     *     if it needed to be swapped (see save())
+     */
+    void saveTile(void* imageData,
+                  const types::RowCol<size_t>& offset,
+                  const types::RowCol<size_t>& dims,
+                  bool restoreData = true);
+
     /*!
      * Closes the underlying IO interface.  This will occur implicitly in the
      * destructor if it's not called.
@@ -110,10 +135,26 @@ private:
 
     void write(const std::vector<sys::byte>& data);
 
+    void checkInitialized() const;
+
+    // Writes the pixels to wherever they belong in each image segment,
+    // either through mIO or, if 'concurrent' is set, through mTileWriter
+    void writePixels(const void* imageData,
+                     const types::RowCol<size_t>& offset,
+                     const types::RowCol<size_t>& dims,
+                     bool concurrent);
+
+    void swapPixels(void* imageData, const types::RowCol<size_t>& dims) const;
+
 private:
-    std::auto_ptr<nitf::IOInterface> mIO;
+    const std::string mPathname;
+    std::auto_ptr<nitf::BufferedWriter> mIO;
     const std::vector<std::string> mSchemaPaths;
 
+    // Guards writing the headers and opening mTileWriter in saveTile()
+    sys::Mutex mMutex;
+    std::auto_ptr<PositionalFileWriter> mTileWriter;
+
     std::vector<nitf::Off> mImageDataStart;
     std::vector<NITFSegmentInfo> mImageSegmentInfo;
     bool mHaveWrittenHeaders;
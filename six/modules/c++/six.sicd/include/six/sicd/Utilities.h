@@ -142,7 +142,7 @@ public:
      * \return a pointer to the loaded data.
      *
      * \throws except::Exception if the pixel type of the SICD is not a
-     *           complex float32 or complex int64, or
+     *           complex float32, complex int16, or AMP8I_PHS8I, or
      *         if the buffer pointer is null
      */
     static void getWidebandData(NITFReadControl& reader,
@@ -164,7 +164,7 @@ public:
      * \return a pointer to the loaded data.
      *
      * \throws except::Exception if the pixel type of the SICD is not a
-     *           complex float32 or complex int64, or
+     *           complex float32, complex int16, or AMP8I_PHS8I, or
      *         if the buffer pointer is null
      */
     static void getWidebandData(NITFReadControl& reader,
@@ -173,6 +173,33 @@ public:
                                 const types::RowCol<size_t>& extent,
                                 std::complex<float>* buffer);
 
+    /*
+     * Same as above, but reads the image segments and converts the pixels
+     * to complex<float> using multiple threads.
+     *
+     * If the reader was loaded with NITFReadControl::OPT_MEMORY_MAP and the
+     * region lies in memory mapped image segments, the pixels are byte
+     * swapped and converted straight out of the map in a single pass.
+     *
+     * \param reader A loaded NITFReadControl associated with the SICD
+     * \param complexData complexData associated with the SICD
+     * \param offset The starting row and column in the region
+     * \param extent The number of rows and columns in the region
+     * \param numThreads Number of threads to use
+     * \param buffer A pointer to the buffer to load data into.  Must be
+     *   at least extent.area() pixels
+     *
+     * \throws except::Exception if the pixel type of the SICD is not a
+     *           complex float32, complex int16, or AMP8I_PHS8I, or
+     *         if the buffer pointer is null
+     */
+    static void getWidebandData(NITFReadControl& reader,
+                                const ComplexData& complexData,
+                                const types::RowCol<size_t>& offset,
+                                const types::RowCol<size_t>& extent,
+                                size_t numThreads,
+                                std::complex<float>* buffer);
+
     /*
      * Given a loaded NITFReadControl and a ComplexData object, this
      * function loads the wideband data associated with the reader
@@ -186,7 +213,7 @@ public:
      * \param buffer The functions output, will contain the image
      *
      * \throws except::Exception if the pixel type of the SICD is not a complex
-     *           float32 or complex int16
+     *           float32, complex int16, or AMP8I_PHS8I
      */
     static void getWidebandData(NITFReadControl& reader,
                                 const ComplexData& complexData,
@@ -207,7 +234,7 @@ public:
      * \param buffer The functions output, will contain the image
      *
      * \throws except::Exception if the pixel type of the SICD is not a complex
-     *           float32 or complex int16
+     *           float32, complex int16, or AMP8I_PHS8I
      */
      static void getWidebandData(NITFReadControl& reader,
                                 const ComplexData& complexData,
@@ -226,7 +253,7 @@ public:
      * \param buffer The pre-sized buffer to be read into
      *
      * \throws except::Exception if the pixel type of the SICD is not a complex
-     *           float32 or complex int16, or
+     *           float32, complex int16, or AMP8I_PHS8I, or
      *         if the buffer pointer is null
      */
     static
@@ -249,7 +276,7 @@ public:
      * \param buffer The pre-sized buffer to be read into
      *
      * \throws except::Exception if the pixel type of the SICD is not a complex
-     *           float32 or complex int16, or
+     *           float32, complex int16, or AMP8I_PHS8I, or
      *         if the buffer pointer is null
      *
      */
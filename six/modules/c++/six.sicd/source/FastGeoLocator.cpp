@@ -0,0 +1,448 @@
+/* =========================================================================
+ * This file is part of six.sicd-c++
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2017, MDA Information Systems LLC
+ *
+ * six.sicd-c++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+
+#include <except/Exception.h>
+#include <str/Convert.h>
+#include <sys/Runnable.h>
+#include <mt/ThreadGroup.h>
+#include <mt/ThreadPlanner.h>
+#include <scene/ProjectionModel.h>
+#include <scene/SceneGeometry.h>
+#include <scene/Utilities.h>
+#include <six/sicd/FastGeoLocator.h>
+#include <six/sicd/Utilities.h>
+
+namespace
+{
+inline double wrapLongitude(double lon)
+{
+    if (lon >= 180.0)
+    {
+        lon -= 360.0;
+    }
+    else if (lon < -180.0)
+    {
+        lon += 360.0;
+    }
+    return lon;
+}
+}
+
+namespace six
+{
+namespace sicd
+{
+const double FastGeoLocator::DEFAULT_MAX_ERROR = 0.1;
+
+class FastGeoLocator::SlantPlaneModel : public FastGeoLocator::Model
+{
+public:
+    SlantPlaneModel(const ComplexData& data) :
+        mData(data),
+        mGeometry(Utilities::getSceneGeometry(&data)),
+        mProjection(Utilities::getProjectionModel(&data, mGeometry.get())),
+        mReferencePosition(mGeometry->getReferencePosition()),
+        mGroundPlaneNormal(mReferencePosition)
+    {
+        mGroundPlaneNormal.normalize();
+    }
+
+    virtual scene::Vector3 toECEF(const types::RowCol<double>& pixel) const
+    {
+        double timeCOA(0.0);
+        return mProjection->imageToScene(mData.pixelToImagePoint(pixel),
+                                         mReferencePosition,
+                                         mGroundPlaneNormal,
+                                         &timeCOA);
+    }
+
+private:
+    const ComplexData& mData;
+    const std::auto_ptr<scene::SceneGeometry> mGeometry;
+    const std::auto_ptr<scene::ProjectionModel> mProjection;
+    const scene::Vector3 mReferencePosition;
+    scene::Vector3 mGroundPlaneNormal;
+};
+
+class FastGeoLocator::GridModel : public FastGeoLocator::Model
+{
+public:
+    GridModel(const scene::GridECEFTransform& transform) :
+        mTransform(transform)
+    {
+    }
+
+    virtual scene::Vector3 toECEF(const types::RowCol<double>& pixel) const
+    {
+        return mTransform.rowColToECEF(pixel);
+    }
+
+private:
+    const scene::GridECEFTransform& mTransform;
+};
+
+class FastGeoLocator::SampleRunnable : public sys::Runnable
+{
+public:
+    // Samples the model at each node in the lattice rows if error is NULL.
+    // Otherwise finds the largest error in the lattice cell rows.
+    SampleRunnable(const FastGeoLocator& locator,
+                   const Model& model,
+                   size_t firstRow,
+                   size_t numRows,
+                   double* error) :
+        mLocator(locator),
+        mModel(model),
+        mFirstRow(firstRow),
+        mNumRows(numRows),
+        mError(error)
+    {
+    }
+
+    virtual void run()
+    {
+        if (mError)
+        {
+            *mError = 0.0;
+        }
+
+        const FastGeoLocator& locator(mLocator);
+        const double spacing = static_cast<double>(locator.mSpacing);
+        const size_t endRow = mFirstRow + mNumRows;
+        for (size_t row = mFirstRow; row < endRow; ++row)
+        {
+            for (size_t col = 0; col < locator.mNumNodes.col; ++col)
+            {
+                const double pixelRow = row * spacing;
+                const double pixelCol = col * spacing;
+                if (mError == NULL)
+                {
+                    const LatLonAlt lla = scene::Utilities::ecefToLatLon(
+                            mModel.toECEF(types::RowCol<double>(pixelRow,
+                                                                pixelCol)));
+                    const size_t idx = row * locator.mNumNodes.col + col;
+                    mLats[idx] = lla.getLat();
+                    mLons[idx] = lla.getLon();
+                    mAlts[idx] = lla.getAlt();
+                    continue;
+                }
+
+                // Check the middle of the cell's top and left edges and
+                // its center, plus the middle of the bottom edge along the
+                // last row.  The last node col covers the last cell's right
+                // edge.
+                if (col + 1 < locator.mNumNodes.col)
+                {
+                    check(pixelRow, pixelCol + spacing / 2);
+                    check(pixelRow + spacing / 2, pixelCol + spacing / 2);
+                    if (row + 2 == locator.mNumNodes.row)
+                    {
+                        check(pixelRow + spacing, pixelCol + spacing / 2);
+                    }
+                }
+                check(pixelRow + spacing / 2, pixelCol);
+            }
+        }
+    }
+
+    void setOutput(double* lats, double* lons, double* alts)
+    {
+        mLats = lats;
+        mLons = lons;
+        mAlts = alts;
+    }
+
+private:
+    void check(double row, double col)
+    {
+        // Only pixels on the image matter
+        if (row > mLocator.mDims.row - 1 || col > mLocator.mDims.col - 1)
+        {
+            return;
+        }
+
+        const scene::Vector3 expected =
+                mModel.toECEF(types::RowCol<double>(row, col));
+        const scene::Vector3 actual = scene::Utilities::latLonToECEF(
+                mLocator.interpolate(row, col));
+        // Written so that a NaN from the model counts as too large
+        const double error = (actual - expected).norm();
+        if (!(error <= *mError))
+        {
+            *mError = error;
+        }
+    }
+
+private:
+    const FastGeoLocator& mLocator;
+    const Model& mModel;
+    const size_t mFirstRow;
+    const size_t mNumRows;
+    double* const mError;
+    double* mLats;
+    double* mLons;
+    double* mAlts;
+};
+
+FastGeoLocator::FastGeoLocator(const ComplexData& data,
+                               double maxError,
+                               size_t numThreads)
+{
+    mDims.row = data.getNumRows();
+    mDims.col = data.getNumCols();
+    initialize(SlantPlaneModel(data), maxError, numThreads);
+}
+
+FastGeoLocator::FastGeoLocator(const scene::GridECEFTransform& transform,
+                               const types::RowCol<size_t>& dims,
+                               double maxError,
+                               size_t numThreads) :
+    mDims(dims)
+{
+    initialize(GridModel(transform), maxError, numThreads);
+}
+
+FastGeoLocator::FastGeoLocator(const Model& model,
+                               const types::RowCol<size_t>& dims,
+                               double maxError,
+                               size_t numThreads) :
+    mDims(dims)
+{
+    initialize(model, maxError, numThreads);
+}
+
+void FastGeoLocator::initialize(const Model& model,
+                                double maxError,
+                                size_t numThreads)
+{
+    if (mDims.area() == 0)
+    {
+        throw except::Exception(Ctxt("Image is empty"));
+    }
+
+    numThreads = std::max<size_t>(numThreads, 1);
+
+    // Start with a lattice that's 4 to 8 cells across
+    const size_t maxDim = std::max(mDims.row, mDims.col);
+    mSpacing = 1;
+    while (mSpacing * 8 <= maxDim)
+    {
+        mSpacing *= 2;
+    }
+
+    while (true)
+    {
+        sample(model, numThreads);
+        mMeasuredError = check(model, numThreads);
+        // Finer lattices won't help if the model gives back NaNs
+        if (!(mMeasuredError > maxError) || mSpacing == 1)
+        {
+            break;
+        }
+        mSpacing /= 2;
+    }
+}
+
+void FastGeoLocator::sample(const Model& model, size_t numThreads)
+{
+    mNumNodes.row = std::max<size_t>(
+            (mDims.row - 1 + mSpacing - 1) / mSpacing + 1, 2);
+    mNumNodes.col = std::max<size_t>(
+            (mDims.col - 1 + mSpacing - 1) / mSpacing + 1, 2);
+    mLats.resize(mNumNodes.area());
+    mLons.resize(mNumNodes.area());
+    mAlts.resize(mNumNodes.area());
+
+    mt::ThreadGroup threads;
+    const mt::ThreadPlanner planner(mNumNodes.row, numThreads);
+    size_t threadNum(0);
+    size_t startRow(0);
+    size_t numRowsThisThread(0);
+    while (planner.getThreadInfo(threadNum++, startRow, numRowsThisThread))
+    {
+        std::auto_ptr<SampleRunnable> sampler(new SampleRunnable(
+                *this, model, startRow, numRowsThisThread, NULL));
+        sampler->setOutput(&mLats[0], &mLons[0], &mAlts[0]);
+        if (numThreads <= 1)
+        {
+            sampler->run();
+        }
+        else
+        {
+            threads.createThread(std::auto_ptr<sys::Runnable>(sampler));
+        }
+    }
+    threads.joinAll();
+
+    // Unwrap the longitudes so that interpolating across the antimeridian
+    // works
+    const double firstLon = mLons[0];
+    for (size_t ii = 1; ii < mLons.size(); ++ii)
+    {
+        mLons[ii] += 360.0 * std::floor((firstLon - mLons[ii]) / 360.0 + 0.5);
+    }
+}
+
+double FastGeoLocator::check(const Model& model, size_t numThreads) const
+{
+    const size_t numCellRows = mNumNodes.row - 1;
+    const mt::ThreadPlanner planner(numCellRows, numThreads);
+    std::vector<double> errors(std::max<size_t>(numThreads, 1), 0.0);
+
+    mt::ThreadGroup threads;
+    size_t threadNum(0);
+    size_t startRow(0);
+    size_t numRowsThisThread(0);
+    while (planner.getThreadInfo(threadNum, startRow, numRowsThisThread))
+    {
+        std::auto_ptr<sys::Runnable> checker(new SampleRunnable(
+                *this, model, startRow, numRowsThisThread,
+                &errors[threadNum]));
+        if (numThreads <= 1)
+        {
+            checker->run();
+        }
+        else
+        {
+            threads.createThread(checker);
+        }
+        ++threadNum;
+    }
+    threads.joinAll();
+
+    double maxError(0.0);
+    for (size_t ii = 0; ii < errors.size(); ++ii)
+    {
+        if (!(errors[ii] <= maxError))
+        {
+            maxError = errors[ii];
+        }
+    }
+    return maxError;
+}
+
+size_t FastGeoLocator::getCell(double pixel,
+                               size_t numNodes,
+                               double& frac) const
+{
+    const double position = pixel / mSpacing;
+    const double cell = std::min(std::max(std::floor(position), 0.0),
+                                 static_cast<double>(numNodes - 2));
+    frac = position - cell;
+    return static_cast<size_t>(cell);
+}
+
+LatLonAlt FastGeoLocator::interpolate(double row, double col) const
+{
+    double rowFrac;
+    double colFrac;
+    const size_t cellRow = getCell(row, mNumNodes.row, rowFrac);
+    const size_t cellCol = getCell(col, mNumNodes.col, colFrac);
+    const size_t idx = cellRow * mNumNodes.col + cellCol;
+    const size_t below = idx + mNumNodes.col;
+
+    const double weights[] = {
+            (1 - rowFrac) * (1 - colFrac), (1 - rowFrac) * colFrac,
+            rowFrac * (1 - colFrac), rowFrac * colFrac};
+    const double lat = weights[0] * mLats[idx] + weights[1] * mLats[idx + 1] +
+            weights[2] * mLats[below] + weights[3] * mLats[below + 1];
+    const double lon = weights[0] * mLons[idx] + weights[1] * mLons[idx + 1] +
+            weights[2] * mLons[below] + weights[3] * mLons[below + 1];
+    const double alt = weights[0] * mAlts[idx] + weights[1] * mAlts[idx + 1] +
+            weights[2] * mAlts[below] + weights[3] * mAlts[below + 1];
+    return LatLonAlt(lat, wrapLongitude(lon), alt);
+}
+
+LatLonAlt FastGeoLocator::geolocate(const RowColDouble& pixel) const
+{
+    return interpolate(pixel.row, pixel.col);
+}
+
+void FastGeoLocator::geolocate(size_t firstRow,
+                               size_t numRows,
+                               double* lats,
+                               double* lons,
+                               double* alts) const
+{
+    if (firstRow + numRows > mDims.row)
+    {
+        throw except::Exception(Ctxt(
+                "Rows [" + str::toString(firstRow) + ", " +
+                str::toString(firstRow + numRows) + ") are out of bounds"));
+    }
+
+    // Which lattice cell each col is in and how far across it
+    const size_t numCols = mDims.col;
+    std::vector<size_t> cells(numCols);
+    std::vector<double> fracs(numCols);
+    for (size_t col = 0; col < numCols; ++col)
+    {
+        cells[col] = getCell(static_cast<double>(col), mNumNodes.col,
+                             fracs[col]);
+    }
+
+    // Each row is interpolated between its two lattice rows once for the
+    // whole row, then along the row per pixel
+    const size_t numNodeCols = mNumNodes.col;
+    std::vector<double> rowLats(numNodeCols);
+    std::vector<double> rowLons(numNodeCols);
+    std::vector<double> rowAlts(numNodeCols);
+    for (size_t row = 0; row < numRows; ++row)
+    {
+        double rowFrac;
+        const size_t cellRow = getCell(static_cast<double>(firstRow + row),
+                                       mNumNodes.row, rowFrac);
+        const size_t above = cellRow * numNodeCols;
+        const size_t below = above + numNodeCols;
+        for (size_t col = 0; col < numNodeCols; ++col)
+        {
+            rowLats[col] = mLats[above + col] +
+                    rowFrac * (mLats[below + col] - mLats[above + col]);
+            rowLons[col] = mLons[above + col] +
+                    rowFrac * (mLons[below + col] - mLons[above + col]);
+            rowAlts[col] = mAlts[above + col] +
+                    rowFrac * (mAlts[below + col] - mAlts[above + col]);
+        }
+
+        const size_t offset = row * numCols;
+        for (size_t col = 0; col < numCols; ++col)
+        {
+            const size_t cell = cells[col];
+            const double frac = fracs[col];
+            lats[offset + col] = rowLats[cell] +
+                    frac * (rowLats[cell + 1] - rowLats[cell]);
+            lons[offset + col] = wrapLongitude(rowLons[cell] +
+                    frac * (rowLons[cell + 1] - rowLons[cell]));
+            if (alts)
+            {
+                alts[offset + col] = rowAlts[cell] +
+                        frac * (rowAlts[cell + 1] - rowAlts[cell]);
+            }
+        }
+    }
+}
+}
+}
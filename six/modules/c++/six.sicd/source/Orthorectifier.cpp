@@ -0,0 +1,804 @@
+/* =========================================================================
+ * This file is part of six.sicd-c++
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2017, MDA Information Systems LLC
+ *
+ * six.sicd-c++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include <except/Exception.h>
+#include <sys/Runnable.h>
+#include <mt/ThreadGroup.h>
+#include <mt/ThreadPlanner.h>
+#include <scene/ProjectionPolynomialFitter.h>
+#include <six/sicd/AreaPlaneUtility.h>
+#include <six/sicd/Orthorectifier.h>
+#include <six/sicd/Utilities.h>
+
+namespace
+{
+// The sinc kernel uses taps floor(x) - 3 through floor(x) + 4
+const size_t SINC_NUM_TAPS = 8;
+const sys::SSize_T SINC_FIRST_TAP = -3;
+const size_t SINC_NUM_STEPS = 512;
+
+// Range of slant plane coordinates a block's valid pixels map to
+struct Bounds
+{
+    Bounds() :
+        minRow(std::numeric_limits<double>::max()),
+        maxRow(-std::numeric_limits<double>::max()),
+        minCol(std::numeric_limits<double>::max()),
+        maxCol(-std::numeric_limits<double>::max()),
+        empty(true)
+    {
+    }
+
+    void add(const Bounds& other)
+    {
+        if (!other.empty)
+        {
+            minRow = std::min(minRow, other.minRow);
+            maxRow = std::max(maxRow, other.maxRow);
+            minCol = std::min(minCol, other.minCol);
+            maxCol = std::max(maxCol, other.maxCol);
+            empty = false;
+        }
+    }
+
+    double minRow;
+    double maxRow;
+    double minCol;
+    double maxCol;
+    bool empty;
+};
+
+// A pixel is interpolated if it's within half a pixel of the image.  This is
+// written so that NaNs are outside.
+inline bool isInside(double row, double col, const types::RowCol<double>& max)
+{
+    return (row >= -0.5 && row < max.row && col >= -0.5 && col < max.col);
+}
+
+inline sys::SSize_T floorToInt(double value)
+{
+    return static_cast<sys::SSize_T>(std::floor(value));
+}
+
+// Evaluates poly at each x with Horner's method, a coefficient at a time so
+// the inner loop vectorizes
+void evaluate(const six::Poly1D& poly,
+              const double* x,
+              size_t numValues,
+              double* values)
+{
+    const size_t order = poly.order();
+    std::fill(values, values + numValues, poly[order]);
+    for (size_t ii = order; ii > 0; --ii)
+    {
+        const double coeff = poly[ii - 1];
+        for (size_t jj = 0; jj < numValues; ++jj)
+        {
+            values[jj] = values[jj] * x[jj] + coeff;
+        }
+    }
+}
+
+inline float clamp(float value, float maxValue)
+{
+    return std::min(std::max(value, 0.0f), maxValue);
+}
+
+void computeAmplitude(const std::complex<float>* pixels,
+                      size_t numPixels,
+                      float* amplitude)
+{
+    const float* const values = reinterpret_cast<const float*>(pixels);
+    for (size_t ii = 0; ii < numPixels; ++ii)
+    {
+        const float real = values[2 * ii];
+        const float imag = values[2 * ii + 1];
+        amplitude[ii] = std::sqrt(real * real + imag * imag);
+    }
+}
+}
+
+namespace six
+{
+namespace sicd
+{
+const size_t Orthorectifier::DEFAULT_ROWS_PER_BLOCK = 256;
+
+class Orthorectifier::Source
+{
+public:
+    virtual ~Source()
+    {
+    }
+
+    virtual void read(const types::RowCol<size_t>& offset,
+                      const types::RowCol<size_t>& extent,
+                      std::complex<float>* buffer) = 0;
+};
+
+class Orthorectifier::MemorySource : public Orthorectifier::Source
+{
+public:
+    MemorySource(const std::complex<float>* image, size_t numCols) :
+        mImage(image),
+        mNumCols(numCols)
+    {
+    }
+
+    virtual void read(const types::RowCol<size_t>& offset,
+                      const types::RowCol<size_t>& extent,
+                      std::complex<float>* buffer)
+    {
+        for (size_t row = 0; row < extent.row; ++row, buffer += extent.col)
+        {
+            const std::complex<float>* const input =
+                    mImage + (offset.row + row) * mNumCols + offset.col;
+            std::copy(input, input + extent.col, buffer);
+        }
+    }
+
+private:
+    const std::complex<float>* const mImage;
+    const size_t mNumCols;
+};
+
+class Orthorectifier::NITFSource : public Orthorectifier::Source
+{
+public:
+    NITFSource(NITFReadControl& reader, size_t numThreads) :
+        mReader(reader),
+        mData(Utilities::getComplexData(reader)),
+        mNumThreads(numThreads)
+    {
+    }
+
+    const ComplexData& getData() const
+    {
+        return *mData;
+    }
+
+    virtual void read(const types::RowCol<size_t>& offset,
+                      const types::RowCol<size_t>& extent,
+                      std::complex<float>* buffer)
+    {
+        Utilities::getWidebandData(mReader, *mData, offset, extent,
+                                   mNumThreads, buffer);
+    }
+
+private:
+    NITFReadControl& mReader;
+    const std::auto_ptr<ComplexData> mData;
+    const size_t mNumThreads;
+};
+
+class Orthorectifier::RowRunnable : public sys::Runnable
+{
+public:
+    RowRunnable(const Orthorectifier& orthorectifier,
+                size_t firstRow,
+                size_t numRows,
+                std::complex<float>* pixels,
+                float* amplitude,
+                Bounds* bounds) :
+        mOrtho(orthorectifier),
+        mFirstRow(firstRow),
+        mNumRows(numRows),
+        mPixels(pixels),
+        mAmplitude(amplitude),
+        mBounds(bounds),
+        mMax(orthorectifier.mInputDims.row - 0.5,
+             orthorectifier.mInputDims.col - 0.5)
+    {
+    }
+
+    virtual void run()
+    {
+        const size_t numCols = mOrtho.mOutputDims.col;
+        mSlantRows.resize(numCols);
+        mSlantCols.resize(numCols);
+        if (mAmplitude && !mPixels)
+        {
+            mScratch.resize(numCols);
+        }
+
+        for (size_t row = 0; row < mNumRows; ++row)
+        {
+            mOrtho.getSlantCoordinates(mFirstRow + row, &mSlantRows[0],
+                                       &mSlantCols[0]);
+            if (mBounds)
+            {
+                findBounds();
+                continue;
+            }
+
+            std::complex<float>* const pixels = mPixels ?
+                    mPixels + row * numCols : &mScratch[0];
+            switch (mOrtho.mInterpolation)
+            {
+            case NEAREST:
+                interpolateNearest(pixels);
+                break;
+            case BILINEAR:
+                interpolateBilinear(pixels);
+                break;
+            case SINC:
+                interpolateSinc(pixels);
+                break;
+            }
+
+            if (mAmplitude)
+            {
+                computeAmplitude(pixels, numCols,
+                                 mAmplitude + row * numCols);
+            }
+        }
+    }
+
+private:
+    void findBounds()
+    {
+        Bounds& bounds(*mBounds);
+        for (size_t col = 0; col < mSlantRows.size(); ++col)
+        {
+            const double row = mSlantRows[col];
+            const double slantCol = mSlantCols[col];
+            if (isInside(row, slantCol, mMax))
+            {
+                bounds.minRow = std::min(bounds.minRow, row);
+                bounds.maxRow = std::max(bounds.maxRow, row);
+                bounds.minCol = std::min(bounds.minCol, slantCol);
+                bounds.maxCol = std::max(bounds.maxCol, slantCol);
+                bounds.empty = false;
+            }
+        }
+    }
+
+    // Returns the first tap in the region, setting the fractional offsets
+    // from the tap at floor()
+    const std::complex<float>* getTaps(double row,
+                                       double col,
+                                       sys::SSize_T firstTap,
+                                       double& rowFrac,
+                                       double& colFrac) const
+    {
+        const double regionRow = row - mOrtho.mRegionOffset.row;
+        const double regionCol = col - mOrtho.mRegionOffset.col;
+        const sys::SSize_T row0 = floorToInt(regionRow);
+        const sys::SSize_T col0 = floorToInt(regionCol);
+        rowFrac = regionRow - row0;
+        colFrac = regionCol - col0;
+        return &mOrtho.mRegion[0] +
+                (row0 + firstTap) * mOrtho.mRegionDims.col + col0 + firstTap;
+    }
+
+    void interpolateNearest(std::complex<float>* pixels) const
+    {
+        for (size_t col = 0; col < mSlantRows.size(); ++col)
+        {
+            if (!isInside(mSlantRows[col], mSlantCols[col], mMax))
+            {
+                pixels[col] = std::complex<float>(0.0f, 0.0f);
+                continue;
+            }
+
+            double rowFrac;
+            double colFrac;
+            const std::complex<float>* const tap = getTaps(
+                    mSlantRows[col] + 0.5, mSlantCols[col] + 0.5, 0,
+                    rowFrac, colFrac);
+            pixels[col] = *tap;
+        }
+    }
+
+    void interpolateBilinear(std::complex<float>* pixels) const
+    {
+        const size_t stride = mOrtho.mRegionDims.col;
+        for (size_t col = 0; col < mSlantRows.size(); ++col)
+        {
+            if (!isInside(mSlantRows[col], mSlantCols[col], mMax))
+            {
+                pixels[col] = std::complex<float>(0.0f, 0.0f);
+                continue;
+            }
+
+            double rowFrac;
+            double colFrac;
+            const std::complex<float>* const tap = getTaps(
+                    mSlantRows[col], mSlantCols[col], 0, rowFrac, colFrac);
+            const float rowWeight = static_cast<float>(rowFrac);
+            const float colWeight = static_cast<float>(colFrac);
+            const std::complex<float> top =
+                    tap[0] + colWeight * (tap[1] - tap[0]);
+            const std::complex<float> bottom =
+                    tap[stride] + colWeight * (tap[stride + 1] - tap[stride]);
+            pixels[col] = top + rowWeight * (bottom - top);
+        }
+    }
+
+    void interpolateSinc(std::complex<float>* pixels) const
+    {
+        // Work on interleaved floats so the tap loops vectorize
+        const size_t stride = 2 * mOrtho.mRegionDims.col;
+        const float* const weights = &mOrtho.mSincWeights[0];
+        for (size_t col = 0; col < mSlantRows.size(); ++col)
+        {
+            if (!isInside(mSlantRows[col], mSlantCols[col], mMax))
+            {
+                pixels[col] = std::complex<float>(0.0f, 0.0f);
+                continue;
+            }
+
+            double rowFrac;
+            double colFrac;
+            const float* const taps = reinterpret_cast<const float*>(
+                    getTaps(mSlantRows[col], mSlantCols[col], SINC_FIRST_TAP,
+                            rowFrac, colFrac));
+            const float* const rowWeights = weights + SINC_NUM_TAPS *
+                    static_cast<size_t>(rowFrac * SINC_NUM_STEPS + 0.5);
+            const float* const colWeights = weights + SINC_NUM_TAPS *
+                    static_cast<size_t>(colFrac * SINC_NUM_STEPS + 0.5);
+
+            float real(0.0f);
+            float imag(0.0f);
+            for (size_t ii = 0; ii < SINC_NUM_TAPS; ++ii)
+            {
+                const float* const rowTaps = taps + ii * stride;
+                float rowReal(0.0f);
+                float rowImag(0.0f);
+                for (size_t jj = 0; jj < SINC_NUM_TAPS; ++jj)
+                {
+                    rowReal += colWeights[jj] * rowTaps[2 * jj];
+                    rowImag += colWeights[jj] * rowTaps[2 * jj + 1];
+                }
+                real += rowWeights[ii] * rowReal;
+                imag += rowWeights[ii] * rowImag;
+            }
+            pixels[col] = std::complex<float>(real, imag);
+        }
+    }
+
+private:
+    const Orthorectifier& mOrtho;
+    const size_t mFirstRow;
+    const size_t mNumRows;
+    std::complex<float>* const mPixels;
+    float* const mAmplitude;
+    Bounds* const mBounds;
+    const types::RowCol<double> mMax;
+
+    std::vector<double> mSlantRows;
+    std::vector<double> mSlantCols;
+    std::vector<std::complex<float> > mScratch;
+};
+
+Orthorectifier::Orthorectifier(NITFReadControl& reader,
+                               Interpolation interpolation,
+                               size_t numThreads,
+                               size_t numRowsPerBlock,
+                               size_t polyOrderX,
+                               size_t polyOrderY) :
+    mInterpolation(interpolation),
+    mNumThreads(numThreads),
+    mNumRowsPerBlock(numRowsPerBlock)
+{
+    std::auto_ptr<NITFSource> source(new NITFSource(reader, numThreads));
+    const ComplexData& data(source->getData());
+    mInputDims.row = data.getNumRows();
+    mInputDims.col = data.getNumCols();
+    fitOutputToSlantPolynomials(data, polyOrderX, polyOrderY,
+                                mToSlantRow, mToSlantCol, mOutputDims);
+    mSource.reset(source.release());
+
+    initialize();
+}
+
+Orthorectifier::Orthorectifier(const std::complex<float>* image,
+                               const types::RowCol<size_t>& inputDims,
+                               const Poly2D& outputToSlantRow,
+                               const Poly2D& outputToSlantCol,
+                               const types::RowCol<size_t>& outputDims,
+                               Interpolation interpolation,
+                               size_t numThreads,
+                               size_t numRowsPerBlock) :
+    mSource(new MemorySource(image, inputDims.col)),
+    mInputDims(inputDims),
+    mOutputDims(outputDims),
+    mInterpolation(interpolation),
+    mNumThreads(numThreads),
+    mNumRowsPerBlock(numRowsPerBlock),
+    mToSlantRow(outputToSlantRow),
+    mToSlantCol(outputToSlantCol)
+{
+    if (image == NULL)
+    {
+        throw except::Exception(Ctxt("Need an input image"));
+    }
+
+    initialize();
+}
+
+Orthorectifier::~Orthorectifier()
+{
+}
+
+void Orthorectifier::initialize()
+{
+    if (mNumRowsPerBlock == 0)
+    {
+        throw except::Exception(Ctxt("Need at least one row per block"));
+    }
+
+    if (mInputDims.area() == 0)
+    {
+        throw except::Exception(Ctxt("Input image is empty"));
+    }
+
+    mToSlantRow = mToSlantRow.flipXY();
+    mToSlantCol = mToSlantCol.flipXY();
+
+    mOutputCols.resize(mOutputDims.col);
+    for (size_t col = 0; col < mOutputCols.size(); ++col)
+    {
+        mOutputCols[col] = static_cast<double>(col);
+    }
+
+    if (mInterpolation == SINC)
+    {
+        // Hann windowed sinc at each fractional offset, normalized so that
+        // flat regions stay flat
+        mSincWeights.resize((SINC_NUM_STEPS + 1) * SINC_NUM_TAPS);
+        const double halfWidth = SINC_NUM_TAPS / 2.0;
+        for (size_t step = 0; step <= SINC_NUM_STEPS; ++step)
+        {
+            const double frac = static_cast<double>(step) / SINC_NUM_STEPS;
+            float* const weights = &mSincWeights[step * SINC_NUM_TAPS];
+
+            double sum(0.0);
+            std::vector<double> values(SINC_NUM_TAPS);
+            for (size_t tap = 0; tap < SINC_NUM_TAPS; ++tap)
+            {
+                const double x = (static_cast<double>(tap) + SINC_FIRST_TAP) -
+                        frac;
+                const double piX = M_PI * x;
+                const double sinc = (x == 0.0) ? 1.0 : std::sin(piX) / piX;
+                const double window =
+                        0.5 * (1.0 + std::cos(piX / halfWidth));
+                values[tap] = sinc * window;
+                sum += values[tap];
+            }
+
+            for (size_t tap = 0; tap < SINC_NUM_TAPS; ++tap)
+            {
+                weights[tap] = static_cast<float>(values[tap] / sum);
+            }
+        }
+    }
+}
+
+void Orthorectifier::fitOutputToSlantPolynomials(
+        const ComplexData& data,
+        size_t polyOrderX,
+        size_t polyOrderY,
+        Poly2D& outputToSlantRow,
+        Poly2D& outputToSlantCol,
+        types::RowCol<size_t>& outputDims)
+{
+    AreaPlane areaPlane;
+    if (AreaPlaneUtility::hasAreaPlane(data))
+    {
+        areaPlane = *data.radarCollection->area->plane;
+    }
+    else
+    {
+        AreaPlaneUtility::deriveAreaPlane(data, areaPlane);
+    }
+
+    types::RowCol<size_t> offset;
+    data.getOutputPlaneOffsetAndExtent(areaPlane, offset, outputDims);
+
+    const std::auto_ptr<scene::ProjectionPolynomialFitter> fitter(
+            Utilities::getPolynomialFitter(data));
+    const types::RowCol<size_t> inPixelStart(data.imageData->firstRow,
+                                             data.imageData->firstCol);
+    const RowColDouble sampleSpacing(data.grid->row->sampleSpacing,
+                                     data.grid->col->sampleSpacing);
+    fitter->fitOutputToSlantPolynomials(inPixelStart,
+                                        data.imageData->scpPixel,
+                                        data.imageData->scpPixel,
+                                        sampleSpacing,
+                                        polyOrderX,
+                                        polyOrderY,
+                                        outputToSlantRow,
+                                        outputToSlantCol);
+}
+
+void Orthorectifier::getSlantCoordinates(size_t outputRow,
+                                         double* slantRows,
+                                         double* slantCols) const
+{
+    const double row = static_cast<double>(outputRow);
+    evaluate(mToSlantRow.atY(row), &mOutputCols[0], mOutputCols.size(),
+             slantRows);
+    evaluate(mToSlantCol.atY(row), &mOutputCols[0], mOutputCols.size(),
+             slantCols);
+}
+
+void Orthorectifier::runRows(bool findBounds,
+                             size_t firstRow,
+                             size_t numRows,
+                             std::complex<float>* pixels,
+                             float* amplitude)
+{
+    const size_t numCols = mOutputDims.col;
+    const mt::ThreadPlanner planner(numRows, mNumThreads);
+    std::vector<Bounds> bounds(findBounds ? planner.getNumThreadsThatWillBeUsed() : 0);
+
+    if (planner.getNumThreadsThatWillBeUsed() <= 1)
+    {
+        RowRunnable(*this, firstRow, numRows, pixels, amplitude,
+                    findBounds ? &bounds[0] : NULL).run();
+    }
+    else
+    {
+        mt::ThreadGroup threads;
+        size_t threadNum(0);
+        size_t startRow(0);
+        size_t numRowsThisThread(0);
+        while (planner.getThreadInfo(threadNum, startRow, numRowsThisThread))
+        {
+            const size_t offset = startRow * numCols;
+            threads.createThread(new RowRunnable(
+                    *this,
+                    firstRow + startRow,
+                    numRowsThisThread,
+                    pixels ? pixels + offset : NULL,
+                    amplitude ? amplitude + offset : NULL,
+                    findBounds ? &bounds[threadNum] : NULL));
+            ++threadNum;
+        }
+        threads.joinAll();
+    }
+
+    if (findBounds)
+    {
+        // Pad out the coordinates to cover every tap the kernel will use
+        Bounds total;
+        for (size_t ii = 0; ii < bounds.size(); ++ii)
+        {
+            total.add(bounds[ii]);
+        }
+
+        if (total.empty)
+        {
+            mRegionDims = types::RowCol<size_t>(0, 0);
+            return;
+        }
+
+        const sys::SSize_T padding = (mInterpolation == SINC) ?
+                -SINC_FIRST_TAP : 0;
+        mRegionOffset.row = floorToInt(total.minRow) - padding;
+        mRegionOffset.col = floorToInt(total.minCol) - padding;
+        mRegionDims.row = static_cast<size_t>(
+                floorToInt(total.maxRow) + 2 + padding - mRegionOffset.row);
+        mRegionDims.col = static_cast<size_t>(
+                floorToInt(total.maxCol) + 2 + padding - mRegionOffset.col);
+    }
+}
+
+void Orthorectifier::loadRegion(size_t firstRow, size_t numRows)
+{
+    runRows(true, firstRow, numRows, NULL, NULL);
+    if (mRegionDims.area() == 0)
+    {
+        return;
+    }
+
+    // Read the part of the region that's on the image
+    const sys::SSize_T lastRow = mRegionOffset.row + mRegionDims.row - 1;
+    const sys::SSize_T lastCol = mRegionOffset.col + mRegionDims.col - 1;
+    const types::RowCol<size_t> offset(
+            std::max<sys::SSize_T>(mRegionOffset.row, 0),
+            std::max<sys::SSize_T>(mRegionOffset.col, 0));
+    const types::RowCol<size_t> extent(
+            std::min<sys::SSize_T>(lastRow, mInputDims.row - 1) -
+                    offset.row + 1,
+            std::min<sys::SSize_T>(lastCol, mInputDims.col - 1) -
+                    offset.col + 1);
+    mScratch.resize(extent.area());
+    mSource->read(offset, extent, &mScratch[0]);
+
+    // Copy it into the region, replicating the edge pixels out into any
+    // padding that's off of the image
+    const size_t numLeft = offset.col - mRegionOffset.col;
+    const size_t numRight = mRegionDims.col - numLeft - extent.col;
+    mRegion.resize(mRegionDims.area());
+    for (size_t row = 0; row < mRegionDims.row; ++row)
+    {
+        const sys::SSize_T imageRow = std::min<sys::SSize_T>(
+                std::max<sys::SSize_T>(
+                        mRegionOffset.row + static_cast<sys::SSize_T>(row),
+                        offset.row),
+                offset.row + extent.row - 1);
+        const std::complex<float>* const input =
+                &mScratch[(imageRow - offset.row) * extent.col];
+        std::complex<float>* const output = &mRegion[row * mRegionDims.col];
+
+        std::fill_n(output, numLeft, input[0]);
+        std::copy(input, input + extent.col, output + numLeft);
+        std::fill_n(output + numLeft + extent.col, numRight,
+                    input[extent.col - 1]);
+    }
+}
+
+void Orthorectifier::getBlock(size_t firstRow,
+                              size_t numRows,
+                              std::complex<float>* pixels,
+                              float* amplitude)
+{
+    if (firstRow + numRows > mOutputDims.row)
+    {
+        throw except::Exception(Ctxt(
+                "Output rows [" + str::toString(firstRow) + ", " +
+                str::toString(firstRow + numRows) + ") are out of bounds"));
+    }
+
+    const size_t numCols = mOutputDims.col;
+    for (size_t row = 0; row < numRows; row += mNumRowsPerBlock)
+    {
+        const size_t numBlockRows = std::min(mNumRowsPerBlock, numRows - row);
+        const size_t offset = row * numCols;
+        std::complex<float>* const blockPixels =
+                pixels ? pixels + offset : NULL;
+        float* const blockAmplitude = amplitude ? amplitude + offset : NULL;
+
+        loadRegion(firstRow + row, numBlockRows);
+        if (mRegionDims.area() == 0)
+        {
+            // The whole block is off of the image
+            const size_t numPixels = numBlockRows * numCols;
+            if (blockPixels)
+            {
+                std::fill_n(blockPixels, numPixels,
+                            std::complex<float>(0.0f, 0.0f));
+            }
+            if (blockAmplitude)
+            {
+                std::fill_n(blockAmplitude, numPixels, 0.0f);
+            }
+            continue;
+        }
+
+        runRows(false, firstRow + row, numBlockRows, blockPixels,
+                blockAmplitude);
+    }
+}
+
+void Orthorectifier::getPixels(size_t firstRow,
+                               size_t numRows,
+                               std::complex<float>* output)
+{
+    getBlock(firstRow, numRows, output, NULL);
+}
+
+void Orthorectifier::getAmplitude(size_t firstRow,
+                                  size_t numRows,
+                                  float* output)
+{
+    getBlock(firstRow, numRows, NULL, output);
+}
+
+OrthorectifiedStream::OrthorectifiedStream(Orthorectifier& orthorectifier,
+                                           PixelType pixelType,
+                                           double scale,
+                                           size_t numRowsPerBlock) :
+    mOrthorectifier(orthorectifier),
+    mDims(orthorectifier.getOutputDims()),
+    mNumBytesPerPixel(pixelType == PixelType::MONO16I ? 2 : 1),
+    mScale(static_cast<float>(scale)),
+    mNumRowsPerBlock(numRowsPerBlock),
+    mNumBytes(mDims.area() * mNumBytesPerPixel),
+    mNextRow(0),
+    mPosition(0),
+    mBufferPosition(0)
+{
+    if (pixelType != PixelType::MONO8I && pixelType != PixelType::MONO16I)
+    {
+        throw except::Exception(Ctxt(
+                "Unsupported pixel type " + pixelType.toString()));
+    }
+
+    if (numRowsPerBlock == 0)
+    {
+        throw except::Exception(Ctxt("Need at least one row per block"));
+    }
+}
+
+sys::Off_T OrthorectifiedStream::available()
+{
+    return mNumBytes - mPosition;
+}
+
+void OrthorectifiedStream::nextBlock()
+{
+    const size_t numRows = std::min(mNumRowsPerBlock, mDims.row - mNextRow);
+    const size_t numPixels = numRows * mDims.col;
+    mAmplitude.resize(numPixels);
+    mBuffer.resize(numPixels * mNumBytesPerPixel);
+    mOrthorectifier.getAmplitude(mNextRow, numRows, &mAmplitude[0]);
+
+    const float maxValue = (mNumBytesPerPixel == 2) ? 65535.0f : 255.0f;
+    if (mNumBytesPerPixel == 2)
+    {
+        sys::Uint16_T* const output =
+                reinterpret_cast<sys::Uint16_T*>(&mBuffer[0]);
+        for (size_t ii = 0; ii < numPixels; ++ii)
+        {
+            output[ii] = static_cast<sys::Uint16_T>(
+                    clamp(mAmplitude[ii] * mScale + 0.5f, maxValue));
+        }
+    }
+    else
+    {
+        for (size_t ii = 0; ii < numPixels; ++ii)
+        {
+            mBuffer[ii] = static_cast<sys::ubyte>(
+                    clamp(mAmplitude[ii] * mScale + 0.5f, maxValue));
+        }
+    }
+
+    mNextRow += numRows;
+    mBufferPosition = 0;
+}
+
+sys::SSize_T OrthorectifiedStream::readImpl(void* buffer, size_t len)
+{
+    if (mPosition >= mNumBytes)
+    {
+        return io::InputStream::IS_EOF;
+    }
+
+    sys::ubyte* output = static_cast<sys::ubyte*>(buffer);
+    size_t numRead(0);
+    while (numRead < len && mPosition < mNumBytes)
+    {
+        if (mBufferPosition >= mBuffer.size())
+        {
+            nextBlock();
+        }
+
+        const size_t numBytes = std::min(len - numRead,
+                                         mBuffer.size() - mBufferPosition);
+        ::memcpy(output + numRead, &mBuffer[mBufferPosition], numBytes);
+        numRead += numBytes;
+        mBufferPosition += numBytes;
+        mPosition += numBytes;
+    }
+
+    return static_cast<sys::SSize_T>(numRead);
+}
+}
+}
@@ -20,15 +20,23 @@
  *
  */
 
+#include <mt/CriticalSection.h>
+#include <six/ByteSwap.h>
 #include <six/sicd/SICDByteProvider.h>
 #include <six/sicd/SICDWriteControl.h>
 
+namespace
+{
+static const size_t NUM_BANDS = 2;
+}
+
 namespace six
 {
 namespace sicd
 {
 SICDWriteControl::SICDWriteControl(const std::string& outputPathname,
                                    const std::vector<std::string>& schemaPaths) :
+    mPathname(outputPathname),
     mIO(new nitf::BufferedWriter(outputPathname, DEFAULT_BUFFER_SIZE)),
     mSchemaPaths(schemaPaths),
     mHaveWrittenHeaders(false)
@@ -83,38 +91,30 @@ void SICDWriteControl::writeHeaders()
     write(byteProvider.getDesSubheaderAndData());
 }
 
-void SICDWriteControl::save(void* imageData,
-                            const types::RowCol<size_t>& offset,
-                            const types::RowCol<size_t>& dims,
-                            bool restoreData)
+void SICDWriteControl::checkInitialized() const
 {
     if (mContainer.get() == NULL)
     {
         throw except::Exception(Ctxt(
                 "initialize() must be called prior to calling save()"));
     }
+}
 
-    // The first time through we'll write out all the headers
-    if (!mHaveWrittenHeaders)
-    {
-        writeHeaders();
-        mHaveWrittenHeaders = true;
-    }
+void SICDWriteControl::swapPixels(void* imageData,
+                                  const types::RowCol<size_t>& dims) const
+{
+    const size_t numBytesPerPixel =
+            mContainer->getData(0)->getNumBytesPerPixel() / NUM_BANDS;
+    six::byteSwap(imageData, numBytesPerPixel, dims.area() * NUM_BANDS);
+}
 
+void SICDWriteControl::writePixels(const void* imageData,
+                                   const types::RowCol<size_t>& offset,
+                                   const types::RowCol<size_t>& dims,
+                                   bool concurrent)
+{
     const six::Data* const data = mContainer->getData(0);
-    static const size_t NUM_BANDS = 2;
     const size_t numBytesPerPixel = data->getNumBytesPerPixel() / NUM_BANDS;
-    const size_t numPixelsTotal = dims.area() * NUM_BANDS;
-    const bool doByteSwap = shouldByteSwap();
-
-    // Byte swap if needed
-    if (doByteSwap)
-    {
-        sys::byteSwap(imageData,
-                      static_cast<unsigned short>(numBytesPerPixel),
-                      numPixelsTotal);
-    }
-
     const size_t globalNumCols = data->getNumCols();
 
     for (size_t seg = 0; seg < mImageSegmentInfo.size(); ++seg)
@@ -132,7 +132,7 @@ void SICDWriteControl::save(void* imageData,
                     startGlobalRowToWrite - offset.row;
             const size_t numBytesPerRow = dims.col * numBytesPerPixel * NUM_BANDS;
             const sys::ubyte* imageDataPtr =
-                    static_cast<sys::ubyte*>(imageData) +
+                    static_cast<const sys::ubyte*>(imageData) +
                     startLocalRowToWrite * numBytesPerRow;
 
             // Now figure out our offset into the segment
@@ -141,48 +141,114 @@ void SICDWriteControl::save(void* imageData,
                     startGlobalRowToWrite - segStartRow;
             const size_t pixelOffset =
                     startRowInSegToWrite * globalNumCols + offset.col;
-            size_t byteOffset = mImageDataStart[seg] +
+            nitf::Off byteOffset = mImageDataStart[seg] +
                     pixelOffset * numBytesPerPixel * NUM_BANDS;
 
             // TODO: For SIDD we'll have to handle blocking too
 
-            if (dims.col == globalNumCols)
+            // If the rows are complete, life is easy - one write
+            const bool fullRows = (dims.col == globalNumCols);
+            const size_t numBytesPerWrite = fullRows ?
+                    numRowsToWrite * numBytesPerRow : numBytesPerRow;
+            const size_t numWrites = fullRows ? 1 : numRowsToWrite;
+            const size_t rowSeekStride =
+                    globalNumCols * numBytesPerPixel * NUM_BANDS;
+
+            for (size_t ii = 0;
+                 ii < numWrites;
+                 ++ii, byteOffset += rowSeekStride,
+                     imageDataPtr += numBytesPerRow)
             {
-                // Life is easy - one write
-                mIO->seek(byteOffset, NITF_SEEK_SET);
-                mIO->write(imageDataPtr,
-                           numRowsToWrite * dims.col * NUM_BANDS *
-                               numBytesPerPixel);
-            }
-            else
-            {
-                // Need to write out partial rows
-                const size_t rowSeekStride =
-                        globalNumCols * numBytesPerPixel * NUM_BANDS;
-
-                for (size_t row = 0;
-                     row < numRowsToWrite;
-                     ++row, byteOffset += rowSeekStride,
-                         imageDataPtr += numBytesPerRow)
+                if (concurrent)
+                {
+                    mTileWriter->writeAt(imageDataPtr, numBytesPerWrite,
+                                         byteOffset);
+                }
+                else
                 {
                     mIO->seek(byteOffset, NITF_SEEK_SET);
-                    mIO->write(imageDataPtr, numBytesPerRow);
+                    mIO->write(imageDataPtr, numBytesPerWrite);
                 }
             }
         }
     }
+}
+
+void SICDWriteControl::save(void* imageData,
+                            const types::RowCol<size_t>& offset,
+                            const types::RowCol<size_t>& dims,
+                            bool restoreData)
+{
+    checkInitialized();
+
+    // The first time through we'll write out all the headers
+    if (!mHaveWrittenHeaders)
+    {
+        writeHeaders();
+        mHaveWrittenHeaders = true;
+    }
+
+    // Byte swap if needed
+    const bool doByteSwap = shouldByteSwap();
+    if (doByteSwap)
+    {
+        swapPixels(imageData, dims);
+    }
+
+    writePixels(imageData, offset, dims, false);
+
+    // Byte swap back if needed
+    if (doByteSwap && restoreData)
+    {
+        swapPixels(imageData, dims);
+    }
+}
+
+void SICDWriteControl::saveTile(void* imageData,
+                                const types::RowCol<size_t>& offset,
+                                const types::RowCol<size_t>& dims,
+                                bool restoreData)
+{
+    checkInitialized();
+
+    {
+        mt::CriticalSection<sys::Mutex> crit(&mMutex);
+
+        // The first tile through writes out all the headers
+        if (!mHaveWrittenHeaders)
+        {
+            writeHeaders();
+            mHaveWrittenHeaders = true;
+        }
+
+        // Get the headers to disk so that tiles can go straight to the file
+        // from here on out
+        if (mTileWriter.get() == NULL)
+        {
+            mIO->flushBuffer();
+            mTileWriter.reset(new PositionalFileWriter(mPathname));
+        }
+    }
+
+    // Byte swap if needed
+    const bool doByteSwap = shouldByteSwap();
+    if (doByteSwap)
+    {
+        swapPixels(imageData, dims);
+    }
+
+    writePixels(imageData, offset, dims, true);
 
     // Byte swap back if needed
     if (doByteSwap && restoreData)
     {
-        sys::byteSwap(imageData,
-                      static_cast<unsigned short>(numBytesPerPixel),
-                      numPixelsTotal);
+        swapPixels(imageData, dims);
     }
 }
 
 void SICDWriteControl::close()
 {
+    mTileWriter.reset();
     mIO->close();
 }
 }
@@ -20,7 +20,14 @@
  *
  */
 
+#include <cmath>
+
 #include <io/StringStream.h>
+#include <sys/Conf.h>
+#include <sys/Runnable.h>
+#include <mt/ThreadPlanner.h>
+#include <mt/ThreadGroup.h>
+#include <six/ByteSwap.h>
 #include <six/Utilities.h>
 #include <six/NITFReadControl.h>
 #include <six/sicd/AreaPlaneUtility.h>
@@ -55,29 +62,282 @@ six::Region buildRegion(const types::RowCol<size_t>& offset,
     return retv;
 }
 
+typedef void (*ConvertFunc)(const void* input,
+                            size_t elemSize,
+                            size_t numElements,
+                            float* output);
+
+// Converts RE32F_IM32F or RE16I_IM16I pixels, optionally byte swapping them
+class PromotePixels
+{
+public:
+    PromotePixels(size_t elemSize, bool swap) :
+        mElemSize(elemSize),
+        mConvert(swap ? six::byteSwapAndPromote : six::promote)
+    {
+    }
+
+    size_t getNumBytesPerPixel() const
+    {
+        return mElemSize * 2;
+    }
+
+    void operator()(const six::UByte* input,
+                    size_t numPixels,
+                    std::complex<float>* output) const
+    {
+        mConvert(input, mElemSize, numPixels * 2,
+                 reinterpret_cast<float*>(output));
+    }
+
+private:
+    const size_t mElemSize;
+    const ConvertFunc mConvert;
+};
+
+// Converts AMP8I_PHS8I pixels.  The amplitude byte is an index into the
+// AmpTable (or the amplitude itself if there's no table) and the phase byte
+// is a fraction of a full cycle in 1/256ths.
+class DecodeAmpPhasePixels
+{
+public:
+    DecodeAmpPhasePixels(const six::AmplitudeTable* ampTable)
+    {
+        for (size_t ii = 0; ii < NUM_ENTRIES; ++ii)
+        {
+            mAmplitudes[ii] = ampTable ?
+                    static_cast<float>(*reinterpret_cast<const double*>(
+                            (*ampTable)[ii])) :
+                    static_cast<float>(ii);
+
+            const double phase = 2.0 * M_PI * ii / NUM_ENTRIES;
+            mCosines[ii] = static_cast<float>(std::cos(phase));
+            mSines[ii] = static_cast<float>(std::sin(phase));
+        }
+    }
+
+    size_t getNumBytesPerPixel() const
+    {
+        return 2;
+    }
+
+    void operator()(const six::UByte* input,
+                    size_t numPixels,
+                    std::complex<float>* output) const
+    {
+        float* const outputPtr = reinterpret_cast<float*>(output);
+        for (size_t ii = 0; ii < numPixels; ++ii)
+        {
+            const float amplitude = mAmplitudes[input[ii * 2]];
+            const six::UByte phase = input[ii * 2 + 1];
+            outputPtr[ii * 2] = amplitude * mCosines[phase];
+            outputPtr[ii * 2 + 1] = amplitude * mSines[phase];
+        }
+    }
+
+private:
+    static const size_t NUM_ENTRIES = 256;
+
+    float mAmplitudes[NUM_ENTRIES];
+    float mCosines[NUM_ENTRIES];
+    float mSines[NUM_ENTRIES];
+};
+
+// Converts rows of pixels to complex<float>, one row at a time.  Each input
+// row may live anywhere (e.g. in different image segments).
+template <typename ConverterT>
+class ConvertRowsRunnable : public sys::Runnable
+{
+public:
+    ConvertRowsRunnable(const std::vector<const six::UByte*>& inputRows,
+                        size_t startRow,
+                        size_t numRows,
+                        size_t numCols,
+                        const ConverterT& convert,
+                        std::complex<float>* output) :
+        mInputRows(inputRows),
+        mStartRow(startRow),
+        mNumRows(numRows),
+        mNumCols(numCols),
+        mConvert(convert),
+        mOutput(output)
+    {
+    }
+
+    virtual void run()
+    {
+        const size_t endRow = mStartRow + mNumRows;
+        for (size_t row = mStartRow; row < endRow; ++row)
+        {
+            mConvert(mInputRows[row], mNumCols, mOutput + row * mNumCols);
+        }
+    }
+
+private:
+    const std::vector<const six::UByte*>& mInputRows;
+    const size_t mStartRow;
+    const size_t mNumRows;
+    const size_t mNumCols;
+    const ConverterT& mConvert;
+    std::complex<float>* const mOutput;
+};
+
+template <typename ConverterT>
+void convertRows(const std::vector<const six::UByte*>& inputRows,
+                 size_t numCols,
+                 const ConverterT& convert,
+                 size_t numThreads,
+                 std::complex<float>* output)
+{
+    if (numThreads <= 1)
+    {
+        ConvertRowsRunnable<ConverterT>(inputRows, 0, inputRows.size(),
+                                        numCols, convert, output).run();
+    }
+    else
+    {
+        mt::ThreadGroup threads;
+        const mt::ThreadPlanner planner(inputRows.size(), numThreads);
+
+        size_t threadNum(0);
+        size_t startRow(0);
+        size_t numRowsThisThread(0);
+        while (planner.getThreadInfo(threadNum++,
+                                     startRow,
+                                     numRowsThisThread))
+        {
+            std::auto_ptr<sys::Runnable> converter(
+                    new ConvertRowsRunnable<ConverterT>(
+                            inputRows,
+                            startRow,
+                            numRowsThisThread,
+                            numCols,
+                            convert,
+                            output));
+            threads.createThread(converter);
+        }
+
+        threads.joinAll();
+    }
+}
+
+// Fills in -1 extents with the full image size and makes sure the region
+// lies within the image, the same as NITFReadControl::interleaved() does
+types::RowCol<size_t> checkRegion(const six::Data& data,
+                                  const types::RowCol<size_t>& offset,
+                                  const types::RowCol<size_t>& extent)
+{
+    const size_t allPixels = static_cast<size_t>(-1);
+    const types::RowCol<size_t> fullExtent(
+            (extent.row == allPixels) ? data.getNumRows() : extent.row,
+            (extent.col == allPixels) ? data.getNumCols() : extent.col);
+
+    if (offset.row > data.getNumRows() ||
+        fullExtent.row > data.getNumRows() - offset.row)
+    {
+        throw except::Exception(Ctxt("Too many rows requested [" +
+                str::toString(fullExtent.row) + "]"));
+    }
+    if (offset.col > data.getNumCols() ||
+        fullExtent.col > data.getNumCols() - offset.col)
+    {
+        throw except::Exception(Ctxt("Too many cols requested [" +
+                str::toString(fullExtent.col) + "]"));
+    }
+    return fullExtent;
+}
+
+// If all the rows of the region live in memory mapped image segments, gets a
+// pointer to the first pixel of each row.  Returns false otherwise.  The
+// region must already be checked against the image (see checkRegion()).
+bool getMappedRows(const six::NITFReadControl& reader,
+                   size_t imageNumber,
+                   const types::RowCol<size_t>& offset,
+                   const types::RowCol<size_t>& extent,
+                   size_t numBytesPerPixel,
+                   std::vector<const six::UByte*>& rows)
+{
+    const std::vector<six::NITFSegmentInfo> segments =
+            reader.getImageSegments(imageNumber);
+    const size_t numCols = reader.getContainer()->getData(imageNumber)->
+            getNumCols();
+
+    rows.resize(extent.row);
+    for (size_t seg = 0; seg < segments.size(); ++seg)
+    {
+        size_t firstRow;
+        size_t numRows;
+        if (!segments[seg].isInRange(offset.row, extent.row,
+                                     firstRow, numRows))
+        {
+            continue;
+        }
+
+        const six::UByte* const data =
+                reader.getMappedSegment(imageNumber, seg);
+        if (data == NULL)
+        {
+            return false;
+        }
+
+        for (size_t row = firstRow; row < firstRow + numRows; ++row)
+        {
+            rows[row - offset.row] = data +
+                    ((row - segments[seg].firstRow) * numCols + offset.col) *
+                    numBytesPerPixel;
+        }
+    }
+
+    return true;
+}
+
+// Converts the region straight out of the memory map, touching each pixel
+// once.  Mapped pixels are in the file's byte order (big endian), so the
+// converter must swap them if need be.  Returns false if the region isn't
+// mapped.
+template <typename ConverterT>
+bool readMappedSICD(const six::NITFReadControl& reader,
+                    size_t imageNumber,
+                    const types::RowCol<size_t>& offset,
+                    const types::RowCol<size_t>& extent,
+                    const ConverterT& convert,
+                    size_t numThreads,
+                    std::complex<float>* buffer)
+{
+    std::vector<const six::UByte*> rows;
+    if (!getMappedRows(reader, imageNumber, offset, extent,
+                       convert.getNumBytesPerPixel(), rows))
+    {
+        return false;
+    }
+
+    convertRows(rows, extent.col, convert, numThreads, buffer);
+    return true;
+}
+
 // Reads in ~32 MB of rows at a time, converts to complex<float>, and keeps
 // going until reads everything
+template <typename ConverterT>
 void readAndConvertSICD(six::NITFReadControl& reader,
                         size_t imageNumber,
                         const types::RowCol<size_t>& offset,
                         const types::RowCol<size_t>& extent,
+                        const ConverterT& convert,
+                        size_t numThreads,
                         std::complex<float>* buffer)
 {
-
-
-    // One for the real component, one for imaginary of each pixel
-    const size_t elementsPerRow = extent.col * 2;
+    const size_t bytesPerRow = extent.col * convert.getNumBytesPerPixel();
 
     // Get at least 32MB per read
-    const size_t rowsAtATime =
-            (32000000 / (elementsPerRow * sizeof(short))) + 1;
+    const size_t rowsAtATime = (32000000 / bytesPerRow) + 1;
 
     // Allocate temp buffer
-    std::vector<short> tempVector(elementsPerRow * rowsAtATime);
-    short* const tempBuffer = &tempVector[0];
+    std::vector<six::UByte> tempVector(bytesPerRow * rowsAtATime);
+    six::UByte* const tempBuffer = &tempVector[0];
 
     const size_t endRow = offset.row + extent.row;
 
+    std::vector<const six::UByte*> tempRows;
     for (size_t row = offset.row, rowsToRead = rowsAtATime;
          row < endRow;
          row += rowsToRead)
@@ -93,17 +353,17 @@ void readAndConvertSICD(six::NITFReadControl& reader,
         types::RowCol<size_t> swathOffset(row, offset.col);
         types::RowCol<size_t> swathExtent(rowsToRead, extent.col);
         six::Region region = buildRegion(swathOffset, swathExtent, tempBuffer);
-        reader.interleaved(region, imageNumber);
-
-        // Take each Int16 out of the temp buffer and put it into the real
-        // buffer as a Float32
-        float* const bufferPtr = reinterpret_cast<float*>(buffer) +
-                ((row - offset.row) * elementsPerRow);
+        reader.interleaved(region, imageNumber, numThreads);
 
-        for (size_t index = 0; index < elementsPerRow * rowsToRead; index++)
+        // Convert the temp buffer into the real buffer
+        tempRows.resize(rowsToRead);
+        for (size_t ii = 0; ii < rowsToRead; ++ii)
         {
-            bufferPtr[index] = tempBuffer[index];
+            tempRows[ii] = tempBuffer + ii * bytesPerRow;
         }
+
+        convertRows(tempRows, extent.col, convert, numThreads,
+                    buffer + (row - offset.row) * extent.col);
     }
 }
 }
@@ -426,10 +686,24 @@ void Utilities::getWidebandData(NITFReadControl& reader,
                                 const types::RowCol<size_t>& offset,
                                 const types::RowCol<size_t>& extent,
                                 std::complex<float>* buffer)
+{
+    getWidebandData(reader, complexData, offset, extent, 1, buffer);
+}
+
+void Utilities::getWidebandData(NITFReadControl& reader,
+                                const ComplexData& complexData,
+                                const types::RowCol<size_t>& offset,
+                                const types::RowCol<size_t>& requestedExtent,
+                                size_t numThreads,
+                                std::complex<float>* buffer)
 {
     const PixelType pixelType = complexData.getPixelType();
     const size_t imageNumber = 0;
 
+    // Before any rows are looked up in the memory map
+    const types::RowCol<size_t> extent =
+            checkRegion(complexData, offset, requestedExtent);
+
     const size_t requiredBufferBytes = sizeof(std::complex<float>)
                                             * extent.area();
 
@@ -443,18 +717,49 @@ void Utilities::getWidebandData(NITFReadControl& reader,
                     + std::string(" byte buffer was expected")));
     }
 
+    // Mapped pixels haven't been byte swapped
+    const bool swapMapped = !sys::isBigEndianSystem();
+
     if (pixelType == PixelType::RE32F_IM32F)
     {
-        six::Region region = buildRegion(offset, extent, buffer);
-        reader.interleaved(region, imageNumber);
+        if (!readMappedSICD(reader, imageNumber, offset, extent,
+                            PromotePixels(sizeof(float), swapMapped),
+                            numThreads, buffer))
+        {
+            six::Region region = buildRegion(offset, extent, buffer);
+            reader.interleaved(region, imageNumber, numThreads);
+        }
     }
     else if (pixelType == PixelType::RE16I_IM16I)
     {
-        readAndConvertSICD(reader,
-                           imageNumber,
-                           offset,
-                           extent,
-                           buffer);
+        if (!readMappedSICD(reader, imageNumber, offset, extent,
+                            PromotePixels(sizeof(short), swapMapped),
+                            numThreads, buffer))
+        {
+            readAndConvertSICD(reader,
+                               imageNumber,
+                               offset,
+                               extent,
+                               PromotePixels(sizeof(short), false),
+                               numThreads,
+                               buffer);
+        }
+    }
+    else if (pixelType == PixelType::AMP8I_PHS8I)
+    {
+        const DecodeAmpPhasePixels decode(
+                complexData.imageData->amplitudeTable.get());
+        if (!readMappedSICD(reader, imageNumber, offset, extent, decode,
+                            numThreads, buffer))
+        {
+            readAndConvertSICD(reader,
+                               imageNumber,
+                               offset,
+                               extent,
+                               decode,
+                               numThreads,
+                               buffer);
+        }
     }
     else
     {
@@ -54,6 +54,15 @@ struct GetPixelType<sys::Int16_T>
     }
 };
 
+template <>
+struct GetPixelType<sys::Uint8_T>
+{
+    static six::PixelType getPixelType()
+    {
+        return six::PixelType::AMP8I_PHS8I;
+    }
+};
+
 // Create dummy SICD data
 template <typename DataTypeT>
 std::auto_ptr<six::sicd::ComplexData>
@@ -0,0 +1,326 @@
+/* =========================================================================
+ * This file is part of six.sicd-c++
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2017, MDA Information Systems LLC
+ *
+ * six.sicd-c++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// Test program for six::sicd::FastGeoLocator
+// Geolocates every pixel of an output plane grid that straddles the
+// antimeridian, both exactly and with FastGeoLocator, checks that they agree
+// to within the error bound, and reports the throughput of each.  If a SICD
+// (NITF or XML) is given, its slant plane pixels are also checked against
+// SlantPlanePixelTransformer.
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <memory>
+#include <vector>
+
+#include <except/Exception.h>
+#include <sys/StopWatch.h>
+#include <types/RowCol.h>
+#include <scene/GridECEFTransform.h>
+#include <scene/Utilities.h>
+#include <six/XMLControlFactory.h>
+#include <six/sicd/ComplexXMLControl.h>
+#include <six/sicd/FastGeoLocator.h>
+#include <six/sicd/SlantPlanePixelTransformer.h>
+#include <six/sicd/Utilities.h>
+
+namespace
+{
+// NaNs come back as infinitely far apart
+double getDistance(const scene::LatLonAlt& lhs, const scene::LatLonAlt& rhs)
+{
+    const double distance = (scene::Utilities::latLonToECEF(lhs) -
+            scene::Utilities::latLonToECEF(rhs)).norm();
+    return (distance == distance) ? distance :
+            std::numeric_limits<double>::infinity();
+}
+
+// An output plane tangent to the earth with some rotation
+std::auto_ptr<scene::GridECEFTransform> createTransform()
+{
+    const scene::Vector3 refPt = scene::Utilities::latLonToECEF(
+            scene::LatLonAlt(40.0, 179.99, 100.0));
+    scene::Vector3 up(refPt);
+    up.normalize();
+    scene::Vector3 east;
+    east[0] = -refPt[1];
+    east[1] = refPt[0];
+    east[2] = 0.0;
+    east.normalize();
+    const scene::Vector3 north = math::linear::cross(up, east);
+
+    const double angle = 0.3;
+    const scene::Vector3 row =
+            north * -std::cos(angle) + east * std::sin(angle);
+    const scene::Vector3 col = math::linear::cross(row, up) * -1.0;
+
+    return std::auto_ptr<scene::GridECEFTransform>(
+            new scene::PlanarGridECEFTransform(
+                    types::RowCol<double>(2.0, 2.5),
+                    types::RowCol<double>(400.0, 350.0),
+                    row, col, refPt));
+}
+
+class QuadraticModel : public six::sicd::FastGeoLocator::Model
+{
+public:
+    QuadraticModel(const scene::GridECEFTransform& transform) :
+        mTransform(transform)
+    {
+    }
+
+    virtual scene::Vector3 toECEF(const types::RowCol<double>& pixel) const
+    {
+        // Stretch the grid a bit more towards the bottom right
+        return mTransform.rowColToECEF(types::RowCol<double>(
+                pixel.row + 1e-4 * pixel.row * pixel.col,
+                pixel.col + 2e-4 * pixel.col * pixel.col));
+    }
+
+private:
+    const scene::GridECEFTransform& mTransform;
+};
+
+bool testGrid(size_t numThreads)
+{
+    const types::RowCol<size_t> dims(800, 1100);
+    const double maxError = 0.02;
+    const std::auto_ptr<scene::GridECEFTransform> transform(
+            createTransform());
+
+    sys::RealTimeStopWatch stopWatch;
+    stopWatch.start();
+    const six::sicd::FastGeoLocator locator(*transform, dims, maxError,
+                                            numThreads);
+    const double setupMS = stopWatch.stop();
+
+    std::vector<double> lats(dims.area());
+    std::vector<double> lons(dims.area());
+    std::vector<double> alts(dims.area());
+    stopWatch.start();
+    locator.geolocate(0, dims.row, &lats[0], &lons[0], &alts[0]);
+    const double fastMS = stopWatch.stop();
+
+    std::vector<scene::LatLonAlt> expected(dims.area());
+    stopWatch.start();
+    for (size_t row = 0, idx = 0; row < dims.row; ++row)
+    {
+        for (size_t col = 0; col < dims.col; ++col, ++idx)
+        {
+            expected[idx] = scene::Utilities::ecefToLatLon(
+                    transform->rowColToECEF(
+                            types::RowCol<double>(row, col)));
+        }
+    }
+    const double exactMS = stopWatch.stop();
+
+    std::cout << "Grid with " << numThreads << " threads: lattice spacing "
+              << locator.getLatticeSpacing() << ", measured error "
+              << locator.getMeasuredError() << " m, setup " << setupMS
+              << " ms, geolocate " << fastMS << " ms vs. exact " << exactMS
+              << " ms\n";
+
+    // The bound is only checked at the lattice cell midpoints
+    double worst(0.0);
+    bool eastOfAntimeridian(false);
+    bool westOfAntimeridian(false);
+    for (size_t ii = 0; ii < expected.size(); ++ii)
+    {
+        if (lons[ii] < -180.0 || lons[ii] >= 180.0)
+        {
+            std::cerr << "Longitude " << lons[ii] << " is not wrapped\n";
+            return false;
+        }
+        eastOfAntimeridian |= (lons[ii] < 0.0);
+        westOfAntimeridian |= (lons[ii] > 0.0);
+
+        const scene::LatLonAlt actual(lats[ii], lons[ii], alts[ii]);
+        worst = std::max(worst, getDistance(actual, expected[ii]));
+    }
+
+    if (worst > 2 * maxError || !eastOfAntimeridian || !westOfAntimeridian)
+    {
+        std::cerr << "Grid geolocation DOES NOT MATCH: worst error " << worst
+                  << " m\n";
+        return false;
+    }
+
+    // Single pixels, including off of the image
+    for (size_t ii = 0; ii < 100; ++ii)
+    {
+        const types::RowCol<double> pixel(ii * 8.37 - 20.0,
+                                          ii * 11.91 - 30.0);
+        const scene::LatLonAlt actual = locator.geolocate(pixel);
+        const scene::LatLonAlt exact = scene::Utilities::ecefToLatLon(
+                transform->rowColToECEF(pixel));
+        if (getDistance(actual, exact) > 2 * maxError)
+        {
+            std::cerr << "Grid geolocation of " << pixel.row << ","
+                      << pixel.col << " DOES NOT MATCH\n";
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool testModel()
+{
+    const types::RowCol<size_t> dims(500, 300);
+    const std::auto_ptr<scene::GridECEFTransform> transform(
+            createTransform());
+    const QuadraticModel model(*transform);
+
+    bool success = true;
+    const double maxErrors[] = {1.0, 0.01};
+    for (size_t ii = 0; ii < 2; ++ii)
+    {
+        const six::sicd::FastGeoLocator locator(model, dims, maxErrors[ii],
+                                                2);
+        double worst(0.0);
+        for (size_t row = 0; row < dims.row; row += 3)
+        {
+            for (size_t col = 0; col < dims.col; col += 7)
+            {
+                const types::RowCol<double> pixel(row, col);
+                worst = std::max(worst, getDistance(
+                        locator.geolocate(pixel),
+                        scene::Utilities::ecefToLatLon(model.toECEF(pixel))));
+            }
+        }
+
+        std::cout << "Quadratic model with " << maxErrors[ii]
+                  << " m bound: lattice spacing "
+                  << locator.getLatticeSpacing() << ", worst error "
+                  << worst << " m\n";
+        if (worst > 2 * maxErrors[ii])
+        {
+            std::cerr << "Quadratic model geolocation DOES NOT MATCH\n";
+            success = false;
+        }
+    }
+
+    return success;
+}
+
+bool testSICD(const std::string& pathname)
+{
+    six::XMLControlFactory::getInstance().addCreator(
+            six::DataType::COMPLEX,
+            new six::XMLControlCreatorT<six::sicd::ComplexXMLControl>());
+    const std::auto_ptr<six::sicd::ComplexData> data =
+            six::sicd::Utilities::getComplexData(
+                    pathname, std::vector<std::string>());
+
+    const double maxError = 0.05;
+    sys::RealTimeStopWatch stopWatch;
+    stopWatch.start();
+    const six::sicd::FastGeoLocator locator(*data, maxError, 2);
+    const double setupMS = stopWatch.stop();
+
+    const std::auto_ptr<scene::SceneGeometry> geometry(
+            six::sicd::Utilities::getSceneGeometry(data.get()));
+    const std::auto_ptr<scene::ProjectionModel> projection(
+            six::sicd::Utilities::getProjectionModel(data.get(),
+                                                     geometry.get()));
+    const six::sicd::SlantPlanePixelTransformer transformer(
+            *data, *geometry, *projection);
+
+    double worst(0.0);
+    const size_t numSteps = 50;
+    for (size_t ii = 0; ii <= numSteps; ++ii)
+    {
+        for (size_t jj = 0; jj <= numSteps; ++jj)
+        {
+            const types::RowCol<double> pixel(
+                    (data->getNumRows() - 1) * ii / numSteps,
+                    (data->getNumCols() - 1) * jj / numSteps);
+            worst = std::max(worst, getDistance(locator.geolocate(pixel),
+                                                transformer.toLLA(pixel)));
+        }
+    }
+
+    std::cout << "SICD: lattice spacing " << locator.getLatticeSpacing()
+              << ", setup " << setupMS << " ms, worst error " << worst
+              << " m\n";
+    if (worst > 2 * maxError)
+    {
+        std::cerr << "SICD geolocation DOES NOT MATCH\n";
+        return false;
+    }
+    return true;
+}
+}
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        if (argc > 2)
+        {
+            std::cerr << "Usage: " << argv[0] << " [SICD pathname]\n";
+            return 1;
+        }
+
+        bool success = true;
+        for (size_t numThreads = 1; numThreads <= 4; numThreads *= 2)
+        {
+            success = testGrid(numThreads) && success;
+        }
+        success = testModel() && success;
+        if (argc == 2)
+        {
+            success = testSICD(argv[1]) && success;
+        }
+
+        if (success)
+        {
+            std::cout << "All tests pass!\n";
+        }
+        else
+        {
+            std::cerr << "Some tests FAIL!\n";
+        }
+
+        return (success ? 0 : 1);
+    }
+    catch (const std::exception& ex)
+    {
+        std::cerr << "Caught std::exception: " << ex.what() << std::endl;
+        return 1;
+    }
+    catch (const except::Exception& ex)
+    {
+        std::cerr << "Caught except::Exception: " << ex.getMessage()
+                  << std::endl;
+        return 1;
+    }
+    catch (...)
+    {
+        std::cerr << "Caught unknown exception\n";
+        return 1;
+    }
+}
@@ -0,0 +1,488 @@
+/* =========================================================================
+ * This file is part of six.sicd-c++
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2017, MDA Information Systems LLC
+ *
+ * six.sicd-c++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// Test program for six::sicd::Orthorectifier
+// Orthorectifies a synthetic slant plane image with each kind of
+// interpolation, compares against a simple per-pixel implementation, checks
+// that the results don't depend on the number of threads or the block size,
+// and reports the throughput of each
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <memory>
+#include <vector>
+
+#include <except/Exception.h>
+#include <sys/StopWatch.h>
+#include <types/RowCol.h>
+#include <six/sicd/Orthorectifier.h>
+
+namespace
+{
+typedef six::sicd::Orthorectifier Orthorectifier;
+
+const char* getName(Orthorectifier::Interpolation interpolation)
+{
+    switch (interpolation)
+    {
+    case Orthorectifier::NEAREST:
+        return "Nearest";
+    case Orthorectifier::BILINEAR:
+        return "Bilinear";
+    default:
+        return "Sinc";
+    }
+}
+
+// Slowly varying so that interpolating it is well behaved
+std::complex<float> getInputPixel(size_t row, size_t col)
+{
+    return std::complex<float>(
+            static_cast<float>(2.0 + std::sin(0.07 * row) +
+                               std::cos(0.05 * col)),
+            static_cast<float>(std::cos(0.04 * row + 0.02 * col)));
+}
+
+class Reference
+{
+public:
+    Reference(const std::vector<std::complex<float> >& image,
+              const types::RowCol<size_t>& dims) :
+        mImage(image),
+        mDims(dims)
+    {
+    }
+
+    std::complex<float> operator()(double row,
+                                   double col,
+                                   Orthorectifier::Interpolation method) const
+    {
+        if (!(row >= -0.5 && row < mDims.row - 0.5 &&
+              col >= -0.5 && col < mDims.col - 0.5))
+        {
+            return std::complex<float>(0.0f, 0.0f);
+        }
+
+        if (method == Orthorectifier::NEAREST)
+        {
+            return get(static_cast<long>(std::floor(row + 0.5)),
+                       static_cast<long>(std::floor(col + 0.5)));
+        }
+
+        const long row0 = static_cast<long>(std::floor(row));
+        const long col0 = static_cast<long>(std::floor(col));
+        const double rowFrac = row - row0;
+        const double colFrac = col - col0;
+        if (method == Orthorectifier::BILINEAR)
+        {
+            return std::complex<float>(
+                    (1 - rowFrac) * (1 - colFrac) *
+                            std::complex<double>(get(row0, col0)) +
+                    (1 - rowFrac) * colFrac *
+                            std::complex<double>(get(row0, col0 + 1)) +
+                    rowFrac * (1 - colFrac) *
+                            std::complex<double>(get(row0 + 1, col0)) +
+                    rowFrac * colFrac *
+                            std::complex<double>(get(row0 + 1, col0 + 1)));
+        }
+
+        std::vector<double> rowWeights;
+        std::vector<double> colWeights;
+        getSincWeights(rowFrac, rowWeights);
+        getSincWeights(colFrac, colWeights);
+        std::complex<double> value(0.0, 0.0);
+        for (long ii = 0; ii < 8; ++ii)
+        {
+            for (long jj = 0; jj < 8; ++jj)
+            {
+                value += rowWeights[ii] * colWeights[jj] *
+                        std::complex<double>(
+                                get(row0 - 3 + ii, col0 - 3 + jj));
+            }
+        }
+        return std::complex<float>(value);
+    }
+
+private:
+    // Clamps to the edge of the image
+    std::complex<float> get(long row, long col) const
+    {
+        row = std::min(std::max(row, 0L), static_cast<long>(mDims.row) - 1);
+        col = std::min(std::max(col, 0L), static_cast<long>(mDims.col) - 1);
+        return mImage[row * mDims.col + col];
+    }
+
+    static void getSincWeights(double frac, std::vector<double>& weights)
+    {
+        double sum(0.0);
+        weights.resize(8);
+        for (size_t ii = 0; ii < 8; ++ii)
+        {
+            const double x = (ii - 3.0) - frac;
+            const double sinc = (x == 0.0) ? 1.0 :
+                    std::sin(M_PI * x) / (M_PI * x);
+            weights[ii] = sinc * 0.5 * (1.0 + std::cos(M_PI * x / 4.0));
+            sum += weights[ii];
+        }
+        for (size_t ii = 0; ii < 8; ++ii)
+        {
+            weights[ii] /= sum;
+        }
+    }
+
+private:
+    const std::vector<std::complex<float> >& mImage;
+    const types::RowCol<size_t> mDims;
+};
+
+class Tester
+{
+public:
+    Tester(const types::RowCol<size_t>& inputDims,
+           const types::RowCol<size_t>& outputDims,
+           size_t maxNumThreads) :
+        mInputDims(inputDims),
+        mOutputDims(outputDims),
+        mMaxNumThreads(maxNumThreads),
+        mImage(inputDims.area()),
+        mSuccess(true)
+    {
+        for (size_t row = 0, idx = 0; row < inputDims.row; ++row)
+        {
+            for (size_t col = 0; col < inputDims.col; ++col, ++idx)
+            {
+                mImage[idx] = getInputPixel(row, col);
+            }
+        }
+    }
+
+    // Output pixels are input pixels shifted by a whole number of pixels,
+    // so every kind of interpolation should give back the input
+    void testShift()
+    {
+        six::Poly2D toSlantRow(1, 1);
+        six::Poly2D toSlantCol(1, 1);
+        toSlantRow[0][0] = 5;
+        toSlantRow[1][0] = 1;
+        toSlantCol[0][0] = -3;
+        toSlantCol[0][1] = 1;
+
+        for (size_t ii = 0; ii < 3; ++ii)
+        {
+            const Orthorectifier::Interpolation method =
+                    static_cast<Orthorectifier::Interpolation>(ii);
+            Orthorectifier ortho(&mImage[0], mInputDims, toSlantRow,
+                                 toSlantCol, mOutputDims, method, 2, 13);
+            std::vector<std::complex<float> > output(mOutputDims.area());
+            ortho.getPixels(0, mOutputDims.row, &output[0]);
+
+            for (size_t row = 0, idx = 0; row < mOutputDims.row; ++row)
+            {
+                for (size_t col = 0; col < mOutputDims.col; ++col, ++idx)
+                {
+                    const long inRow = static_cast<long>(row) + 5;
+                    const long inCol = static_cast<long>(col) - 3;
+                    const std::complex<float> expected =
+                            (inRow < static_cast<long>(mInputDims.row) &&
+                             inCol >= 0 &&
+                             inCol < static_cast<long>(mInputDims.col)) ?
+                            mImage[inRow * mInputDims.col + inCol] :
+                            std::complex<float>(0.0f, 0.0f);
+                    if (std::abs(output[idx] - expected) > 1e-4)
+                    {
+                        std::cerr << getName(method) << " shift DOES NOT "
+                                  << "MATCH at " << row << "," << col << "\n";
+                        mSuccess = false;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    // Rotated, scaled and slightly warped, running off of the image on
+    // every side
+    void testWarp(Orthorectifier::Interpolation method)
+    {
+        six::Poly2D toSlantRow(2, 2);
+        six::Poly2D toSlantCol(2, 2);
+        toSlantRow[0][0] = -11.3;
+        toSlantRow[1][0] = 0.93;
+        toSlantRow[0][1] = 0.31;
+        toSlantRow[2][0] = 1.7e-4;
+        toSlantCol[0][0] = 40.1;
+        toSlantCol[1][0] = -0.29;
+        toSlantCol[0][1] = 0.87;
+        toSlantCol[1][1] = 2.3e-4;
+
+        const std::string name = getName(method);
+        std::vector<std::complex<float> > expected(mOutputDims.area());
+        const Reference reference(mImage, mInputDims);
+        sys::RealTimeStopWatch stopWatch;
+        stopWatch.start();
+        for (size_t row = 0, idx = 0; row < mOutputDims.row; ++row)
+        {
+            for (size_t col = 0; col < mOutputDims.col; ++col, ++idx)
+            {
+                expected[idx] = reference(toSlantRow(row, col),
+                                          toSlantCol(row, col), method);
+            }
+        }
+        report(name + " per-pixel", stopWatch.stop());
+
+        std::vector<std::complex<float> > first;
+        for (size_t numThreads = 1;
+             numThreads <= mMaxNumThreads;
+             numThreads *= 2)
+        {
+            const size_t rowsPerBlock[] = {1, 17, 1000};
+            for (size_t ii = 0; ii < 3; ++ii)
+            {
+                Orthorectifier ortho(&mImage[0], mInputDims, toSlantRow,
+                                     toSlantCol, mOutputDims, method,
+                                     numThreads, rowsPerBlock[ii]);
+                std::vector<std::complex<float> > output(mOutputDims.area());
+                stopWatch.start();
+                ortho.getPixels(0, mOutputDims.row, &output[0]);
+                if (rowsPerBlock[ii] == 17)
+                {
+                    report(name + " with " + str::toString(numThreads) +
+                           " threads", stopWatch.stop());
+                }
+
+                if (first.empty())
+                {
+                    first = output;
+                    compare(name, first, expected);
+                }
+                else if (::memcmp(&first[0], &output[0],
+                                  first.size() * sizeof(first[0])))
+                {
+                    std::cerr << name << " with " << numThreads
+                              << " threads and " << rowsPerBlock[ii]
+                              << " rows per block DOES NOT MATCH\n";
+                    mSuccess = false;
+                }
+
+                // Amplitude of the middle rows
+                const size_t firstRow = mOutputDims.row / 3;
+                const size_t numRows = mOutputDims.row / 3;
+                std::vector<float> amplitude(numRows * mOutputDims.col);
+                ortho.getAmplitude(firstRow, numRows, &amplitude[0]);
+                for (size_t jj = 0; jj < amplitude.size(); ++jj)
+                {
+                    const float pixel = std::abs(
+                            output[firstRow * mOutputDims.col + jj]);
+                    if (std::abs(amplitude[jj] - pixel) > 1e-5 * pixel)
+                    {
+                        std::cerr << name << " amplitude DOES NOT MATCH\n";
+                        mSuccess = false;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    void testStream(six::PixelType pixelType)
+    {
+        six::Poly2D toSlantRow(1, 1);
+        six::Poly2D toSlantCol(1, 1);
+        toSlantRow[0][0] = 3.5;
+        toSlantRow[1][0] = 0.9;
+        toSlantCol[0][0] = 20;
+        toSlantCol[0][1] = 0.75;
+        toSlantCol[1][0] = -0.1;
+
+        Orthorectifier ortho(&mImage[0], mInputDims, toSlantRow, toSlantCol,
+                             mOutputDims, Orthorectifier::BILINEAR,
+                             mMaxNumThreads);
+        std::vector<float> amplitude(mOutputDims.area());
+        ortho.getAmplitude(0, mOutputDims.row, &amplitude[0]);
+
+        // Scale so that some pixels are clamped
+        const bool is16 = (pixelType == six::PixelType::MONO16I);
+        const double scale = is16 ? 20000.0 : 80.0;
+        const double maxValue = is16 ? 65535.0 : 255.0;
+        six::sicd::OrthorectifiedStream stream(ortho, pixelType, scale, 29);
+
+        const size_t numBytes = amplitude.size() * (is16 ? 2 : 1);
+        if (stream.available() != static_cast<sys::Off_T>(numBytes))
+        {
+            std::cerr << pixelType.toString() << " stream is the wrong size\n";
+            mSuccess = false;
+            return;
+        }
+
+        // Read in chunks that don't line up with the rows
+        std::vector<sys::ubyte> bytes(numBytes);
+        for (size_t ii = 0; ii < numBytes; ii += 1001)
+        {
+            const size_t len = std::min<size_t>(1001, numBytes - ii);
+            stream.read(&bytes[ii], len, true);
+        }
+
+        sys::ubyte extra;
+        if (stream.read(&extra, 1) != io::InputStream::IS_EOF)
+        {
+            std::cerr << pixelType.toString() << " stream has extra bytes\n";
+            mSuccess = false;
+        }
+
+        for (size_t ii = 0; ii < amplitude.size(); ++ii)
+        {
+            const double expected = std::min(
+                    std::floor(amplitude[ii] * scale + 0.5), maxValue);
+            const double value = is16 ?
+                    reinterpret_cast<const sys::Uint16_T*>(&bytes[0])[ii] :
+                    bytes[ii];
+
+            // Allow for float vs. double rounding
+            if (std::abs(value - expected) > 1.0)
+            {
+                std::cerr << pixelType.toString() << " stream DOES NOT MATCH at "
+                          << ii << "\n";
+                mSuccess = false;
+                return;
+            }
+        }
+    }
+
+    void testInvalidInputs()
+    {
+        six::Poly2D poly(1, 1);
+        Orthorectifier ortho(&mImage[0], mInputDims, poly, poly,
+                             mOutputDims, Orthorectifier::NEAREST);
+        std::vector<std::complex<float> > output(mOutputDims.col * 2);
+        try
+        {
+            ortho.getPixels(mOutputDims.row - 1, 2, &output[0]);
+            std::cerr << "Reading past the last row didn't throw\n";
+            mSuccess = false;
+        }
+        catch (const except::Exception& )
+        {
+        }
+
+        try
+        {
+            six::sicd::OrthorectifiedStream(ortho, six::PixelType::RGB24I,
+                                            1.0);
+            std::cerr << "RGB24I stream didn't throw\n";
+            mSuccess = false;
+        }
+        catch (const except::Exception& )
+        {
+        }
+    }
+
+    bool success() const
+    {
+        return mSuccess;
+    }
+
+private:
+    void compare(const std::string& name,
+                 const std::vector<std::complex<float> >& output,
+                 const std::vector<std::complex<float> >& expected)
+    {
+        for (size_t ii = 0; ii < output.size(); ++ii)
+        {
+            if (std::abs(output[ii] - expected[ii]) >
+                    1e-3 * (std::abs(expected[ii]) + 1))
+            {
+                std::cerr << name << " DOES NOT MATCH at "
+                          << ii / mOutputDims.col << ","
+                          << ii % mOutputDims.col << ": " << output[ii]
+                          << " vs. " << expected[ii] << "\n";
+                mSuccess = false;
+                return;
+            }
+        }
+    }
+
+    void report(const std::string& name, double elapsedMS)
+    {
+        const double mpixPerSec = (mOutputDims.area() / 1.0e6) /
+                (elapsedMS / 1000.0);
+        std::cout << name << ": " << elapsedMS << " ms, " << mpixPerSec
+                  << " Mpixels/s\n";
+    }
+
+private:
+    const types::RowCol<size_t> mInputDims;
+    const types::RowCol<size_t> mOutputDims;
+    const size_t mMaxNumThreads;
+    std::vector<std::complex<float> > mImage;
+    bool mSuccess;
+};
+}
+
+int main(int /*argc*/, char** /*argv*/)
+{
+    try
+    {
+        const size_t maxNumThreads = 4;
+        const types::RowCol<size_t> outputDims(300, 257);
+        const types::RowCol<size_t> inputDims(225, 205);
+
+        Tester tester(inputDims, outputDims, maxNumThreads);
+        tester.testShift();
+        tester.testWarp(Orthorectifier::NEAREST);
+        tester.testWarp(Orthorectifier::BILINEAR);
+        tester.testWarp(Orthorectifier::SINC);
+        tester.testStream(six::PixelType::MONO8I);
+        tester.testStream(six::PixelType::MONO16I);
+        tester.testInvalidInputs();
+
+        if (tester.success())
+        {
+            std::cout << "All tests pass!\n";
+        }
+        else
+        {
+            std::cerr << "Some tests FAIL!\n";
+        }
+
+        return (tester.success() ? 0 : 1);
+    }
+    catch (const std::exception& ex)
+    {
+        std::cerr << "Caught std::exception: " << ex.what() << std::endl;
+        return 1;
+    }
+    catch (const except::Exception& ex)
+    {
+        std::cerr << "Caught except::Exception: " << ex.getMessage()
+                  << std::endl;
+        return 1;
+    }
+    catch (...)
+    {
+        std::cerr << "Caught unknown exception\n";
+        return 1;
+    }
+}
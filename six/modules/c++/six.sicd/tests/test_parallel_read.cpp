@@ -0,0 +1,235 @@
+/* =========================================================================
+ * This file is part of six.sicd-c++
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2017, MDA Information Systems LLC
+ *
+ * six.sicd-c++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <iostream>
+#include <vector>
+#include <complex>
+
+#include <except/Exception.h>
+#include <mem/ScopedArray.h>
+#include <six/NITFWriteControl.h>
+#include <six/NITFReadControl.h>
+#include <six/XMLControlFactory.h>
+#include <six/sicd/ComplexXMLControl.h>
+
+#include "TestUtilities.h"
+
+namespace
+{
+// Writes out a SICD segmented every numRowsPerSeg rows, then reads back a
+// variety of regions with different numbers of threads, both through NITRO
+// and through a memory map, and makes sure they match what was written
+class Tester
+{
+public:
+    Tester(size_t numRowsPerSeg) :
+        mPathname("test_parallel_read.nitf"),
+        mFileCleanup(mPathname),
+        mDims(123, 456),
+        mImage(mDims.area()),
+        mSuccess(true)
+    {
+        for (size_t ii = 0; ii < mImage.size(); ++ii)
+        {
+            mImage[ii] = std::complex<float>(static_cast<float>(ii),
+                                             static_cast<float>(ii) * -1);
+        }
+
+        static const size_t APPROX_HEADER_SIZE = 2 * 1024;
+        const size_t maxProductSize = numRowsPerSeg * mDims.col *
+                sizeof(std::complex<float>) + APPROX_HEADER_SIZE;
+
+        mem::SharedPtr<six::Container> container(
+                new six::Container(six::DataType::COMPLEX));
+        container->addData(createData<float>(mDims).release());
+
+        six::NITFWriteControl writer;
+        writer.getOptions().setParameter(
+                six::NITFWriteControl::OPT_MAX_PRODUCT_SIZE, maxProductSize);
+        writer.initialize(container);
+
+        six::BufferList buffers;
+        buffers.push_back(reinterpret_cast<six::UByte*>(&mImage[0]));
+        writer.save(buffers, mPathname, std::vector<std::string>());
+
+        mReader.load(mPathname);
+
+        mMappedReader.getOptions().setParameter(
+                six::NITFReadControl::OPT_MEMORY_MAP, true);
+        mMappedReader.load(mPathname);
+        if (mMappedReader.getMappedSegment(0, 0) == NULL)
+        {
+            std::cerr << "Image was not memory mapped" << std::endl;
+            mSuccess = false;
+        }
+
+        // Segments and images past the end
+        try
+        {
+            mMappedReader.getMappedSegment(
+                    0, mMappedReader.getImageSegments(0).size());
+            std::cerr << "Segment past the end was not caught" << std::endl;
+            mSuccess = false;
+        }
+        catch (const except::Exception&)
+        {
+        }
+        try
+        {
+            mMappedReader.getMappedSegment(1, 0);
+            std::cerr << "Image past the end was not caught" << std::endl;
+            mSuccess = false;
+        }
+        catch (const std::exception&)
+        {
+        }
+    }
+
+    void testRegion(six::NITFReadControl& reader,
+                    const types::RowCol<size_t>& offset,
+                    const types::RowCol<size_t>& extent,
+                    size_t numThreads)
+    {
+        six::Region region;
+        region.setStartRow(offset.row);
+        region.setStartCol(offset.col);
+        region.setNumRows(extent.row);
+        region.setNumCols(extent.col);
+
+        mem::ScopedArray<six::UByte> buffer(
+                reader.interleaved(region, 0, numThreads));
+        const std::complex<float>* const pixels =
+                reinterpret_cast<const std::complex<float>*>(buffer.get());
+
+        for (size_t row = 0, idx = 0; row < extent.row; ++row)
+        {
+            for (size_t col = 0; col < extent.col; ++col, ++idx)
+            {
+                const size_t imageIdx =
+                        (offset.row + row) * mDims.col + offset.col + col;
+                if (pixels[idx] != mImage[imageIdx])
+                {
+                    std::cerr << "Region " << offset.row << "," << offset.col
+                              << " " << extent.row << "x" << extent.col
+                              << " with " << numThreads << " threads "
+                              << "DOES NOT MATCH at " << row << "," << col
+                              << std::endl;
+                    mSuccess = false;
+                    return;
+                }
+            }
+        }
+    }
+
+    void testRegions(size_t numThreads)
+    {
+        testRegions(mReader, numThreads);
+        testRegions(mMappedReader, numThreads);
+    }
+
+    bool success() const
+    {
+        return mSuccess;
+    }
+
+private:
+    void testRegions(six::NITFReadControl& reader, size_t numThreads)
+    {
+        testRegion(reader, types::RowCol<size_t>(0, 0), mDims, numThreads);
+        testRegion(reader, types::RowCol<size_t>(5, 0),
+                   types::RowCol<size_t>(100, mDims.col), numThreads);
+        testRegion(reader, types::RowCol<size_t>(17, 30),
+                   types::RowCol<size_t>(61, 200), numThreads);
+        testRegion(reader, types::RowCol<size_t>(122, 0),
+                   types::RowCol<size_t>(1, 10), numThreads);
+    }
+
+private:
+    const std::string mPathname;
+    const EnsureFileCleanup mFileCleanup;
+    const types::RowCol<size_t> mDims;
+    std::vector<std::complex<float> > mImage;
+    six::NITFReadControl mReader;
+    six::NITFReadControl mMappedReader;
+    bool mSuccess;
+};
+}
+
+int main(int /*argc*/, char** /*argv*/)
+{
+    try
+    {
+        six::XMLControlFactory::getInstance().addCreator(
+                six::DataType::COMPLEX,
+                new six::XMLControlCreatorT<six::sicd::ComplexXMLControl>());
+
+        std::vector<size_t> numRowsPerSeg;
+        numRowsPerSeg.push_back(200);
+        numRowsPerSeg.push_back(30);
+        numRowsPerSeg.push_back(7);
+        numRowsPerSeg.push_back(1);
+
+        bool success = true;
+        for (size_t ii = 0; ii < numRowsPerSeg.size(); ++ii)
+        {
+            Tester tester(numRowsPerSeg[ii]);
+            for (size_t numThreads = 1; numThreads <= 8; numThreads *= 2)
+            {
+                // Run each twice to exercise the cached segment readers
+                tester.testRegions(numThreads);
+                tester.testRegions(numThreads);
+            }
+
+            if (!tester.success())
+            {
+                success = false;
+            }
+        }
+
+        if (success)
+        {
+            std::cout << "All tests pass!\n";
+        }
+        else
+        {
+            std::cerr << "Some tests FAIL!\n";
+        }
+
+        return (success ? 0 : 1);
+    }
+    catch (const std::exception& ex)
+    {
+        std::cerr << "Caught std::exception: " << ex.what() << std::endl;
+        return 1;
+    }
+    catch (const except::Exception& ex)
+    {
+        std::cerr << "Caught except::Exception: " << ex.getMessage()
+                  << std::endl;
+        return 1;
+    }
+    catch (...)
+    {
+        std::cerr << "Caught unknown exception\n";
+        return 1;
+    }
+}
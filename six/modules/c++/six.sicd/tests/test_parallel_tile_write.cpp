@@ -0,0 +1,229 @@
+/* =========================================================================
+ * This file is part of six.sicd-c++
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2017, MDA Information Systems LLC
+ *
+ * six.sicd-c++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// Test program for SICDWriteControl::saveTile()
+// Writes the same SICD out a tile at a time from varying numbers of threads
+// at once, checks that it matches a normal write via NITFWriteControl, and
+// reports how long each write took
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include <complex>
+
+#include <except/Exception.h>
+#include <sys/Runnable.h>
+#include <sys/StopWatch.h>
+#include <mt/ThreadGroup.h>
+#include <six/NITFWriteControl.h>
+#include <six/XMLControlFactory.h>
+#include <six/sicd/ComplexXMLControl.h>
+#include <six/sicd/SICDWriteControl.h>
+
+#include "TestUtilities.h"
+
+namespace
+{
+// Writes every numThreads'th tile, starting at tile threadNum
+template <typename DataTypeT>
+class WriteTilesRunnable : public sys::Runnable
+{
+public:
+    WriteTilesRunnable(six::sicd::SICDWriteControl& writer,
+                       const std::vector<std::complex<DataTypeT> >& image,
+                       const types::RowCol<size_t>& dims,
+                       const types::RowCol<size_t>& tileDims,
+                       size_t threadNum,
+                       size_t numThreads) :
+        mWriter(writer),
+        mImage(image),
+        mDims(dims),
+        mTileDims(tileDims),
+        mThreadNum(threadNum),
+        mNumThreads(numThreads)
+    {
+    }
+
+    virtual void run()
+    {
+        const size_t numTileRows =
+                (mDims.row + mTileDims.row - 1) / mTileDims.row;
+        const size_t numTileCols =
+                (mDims.col + mTileDims.col - 1) / mTileDims.col;
+
+        std::vector<std::complex<DataTypeT> > tile;
+        for (size_t ii = mThreadNum;
+             ii < numTileRows * numTileCols;
+             ii += mNumThreads)
+        {
+            const types::RowCol<size_t> offset(
+                    (ii / numTileCols) * mTileDims.row,
+                    (ii % numTileCols) * mTileDims.col);
+            const types::RowCol<size_t> tileDims(
+                    std::min(mTileDims.row, mDims.row - offset.row),
+                    std::min(mTileDims.col, mDims.col - offset.col));
+
+            // The tile gets swapped in place, so write out of a copy
+            tile.resize(tileDims.area());
+            for (size_t row = 0; row < tileDims.row; ++row)
+            {
+                ::memcpy(&tile[row * tileDims.col],
+                         &mImage[(offset.row + row) * mDims.col + offset.col],
+                         tileDims.col * sizeof(tile[0]));
+            }
+
+            mWriter.saveTile(&tile[0], offset, tileDims, false);
+        }
+    }
+
+private:
+    six::sicd::SICDWriteControl& mWriter;
+    const std::vector<std::complex<DataTypeT> >& mImage;
+    const types::RowCol<size_t> mDims;
+    const types::RowCol<size_t> mTileDims;
+    const size_t mThreadNum;
+    const size_t mNumThreads;
+};
+
+template <typename DataTypeT>
+bool runTests(const types::RowCol<size_t>& dims,
+              const types::RowCol<size_t>& tileDims,
+              size_t numRowsPerSeg)
+{
+    const std::string normalPathname("test_parallel_tile_write_normal.nitf");
+    const std::string testPathname("test_parallel_tile_write.nitf");
+    const EnsureFileCleanup normalFileCleanup(normalPathname);
+    const EnsureFileCleanup testFileCleanup(testPathname);
+
+    std::vector<std::complex<DataTypeT> > image(dims.area());
+    for (size_t ii = 0; ii < image.size(); ++ii)
+    {
+        const DataTypeT value = static_cast<DataTypeT>(ii % 30000);
+        image[ii] = std::complex<DataTypeT>(value, -value);
+    }
+
+    static const size_t APPROX_HEADER_SIZE = 2 * 1024;
+    const size_t maxProductSize = numRowsPerSeg * dims.col *
+            sizeof(std::complex<DataTypeT>) + APPROX_HEADER_SIZE;
+
+    mem::SharedPtr<six::Container> container(
+            new six::Container(six::DataType::COMPLEX));
+    container->addData(createData<DataTypeT>(dims).release());
+
+    six::NITFWriteControl normalWriter;
+    normalWriter.getOptions().setParameter(
+            six::NITFWriteControl::OPT_MAX_PRODUCT_SIZE, maxProductSize);
+    normalWriter.initialize(container);
+
+    six::BufferList buffers;
+    buffers.push_back(reinterpret_cast<six::UByte*>(&image[0]));
+    normalWriter.save(buffers, normalPathname, std::vector<std::string>());
+
+    const CompareFiles compareFiles(normalPathname);
+
+    bool success = true;
+    for (size_t numThreads = 1; numThreads <= 32; numThreads *= 2)
+    {
+        sys::RealTimeStopWatch stopWatch;
+        stopWatch.start();
+
+        six::sicd::SICDWriteControl writer(testPathname,
+                                           std::vector<std::string>());
+        writer.getOptions().setParameter(
+                six::NITFWriteControl::OPT_MAX_PRODUCT_SIZE, maxProductSize);
+        writer.initialize(container);
+
+        mt::ThreadGroup threads;
+        for (size_t ii = 0; ii < numThreads; ++ii)
+        {
+            threads.createThread(new WriteTilesRunnable<DataTypeT>(
+                    writer, image, dims, tileDims, ii, numThreads));
+        }
+        threads.joinAll();
+        writer.close();
+
+        const double elapsedMS = stopWatch.stop();
+
+        const std::string prefix = "Tile write of " + str::toString(dims.row) +
+                "x" + str::toString(dims.col) + " with " +
+                str::toString(numThreads) + " threads (" +
+                str::toString(elapsedMS) + " ms)";
+        if (!compareFiles(prefix, testPathname))
+        {
+            success = false;
+        }
+    }
+
+    return success;
+}
+}
+
+int main(int /*argc*/, char** /*argv*/)
+{
+    try
+    {
+        six::XMLControlFactory::getInstance().addCreator(
+                six::DataType::COMPLEX,
+                new six::XMLControlCreatorT<six::sicd::ComplexXMLControl>());
+
+        // Tiles are ragged along the right and bottom edges and straddle
+        // image segment boundaries
+        const types::RowCol<size_t> dims(1000, 1500);
+        const types::RowCol<size_t> tileDims(64, 400);
+
+        bool success = true;
+        if (!runTests<float>(dims, tileDims, 300) ||
+            !runTests<sys::Int16_T>(dims, tileDims, 300) ||
+            !runTests<float>(dims, types::RowCol<size_t>(50, dims.col), 97))
+        {
+            success = false;
+        }
+
+        if (success)
+        {
+            std::cout << "All tests pass!\n";
+        }
+        else
+        {
+            std::cerr << "Some tests FAIL!\n";
+        }
+
+        return (success ? 0 : 1);
+    }
+    catch (const std::exception& ex)
+    {
+        std::cerr << "Caught std::exception: " << ex.what() << std::endl;
+        return 1;
+    }
+    catch (const except::Exception& ex)
+    {
+        std::cerr << "Caught except::Exception: " << ex.getMessage()
+                  << std::endl;
+        return 1;
+    }
+    catch (...)
+    {
+        std::cerr << "Caught unknown exception\n";
+        return 1;
+    }
+}
@@ -0,0 +1,283 @@
+/* =========================================================================
+ * This file is part of six.sicd-c++
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2017, MDA Information Systems LLC
+ *
+ * six.sicd-c++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// Test program for PixelStatisticsCollector::addImage()
+// Writes segmented SICDs, streams them through the collector in row blocks,
+// and checks that the statistics match those of the whole image in memory.
+// Also reports the throughput of gathering statistics versus a plain read.
+
+#include <math.h>
+
+#include <iostream>
+#include <vector>
+
+#include <except/Exception.h>
+#include <sys/StopWatch.h>
+#include <six/NITFReadControl.h>
+#include <six/NITFWriteControl.h>
+#include <six/PixelStatistics.h>
+#include <six/sicd/ComplexXMLControl.h>
+
+#include "TestUtilities.h"
+
+namespace
+{
+const types::RowCol<size_t> DIMS(123, 77);
+
+// Quantiles are off by default, but these tests check them too
+const double COMPRESSION = 100;
+
+template <typename DataTypeT>
+void writeSICD(const std::string& pathname,
+               const types::RowCol<size_t>& dims,
+               const std::vector<DataTypeT>& image,
+               const six::AmplitudeTable* ampTable)
+{
+    std::auto_ptr<six::sicd::ComplexData> data = createData<DataTypeT>(dims);
+    if (ampTable)
+    {
+        data->imageData->amplitudeTable.reset(ampTable->clone());
+    }
+    mem::SharedPtr<six::Container> container(
+            new six::Container(six::DataType::COMPLEX));
+    container->addData(data.release());
+
+    // Several segments
+    static const size_t APPROX_HEADER_SIZE = 2 * 1024;
+    six::NITFWriteControl writer;
+    writer.getOptions().setParameter(
+            six::NITFWriteControl::OPT_MAX_PRODUCT_SIZE,
+            30 * dims.col * 2 * sizeof(DataTypeT) + APPROX_HEADER_SIZE);
+    writer.initialize(container);
+
+    six::BufferList buffers;
+    buffers.push_back(reinterpret_cast<const six::UByte*>(&image[0]));
+    writer.save(buffers, pathname, std::vector<std::string>());
+}
+
+bool matches(const six::SampleStatistics& lhs,
+             const six::SampleStatistics& rhs)
+{
+    return lhs.getCount() == rhs.getCount() &&
+            lhs.getMin() == rhs.getMin() &&
+            lhs.getMax() == rhs.getMax() &&
+            ::fabs(lhs.getMean() - rhs.getMean()) < 1e-9 * rhs.getMean() &&
+            ::fabs(lhs.getVariance() - rhs.getVariance()) <
+                    1e-9 * rhs.getVariance() &&
+            lhs.getHistogram().getCounts() == rhs.getHistogram().getCounts() &&
+            lhs.getHistogram().getNumAbove() ==
+                    rhs.getHistogram().getNumAbove() &&
+            ::fabs(lhs.getQuantile(0.9) - rhs.getQuantile(0.9)) <
+                    0.01 * (rhs.getMax() - rhs.getMin());
+}
+
+template <typename DataTypeT>
+bool testImage(const std::vector<DataTypeT>& image,
+               const six::AmplitudeTable* ampTable,
+               double maxValue)
+{
+    const std::string pathname("test_pixel_statistics.nitf");
+    const EnsureFileCleanup cleanup(pathname);
+    writeSICD(pathname, DIMS, image, ampTable);
+
+    const six::PixelType pixelType =
+            GetPixelType<DataTypeT>::getPixelType();
+    six::PixelStatisticsCollector expected(pixelType, ampTable, 1,
+                                           COMPRESSION);
+    expected.setHistogram(0, maxValue, 100);
+    expected.addPixels(reinterpret_cast<const six::UByte*>(&image[0]), DIMS);
+
+    six::NITFReadControl reader;
+    reader.load(pathname);
+    for (size_t numThreads = 1; numThreads <= 3; numThreads += 2)
+    {
+        for (size_t numRowsPerBlock = 17;
+             numRowsPerBlock <= 1000;
+             numRowsPerBlock *= 10)
+        {
+            six::PixelStatisticsCollector collector(pixelType, ampTable,
+                                                    numThreads, COMPRESSION);
+            collector.setHistogram(0, maxValue, 100);
+            collector.addImage(reader, 0, numRowsPerBlock);
+            if (!matches(collector.getStatistics(),
+                         expected.getStatistics()))
+            {
+                std::cerr << pixelType.toString() << " statistics with "
+                          << numThreads << " threads and " << numRowsPerBlock
+                          << " rows per block DO NOT MATCH" << std::endl;
+                return false;
+            }
+        }
+    }
+
+    // Wrong pixel type
+    six::PixelStatisticsCollector wrongType(six::PixelType::RE32F_IM32F);
+    try
+    {
+        wrongType.addImage(reader);
+        std::cerr << "Pixel type mismatch was not caught" << std::endl;
+        return false;
+    }
+    catch (const except::Exception&)
+    {
+    }
+    return true;
+}
+
+bool testComplexShorts()
+{
+    std::vector<sys::Int16_T> image(DIMS.area() * 2);
+    for (size_t ii = 0; ii < image.size(); ++ii)
+    {
+        image[ii] = static_cast<sys::Int16_T>((ii * 7919) % 20001) - 10000;
+    }
+    return testImage(image, NULL, 15000);
+}
+
+bool testAmpPhase()
+{
+    six::AmplitudeTable ampTable;
+    for (size_t ii = 0; ii < 256; ++ii)
+    {
+        *reinterpret_cast<double*>(ampTable[ii]) = ::pow(ii / 16.0, 2);
+    }
+
+    std::vector<sys::Uint8_T> image(DIMS.area() * 2);
+    for (size_t ii = 0; ii < image.size(); ++ii)
+    {
+        image[ii] = static_cast<sys::Uint8_T>(ii * 31);
+    }
+    return testImage(image, &ampTable, 256);
+}
+
+void report(const std::string& name, size_t numBytes, double elapsedMS)
+{
+    const double mbPerSec = (numBytes / 1.0e6) / (elapsedMS / 1000.0);
+    std::cout << name << ": " << elapsedMS << " ms, " << mbPerSec
+              << " MB/s\n";
+}
+
+// Times a plain read of the image, a block of rows at a time, against
+// gathering statistics of it with and without quantiles
+bool reportThroughput()
+{
+    const types::RowCol<size_t> dims(2048, 1024);
+    const size_t numRowsPerBlock = 256;
+    std::vector<float> image(dims.area() * 2);
+    for (size_t ii = 0; ii < image.size(); ++ii)
+    {
+        image[ii] = static_cast<float>((ii * 7919) % 20001) - 10000;
+    }
+
+    const std::string pathname("test_pixel_statistics_throughput.nitf");
+    const EnsureFileCleanup cleanup(pathname);
+    writeSICD(pathname, dims, image, NULL);
+    six::NITFReadControl reader;
+    reader.load(pathname);
+
+    const size_t numBytes = image.size() * sizeof(float);
+    std::vector<float> block(numRowsPerBlock * dims.col * 2);
+    sys::RealTimeStopWatch stopWatch;
+    for (size_t pass = 0; pass < 2; ++pass)
+    {
+        // The first pass warms the file cache
+        stopWatch.start();
+        for (size_t row = 0; row < dims.row; row += numRowsPerBlock)
+        {
+            six::Region region;
+            region.setStartRow(row);
+            region.setNumRows(std::min(numRowsPerBlock, dims.row - row));
+            region.setNumCols(dims.col);
+            region.setBuffer(reinterpret_cast<six::UByte*>(&block[0]));
+            reader.interleaved(region, 0);
+        }
+    }
+    report("Plain read", numBytes, stopWatch.stop());
+
+    six::PixelStatisticsCollector collector(six::PixelType::RE32F_IM32F);
+    stopWatch.start();
+    collector.addImage(reader, 0, numRowsPerBlock);
+    report("Statistics", numBytes, stopWatch.stop());
+
+    six::PixelStatisticsCollector withQuantiles(six::PixelType::RE32F_IM32F,
+                                                NULL, 1, COMPRESSION);
+    stopWatch.start();
+    withQuantiles.addImage(reader, 0, numRowsPerBlock);
+    report("Statistics with quantiles", numBytes, stopWatch.stop());
+
+    const six::SampleStatistics& stats = collector.getStatistics();
+    const six::SampleStatistics& quantileStats =
+            withQuantiles.getStatistics();
+    if (stats.getCount() != dims.area() ||
+        quantileStats.getCount() != stats.getCount() ||
+        quantileStats.getMean() != stats.getMean() ||
+        quantileStats.getQuantile(0) != stats.getMin())
+    {
+        std::cerr << "Statistics with and without quantiles DO NOT MATCH\n";
+        return false;
+    }
+    return true;
+}
+}
+
+int main(int /*argc*/, char** /*argv*/)
+{
+    try
+    {
+        six::XMLControlFactory::getInstance().addCreator(
+                six::DataType::COMPLEX,
+                new six::XMLControlCreatorT<
+                        six::sicd::ComplexXMLControl>());
+
+        bool success = true;
+        success = testComplexShorts() && success;
+        success = testAmpPhase() && success;
+        success = reportThroughput() && success;
+
+        if (success)
+        {
+            std::cout << "All tests pass!\n";
+        }
+        else
+        {
+            std::cerr << "Some tests FAIL!\n";
+        }
+
+        return (success ? 0 : 1);
+    }
+    catch (const std::exception& ex)
+    {
+        std::cerr << "Caught std::exception: " << ex.what() << std::endl;
+        return 1;
+    }
+    catch (const except::Exception& ex)
+    {
+        std::cerr << "Caught except::Exception: " << ex.getMessage()
+                  << std::endl;
+        return 1;
+    }
+    catch (...)
+    {
+        std::cerr << "Caught unknown exception\n";
+        return 1;
+    }
+}
@@ -0,0 +1,337 @@
+/* =========================================================================
+ * This file is part of six.sicd-c++
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2017, MDA Information Systems LLC
+ *
+ * six.sicd-c++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+#include <complex>
+
+#include <except/Exception.h>
+#include <six/NITFWriteControl.h>
+#include <six/NITFReadControl.h>
+#include <six/XMLControlFactory.h>
+#include <six/sicd/ComplexXMLControl.h>
+#include <six/sicd/Utilities.h>
+
+#include "TestUtilities.h"
+
+namespace
+{
+// Fills in the image with a pattern, and the pixels it should decode to
+template <typename DataTypeT>
+void createImage(const six::sicd::ComplexData& /*data*/,
+                 std::vector<DataTypeT>& image,
+                 std::vector<std::complex<float> >& expected)
+{
+    for (size_t ii = 0; ii < expected.size(); ++ii)
+    {
+        const DataTypeT value = static_cast<DataTypeT>(ii % 30000);
+        image[ii * 2] = value;
+        image[ii * 2 + 1] = -value;
+        expected[ii] = std::complex<float>(value, -value);
+    }
+}
+
+template <>
+void createImage<sys::Uint8_T>(const six::sicd::ComplexData& data,
+                               std::vector<sys::Uint8_T>& image,
+                               std::vector<std::complex<float> >& expected)
+{
+    const six::AmplitudeTable* const ampTable =
+            data.imageData->amplitudeTable.get();
+
+    for (size_t ii = 0; ii < expected.size(); ++ii)
+    {
+        const sys::Uint8_T amp = static_cast<sys::Uint8_T>(ii % 256);
+        const sys::Uint8_T phase = static_cast<sys::Uint8_T>((ii / 7) % 256);
+        image[ii * 2] = amp;
+        image[ii * 2 + 1] = phase;
+
+        const double amplitude = ampTable ?
+                *reinterpret_cast<const double*>((*ampTable)[amp]) : amp;
+        expected[ii] = std::polar(static_cast<float>(amplitude),
+                                  static_cast<float>(2 * M_PI * phase / 256));
+    }
+}
+
+void addAmpTable(six::sicd::ComplexData& data)
+{
+    data.imageData->amplitudeTable.reset(new six::AmplitudeTable());
+    six::AmplitudeTable& ampTable = *data.imageData->amplitudeTable;
+    for (size_t ii = 0; ii < ampTable.numEntries; ++ii)
+    {
+        *reinterpret_cast<double*>(ampTable[ii]) = 0.5 * ii + 3.25;
+    }
+}
+
+bool isClose(const std::complex<float>& lhs, const std::complex<float>& rhs)
+{
+    return std::abs(lhs - rhs) <= 1e-4f * std::max(1.0f, std::abs(rhs));
+}
+
+// Writes out a segmented SICD of the given pixel type, then reads back a
+// variety of regions through Utilities::getWidebandData() with different
+// numbers of threads, both through NITRO and through a memory map, and makes
+// sure they match what was written
+template <typename DataTypeT>
+class Tester
+{
+public:
+    Tester(std::auto_ptr<six::sicd::ComplexData> data,
+           size_t numRowsPerSeg) :
+        mPathname("test_wideband_data.nitf"),
+        mFileCleanup(mPathname),
+        mDims(data->getNumRows(), data->getNumCols()),
+        mImage(mDims.area() * 2),
+        mExpected(mDims.area()),
+        mData(data),
+        mSuccess(true)
+    {
+        createImage(*mData, mImage, mExpected);
+
+        static const size_t APPROX_HEADER_SIZE = 2 * 1024;
+        const size_t maxProductSize = numRowsPerSeg * mDims.col *
+                sizeof(DataTypeT) * 2 + APPROX_HEADER_SIZE;
+
+        mem::SharedPtr<six::Container> container(
+                new six::Container(six::DataType::COMPLEX));
+        container->addData(mData->clone());
+
+        six::NITFWriteControl writer;
+        writer.getOptions().setParameter(
+                six::NITFWriteControl::OPT_MAX_PRODUCT_SIZE, maxProductSize);
+        writer.initialize(container);
+
+        six::BufferList buffers;
+        buffers.push_back(reinterpret_cast<six::UByte*>(&mImage[0]));
+        writer.save(buffers, mPathname, std::vector<std::string>());
+
+        mReader.load(mPathname);
+
+        mMappedReader.getOptions().setParameter(
+                six::NITFReadControl::OPT_MEMORY_MAP, true);
+        mMappedReader.load(mPathname);
+    }
+
+    void testRegions(size_t numThreads)
+    {
+        testRegions(mReader, numThreads);
+        testRegions(mMappedReader, numThreads);
+    }
+
+    // Regions that run off the image must throw rather than read past it
+    void testOutOfRange()
+    {
+        testOutOfRange(mReader);
+        testOutOfRange(mMappedReader);
+    }
+
+    bool success() const
+    {
+        return mSuccess;
+    }
+
+private:
+    void testOutOfRange(six::NITFReadControl& reader)
+    {
+        const types::RowCol<size_t> offsets[] = {
+                types::RowCol<size_t>(0, 0),
+                types::RowCol<size_t>(100, 0),
+                types::RowCol<size_t>(0, 400),
+                types::RowCol<size_t>(mDims.row + 1, 0)};
+        const types::RowCol<size_t> extents[] = {
+                types::RowCol<size_t>(mDims.row + 1, mDims.col),
+                types::RowCol<size_t>(static_cast<size_t>(-1), 10),
+                types::RowCol<size_t>(10, 57),
+                types::RowCol<size_t>(0, 10)};
+
+        for (size_t ii = 0; ii < sizeof(offsets) / sizeof(offsets[0]); ++ii)
+        {
+            std::vector<std::complex<float> > buffer(mDims.area() * 2);
+            try
+            {
+                six::sicd::Utilities::getWidebandData(reader, *mData,
+                                                      offsets[ii],
+                                                      extents[ii], 1,
+                                                      &buffer[0]);
+                std::cerr << "Out of range region " << ii
+                          << " DID NOT THROW" << std::endl;
+                mSuccess = false;
+            }
+            catch (const except::Exception&)
+            {
+            }
+        }
+    }
+
+    void testRegion(six::NITFReadControl& reader,
+                    const types::RowCol<size_t>& offset,
+                    const types::RowCol<size_t>& extent,
+                    size_t numThreads)
+    {
+        std::vector<std::complex<float> > buffer(extent.area());
+        six::sicd::Utilities::getWidebandData(reader, *mData, offset, extent,
+                                              numThreads, &buffer[0]);
+
+        for (size_t row = 0, idx = 0; row < extent.row; ++row)
+        {
+            for (size_t col = 0; col < extent.col; ++col, ++idx)
+            {
+                const std::complex<float>& expected =
+                        mExpected[(offset.row + row) * mDims.col +
+                                  offset.col + col];
+                if (!isClose(buffer[idx], expected))
+                {
+                    std::cerr << "Region " << offset.row << "," << offset.col
+                              << " " << extent.row << "x" << extent.col
+                              << " with " << numThreads << " threads "
+                              << "DOES NOT MATCH at " << row << "," << col
+                              << " " << buffer[idx] << " " << expected
+                              << std::endl;
+                    mSuccess = false;
+                    return;
+                }
+            }
+        }
+    }
+
+    void testRegions(six::NITFReadControl& reader, size_t numThreads)
+    {
+        testRegion(reader, types::RowCol<size_t>(0, 0), mDims, numThreads);
+        testRegion(reader, types::RowCol<size_t>(5, 0),
+                   types::RowCol<size_t>(100, mDims.col), numThreads);
+        testRegion(reader, types::RowCol<size_t>(17, 30),
+                   types::RowCol<size_t>(61, 201), numThreads);
+        testRegion(reader, types::RowCol<size_t>(122, 3),
+                   types::RowCol<size_t>(1, 10), numThreads);
+    }
+
+private:
+    const std::string mPathname;
+    const EnsureFileCleanup mFileCleanup;
+    const types::RowCol<size_t> mDims;
+    std::vector<DataTypeT> mImage;
+    std::vector<std::complex<float> > mExpected;
+    const std::auto_ptr<six::sicd::ComplexData> mData;
+    six::NITFReadControl mReader;
+    six::NITFReadControl mMappedReader;
+    bool mSuccess;
+};
+
+template <typename DataTypeT>
+bool runTests(bool useAmpTable = false)
+{
+    const types::RowCol<size_t> dims(123, 456);
+
+    std::vector<size_t> numRowsPerSeg;
+    numRowsPerSeg.push_back(200);
+    numRowsPerSeg.push_back(30);
+    numRowsPerSeg.push_back(1);
+
+    bool success = true;
+    for (size_t ii = 0; ii < numRowsPerSeg.size(); ++ii)
+    {
+        std::auto_ptr<six::sicd::ComplexData> data =
+                createData<DataTypeT>(dims);
+        if (useAmpTable)
+        {
+            addAmpTable(*data);
+        }
+        Tester<DataTypeT> tester(data, numRowsPerSeg[ii]);
+        for (size_t numThreads = 1; numThreads <= 4; numThreads *= 2)
+        {
+            tester.testRegions(numThreads);
+        }
+        tester.testOutOfRange();
+
+        if (!tester.success())
+        {
+            success = false;
+        }
+    }
+
+    return success;
+}
+}
+
+int main(int /*argc*/, char** /*argv*/)
+{
+    try
+    {
+        six::XMLControlFactory::getInstance().addCreator(
+                six::DataType::COMPLEX,
+                new six::XMLControlCreatorT<six::sicd::ComplexXMLControl>());
+
+        bool success = true;
+        if (!runTests<float>())
+        {
+            std::cerr << "Float tests FAIL" << std::endl;
+            success = false;
+        }
+
+        if (!runTests<sys::Int16_T>())
+        {
+            std::cerr << "Int16 tests FAIL" << std::endl;
+            success = false;
+        }
+
+        if (!runTests<sys::Uint8_T>(false))
+        {
+            std::cerr << "AMP8I_PHS8I tests FAIL" << std::endl;
+            success = false;
+        }
+
+        if (!runTests<sys::Uint8_T>(true))
+        {
+            std::cerr << "AMP8I_PHS8I with AmpTable tests FAIL" << std::endl;
+            success = false;
+        }
+
+        if (success)
+        {
+            std::cout << "All tests pass!\n";
+        }
+        else
+        {
+            std::cerr << "Some tests FAIL!\n";
+        }
+
+        return (success ? 0 : 1);
+    }
+    catch (const std::exception& ex)
+    {
+        std::cerr << "Caught std::exception: " << ex.what() << std::endl;
+        return 1;
+    }
+    catch (const except::Exception& ex)
+    {
+        std::cerr << "Caught except::Exception: " << ex.getMessage()
+                  << std::endl;
+        return 1;
+    }
+    catch (...)
+    {
+        std::cerr << "Caught unknown exception\n";
+        return 1;
+    }
+}
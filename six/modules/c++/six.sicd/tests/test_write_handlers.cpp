@@ -0,0 +1,265 @@
+/* =========================================================================
+ * This file is part of six.sicd-c++
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2017, MDA Information Systems LLC
+ *
+ * six.sicd-c++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <iostream>
+#include <vector>
+#include <complex>
+
+#include <except/Exception.h>
+#include <io/ByteStream.h>
+#include <six/NITFWriteControl.h>
+#include <six/NITFReadControl.h>
+#include <six/XMLControlFactory.h>
+#include <six/sicd/ComplexXMLControl.h>
+#include <six/sicd/Utilities.h>
+
+#include "TestUtilities.h"
+
+namespace
+{
+// Writes out the same segmented SICD from memory and from a stream with
+// varying numbers of byte swapping threads, both synchronously and with the
+// asynchronous write pipeline.  All the files should match, and the pixels
+// should read back as they were written.
+template <typename DataTypeT>
+class Tester
+{
+public:
+    Tester(const types::RowCol<size_t>& dims, size_t numRowsPerSeg) :
+        mNormalPathname("test_write_handlers_normal.nitf"),
+        mTestPathname("test_write_handlers.nitf"),
+        mNormalFileCleanup(mNormalPathname),
+        mTestFileCleanup(mTestPathname),
+        mData(createData<DataTypeT>(dims)),
+        mImage(dims.area()),
+        mMaxProductSize(numRowsPerSeg * dims.col *
+                        sizeof(std::complex<DataTypeT>) + 2 * 1024),
+        mSuccess(true)
+    {
+        for (size_t ii = 0; ii < mImage.size(); ++ii)
+        {
+            const DataTypeT value = static_cast<DataTypeT>(ii % 30000);
+            mImage[ii] = std::complex<DataTypeT>(value, -value);
+        }
+
+        writeFromMemory(mNormalPathname, 1, 0);
+        checkPixels();
+    }
+
+    void test(size_t numThreads, size_t queueDepth)
+    {
+        const CompareFiles compareFiles(mNormalPathname);
+        const std::string description = " with " +
+                str::toString(numThreads) + " threads and queue depth " +
+                str::toString(queueDepth);
+
+        writeFromMemory(mTestPathname, numThreads, queueDepth);
+        if (!compareFiles("Memory write" + description, mTestPathname))
+        {
+            mSuccess = false;
+        }
+
+        writeFromStream(mTestPathname, numThreads, queueDepth);
+        if (!compareFiles("Stream write" + description, mTestPathname))
+        {
+            mSuccess = false;
+        }
+    }
+
+    // A stream that runs out of pixels must fail the write rather than
+    // leave garbage in the file
+    void testShortStream(size_t numThreads, size_t queueDepth)
+    {
+        io::ByteStream stream;
+        stream.write(&mImage[0], mImage.size() * sizeof(mImage[0]) / 2);
+        stream.reset();
+
+        six::SourceList sources;
+        sources.push_back(&stream);
+        try
+        {
+            createWriter(numThreads, queueDepth)->save(
+                    sources, mTestPathname, std::vector<std::string>());
+            std::cerr << "Short stream with queue depth " << queueDepth
+                      << " was not caught" << std::endl;
+            mSuccess = false;
+        }
+        catch (const except::Exception&)
+        {
+        }
+    }
+
+    bool success() const
+    {
+        return mSuccess;
+    }
+
+private:
+    std::auto_ptr<six::NITFWriteControl> createWriter(size_t numThreads,
+                                                      size_t queueDepth)
+    {
+        mem::SharedPtr<six::Container> container(
+                new six::Container(six::DataType::COMPLEX));
+        container->addData(mData->clone());
+
+        std::auto_ptr<six::NITFWriteControl> writer(
+                new six::NITFWriteControl());
+        writer->getOptions().setParameter(
+                six::NITFWriteControl::OPT_MAX_PRODUCT_SIZE, mMaxProductSize);
+        writer->getOptions().setParameter(
+                six::NITFWriteControl::OPT_NUM_THREADS, numThreads);
+        writer->getOptions().setParameter(
+                six::NITFWriteControl::OPT_ASYNC_WRITE, queueDepth);
+        writer->initialize(container);
+        return writer;
+    }
+
+    void writeFromMemory(const std::string& pathname,
+                         size_t numThreads,
+                         size_t queueDepth)
+    {
+        six::BufferList buffers;
+        buffers.push_back(reinterpret_cast<six::UByte*>(&mImage[0]));
+        createWriter(numThreads, queueDepth)->save(
+                buffers, pathname, std::vector<std::string>());
+    }
+
+    void writeFromStream(const std::string& pathname,
+                         size_t numThreads,
+                         size_t queueDepth)
+    {
+        io::ByteStream stream;
+        stream.write(&mImage[0], mImage.size() * sizeof(mImage[0]));
+        stream.reset();
+
+        six::SourceList sources;
+        sources.push_back(&stream);
+        createWriter(numThreads, queueDepth)->save(
+                sources, pathname, std::vector<std::string>());
+    }
+
+    void checkPixels()
+    {
+        six::NITFReadControl reader;
+        reader.load(mNormalPathname);
+
+        std::vector<std::complex<float> > pixels;
+        six::sicd::Utilities::getWidebandData(reader, *mData, pixels);
+
+        for (size_t ii = 0; ii < pixels.size(); ++ii)
+        {
+            if (pixels[ii].real() != mImage[ii].real() ||
+                pixels[ii].imag() != mImage[ii].imag())
+            {
+                std::cerr << "Pixel " << ii << " DOES NOT MATCH" << std::endl;
+                mSuccess = false;
+                return;
+            }
+        }
+    }
+
+private:
+    const std::string mNormalPathname;
+    const std::string mTestPathname;
+    const EnsureFileCleanup mNormalFileCleanup;
+    const EnsureFileCleanup mTestFileCleanup;
+    const std::auto_ptr<six::sicd::ComplexData> mData;
+    std::vector<std::complex<DataTypeT> > mImage;
+    const size_t mMaxProductSize;
+    bool mSuccess;
+};
+
+template <typename DataTypeT>
+bool runTests(const types::RowCol<size_t>& dims)
+{
+    std::vector<size_t> numRowsPerSeg;
+    numRowsPerSeg.push_back(dims.row + 1);
+    numRowsPerSeg.push_back(7);
+
+    bool success = true;
+    for (size_t ii = 0; ii < numRowsPerSeg.size(); ++ii)
+    {
+        Tester<DataTypeT> tester(dims, numRowsPerSeg[ii]);
+        tester.test(1, 0);
+        tester.test(3, 0);
+        tester.test(1, 2);
+        tester.test(3, 3);
+        tester.testShortStream(1, 0);
+        tester.testShortStream(3, 3);
+
+        if (!tester.success())
+        {
+            success = false;
+        }
+    }
+
+    return success;
+}
+}
+
+int main(int /*argc*/, char** /*argv*/)
+{
+    try
+    {
+        six::XMLControlFactory::getInstance().addCreator(
+                six::DataType::COMPLEX,
+                new six::XMLControlCreatorT<six::sicd::ComplexXMLControl>());
+
+        // The wide image spans several strips of rows
+        const types::RowCol<size_t> narrow(123, 456);
+        const types::RowCol<size_t> wide(40, 100000);
+
+        bool success = true;
+        if (!runTests<float>(narrow) || !runTests<float>(wide) ||
+            !runTests<sys::Int16_T>(narrow) || !runTests<sys::Int16_T>(wide))
+        {
+            success = false;
+        }
+
+        if (success)
+        {
+            std::cout << "All tests pass!\n";
+        }
+        else
+        {
+            std::cerr << "Some tests FAIL!\n";
+        }
+
+        return (success ? 0 : 1);
+    }
+    catch (const std::exception& ex)
+    {
+        std::cerr << "Caught std::exception: " << ex.what() << std::endl;
+        return 1;
+    }
+    catch (const except::Exception& ex)
+    {
+        std::cerr << "Caught except::Exception: " << ex.getMessage()
+                  << std::endl;
+        return 1;
+    }
+    catch (...)
+    {
+        std::cerr << "Caught unknown exception\n";
+        return 1;
+    }
+}
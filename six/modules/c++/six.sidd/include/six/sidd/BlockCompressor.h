@@ -0,0 +1,72 @@
+/* =========================================================================
+ * This file is part of six.sidd-c++
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2018, MDA Information Systems LLC
+ *
+ * six.sidd-c++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __SIX_SIDD_BLOCK_COMPRESSOR_H__
+#define __SIX_SIDD_BLOCK_COMPRESSOR_H__
+
+#include <vector>
+
+#include <sys/Conf.h>
+#include <types/RowCol.h>
+
+namespace six
+{
+namespace sidd
+{
+/*!
+ * \class BlockCompressor
+ * \brief Compresses one NITF block of SIDD pixels at a time.  Used by
+ * CompressedSIDDEncoder, which calls compress() for different blocks from
+ * multiple threads at once, so implementations must be thread-safe.
+ */
+class BlockCompressor
+{
+public:
+    virtual ~BlockCompressor()
+    {
+    }
+
+    /*!
+     * Compresses a block
+     *
+     * \param block Pixels of the block in native byte order, row-major, with
+     * the bands of each pixel interleaved (i.e. the same layout as the SIDD
+     * image).  Blocks on the bottom and right edges of the image are not
+     * padded.
+     * \param blockIndex 0-based index of the block, counting across and then
+     * down the image
+     * \param blockDims Dimensions of this block
+     * \param[out] compressed Compressed bytes.  These are written to the NITF
+     * as-is, one block after another.
+     */
+    virtual void compress(const sys::ubyte* block,
+                          size_t blockIndex,
+                          const types::RowCol<size_t>& blockDims,
+                          std::vector<sys::ubyte>& compressed) const = 0;
+
+    //! \return Whether the decompressed pixels will exactly match the input
+    virtual bool isNumericallyLossless() const = 0;
+};
+}
+}
+
+#endif
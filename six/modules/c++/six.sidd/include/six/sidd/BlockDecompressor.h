@@ -0,0 +1,79 @@
+/* =========================================================================
+ * This file is part of six.sidd-c++
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2018, MDA Information Systems LLC
+ *
+ * six.sidd-c++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __SIX_SIDD_BLOCK_DECOMPRESSOR_H__
+#define __SIX_SIDD_BLOCK_DECOMPRESSOR_H__
+
+#include <sys/Conf.h>
+#include <types/RowCol.h>
+#include <six/sidd/DerivedData.h>
+
+namespace six
+{
+namespace sidd
+{
+/*!
+ * \class BlockDecompressor
+ * \brief Decompresses one NITF block of a compressed SIDD at a time.  The
+ * counterpart of BlockCompressor, used by CompressedSIDDReader, which calls
+ * decompress() for different blocks from multiple threads at once.
+ */
+class BlockDecompressor
+{
+public:
+    virtual ~BlockDecompressor()
+    {
+    }
+
+    /*!
+     * Finds the blocks in an image's compressed data.  Called once before
+     * any calls to decompress().
+     *
+     * \param data Representation of the derived data
+     * \param imageData All of the image segment's compressed data.  Stays
+     * valid until the next call to load().
+     * \param numBytes Number of bytes in imageData
+     * \param numBlocks Number of blocks in the image
+     */
+    virtual void load(const DerivedData& data,
+                      const sys::ubyte* imageData,
+                      size_t numBytes,
+                      size_t numBlocks) = 0;
+
+    /*!
+     * Decompresses a block.  Must be thread-safe.
+     *
+     * \param blockIndex 0-based index of the block, counting across and then
+     * down the image
+     * \param blockDims Dimensions of this block.  Blocks on the bottom and
+     * right edges of the image are not padded.
+     * \param[out] block Pixels of the block in native byte order, row-major,
+     * with the bands of each pixel interleaved
+     */
+    virtual void decompress(size_t blockIndex,
+                            const types::RowCol<size_t>& blockDims,
+                            sys::ubyte* block) const = 0;
+};
+}
+}
+
+#endif
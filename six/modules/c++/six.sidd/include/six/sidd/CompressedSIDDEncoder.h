@@ -0,0 +1,133 @@
+/* =========================================================================
+ * This file is part of six.sidd-c++
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2018, MDA Information Systems LLC
+ *
+ * six.sidd-c++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __SIX_SIDD_COMPRESSED_SIDD_ENCODER_H__
+#define __SIX_SIDD_COMPRESSED_SIDD_ENCODER_H__
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <sys/Conf.h>
+#include <types/RowCol.h>
+#include <six/sidd/BlockCompressor.h>
+#include <six/sidd/CompressedSIDDByteProvider.h>
+#include <six/sidd/DerivedData.h>
+
+namespace six
+{
+namespace sidd
+{
+/*!
+ * \class CompressedSIDDEncoder
+ * \brief Compresses raw SIDD pixels block by block on multiple threads and
+ * hands the results to a CompressedSIDDByteProvider.
+ *
+ * Blocks are compressed in parallel with a BlockCompressor (e.g.
+ * J2KBlockCompressor) and concatenated in NITF block order, so that
+ * getCompressedData() and getBytesPerBlock() are exactly what
+ * CompressedSIDDByteProvider expects.  The whole image is written to a
+ * single image segment, as the SIDD spec requires for compressed images.
+ */
+class CompressedSIDDEncoder
+{
+public:
+    /*!
+     * \param data Representation of the derived data.  Must outlive this
+     * object.
+     * \param compressor Block compressor.  Must be set up for the same
+     * image and blocking and must outlive this object.
+     * \param numRowsPerBlock The number of rows per block.  Defaults to no
+     * blocking.
+     * \param numColsPerBlock The number of columns per block.  Defaults to no
+     * blocking.
+     * \param numThreads Number of threads to compress blocks with
+     */
+    CompressedSIDDEncoder(const DerivedData& data,
+                          const BlockCompressor& compressor,
+                          size_t numRowsPerBlock = 0,
+                          size_t numColsPerBlock = 0,
+                          size_t numThreads = 1);
+
+    /*!
+     * Compresses the whole image, replacing the results of any previous call
+     *
+     * \param imageData Every pixel of the image in native byte order
+     */
+    void encode(const sys::ubyte* imageData);
+
+    /*!
+     * \return Compressed sizes of each block, in bytes, in the form
+     * CompressedSIDDByteProvider takes
+     */
+    const std::vector<std::vector<size_t> >& getBytesPerBlock() const
+    {
+        return mBytesPerBlock;
+    }
+
+    //! \return Compressed blocks, one after another
+    const sys::ubyte* getCompressedData() const
+    {
+        return mCompressedData.empty() ? NULL : &mCompressedData[0];
+    }
+
+    //! \return Total number of compressed bytes
+    size_t getNumCompressedBytes() const
+    {
+        return mCompressedData.size();
+    }
+
+    //! \return Number of blocks in the image
+    size_t getNumBlocks() const
+    {
+        return mNumBlocks.area();
+    }
+
+    /*!
+     * Creates a byte provider for the most recently encoded image.  Pass
+     * getCompressedData() to its getBytes() for all the image rows to get the
+     * NITF.
+     *
+     * \param schemaPaths Directories or files of schema locations
+     * \return Byte provider
+     */
+    std::auto_ptr<CompressedSIDDByteProvider>
+    createByteProvider(const std::vector<std::string>& schemaPaths) const;
+
+private:
+    // Compresses a range of blocks
+    class EncodeRunnable;
+
+    const DerivedData& mData;
+    const BlockCompressor& mCompressor;
+    const size_t mNumThreads;
+    const types::RowCol<size_t> mImageDims;
+    const types::RowCol<size_t> mBlockDims;
+    const types::RowCol<size_t> mNumBlocks;
+
+    std::vector<std::vector<size_t> > mBytesPerBlock;
+    std::vector<sys::ubyte> mCompressedData;
+};
+}
+}
+
+#endif
@@ -0,0 +1,157 @@
+/* =========================================================================
+ * This file is part of six.sidd-c++
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2018, MDA Information Systems LLC
+ *
+ * six.sidd-c++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __SIX_SIDD_COMPRESSED_SIDD_READER_H__
+#define __SIX_SIDD_COMPRESSED_SIDD_READER_H__
+
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <sys/Conf.h>
+#include <types/RowCol.h>
+#include <six/MemoryMappedFile.h>
+#include <six/NITFReadControl.h>
+#include <six/Region.h>
+#include <six/XMLControlFactory.h>
+#include <six/sidd/BlockDecompressor.h>
+#include <six/sidd/DerivedData.h>
+
+namespace six
+{
+namespace sidd
+{
+/*!
+ * \class CompressedSIDDReader
+ * \brief Reads regions of a blocked, compressed SIDD image by decompressing
+ * just the blocks each region overlaps, on multiple threads.
+ *
+ * The image must be a single image segment with IC C8, as
+ * CompressedSIDDByteProvider writes.  The file is memory mapped and each
+ * block's compressed bytes are handed to a BlockDecompressor (e.g.
+ * J2KBlockDecompressor) rather than decoding the whole segment through
+ * NITRO on the calling thread.
+ *
+ * Optionally, the most recently used decompressed blocks are cached so that
+ * overlapping reads, like a viewer panning and zooming, don't decompress
+ * them again.
+ *
+ * A reader should only be used by one thread at a time.
+ */
+class CompressedSIDDReader
+{
+public:
+    /*!
+     * \param pathname SIDD to read
+     * \param schemaPaths Directories or files of schema locations
+     * \param decompressor Block decompressor for the image's compression.
+     * Must outlive this object.
+     * \param imageNumber Index of the product image to read
+     * \param numThreads Number of threads to decompress blocks with
+     * \param numCachedBlocks Maximum number of decompressed blocks to keep.
+     * Defaults to no caching.
+     */
+    CompressedSIDDReader(const std::string& pathname,
+                         const std::vector<std::string>& schemaPaths,
+                         BlockDecompressor& decompressor,
+                         size_t imageNumber = 0,
+                         size_t numThreads = 1,
+                         size_t numCachedBlocks = 0);
+
+    //! \return The image's derived data
+    const DerivedData& getDerivedData() const
+    {
+        return *mData;
+    }
+
+    /*!
+     * Read section of image data specified by region
+     *
+     * \param region Rows and columns of the image to read.  If the number
+     * of rows and/or number of columns is set to -1, this indicates to read
+     * the entirety of the image in that dimension.  In this case, this
+     * parameter will be updated with the actual number of rows and/or
+     * columns that were read.
+     *
+     * \return Buffer of image data in native byte order.  This is simply a
+     * pointer to the buffer that is held by 'region'.  If it is NULL in the
+     * incoming region, the memory is allocated and the region's buffer is
+     * updated.  In this case it is up to the caller to delete the memory.
+     */
+    UByte* interleaved(Region& region);
+
+    //! \return The blocking of the image
+    const types::RowCol<size_t>& getBlockDims() const
+    {
+        return mBlockDims;
+    }
+
+    //! \return Number of blocks decompressed so far, not counting cache hits
+    size_t getNumBlocksDecompressed() const
+    {
+        return mNumBlocksDecompressed;
+    }
+
+private:
+    // Decompresses a range of blocks
+    class DecodeRunnable;
+
+    struct CachedBlock
+    {
+        std::vector<sys::ubyte> pixels;
+        std::list<size_t>::iterator recentPos;
+    };
+
+    // Dimensions of a block, which are smaller on the bottom and right edges
+    types::RowCol<size_t> getBlockDims(size_t blockIndex) const;
+
+    // Copies the part of a block inside the region into the region's buffer
+    void copyBlock(size_t blockIndex,
+                   const sys::ubyte* block,
+                   const Region& region,
+                   UByte* buffer) const;
+
+    void cacheBlock(size_t blockIndex, std::vector<sys::ubyte>& pixels);
+
+private:
+    XMLControlRegistry mXMLRegistry;
+    NITFReadControl mReadControl;
+    std::auto_ptr<MemoryMappedFile> mMappedFile;
+    const DerivedData* mData;
+    BlockDecompressor& mDecompressor;
+    const size_t mNumThreads;
+    const size_t mNumCachedBlocks;
+    types::RowCol<size_t> mImageDims;
+    types::RowCol<size_t> mBlockDims;
+    types::RowCol<size_t> mNumBlocks;
+    size_t mNumBlocksDecompressed;
+
+    // Most recently used block first
+    std::list<size_t> mRecentBlocks;
+    std::map<size_t, CachedBlock> mCache;
+};
+}
+}
+
+#endif
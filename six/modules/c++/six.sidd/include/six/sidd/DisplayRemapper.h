@@ -0,0 +1,190 @@
+/* =========================================================================
+ * This file is part of six.sidd-c++
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2018, MDA Information Systems LLC
+ *
+ * six.sidd-c++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __SIX_SIDD_DISPLAY_REMAPPER_H__
+#define __SIX_SIDD_DISPLAY_REMAPPER_H__
+
+#include <complex>
+#include <string>
+
+#include <types/RowCol.h>
+#include <six/PixelStatistics.h>
+#include <six/Types.h>
+#include <six/sidd/Display.h>
+
+namespace six
+{
+namespace sidd
+{
+/*!
+ * \class DisplayRemapper
+ * \brief Detects complex SICD pixels and remaps their amplitudes to SIDD
+ * display pixels.
+ *
+ * The supported remap types are
+ *   - Linear: min to max amplitude, linearly
+ *   - Log: min nonzero to max amplitude, logarithmically
+ *   - Density: the SIPS density remap, with its DMin and MMult parameters
+ *     defaulting to 30 and 40 and its clip points relative to the mean
+ *     amplitude.  Brighter (DMin 60), Darker (DMin 0) and High Contrast
+ *     (MMult 4) are its usual variations.
+ *   - PEDF: Density with the upper half of the range compressed by 2, so
+ *     that bright returns don't saturate
+ *
+ * Outputs are MONO8I, MONO8LU and RGB8LU, whose pixels are the 8-bit remap
+ * (the lookup table is applied at display time, see applyLUT()), and
+ * MONO16I, which is the same remap at 16-bit precision in native byte order.
+ *
+ * Usage is to accumulate the statistics over the whole image, then remap
+ * it.  Both steps can be called on row blocks, and split each call's rows
+ * across threads.  The statistics are SampleStatistics of the amplitudes,
+ * so they can also come from a PixelStatisticsCollector run over the SICD.
+ */
+class DisplayRemapper
+{
+public:
+    /*!
+     * \param remapType One of the remap types above.  Case, spaces and
+     * dashes are ignored.
+     * \param pixelType Output pixel type
+     * \param numThreads Number of threads to use
+     */
+    DisplayRemapper(const std::string& remapType,
+                    PixelType pixelType,
+                    size_t numThreads = 1);
+
+    /*!
+     * Sets up the remap a SIDD's Display describes: the pixel type, the
+     * MonochromeDisplayRemap's remap type and its DMin and MMult parameters,
+     * and the DRAHistogramOverrides clip points (see setClipPoints()).
+     * Color products and monochrome products without a remap type get a
+     * Density remap.
+     *
+     * \param display SIDD display metadata
+     * \param numThreads Number of threads to use
+     */
+    DisplayRemapper(const Display& display, size_t numThreads = 1);
+
+    //! \return Whether 'remapType' is supported
+    static bool isSupported(const std::string& remapType);
+
+    //! Sets the Density parameters.  Throws for other remap types.
+    void setDensityParameters(double dMin, double mMult);
+
+    /*!
+     * Stretches the 8-bit remapped values between the clip points to the
+     * full output range, as the ELT DRA does with Pmin and Pmax
+     *
+     * \param clipMin Remapped value that goes to 0
+     * \param clipMax Remapped value that goes to the maximum output
+     */
+    void setClipPoints(double clipMin, double clipMax);
+
+    //! Clears the statistics, to start on another image
+    void resetStatistics();
+
+    /*!
+     * Adds the amplitudes of rows of pixels to the statistics
+     *
+     * \param pixels Complex pixels
+     * \param dims Dimensions of 'pixels'
+     */
+    void accumulateStatistics(const std::complex<float>* pixels,
+                              const types::RowCol<size_t>& dims);
+
+    /*!
+     * Uses amplitude statistics that were gathered elsewhere.  The remaps
+     * only need the count, extrema, smallest positive value and mean.
+     */
+    void setStatistics(const SampleStatistics& statistics)
+    {
+        mStatistics = statistics;
+    }
+
+    //! \return Statistics of the pixel amplitudes
+    const SampleStatistics& getStatistics() const
+    {
+        return mStatistics;
+    }
+
+    PixelType getPixelType() const
+    {
+        return mPixelType;
+    }
+
+    /*!
+     * Remaps rows of pixels.  The statistics must already be accumulated.
+     *
+     * \param pixels Complex pixels
+     * \param dims Dimensions of 'pixels'
+     * \param[out] output Display pixels, dims.area() * bytes per pixel
+     */
+    void remap(const std::complex<float>* pixels,
+               const types::RowCol<size_t>& dims,
+               UByte* output) const;
+
+    /*!
+     * Looks up display values of 8-bit pixels
+     *
+     * \param lut Lookup table with an entry for every pixel value
+     * \param pixels 8-bit pixels
+     * \param numPixels Number of pixels
+     * \param[out] output lut.elementSize bytes per pixel
+     */
+    static void applyLUT(const LUT& lut,
+                         const UByte* pixels,
+                         size_t numPixels,
+                         UByte* output);
+
+private:
+    enum RemapType
+    {
+        LINEAR,
+        LOG,
+        DENSITY,
+        PEDF
+    };
+
+    class StatisticsRunnable;
+    class RemapRunnable;
+
+    void initialize(const std::string& remapType);
+
+    //! Remaps a run of pixels
+    void remapPixels(const std::complex<float>* pixels,
+                     size_t numPixels,
+                     UByte* output) const;
+
+private:
+    PixelType mPixelType;
+    size_t mNumThreads;
+    RemapType mRemapType;
+    double mDMin;
+    double mMMult;
+    double mClipMin;
+    double mClipMax;
+    SampleStatistics mStatistics;
+};
+}
+}
+
+#endif
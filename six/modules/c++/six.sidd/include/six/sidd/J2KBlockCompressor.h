@@ -0,0 +1,88 @@
+/* =========================================================================
+ * This file is part of six.sidd-c++
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2018, MDA Information Systems LLC
+ *
+ * six.sidd-c++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __SIX_SIDD_J2K_BLOCK_COMPRESSOR_H__
+#define __SIX_SIDD_J2K_BLOCK_COMPRESSOR_H__
+
+#include <six/sidd/BlockCompressor.h>
+#include <six/sidd/DerivedData.h>
+
+namespace six
+{
+namespace sidd
+{
+/*!
+ * \class J2KBlockCompressor
+ * \brief Compresses each NITF block as one tile of a single J2K codestream
+ * using OpenJPEG.
+ *
+ * The codestream's main header is prepended to the first block and the EOC
+ * marker appended to the last, so the blocks written back to back form the
+ * C8 image data of a tiled J2K NITF.  Each call to compress() sets up its own
+ * OpenJPEG codec, so blocks can be compressed concurrently.  This relies on
+ * the patched OpenJPEG that ships with the j2k driver, which allows writing
+ * any single tile.
+ *
+ * Only available if six.sidd is built with J2K enabled; otherwise the
+ * constructor throws.
+ */
+class J2KBlockCompressor : public BlockCompressor
+{
+public:
+    /*!
+     * \param data Representation of the derived data
+     * \param numRowsPerBlock The number of rows per block.  Defaults to no
+     * blocking.
+     * \param numColsPerBlock The number of columns per block.  Defaults to no
+     * blocking.
+     * \param byterate Compressed size as a fraction of the uncompressed
+     * size, in (0, 1).  0 compresses losslessly.
+     */
+    J2KBlockCompressor(const DerivedData& data,
+                       size_t numRowsPerBlock = 0,
+                       size_t numColsPerBlock = 0,
+                       double byterate = 0.0);
+
+    virtual void compress(const sys::ubyte* block,
+                          size_t blockIndex,
+                          const types::RowCol<size_t>& blockDims,
+                          std::vector<sys::ubyte>& compressed) const;
+
+    virtual bool isNumericallyLossless() const
+    {
+        return mByterate == 0.0;
+    }
+
+    //! \return Whether six.sidd was built with J2K support
+    static bool isAvailable();
+
+private:
+    const PixelType mPixelType;
+    const types::RowCol<size_t> mImageDims;
+    const types::RowCol<size_t> mBlockDims;
+    const size_t mNumBlocks;
+    const double mByterate;
+};
+}
+}
+
+#endif
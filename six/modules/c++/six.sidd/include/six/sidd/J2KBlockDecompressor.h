@@ -0,0 +1,93 @@
+/* =========================================================================
+ * This file is part of six.sidd-c++
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2018, MDA Information Systems LLC
+ *
+ * six.sidd-c++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __SIX_SIDD_J2K_BLOCK_DECOMPRESSOR_H__
+#define __SIX_SIDD_J2K_BLOCK_DECOMPRESSOR_H__
+
+#include <vector>
+
+#include <types/Range.h>
+#include <six/sidd/BlockDecompressor.h>
+
+namespace six
+{
+namespace sidd
+{
+/*!
+ * \class J2KBlockDecompressor
+ * \brief Decompresses the tiles of a tiled J2K codestream using OpenJPEG,
+ * where each NITF block is one J2K tile.
+ *
+ * load() walks the codestream's tile-part headers to find each tile's
+ * bytes without decoding anything.  Each call to decompress() then hands
+ * OpenJPEG just the main header and that tile's tile-parts, so tiles decode
+ * independently and concurrently.
+ *
+ * load() doesn't need OpenJPEG, but decompress() throws unless six.sidd is
+ * built with J2K enabled.
+ */
+class J2KBlockDecompressor : public BlockDecompressor
+{
+public:
+    J2KBlockDecompressor();
+
+    virtual void load(const DerivedData& data,
+                      const sys::ubyte* imageData,
+                      size_t numBytes,
+                      size_t numBlocks);
+
+    virtual void decompress(size_t blockIndex,
+                            const types::RowCol<size_t>& blockDims,
+                            sys::ubyte* block) const;
+
+    //! \return Number of bytes before the first tile-part, from load()
+    size_t getMainHeaderLength() const
+    {
+        return mMainHeaderLength;
+    }
+
+    /*!
+     * \param tile Tile index
+     *
+     * \return Byte ranges of the tile's tile-parts within the codestream,
+     * in the order they appear, from load()
+     */
+    const std::vector<types::Range>& getTileParts(size_t tile) const
+    {
+        return mTileParts.at(tile);
+    }
+
+    //! \return Whether six.sidd was built with J2K support
+    static bool isAvailable();
+
+private:
+    size_t mNumBytesPerPixel;
+    const sys::ubyte* mCodestream;
+    size_t mMainHeaderLength;
+
+    // Byte ranges of each tile's tile-parts
+    std::vector<std::vector<types::Range> > mTileParts;
+};
+}
+}
+
+#endif
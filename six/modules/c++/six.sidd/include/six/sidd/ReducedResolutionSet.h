@@ -0,0 +1,195 @@
+/* =========================================================================
+ * This file is part of six.sidd-c++
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2018, MDA Information Systems LLC
+ *
+ * six.sidd-c++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __SIX_SIDD_REDUCED_RESOLUTION_SET_H__
+#define __SIX_SIDD_REDUCED_RESOLUTION_SET_H__
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <mem/SharedPtr.h>
+#include <six/NITFReadControl.h>
+#include <six/Region.h>
+#include <six/XMLControlFactory.h>
+#include <six/sidd/DerivedData.h>
+
+namespace six
+{
+namespace sidd
+{
+/*
+ * Reduced resolution sets (R-sets) are overviews of a SIDD image, where
+ * level L is decimated by 2^L in each direction (level 0 is the full
+ * resolution image).  Each level is made from the one before it by
+ * averaging 2x2 boxes of pixels, except for pixel types with lookup tables,
+ * where averaging the indices would be meaningless, so the upper-left pixel
+ * is kept instead.
+ *
+ * Each level is stored as its own single image SIDD alongside the full
+ * resolution SIDD (see getRSetPathname()).  Its metadata describes the
+ * decimation with a GeometricChip, so it is a valid SIDD in its own right.
+ */
+
+/*!
+ * \param pathname Pathname of the full resolution SIDD
+ * \param imageNumber Index of the product image
+ * \param level Reduced resolution level
+ *
+ * \return Pathname of the SIDD that holds the level.  For example, level 2
+ * of image 0 of foo.nitf is foo.0.r2.nitf.  Level 0 is 'pathname' itself.
+ */
+std::string getRSetPathname(const std::string& pathname,
+                            size_t imageNumber,
+                            size_t level);
+
+/*!
+ * Creates the metadata of a reduced resolution level, with the image size,
+ * GeometricChip, and pixel footprint updated
+ *
+ * \param data Metadata of the full resolution image
+ * \param level Reduced resolution level
+ *
+ * \return Metadata of the reduced resolution image
+ */
+std::auto_ptr<DerivedData> createReducedData(const DerivedData& data,
+                                             size_t level);
+
+/*!
+ * Halves the resolution of an image
+ *
+ * \param data Metadata of the input image
+ * \param input The input image in native byte order
+ * \param[out] output The output image, with dimensions rounded up from half
+ * of the input's, in native byte order
+ */
+void halveResolution(const DerivedData& data,
+                     const UByte* input,
+                     UByte* output);
+
+/*!
+ * Writes the reduced resolution levels of a SIDD image.  Call this alongside
+ * writing the full resolution SIDD.
+ *
+ * \param data Metadata of the full resolution image
+ * \param imageData The full resolution image in native byte order
+ * \param pathname Pathname of the full resolution SIDD
+ * \param schemaPaths Directories or files of schema locations
+ * \param numLevels Number of reduced levels to write, not counting level 0
+ * \param imageNumber Index of the product image in the full resolution SIDD
+ * \param numRowsPerBlock The number of rows per block.  Defaults to no
+ * blocking.
+ * \param numColsPerBlock The number of columns per block.  Defaults to no
+ * blocking.
+ */
+void writeRSet(const DerivedData& data,
+               const UByte* imageData,
+               const std::string& pathname,
+               const std::vector<std::string>& schemaPaths,
+               size_t numLevels,
+               size_t imageNumber = 0,
+               size_t numRowsPerBlock = 0,
+               size_t numColsPerBlock = 0);
+
+/*!
+ * \class RSetReader
+ * \brief Reads a SIDD at any of the reduced resolution levels that were
+ * written with writeRSet()
+ */
+class RSetReader
+{
+public:
+    /*!
+     * Loads the full resolution SIDD and whatever levels exist beside it
+     *
+     * \param pathname Pathname of the full resolution SIDD
+     * \param schemaPaths Directories or files of schema locations
+     */
+    RSetReader(const std::string& pathname,
+               const std::vector<std::string>& schemaPaths);
+
+    //! \return Number of product images
+    size_t getNumImages() const
+    {
+        return mLevels.size();
+    }
+
+    /*!
+     * \param imageNumber Index of the product image
+     *
+     * \return Number of levels available for the image, including level 0
+     */
+    size_t getNumLevels(size_t imageNumber) const
+    {
+        return mLevels.at(imageNumber).size();
+    }
+
+    /*!
+     * \param imageNumber Index of the product image
+     * \param level Reduced resolution level
+     *
+     * \return The level's metadata
+     */
+    const DerivedData& getDerivedData(size_t imageNumber, size_t level) const;
+
+    /*!
+     * Picks the level to serve a zoomed out view from
+     *
+     * \param imageNumber Index of the product image
+     * \param decimation Number of full resolution pixels per displayed pixel
+     *
+     * \return The coarsest available level that is at least as fine as
+     * 'decimation'
+     */
+    size_t getLevel(size_t imageNumber, double decimation) const;
+
+    /*!
+     * Read section of image data specified by region from one level
+     *
+     * \param region Rows and columns of the level to read (see
+     * NITFReadControl::interleaved())
+     * \param imageNumber Index of the product image
+     * \param level Reduced resolution level
+     *
+     * \return Buffer of image data in native byte order (see
+     * NITFReadControl::interleaved())
+     */
+    UByte* interleaved(Region& region, size_t imageNumber, size_t level);
+
+private:
+    struct Level
+    {
+        mem::SharedPtr<NITFReadControl> reader;
+        size_t imageNumber;
+        const DerivedData* data;
+    };
+
+    const Level& getLevelInfo(size_t imageNumber, size_t level) const;
+
+private:
+    XMLControlRegistry mXMLRegistry;
+    std::vector<std::vector<Level> > mLevels;
+};
+}
+}
+
+#endif
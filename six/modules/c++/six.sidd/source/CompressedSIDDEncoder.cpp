@@ -0,0 +1,240 @@
+/* =========================================================================
+ * This file is part of six.sidd-c++
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2018, MDA Information Systems LLC
+ *
+ * six.sidd-c++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <string.h>
+
+#include <algorithm>
+
+#include <except/Exception.h>
+#include <math/Round.h>
+#include <mt/ThreadGroup.h>
+#include <mt/ThreadPlanner.h>
+#include <sys/Runnable.h>
+#include <six/sidd/CompressedSIDDEncoder.h>
+
+namespace
+{
+types::RowCol<size_t> getBlockDims(const types::RowCol<size_t>& imageDims,
+                                   size_t numRowsPerBlock,
+                                   size_t numColsPerBlock)
+{
+    // 0 means no blocking in that direction
+    return types::RowCol<size_t>(
+            (numRowsPerBlock == 0) ?
+                    imageDims.row : std::min(numRowsPerBlock, imageDims.row),
+            (numColsPerBlock == 0) ?
+                    imageDims.col : std::min(numColsPerBlock, imageDims.col));
+}
+
+types::RowCol<size_t> countBlocks(const types::RowCol<size_t>& imageDims,
+                                  const types::RowCol<size_t>& blockDims)
+{
+    return types::RowCol<size_t>(
+            math::ceilingDivide(imageDims.row, blockDims.row),
+            math::ceilingDivide(imageDims.col, blockDims.col));
+}
+}
+
+namespace six
+{
+namespace sidd
+{
+class CompressedSIDDEncoder::EncodeRunnable : public sys::Runnable
+{
+public:
+    EncodeRunnable(const CompressedSIDDEncoder& encoder,
+                   const sys::ubyte* imageData,
+                   size_t firstBlock,
+                   size_t numBlocks,
+                   std::vector<std::vector<sys::ubyte> >& compressedBlocks) :
+        mEncoder(encoder),
+        mImageData(imageData),
+        mFirstBlock(firstBlock),
+        mNumBlocks(numBlocks),
+        mCompressedBlocks(compressedBlocks)
+    {
+    }
+
+    virtual void run()
+    {
+        const size_t pixelBytes = mEncoder.mData.getNumBytesPerPixel();
+        const size_t imageRowBytes = mEncoder.mImageDims.col * pixelBytes;
+        const types::RowCol<size_t>& blockDims(mEncoder.mBlockDims);
+
+        for (size_t block = mFirstBlock;
+             block < mFirstBlock + mNumBlocks;
+             ++block)
+        {
+            const types::RowCol<size_t> blockIdx(
+                    block / mEncoder.mNumBlocks.col,
+                    block % mEncoder.mNumBlocks.col);
+            const types::RowCol<size_t> offset(blockIdx.row * blockDims.row,
+                                               blockIdx.col * blockDims.col);
+            const types::RowCol<size_t> dims(
+                    std::min(blockDims.row,
+                             mEncoder.mImageDims.row - offset.row),
+                    std::min(blockDims.col,
+                             mEncoder.mImageDims.col - offset.col));
+
+            const sys::ubyte* const blockStart = mImageData +
+                    offset.row * imageRowBytes + offset.col * pixelBytes;
+
+            // Full width blocks are already contiguous.  Otherwise, gather
+            // the block's rows.
+            const sys::ubyte* blockData;
+            if (dims.col == mEncoder.mImageDims.col)
+            {
+                blockData = blockStart;
+            }
+            else
+            {
+                const size_t blockRowBytes = dims.col * pixelBytes;
+                mScratch.resize(dims.row * blockRowBytes);
+                for (size_t row = 0; row < dims.row; ++row)
+                {
+                    ::memcpy(&mScratch[row * blockRowBytes],
+                             blockStart + row * imageRowBytes,
+                             blockRowBytes);
+                }
+                blockData = &mScratch[0];
+            }
+
+            mEncoder.mCompressor.compress(blockData, block, dims,
+                                          mCompressedBlocks[block]);
+        }
+    }
+
+private:
+    const CompressedSIDDEncoder& mEncoder;
+    const sys::ubyte* const mImageData;
+    const size_t mFirstBlock;
+    const size_t mNumBlocks;
+    std::vector<std::vector<sys::ubyte> >& mCompressedBlocks;
+    std::vector<sys::ubyte> mScratch;
+};
+
+CompressedSIDDEncoder::CompressedSIDDEncoder(const DerivedData& data,
+                                             const BlockCompressor& compressor,
+                                             size_t numRowsPerBlock,
+                                             size_t numColsPerBlock,
+                                             size_t numThreads) :
+    mData(data),
+    mCompressor(compressor),
+    mNumThreads(std::max<size_t>(numThreads, 1)),
+    mImageDims(data.getNumRows(), data.getNumCols()),
+    mBlockDims(getBlockDims(mImageDims, numRowsPerBlock, numColsPerBlock)),
+    mNumBlocks(countBlocks(mImageDims, mBlockDims))
+{
+    if (mImageDims.area() == 0)
+    {
+        throw except::Exception(Ctxt("Cannot encode an empty image"));
+    }
+}
+
+void CompressedSIDDEncoder::encode(const sys::ubyte* imageData)
+{
+    const size_t numBlocks = mNumBlocks.area();
+    std::vector<std::vector<sys::ubyte> > compressedBlocks(numBlocks);
+
+    const mt::ThreadPlanner planner(numBlocks, mNumThreads);
+    if (planner.getNumThreadsThatWillBeUsed() <= 1)
+    {
+        EncodeRunnable(*this, imageData, 0, numBlocks, compressedBlocks).run();
+    }
+    else
+    {
+        mt::ThreadGroup threads;
+        size_t threadNum(0);
+        size_t firstBlock(0);
+        size_t numBlocksThisThread(0);
+        while (planner.getThreadInfo(threadNum++, firstBlock,
+                                     numBlocksThisThread))
+        {
+            threads.createThread(new EncodeRunnable(
+                    *this, imageData, firstBlock, numBlocksThisThread,
+                    compressedBlocks));
+        }
+        threads.joinAll();
+    }
+
+    // Lay the blocks out the way the byte provider wants them
+    mBytesPerBlock.assign(1, std::vector<size_t>(numBlocks));
+    size_t numBytes(0);
+    for (size_t block = 0; block < numBlocks; ++block)
+    {
+        mBytesPerBlock[0][block] = compressedBlocks[block].size();
+        numBytes += compressedBlocks[block].size();
+    }
+
+    mCompressedData.resize(numBytes);
+    sys::ubyte* dest = numBytes ? &mCompressedData[0] : NULL;
+    for (size_t block = 0; block < numBlocks; ++block)
+    {
+        std::vector<sys::ubyte>& compressed(compressedBlocks[block]);
+        if (!compressed.empty())
+        {
+            ::memcpy(dest, &compressed[0], compressed.size());
+            dest += compressed.size();
+        }
+
+        // Give the memory back as we go
+        std::vector<sys::ubyte>().swap(compressed);
+    }
+}
+
+std::auto_ptr<CompressedSIDDByteProvider>
+CompressedSIDDEncoder::createByteProvider(
+        const std::vector<std::string>& schemaPaths) const
+{
+    if (mBytesPerBlock.empty())
+    {
+        throw except::Exception(Ctxt(
+                "encode() must be called before creating a byte provider"));
+    }
+
+    // Unblocked directions are passed through as 0 so the NITF isn't
+    // marked as blocked unnecessarily
+    const size_t numRowsPerBlock =
+            (mNumBlocks.row > 1) ? mBlockDims.row : 0;
+    const size_t numColsPerBlock =
+            (mNumBlocks.col > 1) ? mBlockDims.col : 0;
+
+    // Segmentation is computed as if the image were uncompressed (and
+    // padded out to whole blocks), so make room for all of that in the one
+    // segment allowed
+    const sys::Uint64_T paddedSize =
+            static_cast<sys::Uint64_T>(mNumBlocks.row * mBlockDims.row) *
+            mNumBlocks.col * mBlockDims.col * mData.getNumBytesPerPixel();
+    const size_t maxProductSize = static_cast<size_t>(
+            std::min<sys::Uint64_T>(paddedSize, Constants::IS_SIZE_MAX));
+
+    return std::auto_ptr<CompressedSIDDByteProvider>(
+            new CompressedSIDDByteProvider(mData,
+                                           schemaPaths,
+                                           mBytesPerBlock,
+                                           mCompressor.isNumericallyLossless(),
+                                           numRowsPerBlock,
+                                           numColsPerBlock,
+                                           maxProductSize));
+}
+}
+}
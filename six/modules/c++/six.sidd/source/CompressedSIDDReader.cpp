@@ -0,0 +1,341 @@
+/* =========================================================================
+ * This file is part of six.sidd-c++
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2018, MDA Information Systems LLC
+ *
+ * six.sidd-c++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <string.h>
+
+#include <algorithm>
+
+#include <except/Exception.h>
+#include <math/Round.h>
+#include <mt/ThreadGroup.h>
+#include <mt/ThreadPlanner.h>
+#include <str/Convert.h>
+#include <str/Manip.h>
+#include <sys/Runnable.h>
+#include <six/sidd/CompressedSIDDReader.h>
+#include <six/sidd/DerivedXMLControl.h>
+
+namespace
+{
+// 0 means the block is the whole image in that direction
+size_t getBlockSize(size_t numPixelsPerBlock, size_t imageSize)
+{
+    return (numPixelsPerBlock == 0) ?
+            imageSize : std::min(numPixelsPerBlock, imageSize);
+}
+}
+
+namespace six
+{
+namespace sidd
+{
+class CompressedSIDDReader::DecodeRunnable : public sys::Runnable
+{
+public:
+    DecodeRunnable(const CompressedSIDDReader& reader,
+                   const Region& region,
+                   UByte* buffer,
+                   const std::vector<size_t>& blocks,
+                   size_t firstBlock,
+                   size_t numBlocks,
+                   size_t firstToKeep,
+                   std::vector<std::vector<sys::ubyte> >& decoded) :
+        mReader(reader),
+        mRegion(region),
+        mBuffer(buffer),
+        mBlocks(blocks),
+        mFirstBlock(firstBlock),
+        mNumBlocks(numBlocks),
+        mFirstToKeep(firstToKeep),
+        mDecoded(decoded)
+    {
+    }
+
+    virtual void run()
+    {
+        // Blocks that won't be cached share one scratch block, so memory
+        // doesn't grow with the size of the region
+        const size_t pixelBytes = mReader.mData->getNumBytesPerPixel();
+        std::vector<sys::ubyte> scratch;
+        for (size_t ii = mFirstBlock; ii < mFirstBlock + mNumBlocks; ++ii)
+        {
+            const size_t blockIndex = mBlocks[ii];
+            const types::RowCol<size_t> dims =
+                    mReader.getBlockDims(blockIndex);
+
+            std::vector<sys::ubyte>& pixels((ii < mFirstToKeep) ?
+                    scratch : mDecoded[ii - mFirstToKeep]);
+            pixels.resize(dims.area() * pixelBytes);
+            mReader.mDecompressor.decompress(blockIndex, dims, &pixels[0]);
+            mReader.copyBlock(blockIndex, &pixels[0], mRegion, mBuffer);
+        }
+    }
+
+private:
+    const CompressedSIDDReader& mReader;
+    const Region& mRegion;
+    UByte* const mBuffer;
+    const std::vector<size_t>& mBlocks;
+    const size_t mFirstBlock;
+    const size_t mNumBlocks;
+    const size_t mFirstToKeep;
+    std::vector<std::vector<sys::ubyte> >& mDecoded;
+};
+
+CompressedSIDDReader::CompressedSIDDReader(
+        const std::string& pathname,
+        const std::vector<std::string>& schemaPaths,
+        BlockDecompressor& decompressor,
+        size_t imageNumber,
+        size_t numThreads,
+        size_t numCachedBlocks) :
+    mData(NULL),
+    mDecompressor(decompressor),
+    mNumThreads(std::max<size_t>(numThreads, 1)),
+    mNumCachedBlocks(numCachedBlocks),
+    mNumBlocksDecompressed(0)
+{
+    mXMLRegistry.addCreator(DataType::DERIVED,
+                            new XMLControlCreatorT<DerivedXMLControl>());
+    mReadControl.setXMLControlRegistry(&mXMLRegistry);
+    mReadControl.load(pathname, schemaPaths);
+
+    mem::SharedPtr<const Container> container =
+            mReadControl.getContainer();
+    if (container->getDataType() != DataType::DERIVED ||
+        imageNumber >= container->getNumData())
+    {
+        throw except::Exception(Ctxt(pathname + " has no SIDD image " +
+                str::toString(imageNumber)));
+    }
+    mData = static_cast<const DerivedData*>(container->getData(imageNumber));
+    mImageDims = types::RowCol<size_t>(mData->getNumRows(),
+                                       mData->getNumCols());
+
+    if (mReadControl.getImageSegments(imageNumber).size() != 1)
+    {
+        throw except::Exception(Ctxt(
+                "Compressed SIDD images must be a single image segment"));
+    }
+    nitf::ImageSegment segment = mReadControl.getRecord().getImages()[
+            mReadControl.getStartIndex(imageNumber)];
+    nitf::ImageSubheader subheader = segment.getSubheader();
+
+    std::string compression = subheader.getImageCompression().toString();
+    str::trim(compression);
+    if (compression != "C8")
+    {
+        throw except::Exception(Ctxt(
+                "Expected a C8 compressed image but got IC " + compression));
+    }
+
+    mBlockDims = types::RowCol<size_t>(
+            getBlockSize(static_cast<nitf::Uint32>(
+                                 subheader.getNumPixelsPerVertBlock()),
+                         mImageDims.row),
+            getBlockSize(static_cast<nitf::Uint32>(
+                                 subheader.getNumPixelsPerHorizBlock()),
+                         mImageDims.col));
+    mNumBlocks = types::RowCol<size_t>(
+            math::ceilingDivide(mImageDims.row, mBlockDims.row),
+            math::ceilingDivide(mImageDims.col, mBlockDims.col));
+
+    // Hand the decompressor the segment's bytes straight from the file
+    mMappedFile.reset(new MemoryMappedFile(pathname));
+    const sys::Uint64_T offset = segment.getImageOffset();
+    const sys::Uint64_T end = segment.getImageEnd();
+    if (end < offset || end > mMappedFile->getSize())
+    {
+        throw except::Exception(Ctxt(pathname + " is truncated"));
+    }
+    mDecompressor.load(*mData,
+                       mMappedFile->getData() + offset,
+                       static_cast<size_t>(end - offset),
+                       mNumBlocks.area());
+}
+
+UByte* CompressedSIDDReader::interleaved(Region& region)
+{
+    if (region.getNumRows() == -1)
+    {
+        region.setNumRows(mImageDims.row);
+    }
+    if (region.getNumCols() == -1)
+    {
+        region.setNumCols(mImageDims.col);
+    }
+
+    const size_t startRow = region.getStartRow();
+    const size_t startCol = region.getStartCol();
+    const size_t numRows = region.getNumRows();
+    const size_t numCols = region.getNumCols();
+    if (startRow > mImageDims.row || numRows > mImageDims.row - startRow ||
+        startCol > mImageDims.col || numCols > mImageDims.col - startCol)
+    {
+        throw except::Exception(Ctxt("Region is outside of the image"));
+    }
+
+    UByte* buffer = region.getBuffer();
+    if (buffer == NULL)
+    {
+        buffer = new UByte[numRows * numCols * mData->getNumBytesPerPixel()];
+        region.setBuffer(buffer);
+    }
+    if (numRows == 0 || numCols == 0)
+    {
+        return buffer;
+    }
+
+    // Copy out what's already cached and gather up the rest
+    const size_t firstBlockRow = startRow / mBlockDims.row;
+    const size_t lastBlockRow = (startRow + numRows - 1) / mBlockDims.row;
+    const size_t firstBlockCol = startCol / mBlockDims.col;
+    const size_t lastBlockCol = (startCol + numCols - 1) / mBlockDims.col;
+
+    std::vector<size_t> blocksToDecode;
+    for (size_t blockRow = firstBlockRow; blockRow <= lastBlockRow; ++blockRow)
+    {
+        for (size_t blockCol = firstBlockCol;
+             blockCol <= lastBlockCol;
+             ++blockCol)
+        {
+            const size_t blockIndex = blockRow * mNumBlocks.col + blockCol;
+            const std::map<size_t, CachedBlock>::iterator iter =
+                    mCache.find(blockIndex);
+            if (iter == mCache.end())
+            {
+                blocksToDecode.push_back(blockIndex);
+            }
+            else
+            {
+                copyBlock(blockIndex, &iter->second.pixels[0], region, buffer);
+                mRecentBlocks.splice(mRecentBlocks.begin(),
+                                     mRecentBlocks,
+                                     iter->second.recentPos);
+            }
+        }
+    }
+
+    // Only the last blocks decoded would stay in the cache, so only those
+    // are kept
+    const size_t numToDecode = blocksToDecode.size();
+    const size_t firstToKeep = (numToDecode > mNumCachedBlocks) ?
+            numToDecode - mNumCachedBlocks : 0;
+    std::vector<std::vector<sys::ubyte> > decoded(numToDecode - firstToKeep);
+    const mt::ThreadPlanner planner(numToDecode, mNumThreads);
+    if (planner.getNumThreadsThatWillBeUsed() <= 1)
+    {
+        DecodeRunnable(*this, region, buffer, blocksToDecode, 0, numToDecode,
+                       firstToKeep, decoded).run();
+    }
+    else
+    {
+        mt::ThreadGroup threads;
+        size_t threadNum(0);
+        size_t firstBlock(0);
+        size_t numBlocksThisThread(0);
+        while (planner.getThreadInfo(threadNum++, firstBlock,
+                                     numBlocksThisThread))
+        {
+            threads.createThread(new DecodeRunnable(
+                    *this, region, buffer, blocksToDecode, firstBlock,
+                    numBlocksThisThread, firstToKeep, decoded));
+        }
+        threads.joinAll();
+    }
+    mNumBlocksDecompressed += numToDecode;
+
+    for (size_t ii = firstToKeep; ii < numToDecode; ++ii)
+    {
+        cacheBlock(blocksToDecode[ii], decoded[ii - firstToKeep]);
+    }
+
+    return buffer;
+}
+
+types::RowCol<size_t>
+CompressedSIDDReader::getBlockDims(size_t blockIndex) const
+{
+    const size_t firstRow = (blockIndex / mNumBlocks.col) * mBlockDims.row;
+    const size_t firstCol = (blockIndex % mNumBlocks.col) * mBlockDims.col;
+    return types::RowCol<size_t>(
+            std::min(mBlockDims.row, mImageDims.row - firstRow),
+            std::min(mBlockDims.col, mImageDims.col - firstCol));
+}
+
+void CompressedSIDDReader::copyBlock(size_t blockIndex,
+                                     const sys::ubyte* block,
+                                     const Region& region,
+                                     UByte* buffer) const
+{
+    const size_t pixelBytes = mData->getNumBytesPerPixel();
+    const types::RowCol<size_t> dims = getBlockDims(blockIndex);
+    const size_t blockFirstRow =
+            (blockIndex / mNumBlocks.col) * mBlockDims.row;
+    const size_t blockFirstCol =
+            (blockIndex % mNumBlocks.col) * mBlockDims.col;
+
+    const size_t regionFirstRow = region.getStartRow();
+    const size_t regionFirstCol = region.getStartCol();
+    const size_t regionNumCols = region.getNumCols();
+
+    // The overlap of the block and the region, in image coordinates
+    const size_t firstRow = std::max(blockFirstRow, regionFirstRow);
+    const size_t endRow = std::min<size_t>(blockFirstRow + dims.row,
+            regionFirstRow + region.getNumRows());
+    const size_t firstCol = std::max(blockFirstCol, regionFirstCol);
+    const size_t endCol = std::min<size_t>(blockFirstCol + dims.col,
+            regionFirstCol + regionNumCols);
+    const size_t rowBytes = (endCol - firstCol) * pixelBytes;
+
+    for (size_t row = firstRow; row < endRow; ++row)
+    {
+        ::memcpy(buffer + ((row - regionFirstRow) * regionNumCols +
+                           (firstCol - regionFirstCol)) * pixelBytes,
+                 block + ((row - blockFirstRow) * dims.col +
+                          (firstCol - blockFirstCol)) * pixelBytes,
+                 rowBytes);
+    }
+}
+
+void CompressedSIDDReader::cacheBlock(size_t blockIndex,
+                                      std::vector<sys::ubyte>& pixels)
+{
+    if (mNumCachedBlocks == 0)
+    {
+        return;
+    }
+
+    // Make room by dropping the least recently used blocks
+    while (mCache.size() >= mNumCachedBlocks)
+    {
+        mCache.erase(mRecentBlocks.back());
+        mRecentBlocks.pop_back();
+    }
+
+    mRecentBlocks.push_front(blockIndex);
+    CachedBlock& cached(mCache[blockIndex]);
+    cached.pixels.swap(pixels);
+    cached.recentPos = mRecentBlocks.begin();
+}
+}
+}
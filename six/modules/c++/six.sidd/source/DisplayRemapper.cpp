@@ -0,0 +1,819 @@
+/* =========================================================================
+ * This file is part of six.sidd-c++
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2018, MDA Information Systems LLC
+ *
+ * six.sidd-c++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#include <except/Exception.h>
+#include <mt/ThreadGroup.h>
+#include <mt/ThreadPlanner.h>
+#include <str/Convert.h>
+#include <str/Manip.h>
+#include <sys/Runnable.h>
+#include <six/Init.h>
+#include <six/sidd/DisplayRemapper.h>
+
+// As in ByteSwap.cpp, GCC and Clang compile the SSE2 kernels with a target
+// attribute and we check for SSE2 at runtime.  Otherwise we can only count
+// on it for 64-bit MSVC builds.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SIX_SIMD_X86_GNU
+#define SIX_SIMD_TARGET(isa) __attribute__((target(isa)))
+#include <immintrin.h>
+#elif defined(_MSC_VER) && defined(_M_X64)
+#define SIX_SIMD_X86_MSVC
+#define SIX_SIMD_TARGET(isa)
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+// Pixels are detected and remapped this many at a time so that the
+// intermediate values stay in cache
+const size_t CHUNK_SIZE = 1024;
+
+// Amplitudes below this are all at the bottom of the Density remap
+const double DENSITY_MIN_AMPLITUDE = 1e-5;
+
+bool detectSSE2()
+{
+#if defined(SIX_SIMD_X86_GNU)
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse2") != 0;
+#elif defined(SIX_SIMD_X86_MSVC)
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool haveSSE2()
+{
+    // Detecting this more than once in a race is harmless
+    static const bool sse2 = detectSSE2();
+    return sse2;
+}
+
+void detectPowerScalar(const std::complex<float>* pixels,
+                       size_t numPixels,
+                       float* power)
+{
+    const float* const iq = reinterpret_cast<const float*>(pixels);
+    for (size_t ii = 0; ii < numPixels; ++ii)
+    {
+        power[ii] = iq[2 * ii] * iq[2 * ii] + iq[2 * ii + 1] * iq[2 * ii + 1];
+    }
+}
+
+void remapLinearScalar(float* values, size_t numValues, float gain,
+                       float offset)
+{
+    for (size_t ii = 0; ii < numValues; ++ii)
+    {
+        values[ii] = ::sqrtf(values[ii]) * gain + offset;
+    }
+}
+
+void remapLogScalar(float* values, size_t numValues, float minPower,
+                    float gain, float offset)
+{
+    for (size_t ii = 0; ii < numValues; ++ii)
+    {
+        values[ii] = ::logf(std::max(values[ii], minPower)) * gain + offset;
+    }
+}
+
+// Halves the distance above the middle of the 8-bit scale, then stretches
+void compressPEDFScalar(float* values, size_t numValues, float stretch,
+                        float shift)
+{
+    for (size_t ii = 0; ii < numValues; ++ii)
+    {
+        const float value = std::min(values[ii], 0.5f * (values[ii] + 127.5f));
+        values[ii] = value * stretch + shift;
+    }
+}
+
+template <typename T>
+void quantizeScalar(const float* values, size_t numValues, float maxValue,
+                    T* output)
+{
+    for (size_t ii = 0; ii < numValues; ++ii)
+    {
+        const float value = std::min(std::max(values[ii], 0.0f), maxValue);
+        output[ii] = static_cast<T>(value + 0.5f);
+    }
+}
+
+#if defined(SIX_SIMD_X86_GNU) || defined(SIX_SIMD_X86_MSVC)
+SIX_SIMD_TARGET("sse2")
+void detectPowerSSE2(const std::complex<float>* pixels,
+                     size_t numPixels,
+                     float* power)
+{
+    const float* const iq = reinterpret_cast<const float*>(pixels);
+    size_t ii = 0;
+    for (; ii + 4 <= numPixels; ii += 4)
+    {
+        // Square two pixels per register, then add the I's to the Q's
+        const __m128 first = _mm_loadu_ps(iq + 2 * ii);
+        const __m128 second = _mm_loadu_ps(iq + 2 * ii + 4);
+        const __m128 firstSquared = _mm_mul_ps(first, first);
+        const __m128 secondSquared = _mm_mul_ps(second, second);
+        _mm_storeu_ps(power + ii, _mm_add_ps(
+                _mm_shuffle_ps(firstSquared, secondSquared,
+                               _MM_SHUFFLE(2, 0, 2, 0)),
+                _mm_shuffle_ps(firstSquared, secondSquared,
+                               _MM_SHUFFLE(3, 1, 3, 1))));
+    }
+
+    detectPowerScalar(pixels + ii, numPixels - ii, power + ii);
+}
+
+// Natural log of positive, normal floats, to within an ulp.  This is the
+// Cephes logf: split off the exponent, then a polynomial in the
+// mantissa.
+SIX_SIMD_TARGET("sse2")
+inline __m128 logSSE2(__m128 x)
+{
+    static const float COEFFICIENTS[] = {
+            7.0376836292E-2f, -1.1514610310E-1f, 1.1676998740E-1f,
+            -1.2420140846E-1f, 1.4249322787E-1f, -1.6668057665E-1f,
+            2.0000714765E-1f, -2.4999993993E-1f, 3.3333331174E-1f};
+    const __m128 one = _mm_set1_ps(1.0f);
+
+    // x = mantissa * 2^exponent, with the mantissa in [0.5, 1)
+    const __m128i exponentBits = _mm_sub_epi32(
+            _mm_srli_epi32(_mm_castps_si128(x), 23), _mm_set1_epi32(126));
+    __m128 exponent = _mm_cvtepi32_ps(exponentBits);
+    __m128 mantissa = _mm_or_ps(
+            _mm_and_ps(x, _mm_castsi128_ps(_mm_set1_epi32(0x007FFFFF))),
+            _mm_set1_ps(0.5f));
+
+    // Then move the mantissa to [sqrt(1/2), sqrt(2)) and subtract 1
+    const __m128 isSmall =
+            _mm_cmplt_ps(mantissa, _mm_set1_ps(0.707106781186547524f));
+    exponent = _mm_sub_ps(exponent, _mm_and_ps(one, isSmall));
+    mantissa = _mm_add_ps(_mm_sub_ps(mantissa, one),
+                          _mm_and_ps(mantissa, isSmall));
+
+    const __m128 squared = _mm_mul_ps(mantissa, mantissa);
+    __m128 poly = _mm_set1_ps(COEFFICIENTS[0]);
+    for (size_t ii = 1; ii < sizeof(COEFFICIENTS) / sizeof(float); ++ii)
+    {
+        poly = _mm_add_ps(_mm_mul_ps(poly, mantissa),
+                          _mm_set1_ps(COEFFICIENTS[ii]));
+    }
+    poly = _mm_mul_ps(_mm_mul_ps(poly, mantissa), squared);
+
+    // log(2) is split in two so that exponent * log(2) stays exact
+    poly = _mm_add_ps(poly,
+                      _mm_mul_ps(exponent, _mm_set1_ps(-2.12194440E-4f)));
+    poly = _mm_sub_ps(poly, _mm_mul_ps(squared, _mm_set1_ps(0.5f)));
+    return _mm_add_ps(_mm_add_ps(mantissa, poly),
+                      _mm_mul_ps(exponent, _mm_set1_ps(0.693359375f)));
+}
+
+SIX_SIMD_TARGET("sse2")
+void remapLinearSSE2(float* values, size_t numValues, float gain,
+                     float offset)
+{
+    const __m128 gainV = _mm_set1_ps(gain);
+    const __m128 offsetV = _mm_set1_ps(offset);
+    size_t ii = 0;
+    for (; ii + 4 <= numValues; ii += 4)
+    {
+        const __m128 value = _mm_sqrt_ps(_mm_loadu_ps(values + ii));
+        _mm_storeu_ps(values + ii,
+                      _mm_add_ps(_mm_mul_ps(value, gainV), offsetV));
+    }
+
+    remapLinearScalar(values + ii, numValues - ii, gain, offset);
+}
+
+SIX_SIMD_TARGET("sse2")
+inline __m128 remapLogSSE2(__m128 value, __m128 minPower, __m128 gain,
+                           __m128 offset)
+{
+    return _mm_add_ps(
+            _mm_mul_ps(logSSE2(_mm_max_ps(value, minPower)), gain), offset);
+}
+
+// logSSE2() doesn't round exactly like logf(), so the leftover values go
+// through it too, padded out to a full register.  That way a pixel always
+// remaps to the same value, wherever it lands in a chunk.
+SIX_SIMD_TARGET("sse2")
+void remapLogSSE2(float* values, size_t numValues, float minPower,
+                  float gain, float offset)
+{
+    const __m128 minPowerV = _mm_set1_ps(minPower);
+    const __m128 gainV = _mm_set1_ps(gain);
+    const __m128 offsetV = _mm_set1_ps(offset);
+    size_t ii = 0;
+    for (; ii + 4 <= numValues; ii += 4)
+    {
+        _mm_storeu_ps(values + ii, remapLogSSE2(_mm_loadu_ps(values + ii),
+                                                minPowerV, gainV, offsetV));
+    }
+
+    if (ii < numValues)
+    {
+        float leftover[4] = {0, 0, 0, 0};
+        std::copy(values + ii, values + numValues, leftover);
+        _mm_storeu_ps(leftover, remapLogSSE2(_mm_loadu_ps(leftover),
+                                             minPowerV, gainV, offsetV));
+        std::copy(leftover, leftover + numValues - ii, values + ii);
+    }
+}
+
+SIX_SIMD_TARGET("sse2")
+void compressPEDFSSE2(float* values, size_t numValues, float stretch,
+                      float shift)
+{
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 middle = _mm_set1_ps(127.5f);
+    const __m128 stretchV = _mm_set1_ps(stretch);
+    const __m128 shiftV = _mm_set1_ps(shift);
+    size_t ii = 0;
+    for (; ii + 4 <= numValues; ii += 4)
+    {
+        const __m128 value = _mm_loadu_ps(values + ii);
+        const __m128 compressed = _mm_min_ps(
+                value, _mm_mul_ps(half, _mm_add_ps(value, middle)));
+        _mm_storeu_ps(values + ii,
+                      _mm_add_ps(_mm_mul_ps(compressed, stretchV), shiftV));
+    }
+
+    compressPEDFScalar(values + ii, numValues - ii, stretch, shift);
+}
+
+// Clamps to [0, maxValue] and rounds, like quantizeScalar()
+SIX_SIMD_TARGET("sse2")
+inline __m128i roundSSE2(const float* values, __m128 maxValue)
+{
+    const __m128 value = _mm_min_ps(
+            _mm_max_ps(_mm_loadu_ps(values), _mm_setzero_ps()), maxValue);
+    return _mm_cvttps_epi32(_mm_add_ps(value, _mm_set1_ps(0.5f)));
+}
+
+SIX_SIMD_TARGET("sse2")
+void quantizeSSE2(const float* values, size_t numValues, float maxValue,
+                  sys::Uint8_T* output)
+{
+    const __m128 maxValueV = _mm_set1_ps(maxValue);
+    size_t ii = 0;
+    for (; ii + 16 <= numValues; ii += 16)
+    {
+        const __m128i lo = _mm_packs_epi32(
+                roundSSE2(values + ii, maxValueV),
+                roundSSE2(values + ii + 4, maxValueV));
+        const __m128i hi = _mm_packs_epi32(
+                roundSSE2(values + ii + 8, maxValueV),
+                roundSSE2(values + ii + 12, maxValueV));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(output + ii),
+                         _mm_packus_epi16(lo, hi));
+    }
+
+    quantizeScalar(values + ii, numValues - ii, maxValue, output + ii);
+}
+
+SIX_SIMD_TARGET("sse2")
+void quantizeSSE2(const float* values, size_t numValues, float maxValue,
+                  sys::Uint16_T* output)
+{
+    // SSE2 can only pack to signed 16-bit values, so shift the range down
+    // by 32768 first and flip the sign bit back afterwards
+    const __m128 maxValueV = _mm_set1_ps(maxValue);
+    const __m128i bias = _mm_set1_epi32(32768);
+    const __m128i signBit = _mm_set1_epi16(static_cast<short>(0x8000));
+    size_t ii = 0;
+    for (; ii + 8 <= numValues; ii += 8)
+    {
+        const __m128i packed = _mm_packs_epi32(
+                _mm_sub_epi32(roundSSE2(values + ii, maxValueV), bias),
+                _mm_sub_epi32(roundSSE2(values + ii + 4, maxValueV), bias));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(output + ii),
+                         _mm_xor_si128(packed, signBit));
+    }
+
+    quantizeScalar(values + ii, numValues - ii, maxValue, output + ii);
+}
+#endif
+
+void detectPower(const std::complex<float>* pixels,
+                 size_t numPixels,
+                 float* power)
+{
+#if defined(SIX_SIMD_X86_GNU) || defined(SIX_SIMD_X86_MSVC)
+    if (haveSSE2())
+    {
+        detectPowerSSE2(pixels, numPixels, power);
+        return;
+    }
+#endif
+    detectPowerScalar(pixels, numPixels, power);
+}
+
+void remapLinear(float* values, size_t numValues, float gain, float offset)
+{
+#if defined(SIX_SIMD_X86_GNU) || defined(SIX_SIMD_X86_MSVC)
+    if (haveSSE2())
+    {
+        remapLinearSSE2(values, numValues, gain, offset);
+        return;
+    }
+#endif
+    remapLinearScalar(values, numValues, gain, offset);
+}
+
+void remapLog(float* values, size_t numValues, float minPower, float gain,
+              float offset)
+{
+#if defined(SIX_SIMD_X86_GNU) || defined(SIX_SIMD_X86_MSVC)
+    if (haveSSE2())
+    {
+        remapLogSSE2(values, numValues, minPower, gain, offset);
+        return;
+    }
+#endif
+    remapLogScalar(values, numValues, minPower, gain, offset);
+}
+
+void compressPEDF(float* values, size_t numValues, float stretch,
+                  float shift)
+{
+#if defined(SIX_SIMD_X86_GNU) || defined(SIX_SIMD_X86_MSVC)
+    if (haveSSE2())
+    {
+        compressPEDFSSE2(values, numValues, stretch, shift);
+        return;
+    }
+#endif
+    compressPEDFScalar(values, numValues, stretch, shift);
+}
+
+template <typename T>
+void quantize(const float* values, size_t numValues, float maxValue,
+              T* output)
+{
+#if defined(SIX_SIMD_X86_GNU) || defined(SIX_SIMD_X86_MSVC)
+    if (haveSSE2())
+    {
+        quantizeSSE2(values, numValues, maxValue, output);
+        return;
+    }
+#endif
+    quantizeScalar(values, numValues, maxValue, output);
+}
+
+// Adds the pixels' amplitudes to the statistics
+void addAmplitudes(const std::complex<float>* pixels,
+                   size_t numPixels,
+                   six::SampleStatistics& statistics)
+{
+    float amplitudes[CHUNK_SIZE];
+    for (size_t start = 0; start < numPixels; start += CHUNK_SIZE)
+    {
+        const size_t numThisChunk = std::min(CHUNK_SIZE, numPixels - start);
+        detectPower(pixels + start, numThisChunk, amplitudes);
+
+        // A linear remap with unit gain is just the square root
+        remapLinear(amplitudes, numThisChunk, 1.0f, 0.0f);
+        statistics.add(amplitudes, numThisChunk);
+    }
+}
+
+std::string normalizeRemapType(const std::string& remapType)
+{
+    std::string normalized;
+    for (size_t ii = 0; ii < remapType.size(); ++ii)
+    {
+        if (remapType[ii] != ' ' && remapType[ii] != '-' &&
+            remapType[ii] != '_')
+        {
+            normalized += remapType[ii];
+        }
+    }
+    str::upper(normalized);
+    return normalized;
+}
+}
+
+namespace six
+{
+namespace sidd
+{
+class DisplayRemapper::StatisticsRunnable : public sys::Runnable
+{
+public:
+    StatisticsRunnable(const std::complex<float>* pixels,
+                       size_t numPixels,
+                       SampleStatistics& statistics) :
+        mPixels(pixels),
+        mNumPixels(numPixels),
+        mStatistics(statistics)
+    {
+    }
+
+    virtual void run()
+    {
+        addAmplitudes(mPixels, mNumPixels, mStatistics);
+    }
+
+private:
+    const std::complex<float>* const mPixels;
+    const size_t mNumPixels;
+    SampleStatistics& mStatistics;
+};
+
+class DisplayRemapper::RemapRunnable : public sys::Runnable
+{
+public:
+    RemapRunnable(const DisplayRemapper& remapper,
+                  const std::complex<float>* pixels,
+                  size_t numPixels,
+                  UByte* output) :
+        mRemapper(remapper),
+        mPixels(pixels),
+        mNumPixels(numPixels),
+        mOutput(output)
+    {
+    }
+
+    virtual void run()
+    {
+        mRemapper.remapPixels(mPixels, mNumPixels, mOutput);
+    }
+
+private:
+    const DisplayRemapper& mRemapper;
+    const std::complex<float>* const mPixels;
+    const size_t mNumPixels;
+    UByte* const mOutput;
+};
+
+DisplayRemapper::DisplayRemapper(const std::string& remapType,
+                                 PixelType pixelType,
+                                 size_t numThreads) :
+    mPixelType(pixelType),
+    mNumThreads(numThreads)
+{
+    initialize(remapType);
+}
+
+DisplayRemapper::DisplayRemapper(const Display& display, size_t numThreads) :
+    mPixelType(display.pixelType),
+    mNumThreads(numThreads)
+{
+    const MonochromeDisplayRemap* const monoRemap =
+            dynamic_cast<const MonochromeDisplayRemap*>(
+                    display.remapInformation.get());
+    initialize((monoRemap && !monoRemap->remapType.empty()) ?
+            monoRemap->remapType : "Density");
+
+    if (monoRemap && (mRemapType == DENSITY || mRemapType == PEDF))
+    {
+        const ParameterCollection& params(monoRemap->remapParameters);
+        setDensityParameters(
+                params.containsParameter("DMin") ?
+                        static_cast<double>(params.findParameter("DMin")) :
+                        mDMin,
+                params.containsParameter("MMult") ?
+                        static_cast<double>(params.findParameter("MMult")) :
+                        mMMult);
+    }
+
+    const DRAHistogramOverrides* const overrides =
+            display.histogramOverrides.get();
+    if (overrides && !Init::isUndefined(overrides->clipMin) &&
+        !Init::isUndefined(overrides->clipMax))
+    {
+        setClipPoints(overrides->clipMin, overrides->clipMax);
+    }
+}
+
+void DisplayRemapper::initialize(const std::string& remapType)
+{
+    if (mPixelType != PixelType::MONO8I && mPixelType != PixelType::MONO8LU &&
+        mPixelType != PixelType::RGB8LU && mPixelType != PixelType::MONO16I)
+    {
+        throw except::Exception(Ctxt("Can't remap to " +
+                mPixelType.toString() + " pixels"));
+    }
+    if (mNumThreads == 0)
+    {
+        throw except::Exception(Ctxt("Need at least one thread"));
+    }
+
+    mDMin = 30;
+    mMMult = 40;
+    mClipMin = Init::undefined<double>();
+    mClipMax = Init::undefined<double>();
+
+    const std::string type = normalizeRemapType(remapType);
+    if (type == "LINEAR")
+    {
+        mRemapType = LINEAR;
+    }
+    else if (type == "LOG")
+    {
+        mRemapType = LOG;
+    }
+    else if (type == "DENSITY")
+    {
+        mRemapType = DENSITY;
+    }
+    else if (type == "BRIGHTER")
+    {
+        mRemapType = DENSITY;
+        mDMin = 60;
+    }
+    else if (type == "DARKER")
+    {
+        mRemapType = DENSITY;
+        mDMin = 0;
+    }
+    else if (type == "HIGHCONTRAST")
+    {
+        mRemapType = DENSITY;
+        mMMult = 4;
+    }
+    else if (type == "PEDF")
+    {
+        mRemapType = PEDF;
+    }
+    else
+    {
+        throw except::Exception(Ctxt("Unsupported remap type " + remapType));
+    }
+}
+
+bool DisplayRemapper::isSupported(const std::string& remapType)
+{
+    try
+    {
+        DisplayRemapper(remapType, PixelType::MONO8I);
+        return true;
+    }
+    catch (const except::Exception&)
+    {
+        return false;
+    }
+}
+
+void DisplayRemapper::setDensityParameters(double dMin, double mMult)
+{
+    if (mRemapType != DENSITY && mRemapType != PEDF)
+    {
+        throw except::Exception(Ctxt(
+                "Only the Density and PEDF remaps have density parameters"));
+    }
+    if (dMin < 0 || dMin > 255 || mMult <= 1)
+    {
+        throw except::Exception(Ctxt("Invalid density parameters DMin " +
+                str::toString(dMin) + " and MMult " + str::toString(mMult)));
+    }
+    mDMin = dMin;
+    mMMult = mMult;
+}
+
+void DisplayRemapper::setClipPoints(double clipMin, double clipMax)
+{
+    if (!(clipMin < clipMax))
+    {
+        throw except::Exception(Ctxt("Clip points " +
+                str::toString(clipMin) + " and " + str::toString(clipMax) +
+                " are out of order"));
+    }
+    mClipMin = clipMin;
+    mClipMax = clipMax;
+}
+
+void DisplayRemapper::resetStatistics()
+{
+    mStatistics = SampleStatistics();
+}
+
+void DisplayRemapper::accumulateStatistics(
+        const std::complex<float>* pixels,
+        const types::RowCol<size_t>& dims)
+{
+    const mt::ThreadPlanner planner(dims.row, mNumThreads);
+    if (planner.getNumThreadsThatWillBeUsed() <= 1)
+    {
+        addAmplitudes(pixels, dims.area(), mStatistics);
+        return;
+    }
+
+    // Each thread has its own partial statistics, merged at the end
+    std::vector<SampleStatistics> partials(
+            planner.getNumThreadsThatWillBeUsed());
+    mt::ThreadGroup threads;
+    size_t threadNum(0);
+    size_t startRow(0);
+    size_t numRowsThisThread(0);
+    while (planner.getThreadInfo(threadNum, startRow, numRowsThisThread))
+    {
+        threads.createThread(new StatisticsRunnable(
+                pixels + startRow * dims.col,
+                numRowsThisThread * dims.col,
+                partials[threadNum]));
+        ++threadNum;
+    }
+    threads.joinAll();
+
+    for (size_t ii = 0; ii < partials.size(); ++ii)
+    {
+        mStatistics.merge(partials[ii]);
+    }
+}
+
+void DisplayRemapper::remap(const std::complex<float>* pixels,
+                            const types::RowCol<size_t>& dims,
+                            UByte* output) const
+{
+    if (mStatistics.getCount() == 0)
+    {
+        throw except::Exception(Ctxt(
+                "Statistics must be accumulated before remapping"));
+    }
+
+    const mt::ThreadPlanner planner(dims.row, mNumThreads);
+    if (planner.getNumThreadsThatWillBeUsed() <= 1)
+    {
+        remapPixels(pixels, dims.area(), output);
+        return;
+    }
+
+    const size_t pixelBytes = (mPixelType == PixelType::MONO16I) ? 2 : 1;
+    mt::ThreadGroup threads;
+    size_t threadNum(0);
+    size_t startRow(0);
+    size_t numRowsThisThread(0);
+    while (planner.getThreadInfo(threadNum++, startRow, numRowsThisThread))
+    {
+        threads.createThread(new RemapRunnable(
+                *this,
+                pixels + startRow * dims.col,
+                numRowsThisThread * dims.col,
+                output + startRow * dims.col * pixelBytes));
+    }
+    threads.joinAll();
+}
+
+void DisplayRemapper::remapPixels(const std::complex<float>* pixels,
+                                  size_t numPixels,
+                                  UByte* output) const
+{
+    // Every remap is gain * f(amplitude) + offset, on the 8-bit scale, where
+    // f is the identity for Linear and the natural log for the rest.  The
+    // log is taken of the power, which saves a square root per pixel, so
+    // the gain is halved for it.
+    double gain(0);
+    double offset(0);
+    double minPower(1);
+    switch (mRemapType)
+    {
+    case LINEAR:
+    {
+        const double minAmplitude = mStatistics.getMin();
+        const double maxAmplitude = mStatistics.getMax();
+        if (maxAmplitude > minAmplitude)
+        {
+            gain = 255 / (maxAmplitude - minAmplitude);
+            offset = -minAmplitude * gain;
+        }
+        break;
+    }
+    case LOG:
+    {
+        // The Log remap starts at the smallest nonzero amplitude, since
+        // log(0) is unbounded
+        const double minAmplitude = mStatistics.getMinPositive();
+        const double maxAmplitude = mStatistics.getMax();
+        if (minAmplitude > 0 && maxAmplitude > minAmplitude)
+        {
+            gain = 255 / ::log(maxAmplitude / minAmplitude);
+            offset = -::log(minAmplitude) * gain;
+            gain /= 2;
+            minPower = minAmplitude * minAmplitude;
+        }
+        break;
+    }
+    case DENSITY:
+    case PEDF:
+    {
+        // SIPS puts the low clip at 0.8 times the mean amplitude and the
+        // high clip at MMult times that
+        const double lowClip = std::max(0.8 * mStatistics.getMean(),
+                                        DENSITY_MIN_AMPLITUDE);
+        gain = (255 - mDMin) / ::log(mMMult);
+        offset = mDMin - ::log(lowClip) * gain;
+        gain /= 2;
+        minPower = DENSITY_MIN_AMPLITUDE * DENSITY_MIN_AMPLITUDE;
+        break;
+    }
+    }
+
+    // Then the clip points stretch the 8-bit scale to the output's
+    const float maxValue = (mPixelType == PixelType::MONO16I) ? 65535 : 255;
+    double stretch = maxValue / 255.0;
+    double shift = 0;
+    if (!Init::isUndefined(mClipMin))
+    {
+        stretch = maxValue / (mClipMax - mClipMin);
+        shift = -mClipMin * stretch;
+    }
+
+    // PEDF compresses the upper half of the 8-bit scale before the stretch.
+    // Otherwise, the stretch just folds into the gain and offset.
+    const bool isPEDF = (mRemapType == PEDF);
+    if (!isPEDF)
+    {
+        gain *= stretch;
+        offset = offset * stretch + shift;
+    }
+
+    const float gainF = static_cast<float>(gain);
+    const float offsetF = static_cast<float>(offset);
+    // A zero or subnormal floor would send the log to -infinity or past
+    // what logSSE2() handles
+    const float minPowerF = std::max(static_cast<float>(minPower),
+                                     std::numeric_limits<float>::min());
+    const float stretchF = static_cast<float>(stretch);
+    const float shiftF = static_cast<float>(shift);
+
+    float values[CHUNK_SIZE];
+    for (size_t start = 0; start < numPixels; start += CHUNK_SIZE)
+    {
+        const size_t numThisChunk = std::min(CHUNK_SIZE, numPixels - start);
+        detectPower(pixels + start, numThisChunk, values);
+
+        if (mRemapType == LINEAR)
+        {
+            remapLinear(values, numThisChunk, gainF, offsetF);
+        }
+        else
+        {
+            remapLog(values, numThisChunk, minPowerF, gainF, offsetF);
+        }
+
+        if (isPEDF)
+        {
+            compressPEDF(values, numThisChunk, stretchF, shiftF);
+        }
+
+        if (mPixelType == PixelType::MONO16I)
+        {
+            quantize(values, numThisChunk, maxValue,
+                     reinterpret_cast<sys::Uint16_T*>(output) + start);
+        }
+        else
+        {
+            quantize(values, numThisChunk, maxValue, output + start);
+        }
+    }
+}
+
+void DisplayRemapper::applyLUT(const LUT& lut,
+                               const UByte* pixels,
+                               size_t numPixels,
+                               UByte* output)
+{
+    if (lut.numEntries < 256)
+    {
+        throw except::Exception(Ctxt("Lookup table has only " +
+                str::toString(lut.numEntries) + " entries"));
+    }
+
+    const size_t elementSize = lut.elementSize;
+    for (size_t ii = 0; ii < numPixels; ++ii)
+    {
+        ::memcpy(output + ii * elementSize, lut[pixels[ii]], elementSize);
+    }
+}
+}
+}
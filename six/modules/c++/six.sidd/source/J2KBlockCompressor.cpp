@@ -0,0 +1,375 @@
+/* =========================================================================
+ * This file is part of six.sidd-c++
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2018, MDA Information Systems LLC
+ *
+ * six.sidd-c++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+
+#include <except/Exception.h>
+#include <math/Round.h>
+#include <str/Convert.h>
+#include <six/sidd/J2KBlockCompressor.h>
+
+#ifdef SIX_HAVE_OPENJPEG
+#include <openjpeg.h>
+#endif
+
+namespace
+{
+size_t getNumComponents(six::PixelType pixelType)
+{
+    switch (pixelType)
+    {
+    case six::PixelType::MONO8I:
+    case six::PixelType::MONO8LU:
+    case six::PixelType::MONO16I:
+    case six::PixelType::RGB8LU:
+        return 1;
+    case six::PixelType::RGB24I:
+        return 3;
+    default:
+        throw except::Exception(Ctxt(
+                "Cannot J2K compress pixel type " + pixelType.toString()));
+    }
+}
+
+size_t getNumBitsPerComponent(six::PixelType pixelType)
+{
+    return (pixelType == six::PixelType::MONO16I) ? 16 : 8;
+}
+
+types::RowCol<size_t> getBlockDims(const six::sidd::DerivedData& data,
+                                   size_t numRowsPerBlock,
+                                   size_t numColsPerBlock)
+{
+    return types::RowCol<size_t>(
+            (numRowsPerBlock == 0) ? data.getNumRows() :
+                    std::min(numRowsPerBlock, data.getNumRows()),
+            (numColsPerBlock == 0) ? data.getNumCols() :
+                    std::min(numColsPerBlock, data.getNumCols()));
+}
+
+#ifdef SIX_HAVE_OPENJPEG
+// J2K end of codestream marker
+const sys::ubyte EOC_MARKER[] = {0xFF, 0xD9};
+
+// OpenJPEG's default, reduced so the coarsest level isn't smaller than a
+// pixel for small blocks
+OPJ_UINT32 getNumResolutions(const types::RowCol<size_t>& blockDims)
+{
+    const size_t minDim = std::min(blockDims.row, blockDims.col);
+    OPJ_UINT32 numResolutions = 6;
+    while (numResolutions > 1 &&
+           (static_cast<size_t>(1) << (numResolutions - 1)) > minDim)
+    {
+        --numResolutions;
+    }
+    return numResolutions;
+}
+
+// Where OpenJPEG writes the codestream
+struct MemoryDestination
+{
+    MemoryDestination() :
+        position(0)
+    {
+    }
+
+    void moveTo(size_t newPosition)
+    {
+        position = newPosition;
+        if (position > buffer.size())
+        {
+            buffer.resize(position);
+        }
+    }
+
+    std::vector<sys::ubyte> buffer;
+    size_t position;
+};
+
+OPJ_SIZE_T writeToMemory(void* buffer, OPJ_SIZE_T numBytes, void* userData)
+{
+    MemoryDestination& dest = *static_cast<MemoryDestination*>(userData);
+    const size_t position = dest.position;
+    dest.moveTo(position + numBytes);
+    ::memcpy(&dest.buffer[position], buffer, numBytes);
+    return numBytes;
+}
+
+OPJ_OFF_T skipInMemory(OPJ_OFF_T numBytes, void* userData)
+{
+    MemoryDestination& dest = *static_cast<MemoryDestination*>(userData);
+    if (numBytes < 0 && static_cast<size_t>(-numBytes) > dest.position)
+    {
+        return -1;
+    }
+    dest.moveTo(dest.position + numBytes);
+    return numBytes;
+}
+
+OPJ_BOOL seekInMemory(OPJ_OFF_T offset, void* userData)
+{
+    if (offset < 0)
+    {
+        return OPJ_FALSE;
+    }
+    static_cast<MemoryDestination*>(userData)->moveTo(offset);
+    return OPJ_TRUE;
+}
+
+void recordError(const char* message, void* userData)
+{
+    static_cast<std::string*>(userData)->append(message);
+}
+
+// Releases whatever OpenJPEG objects were created
+struct OpenJPEGObjects
+{
+    OpenJPEGObjects() :
+        image(NULL),
+        codec(NULL),
+        stream(NULL)
+    {
+    }
+
+    ~OpenJPEGObjects()
+    {
+        if (stream)
+        {
+            opj_stream_destroy(stream);
+        }
+        if (codec)
+        {
+            opj_destroy_codec(codec);
+        }
+        if (image)
+        {
+            opj_image_destroy(image);
+        }
+    }
+
+    opj_image_t* image;
+    opj_codec_t* codec;
+    opj_stream_t* stream;
+};
+
+void throwOpenJPEGError(const std::string& action, const std::string& errors)
+{
+    throw except::Exception(Ctxt("OpenJPEG failed to " + action +
+            (errors.empty() ? std::string() : (": " + errors))));
+}
+#endif
+}
+
+namespace six
+{
+namespace sidd
+{
+J2KBlockCompressor::J2KBlockCompressor(const DerivedData& data,
+                                       size_t numRowsPerBlock,
+                                       size_t numColsPerBlock,
+                                       double byterate) :
+    mPixelType(data.getPixelType()),
+    mImageDims(data.getNumRows(), data.getNumCols()),
+    mBlockDims(getBlockDims(data, numRowsPerBlock, numColsPerBlock)),
+    mNumBlocks(math::ceilingDivide(mImageDims.row, mBlockDims.row) *
+               math::ceilingDivide(mImageDims.col, mBlockDims.col)),
+    mByterate(byterate)
+{
+    if (!isAvailable())
+    {
+        throw except::Exception(Ctxt(
+                "six.sidd was built without J2K support"));
+    }
+
+    // Validate the pixel type
+    getNumComponents(mPixelType);
+
+    if (mByterate < 0.0 || mByterate >= 1.0)
+    {
+        throw except::Exception(Ctxt("Byterate must be in [0, 1), not " +
+                str::toString(mByterate)));
+    }
+
+    // Lossy compression would change the indices rather than the colors
+    if (!isNumericallyLossless() &&
+        (mPixelType == PixelType::MONO8LU || mPixelType == PixelType::RGB8LU))
+    {
+        throw except::Exception(Ctxt(
+                "Pixel types with lookup tables must be compressed "
+                "losslessly"));
+    }
+}
+
+bool J2KBlockCompressor::isAvailable()
+{
+#ifdef SIX_HAVE_OPENJPEG
+    return true;
+#else
+    return false;
+#endif
+}
+
+#ifdef SIX_HAVE_OPENJPEG
+void J2KBlockCompressor::compress(const sys::ubyte* block,
+                                  size_t blockIndex,
+                                  const types::RowCol<size_t>& blockDims,
+                                  std::vector<sys::ubyte>& compressed) const
+{
+    const size_t numComponents = getNumComponents(mPixelType);
+    const size_t numBits = getNumBitsPerComponent(mPixelType);
+
+    // Describe the whole image so the main header is the same for every
+    // block
+    std::vector<opj_image_cmptparm_t> componentParams(numComponents);
+    for (size_t ii = 0; ii < numComponents; ++ii)
+    {
+        opj_image_cmptparm_t& param(componentParams[ii]);
+        ::memset(&param, 0, sizeof(param));
+        param.dx = 1;
+        param.dy = 1;
+        param.w = static_cast<OPJ_UINT32>(mImageDims.col);
+        param.h = static_cast<OPJ_UINT32>(mImageDims.row);
+        param.prec = static_cast<OPJ_UINT32>(numBits);
+        param.bpp = static_cast<OPJ_UINT32>(numBits);
+        param.sgnd = 0;
+    }
+
+    OpenJPEGObjects objects;
+    objects.image = opj_image_tile_create(
+            static_cast<OPJ_UINT32>(numComponents),
+            &componentParams[0],
+            (numComponents == 3) ? OPJ_CLRSPC_SRGB : OPJ_CLRSPC_GRAY);
+    if (!objects.image)
+    {
+        throwOpenJPEGError("create image", "");
+    }
+    objects.image->x0 = 0;
+    objects.image->y0 = 0;
+    objects.image->x1 = static_cast<OPJ_UINT32>(mImageDims.col);
+    objects.image->y1 = static_cast<OPJ_UINT32>(mImageDims.row);
+
+    opj_cparameters_t params;
+    opj_set_default_encoder_parameters(&params);
+    params.tcp_numlayers = 1;
+    params.cp_disto_alloc = 1;
+    if (isNumericallyLossless())
+    {
+        params.tcp_rates[0] = 0.0f;
+        params.irreversible = 0;
+    }
+    else
+    {
+        params.tcp_rates[0] = static_cast<float>(1.0 / mByterate);
+        params.irreversible = 1;
+    }
+    params.tcp_mct = (numComponents == 3) ? 1 : 0;
+    params.tile_size_on = OPJ_TRUE;
+    params.cp_tx0 = 0;
+    params.cp_ty0 = 0;
+    params.cp_tdx = static_cast<int>(mBlockDims.col);
+    params.cp_tdy = static_cast<int>(mBlockDims.row);
+    params.numresolution = getNumResolutions(mBlockDims);
+
+    std::string errors;
+    objects.codec = opj_create_compress(OPJ_CODEC_J2K);
+    if (!objects.codec)
+    {
+        throwOpenJPEGError("create codec", "");
+    }
+    opj_set_error_handler(objects.codec, recordError, &errors);
+    if (!opj_setup_encoder(objects.codec, &params, objects.image))
+    {
+        throwOpenJPEGError("set up encoder", errors);
+    }
+
+    MemoryDestination dest;
+    objects.stream = opj_stream_create(OPJ_J2K_STREAM_CHUNK_SIZE, OPJ_FALSE);
+    if (!objects.stream)
+    {
+        throwOpenJPEGError("create stream", "");
+    }
+    opj_stream_set_write_function(objects.stream, writeToMemory);
+    opj_stream_set_skip_function(objects.stream, skipInMemory);
+    opj_stream_set_seek_function(objects.stream, seekInMemory);
+    opj_stream_set_user_data(objects.stream, &dest, NULL);
+
+    if (!opj_start_compress(objects.codec, objects.image, objects.stream) ||
+        !opj_flush(objects.codec, objects.stream))
+    {
+        throwOpenJPEGError("write main header", errors);
+    }
+    const size_t headerLength = dest.buffer.size();
+
+    // OpenJPEG wants each component's samples together
+    const size_t numPixels = blockDims.area();
+    const size_t numBytes = numPixels * numComponents * (numBits / 8);
+    const sys::ubyte* tileData = block;
+    std::vector<sys::ubyte> planar;
+    if (numComponents > 1)
+    {
+        planar.resize(numBytes);
+        for (size_t pixel = 0; pixel < numPixels; ++pixel)
+        {
+            for (size_t comp = 0; comp < numComponents; ++comp)
+            {
+                planar[comp * numPixels + pixel] =
+                        block[pixel * numComponents + comp];
+            }
+        }
+        tileData = &planar[0];
+    }
+
+    if (!opj_write_tile(objects.codec,
+                        static_cast<OPJ_UINT32>(blockIndex),
+                        const_cast<OPJ_BYTE*>(tileData),
+                        static_cast<OPJ_UINT32>(numBytes),
+                        objects.stream) ||
+        !opj_flush(objects.codec, objects.stream))
+    {
+        throwOpenJPEGError("write tile " + str::toString(blockIndex), errors);
+    }
+
+    // Only the first block carries the main header and only the last one
+    // ends the codestream
+    compressed.assign(dest.buffer.begin() + (blockIndex == 0 ? 0 : headerLength),
+                      dest.buffer.end());
+    if (blockIndex == mNumBlocks - 1)
+    {
+        compressed.insert(compressed.end(),
+                          EOC_MARKER,
+                          EOC_MARKER + sizeof(EOC_MARKER));
+    }
+}
+#else
+void J2KBlockCompressor::compress(const sys::ubyte* /*block*/,
+                                  size_t /*blockIndex*/,
+                                  const types::RowCol<size_t>& /*blockDims*/,
+                                  std::vector<sys::ubyte>& /*compressed*/) const
+{
+    throw except::Exception(Ctxt("six.sidd was built without J2K support"));
+}
+#endif
+}
+}
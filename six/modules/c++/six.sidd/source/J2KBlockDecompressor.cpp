@@ -0,0 +1,353 @@
+/* =========================================================================
+ * This file is part of six.sidd-c++
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2018, MDA Information Systems LLC
+ *
+ * six.sidd-c++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+
+#include <except/Exception.h>
+#include <str/Convert.h>
+#include <six/sidd/J2KBlockDecompressor.h>
+
+#ifdef SIX_HAVE_OPENJPEG
+#include <openjpeg.h>
+#endif
+
+namespace
+{
+// J2K markers
+const size_t SOC = 0xFF4F;
+const size_t SOT = 0xFF90;
+const size_t EOC = 0xFFD9;
+
+size_t readUint16(const sys::ubyte* data)
+{
+    return (static_cast<size_t>(data[0]) << 8) | data[1];
+}
+
+size_t readUint32(const sys::ubyte* data)
+{
+    return (readUint16(data) << 16) | readUint16(data + 2);
+}
+
+void throwMalformed(const std::string& reason, size_t offset)
+{
+    throw except::Exception(Ctxt("Malformed J2K codestream: " + reason +
+            " at byte " + str::toString(offset)));
+}
+
+#ifdef SIX_HAVE_OPENJPEG
+// Where OpenJPEG reads the codestream from
+struct MemorySource
+{
+    MemorySource(const std::vector<sys::ubyte>& buffer) :
+        buffer(buffer),
+        position(0)
+    {
+    }
+
+    const std::vector<sys::ubyte>& buffer;
+    size_t position;
+};
+
+OPJ_SIZE_T readFromMemory(void* buffer, OPJ_SIZE_T numBytes, void* userData)
+{
+    MemorySource& source = *static_cast<MemorySource*>(userData);
+    if (source.position >= source.buffer.size())
+    {
+        return static_cast<OPJ_SIZE_T>(-1);
+    }
+    const size_t numToRead =
+            std::min<size_t>(numBytes, source.buffer.size() - source.position);
+    ::memcpy(buffer, &source.buffer[source.position], numToRead);
+    source.position += numToRead;
+    return numToRead;
+}
+
+OPJ_OFF_T skipInMemory(OPJ_OFF_T numBytes, void* userData)
+{
+    MemorySource& source = *static_cast<MemorySource*>(userData);
+    if (numBytes < 0 && static_cast<size_t>(-numBytes) > source.position)
+    {
+        return -1;
+    }
+    source.position += numBytes;
+    return numBytes;
+}
+
+OPJ_BOOL seekInMemory(OPJ_OFF_T offset, void* userData)
+{
+    MemorySource& source = *static_cast<MemorySource*>(userData);
+    if (offset < 0 || static_cast<size_t>(offset) > source.buffer.size())
+    {
+        return OPJ_FALSE;
+    }
+    source.position = offset;
+    return OPJ_TRUE;
+}
+
+void recordError(const char* message, void* userData)
+{
+    static_cast<std::string*>(userData)->append(message);
+}
+
+// Releases whatever OpenJPEG objects were created
+struct OpenJPEGObjects
+{
+    OpenJPEGObjects() :
+        image(NULL),
+        codec(NULL),
+        stream(NULL)
+    {
+    }
+
+    ~OpenJPEGObjects()
+    {
+        if (stream)
+        {
+            opj_stream_destroy(stream);
+        }
+        if (codec)
+        {
+            opj_destroy_codec(codec);
+        }
+        if (image)
+        {
+            opj_image_destroy(image);
+        }
+    }
+
+    opj_image_t* image;
+    opj_codec_t* codec;
+    opj_stream_t* stream;
+};
+
+void throwOpenJPEGError(const std::string& action, const std::string& errors)
+{
+    throw except::Exception(Ctxt("OpenJPEG failed to " + action +
+            (errors.empty() ? std::string() : (": " + errors))));
+}
+#endif
+}
+
+namespace six
+{
+namespace sidd
+{
+J2KBlockDecompressor::J2KBlockDecompressor() :
+    mNumBytesPerPixel(0),
+    mCodestream(NULL),
+    mMainHeaderLength(0)
+{
+}
+
+bool J2KBlockDecompressor::isAvailable()
+{
+#ifdef SIX_HAVE_OPENJPEG
+    return true;
+#else
+    return false;
+#endif
+}
+
+void J2KBlockDecompressor::load(const DerivedData& data,
+                                const sys::ubyte* imageData,
+                                size_t numBytes,
+                                size_t numBlocks)
+{
+    mNumBytesPerPixel = data.getNumBytesPerPixel();
+    mCodestream = imageData;
+    mTileParts.assign(numBlocks, std::vector<types::Range>());
+
+    if (numBytes < 4 || readUint16(imageData) != SOC)
+    {
+        throwMalformed("missing SOC marker", 0);
+    }
+
+    // The main header is every marker segment up to the first SOT
+    size_t pos = 2;
+    while (true)
+    {
+        if (pos + 4 > numBytes)
+        {
+            throwMalformed("main header runs past the end", pos);
+        }
+        if (readUint16(imageData + pos) == SOT)
+        {
+            break;
+        }
+        pos += 2 + readUint16(imageData + pos + 2);
+    }
+    mMainHeaderLength = pos;
+
+    // Then the tile-parts.  Psot is the length of the tile-part including
+    // its SOT marker segment, or 0 if it runs until the EOC.  Requiring the
+    // EOC catches codestreams that were cut off between tile-parts.
+    while (true)
+    {
+        if (pos + 2 > numBytes)
+        {
+            throwMalformed("missing EOC marker", pos);
+        }
+        const size_t marker = readUint16(imageData + pos);
+        if (marker == EOC)
+        {
+            break;
+        }
+        if (marker != SOT || pos + 12 > numBytes)
+        {
+            throwMalformed("expected SOT marker", pos);
+        }
+
+        const size_t tileIndex = readUint16(imageData + pos + 4);
+        size_t length = readUint32(imageData + pos + 6);
+        if (length == 0)
+        {
+            if (readUint16(imageData + numBytes - 2) != EOC)
+            {
+                throwMalformed("missing EOC marker", numBytes);
+            }
+            length = numBytes - 2 - pos;
+        }
+        if (tileIndex >= numBlocks || length < 12 || pos + length > numBytes)
+        {
+            throwMalformed("invalid tile-part for tile " +
+                    str::toString(tileIndex), pos);
+        }
+
+        mTileParts[tileIndex].push_back(types::Range(pos, length));
+        pos += length;
+    }
+
+    for (size_t tile = 0; tile < numBlocks; ++tile)
+    {
+        if (mTileParts[tile].empty())
+        {
+            throw except::Exception(Ctxt(
+                    "J2K codestream has no data for tile " +
+                    str::toString(tile) + "; is each NITF block a J2K tile?"));
+        }
+    }
+}
+
+#ifdef SIX_HAVE_OPENJPEG
+void J2KBlockDecompressor::decompress(size_t blockIndex,
+                                      const types::RowCol<size_t>& blockDims,
+                                      sys::ubyte* block) const
+{
+    // Just enough of a codestream for OpenJPEG to find this tile
+    const std::vector<types::Range>& tileParts = mTileParts.at(blockIndex);
+    std::vector<sys::ubyte> codestream(mCodestream,
+                                       mCodestream + mMainHeaderLength);
+    for (size_t ii = 0; ii < tileParts.size(); ++ii)
+    {
+        const sys::ubyte* const part =
+                mCodestream + tileParts[ii].mStartElement;
+        codestream.insert(codestream.end(),
+                          part,
+                          part + tileParts[ii].mNumElements);
+    }
+    codestream.push_back(static_cast<sys::ubyte>(EOC >> 8));
+    codestream.push_back(static_cast<sys::ubyte>(EOC & 0xFF));
+
+    OpenJPEGObjects objects;
+    std::string errors;
+    objects.codec = opj_create_decompress(OPJ_CODEC_J2K);
+    if (!objects.codec)
+    {
+        throwOpenJPEGError("create codec", "");
+    }
+    opj_set_error_handler(objects.codec, recordError, &errors);
+
+    opj_dparameters_t params;
+    opj_set_default_decoder_parameters(&params);
+    if (!opj_setup_decoder(objects.codec, &params))
+    {
+        throwOpenJPEGError("set up decoder", errors);
+    }
+
+    MemorySource source(codestream);
+    objects.stream = opj_stream_create(OPJ_J2K_STREAM_CHUNK_SIZE, OPJ_TRUE);
+    if (!objects.stream)
+    {
+        throwOpenJPEGError("create stream", "");
+    }
+    opj_stream_set_read_function(objects.stream, readFromMemory);
+    opj_stream_set_skip_function(objects.stream, skipInMemory);
+    opj_stream_set_seek_function(objects.stream, seekInMemory);
+    opj_stream_set_user_data(objects.stream, &source, NULL);
+    opj_stream_set_user_data_length(objects.stream, codestream.size());
+
+    if (!opj_read_header(objects.stream, objects.codec, &objects.image) ||
+        !opj_get_decoded_tile(objects.codec, objects.stream, objects.image,
+                              static_cast<OPJ_UINT32>(blockIndex)))
+    {
+        throwOpenJPEGError("decode tile " + str::toString(blockIndex),
+                           errors);
+    }
+
+    // Back to interleaved pixels
+    const size_t numComponents = objects.image->numcomps;
+    const size_t numPixels = blockDims.area();
+    const size_t sampleSize = (objects.image->comps[0].prec > 8) ? 2 : 1;
+    if (numComponents * sampleSize != mNumBytesPerPixel ||
+        objects.image->comps[0].w != blockDims.col ||
+        objects.image->comps[0].h != blockDims.row)
+    {
+        throw except::Exception(Ctxt("Tile " + str::toString(blockIndex) +
+                " doesn't match the SIDD's pixel type or blocking"));
+    }
+
+    for (size_t comp = 0; comp < numComponents; ++comp)
+    {
+        const OPJ_INT32* const samples = objects.image->comps[comp].data;
+        if (sampleSize == 1)
+        {
+            sys::ubyte* dest = block + comp;
+            for (size_t pixel = 0; pixel < numPixels;
+                 ++pixel, dest += numComponents)
+            {
+                *dest = static_cast<sys::ubyte>(samples[pixel]);
+            }
+        }
+        else
+        {
+            sys::Uint16_T* const dest = reinterpret_cast<sys::Uint16_T*>(block);
+            for (size_t pixel = 0; pixel < numPixels; ++pixel)
+            {
+                dest[pixel * numComponents + comp] =
+                        static_cast<sys::Uint16_T>(samples[pixel]);
+            }
+        }
+    }
+}
+#else
+void J2KBlockDecompressor::decompress(size_t /*blockIndex*/,
+                                      const types::RowCol<size_t>& /*blockDims*/,
+                                      sys::ubyte* /*block*/) const
+{
+    throw except::Exception(Ctxt("six.sidd was built without J2K support"));
+}
+#endif
+}
+}
@@ -0,0 +1,433 @@
+/* =========================================================================
+ * This file is part of six.sidd-c++
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2018, MDA Information Systems LLC
+ *
+ * six.sidd-c++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <algorithm>
+
+#include <except/Exception.h>
+#include <io/FileOutputStream.h>
+#include <math/Round.h>
+#include <nitf/ImageBlocker.hpp>
+#include <nitf/NITFBufferList.hpp>
+#include <str/Convert.h>
+#include <sys/Conf.h>
+#include <sys/OS.h>
+#include <types/RowCol.h>
+#include <six/ByteSwap.h>
+#include <six/sidd/DerivedXMLControl.h>
+#include <six/sidd/ReducedResolutionSet.h>
+#include <six/sidd/SIDDByteProvider.h>
+
+namespace
+{
+types::RowCol<size_t> getReducedDims(const six::sidd::DerivedData& data,
+                                     size_t level)
+{
+    if (level >= 32)
+    {
+        throw except::Exception(Ctxt("Level " + str::toString(level) +
+                                     " is too coarse"));
+    }
+
+    const size_t factor = static_cast<size_t>(1) << level;
+    return types::RowCol<size_t>(
+            math::ceilingDivide(data.getNumRows(), factor),
+            math::ceilingDivide(data.getNumCols(), factor));
+}
+
+// Averages each 2x2 box of pixels, or what's left of one on the bottom and
+// right edges
+template <typename T>
+void averageBoxes(const T* input,
+                  const types::RowCol<size_t>& inDims,
+                  size_t numBands,
+                  T* output)
+{
+    const types::RowCol<size_t> outDims(
+            math::ceilingDivide(inDims.row, static_cast<size_t>(2)),
+            math::ceilingDivide(inDims.col, static_cast<size_t>(2)));
+    const size_t inRowLength = inDims.col * numBands;
+
+    for (size_t row = 0; row < outDims.row; ++row)
+    {
+        const size_t numInRows = std::min<size_t>(2, inDims.row - 2 * row);
+        const T* const inRow = input + 2 * row * inRowLength;
+        for (size_t col = 0; col < outDims.col; ++col)
+        {
+            const size_t numInCols =
+                    std::min<size_t>(2, inDims.col - 2 * col);
+            const size_t count = numInRows * numInCols;
+            for (size_t band = 0; band < numBands; ++band)
+            {
+                const T* const in = inRow + 2 * col * numBands + band;
+                sys::Uint32_T sum = 0;
+                for (size_t ii = 0; ii < numInRows; ++ii)
+                {
+                    for (size_t jj = 0; jj < numInCols; ++jj)
+                    {
+                        sum += in[ii * inRowLength + jj * numBands];
+                    }
+                }
+                *output++ = static_cast<T>((sum + count / 2) / count);
+            }
+        }
+    }
+}
+
+// Keeps the upper-left pixel of each 2x2 box
+void subsample(const six::UByte* input,
+               const types::RowCol<size_t>& inDims,
+               size_t numBytesPerPixel,
+               six::UByte* output)
+{
+    const size_t inRowBytes = inDims.col * numBytesPerPixel;
+    for (size_t row = 0; row < inDims.row; row += 2)
+    {
+        const six::UByte* const inRow = input + row * inRowBytes;
+        for (size_t col = 0; col < inDims.col; col += 2)
+        {
+            output = std::copy(inRow + col * numBytesPerPixel,
+                               inRow + (col + 1) * numBytesPerPixel,
+                               output);
+        }
+    }
+}
+
+void writeLevel(const six::sidd::DerivedData& data,
+                const std::vector<six::UByte>& imageData,
+                const std::string& pathname,
+                const std::vector<std::string>& schemaPaths,
+                size_t numRowsPerBlock,
+                size_t numColsPerBlock)
+{
+    const size_t numRows = data.getNumRows();
+    const size_t numCols = data.getNumCols();
+    const six::sidd::SIDDByteProvider byteProvider(
+            data,
+            schemaPaths,
+            std::min(numRowsPerBlock, numRows),
+            std::min(numColsPerBlock, numCols));
+
+    // The byte provider wants big endian pixels, already blocked
+    const six::UByte* pixels = &imageData[0];
+    std::vector<six::UByte> swapped;
+    if (data.getPixelType() == six::PixelType::MONO16I &&
+        !sys::isBigEndianSystem())
+    {
+        swapped = imageData;
+        six::byteSwap(&swapped[0], 2, swapped.size() / 2);
+        pixels = &swapped[0];
+    }
+
+    std::vector<six::UByte> blocked;
+    if (numRowsPerBlock != 0 || numColsPerBlock != 0)
+    {
+        const size_t numBytesPerPixel = data.getNumBytesPerPixel();
+        const std::auto_ptr<const nitf::ImageBlocker> imageBlocker =
+                byteProvider.getImageBlocker();
+        blocked.resize(imageBlocker->getNumBytesRequired(0, numRows,
+                                                         numBytesPerPixel));
+        imageBlocker->block(pixels, 0, numRows, numBytesPerPixel,
+                            &blocked[0]);
+        pixels = &blocked[0];
+    }
+
+    nitf::Off fileOffset;
+    nitf::NITFBufferList buffers;
+    byteProvider.getBytes(pixels, 0, numRows, fileOffset, buffers);
+
+    io::FileOutputStream outStream(pathname);
+    for (size_t ii = 0; ii < buffers.mBuffers.size(); ++ii)
+    {
+        outStream.write(
+                static_cast<const sys::byte*>(buffers.mBuffers[ii].mData),
+                buffers.mBuffers[ii].mNumBytes);
+    }
+    outStream.close();
+}
+}
+
+namespace six
+{
+namespace sidd
+{
+std::string getRSetPathname(const std::string& pathname,
+                            size_t imageNumber,
+                            size_t level)
+{
+    if (level == 0)
+    {
+        return pathname;
+    }
+
+    // Goes before the extension, if there is one
+    const std::string::size_type slash = pathname.find_last_of("/\\");
+    std::string::size_type dot = pathname.rfind('.');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+    {
+        dot = pathname.length();
+    }
+    return pathname.substr(0, dot) + "." + str::toString(imageNumber) +
+            ".r" + str::toString(level) + pathname.substr(dot);
+}
+
+std::auto_ptr<DerivedData> createReducedData(const DerivedData& data,
+                                             size_t level)
+{
+    std::auto_ptr<DerivedData> reduced(
+            static_cast<DerivedData*>(data.clone()));
+    if (level == 0)
+    {
+        return reduced;
+    }
+
+    const types::RowCol<size_t> dims = getReducedDims(data, level);
+    const double factor = static_cast<double>(static_cast<size_t>(1) << level);
+
+    // A reduced pixel sits at the center of the box it averages, or on the
+    // upper-left pixel if it was subsampled.  If this SIDD is already a
+    // chip, go from there back to the original product.
+    const PixelType pixelType = data.getPixelType();
+    const double offset = (pixelType == PixelType::MONO8LU ||
+                           pixelType == PixelType::RGB8LU) ?
+            0.0 : (factor - 1.0) / 2.0;
+    std::auto_ptr<const GeometricChip> existingChip;
+    if (data.downstreamReprocessing.get() &&
+        data.downstreamReprocessing->geometricChip.get())
+    {
+        existingChip.reset(new GeometricChip(
+                *data.downstreamReprocessing->geometricChip));
+    }
+
+    const size_t lastRow = dims.row - 1;
+    const size_t lastCol = dims.col - 1;
+    RowColDouble corners[4] = {
+            RowColDouble(0, 0),
+            RowColDouble(0, static_cast<double>(lastCol)),
+            RowColDouble(static_cast<double>(lastRow),
+                         static_cast<double>(lastCol)),
+            RowColDouble(static_cast<double>(lastRow), 0)};
+    for (size_t ii = 0; ii < 4; ++ii)
+    {
+        corners[ii].row = corners[ii].row * factor + offset;
+        corners[ii].col = corners[ii].col * factor + offset;
+        if (existingChip.get())
+        {
+            corners[ii] =
+                    existingChip->getFullImageCoordinateFromChip(corners[ii]);
+        }
+    }
+
+    GeometricChip chip;
+    chip.chipSize.row = dims.row;
+    chip.chipSize.col = dims.col;
+    chip.originalUpperLeftCoordinate = corners[0];
+    chip.originalUpperRightCoordinate = corners[1];
+    chip.originalLowerRightCoordinate = corners[2];
+    chip.originalLowerLeftCoordinate = corners[3];
+
+    if (reduced->downstreamReprocessing.get() == NULL)
+    {
+        reduced->downstreamReprocessing.reset(new DownstreamReprocessing());
+    }
+    reduced->downstreamReprocessing->geometricChip.reset(
+            new GeometricChip(chip));
+
+    reduced->setNumRows(dims.row);
+    reduced->setNumCols(dims.col);
+    return reduced;
+}
+
+void halveResolution(const DerivedData& data,
+                     const UByte* input,
+                     UByte* output)
+{
+    const types::RowCol<size_t> dims(data.getNumRows(), data.getNumCols());
+    switch (data.getPixelType())
+    {
+    case PixelType::MONO8I:
+        averageBoxes(input, dims, 1, output);
+        break;
+    case PixelType::MONO16I:
+        averageBoxes(reinterpret_cast<const sys::Uint16_T*>(input), dims, 1,
+                     reinterpret_cast<sys::Uint16_T*>(output));
+        break;
+    case PixelType::RGB24I:
+        averageBoxes(input, dims, 3, output);
+        break;
+    case PixelType::MONO8LU:
+    case PixelType::RGB8LU:
+        subsample(input, dims, data.getNumBytesPerPixel(), output);
+        break;
+    default:
+        throw except::Exception(Ctxt("Cannot reduce pixel type " +
+                                     data.getPixelType().toString()));
+    }
+}
+
+void writeRSet(const DerivedData& data,
+               const UByte* imageData,
+               const std::string& pathname,
+               const std::vector<std::string>& schemaPaths,
+               size_t numLevels,
+               size_t imageNumber,
+               size_t numRowsPerBlock,
+               size_t numColsPerBlock)
+{
+    // Each level is made from the one before it
+    const UByte* input = imageData;
+    std::auto_ptr<DerivedData> inputData = createReducedData(data, 0);
+    std::vector<UByte> levelImage;
+
+    for (size_t level = 1; level <= numLevels; ++level)
+    {
+        std::auto_ptr<DerivedData> levelData = createReducedData(data, level);
+        std::vector<UByte> output(levelData->getNumRows() *
+                                  levelData->getNumCols() *
+                                  levelData->getNumBytesPerPixel());
+        halveResolution(*inputData, input, &output[0]);
+
+        writeLevel(*levelData,
+                   output,
+                   getRSetPathname(pathname, imageNumber, level),
+                   schemaPaths,
+                   numRowsPerBlock,
+                   numColsPerBlock);
+
+        levelImage.swap(output);
+        input = &levelImage[0];
+        inputData = levelData;
+    }
+}
+
+RSetReader::RSetReader(const std::string& pathname,
+                       const std::vector<std::string>& schemaPaths)
+{
+    mXMLRegistry.addCreator(DataType::DERIVED,
+                            new XMLControlCreatorT<DerivedXMLControl>());
+
+    mem::SharedPtr<NITFReadControl> fullReader(new NITFReadControl());
+    fullReader->setXMLControlRegistry(&mXMLRegistry);
+    fullReader->load(pathname, schemaPaths);
+
+    mem::SharedPtr<const Container> container = fullReader->getContainer();
+    if (container->getDataType() != DataType::DERIVED)
+    {
+        throw except::Exception(Ctxt(pathname + " is not a SIDD"));
+    }
+
+    // Only the SIDD DESs count as images
+    for (size_t ii = 0; ii < container->getNumData(); ++ii)
+    {
+        const Data* const data = container->getData(ii);
+        if (data->getDataType() == DataType::DERIVED)
+        {
+            Level level;
+            level.reader = fullReader;
+            level.imageNumber = mLevels.size();
+            level.data = static_cast<const DerivedData*>(data);
+            mLevels.push_back(std::vector<Level>(1, level));
+        }
+    }
+
+    const sys::OS os;
+    for (size_t imageNumber = 0; imageNumber < mLevels.size(); ++imageNumber)
+    {
+        std::vector<Level>& levels(mLevels[imageNumber]);
+        const DerivedData& fullData(*levels[0].data);
+
+        for (size_t levelNum = 1; ; ++levelNum)
+        {
+            const std::string levelPathname =
+                    getRSetPathname(pathname, imageNumber, levelNum);
+            if (!os.exists(levelPathname))
+            {
+                break;
+            }
+
+            Level level;
+            level.reader.reset(new NITFReadControl());
+            level.reader->setXMLControlRegistry(&mXMLRegistry);
+            level.reader->load(levelPathname, schemaPaths);
+            level.imageNumber = 0;
+
+            mem::SharedPtr<const Container> levelContainer =
+                    level.reader->getContainer();
+            const types::RowCol<size_t> expectedDims =
+                    getReducedDims(fullData, levelNum);
+            if (levelContainer->getDataType() != DataType::DERIVED ||
+                levelContainer->getNumData() == 0 ||
+                levelContainer->getData(0)->getNumRows() != expectedDims.row ||
+                levelContainer->getData(0)->getNumCols() != expectedDims.col)
+            {
+                throw except::Exception(Ctxt(levelPathname +
+                        " is not reduced resolution level " +
+                        str::toString(levelNum) + " of " + pathname));
+            }
+            level.data = static_cast<const DerivedData*>(
+                    levelContainer->getData(0));
+            levels.push_back(level);
+        }
+    }
+}
+
+const RSetReader::Level& RSetReader::getLevelInfo(size_t imageNumber,
+                                                  size_t level) const
+{
+    if (imageNumber >= mLevels.size() ||
+        level >= mLevels[imageNumber].size())
+    {
+        throw except::Exception(Ctxt("No level " + str::toString(level) +
+                " for image " + str::toString(imageNumber)));
+    }
+    return mLevels[imageNumber][level];
+}
+
+const DerivedData& RSetReader::getDerivedData(size_t imageNumber,
+                                              size_t level) const
+{
+    return *getLevelInfo(imageNumber, level).data;
+}
+
+size_t RSetReader::getLevel(size_t imageNumber, double decimation) const
+{
+    getLevelInfo(imageNumber, 0);
+    const size_t numLevels = mLevels[imageNumber].size();
+
+    size_t level = 0;
+    while (level + 1 < numLevels &&
+           static_cast<double>(static_cast<size_t>(1) << (level + 1)) <=
+                   decimation)
+    {
+        ++level;
+    }
+    return level;
+}
+
+UByte* RSetReader::interleaved(Region& region,
+                               size_t imageNumber,
+                               size_t level)
+{
+    const Level& levelInfo = getLevelInfo(imageNumber, level);
+    return levelInfo.reader->interleaved(region, levelInfo.imageNumber);
+}
+}
+}
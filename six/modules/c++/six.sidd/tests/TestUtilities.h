@@ -0,0 +1,212 @@
+/* =========================================================================
+ * This file is part of six.sidd-c++
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2018, MDA Information Systems LLC
+ *
+ * six.sidd-c++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __SIX_SIDD_TEST_UTILITIES_H__
+#define __SIX_SIDD_TEST_UTILITIES_H__
+
+#include <string.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <except/Exception.h>
+#include <io/FileOutputStream.h>
+#include <sys/Conf.h>
+#include <types/RowCol.h>
+#include <nitf/NITFBufferList.hpp>
+#include <six/sidd/BlockDecompressor.h>
+#include <six/sidd/CompressedSIDDEncoder.h>
+#include <six/sidd/Utilities.h>
+
+// Each block is its index and length followed by (run length, byte) pairs
+class RunLengthCompressor : public six::sidd::BlockCompressor
+{
+public:
+    RunLengthCompressor(size_t numBytesPerPixel) :
+        mNumBytesPerPixel(numBytesPerPixel)
+    {
+    }
+
+    virtual void compress(const sys::ubyte* block,
+                          size_t blockIndex,
+                          const types::RowCol<size_t>& blockDims,
+                          std::vector<sys::ubyte>& compressed) const
+    {
+        compressed.resize(2 * sizeof(sys::Uint32_T));
+        const size_t numBytes = blockDims.area() * mNumBytesPerPixel;
+        for (size_t ii = 0; ii < numBytes; )
+        {
+            sys::ubyte run = 1;
+            while (ii + run < numBytes && run < 255 &&
+                   block[ii + run] == block[ii])
+            {
+                ++run;
+            }
+            compressed.push_back(run);
+            compressed.push_back(block[ii]);
+            ii += run;
+        }
+
+        const sys::Uint32_T header[] = {
+                static_cast<sys::Uint32_T>(blockIndex),
+                static_cast<sys::Uint32_T>(compressed.size())};
+        ::memcpy(&compressed[0], header, sizeof(header));
+    }
+
+    virtual bool isNumericallyLossless() const
+    {
+        return true;
+    }
+
+private:
+    const size_t mNumBytesPerPixel;
+};
+
+class RunLengthDecompressor : public six::sidd::BlockDecompressor
+{
+public:
+    RunLengthDecompressor(size_t numBytesPerPixel) :
+        mNumBytesPerPixel(numBytesPerPixel)
+    {
+    }
+
+    /*!
+     * Decodes a block on its own, whatever its size
+     *
+     * \param compressed Block from a RunLengthCompressor
+     * \param[out] block The pixels
+     *
+     * \return The index of the block
+     */
+    static size_t decode(const sys::ubyte* compressed,
+                         std::vector<sys::ubyte>& block)
+    {
+        sys::Uint32_T header[2];
+        ::memcpy(header, compressed, sizeof(header));
+
+        block.clear();
+        for (size_t ii = sizeof(header); ii + 1 < header[1]; ii += 2)
+        {
+            block.insert(block.end(), compressed[ii], compressed[ii + 1]);
+        }
+        return header[0];
+    }
+
+    virtual void load(const six::sidd::DerivedData& /*data*/,
+                      const sys::ubyte* imageData,
+                      size_t numBytes,
+                      size_t numBlocks)
+    {
+        mBlocks.assign(numBlocks, NULL);
+        for (size_t offset = 0; offset < numBytes; )
+        {
+            sys::Uint32_T header[2];
+            ::memcpy(header, imageData + offset, sizeof(header));
+            mBlocks.at(header[0]) = imageData + offset;
+            offset += header[1];
+        }
+    }
+
+    virtual void decompress(size_t blockIndex,
+                            const types::RowCol<size_t>& blockDims,
+                            sys::ubyte* block) const
+    {
+        const sys::ubyte* const compressed = mBlocks.at(blockIndex);
+        sys::Uint32_T header[2];
+        ::memcpy(header, compressed, sizeof(header));
+
+        const size_t numBytes = blockDims.area() * mNumBytesPerPixel;
+        size_t pos = 0;
+        for (size_t ii = sizeof(header); ii + 1 < header[1]; ii += 2)
+        {
+            if (pos + compressed[ii] > numBytes)
+            {
+                throw except::Exception(Ctxt("Block overflows"));
+            }
+            ::memset(block + pos, compressed[ii + 1], compressed[ii]);
+            pos += compressed[ii];
+        }
+        if (pos != numBytes)
+        {
+            throw except::Exception(Ctxt("Block is short"));
+        }
+    }
+
+private:
+    const size_t mNumBytesPerPixel;
+    std::vector<const sys::ubyte*> mBlocks;
+};
+
+inline std::auto_ptr<six::sidd::DerivedData>
+createData(const types::RowCol<size_t>& dims, six::PixelType pixelType)
+{
+    std::auto_ptr<six::sidd::DerivedData> data =
+            six::sidd::Utilities::createFakeDerivedData();
+    data->setNumRows(dims.row);
+    data->setNumCols(dims.col);
+    data->setPixelType(pixelType);
+    return data;
+}
+
+// Smooth with some runs so that it actually compresses
+inline std::vector<sys::ubyte>
+createCompressibleImage(const six::sidd::DerivedData& data)
+{
+    const size_t numBytes = data.getNumRows() * data.getNumCols() *
+            data.getNumBytesPerPixel();
+    std::vector<sys::ubyte> image(numBytes);
+    for (size_t ii = 0; ii < numBytes; ++ii)
+    {
+        image[ii] = static_cast<sys::ubyte>((ii / 5) % 7 + (ii / 997) * 3);
+    }
+    return image;
+}
+
+// Writes out a SIDD whose image is compressed in blocks
+inline void writeCompressedSIDD(const six::sidd::DerivedData& data,
+                                const std::vector<sys::ubyte>& image,
+                                const six::sidd::BlockCompressor& compressor,
+                                const types::RowCol<size_t>& blockDims,
+                                const std::string& pathname)
+{
+    six::sidd::CompressedSIDDEncoder encoder(data, compressor,
+                                             blockDims.row, blockDims.col);
+    encoder.encode(&image[0]);
+    const std::auto_ptr<six::sidd::CompressedSIDDByteProvider> byteProvider =
+            encoder.createByteProvider(std::vector<std::string>());
+
+    nitf::Off fileOffset;
+    nitf::NITFBufferList buffers;
+    byteProvider->getBytes(encoder.getCompressedData(), 0, data.getNumRows(),
+                           fileOffset, buffers);
+
+    io::FileOutputStream outStream(pathname);
+    for (size_t ii = 0; ii < buffers.mBuffers.size(); ++ii)
+    {
+        outStream.write(
+                static_cast<const sys::byte*>(buffers.mBuffers[ii].mData),
+                buffers.mBuffers[ii].mNumBytes);
+    }
+}
+
+#endif
@@ -0,0 +1,463 @@
+/* =========================================================================
+ * This file is part of six.sidd-c++
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2018, MDA Information Systems LLC
+ *
+ * six.sidd-c++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// Test program for CompressedSIDDEncoder
+// Encodes images with a simple run-length BlockCompressor for various
+// blockings and thread counts, checks that every block decodes back to the
+// original pixels in the right order, and that the byte provider turns the
+// result into a NITF with the expected layout.  Also, if six.sidd was built
+// with J2K support, J2K compresses and checks that NITRO's J2K reader decodes
+// the lossless codestream back to the original pixels.
+
+#include <string.h>
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <except/Exception.h>
+#include <io/FileOutputStream.h>
+#include <io/TempFile.h>
+#include <math/Round.h>
+#include <sys/Conf.h>
+#include <types/RowCol.h>
+#include <nitf/IOHandle.hpp>
+#include <nitf/NITFBufferList.hpp>
+#include <nitf/Reader.hpp>
+#include <nitf/Record.hpp>
+#include <six/sidd/CompressedSIDDEncoder.h>
+#include <six/sidd/J2KBlockCompressor.h>
+#include <six/sidd/Utilities.h>
+
+#include "TestUtilities.h"
+
+#ifdef SIX_HAVE_OPENJPEG
+#include <import/j2k.h>
+#endif
+
+namespace
+{
+bool checkBlocks(const six::sidd::DerivedData& data,
+                 const std::vector<sys::ubyte>& image,
+                 const six::sidd::CompressedSIDDEncoder& encoder,
+                 const types::RowCol<size_t>& blockDims)
+{
+    const types::RowCol<size_t> imageDims(data.getNumRows(),
+                                          data.getNumCols());
+    const size_t pixelBytes = data.getNumBytesPerPixel();
+    const size_t numBlocksPerRow =
+            math::ceilingDivide(imageDims.col, blockDims.col);
+
+    const std::vector<std::vector<size_t> >& bytesPerBlock =
+            encoder.getBytesPerBlock();
+    if (bytesPerBlock.size() != 1 ||
+        bytesPerBlock[0].size() != encoder.getNumBlocks() ||
+        encoder.getNumBlocks() != numBlocksPerRow *
+                math::ceilingDivide(imageDims.row, blockDims.row))
+    {
+        std::cerr << "Wrong number of blocks\n";
+        return false;
+    }
+
+    const sys::ubyte* compressed = encoder.getCompressedData();
+    std::vector<sys::ubyte> decompressed;
+    for (size_t block = 0; block < bytesPerBlock[0].size(); ++block)
+    {
+        if (RunLengthDecompressor::decode(compressed, decompressed) != block)
+        {
+            std::cerr << "Block " << block << " is out of order\n";
+            return false;
+        }
+        compressed += bytesPerBlock[0][block];
+
+        const types::RowCol<size_t> offset(
+                (block / numBlocksPerRow) * blockDims.row,
+                (block % numBlocksPerRow) * blockDims.col);
+        const types::RowCol<size_t> dims(
+                std::min(blockDims.row, imageDims.row - offset.row),
+                std::min(blockDims.col, imageDims.col - offset.col));
+        const size_t blockRowBytes = dims.col * pixelBytes;
+        if (decompressed.size() != dims.row * blockRowBytes)
+        {
+            std::cerr << "Block " << block << " is the wrong size\n";
+            return false;
+        }
+
+        for (size_t row = 0; row < dims.row; ++row)
+        {
+            const size_t imageOffset =
+                    ((offset.row + row) * imageDims.col + offset.col) *
+                    pixelBytes;
+            if (::memcmp(&decompressed[row * blockRowBytes],
+                         &image[imageOffset],
+                         blockRowBytes))
+            {
+                std::cerr << "Block " << block << " DOES NOT MATCH\n";
+                return false;
+            }
+        }
+    }
+
+    return (compressed == encoder.getCompressedData() +
+            encoder.getNumCompressedBytes());
+}
+
+bool testBlocks(six::PixelType pixelType)
+{
+    const std::auto_ptr<six::sidd::DerivedData> data =
+            createData(types::RowCol<size_t>(123, 79), pixelType);
+    const std::vector<sys::ubyte> image = createCompressibleImage(*data);
+    const RunLengthCompressor compressor(data->getNumBytesPerPixel());
+
+    const types::RowCol<size_t> blockings[] = {
+        types::RowCol<size_t>(0, 0),
+        types::RowCol<size_t>(7, 0),
+        types::RowCol<size_t>(16, 13),
+        types::RowCol<size_t>(200, 20)};
+
+    bool success = true;
+    for (size_t ii = 0; ii < 4; ++ii)
+    {
+        const types::RowCol<size_t> blockDims(
+                blockings[ii].row ?
+                        std::min(blockings[ii].row, data->getNumRows()) :
+                        data->getNumRows(),
+                blockings[ii].col ?
+                        std::min(blockings[ii].col, data->getNumCols()) :
+                        data->getNumCols());
+
+        std::vector<sys::ubyte> expected;
+        for (size_t numThreads = 1; numThreads <= 4; ++numThreads)
+        {
+            six::sidd::CompressedSIDDEncoder encoder(*data,
+                                                     compressor,
+                                                     blockings[ii].row,
+                                                     blockings[ii].col,
+                                                     numThreads);
+            encoder.encode(&image[0]);
+
+            const std::vector<sys::ubyte> actual(
+                    encoder.getCompressedData(),
+                    encoder.getCompressedData() +
+                            encoder.getNumCompressedBytes());
+            if (numThreads == 1)
+            {
+                expected = actual;
+            }
+
+            if (!checkBlocks(*data, image, encoder, blockDims) ||
+                actual != expected)
+            {
+                std::cerr << pixelType.toString() << " with "
+                          << blockings[ii].row << "x" << blockings[ii].col
+                          << " blocks and " << numThreads
+                          << " threads FAILS\n";
+                success = false;
+            }
+        }
+    }
+    return success;
+}
+
+bool testByteProvider()
+{
+    const std::auto_ptr<six::sidd::DerivedData> data = createData(
+            types::RowCol<size_t>(123, 79), six::PixelType::MONO8I);
+    const std::vector<sys::ubyte> image = createCompressibleImage(*data);
+    const RunLengthCompressor compressor(data->getNumBytesPerPixel());
+
+    six::sidd::CompressedSIDDEncoder encoder(*data, compressor, 32, 32, 2);
+    encoder.encode(&image[0]);
+    const std::auto_ptr<six::sidd::CompressedSIDDByteProvider> byteProvider =
+            encoder.createByteProvider(std::vector<std::string>());
+
+    nitf::Off fileOffset;
+    nitf::NITFBufferList buffers;
+    byteProvider->getBytes(encoder.getCompressedData(), 0, data->getNumRows(),
+                           fileOffset, buffers);
+    if (fileOffset != 0 ||
+        static_cast<nitf::Off>(buffers.getTotalNumBytes()) !=
+                byteProvider->getFileNumBytes())
+    {
+        std::cerr << "Byte provider gave back the wrong number of bytes\n";
+        return false;
+    }
+
+    const io::TempFile tempFile;
+    {
+        io::FileOutputStream outStream(tempFile.pathname());
+        for (size_t ii = 0; ii < buffers.mBuffers.size(); ++ii)
+        {
+            outStream.write(
+                    static_cast<const sys::byte*>(buffers.mBuffers[ii].mData),
+                    buffers.mBuffers[ii].mNumBytes);
+        }
+    }
+
+    nitf::IOHandle handle(tempFile.pathname(), NITF_ACCESS_READONLY,
+                          NITF_OPEN_EXISTING);
+    nitf::Reader reader;
+    nitf::Record record = reader.read(handle);
+    if (record.getNumImages() != 1)
+    {
+        std::cerr << "Compressed SIDD should be one image segment\n";
+        return false;
+    }
+
+    nitf::ImageSegment segment = record.getImages()[0];
+    nitf::ImageSubheader subheader = segment.getSubheader();
+    const std::string compression =
+            subheader.getImageCompression().toString();
+    const size_t numBlocksPerRow = static_cast<nitf::Uint32>(
+            subheader.getNumBlocksPerRow());
+    const size_t numBlocksPerCol = static_cast<nitf::Uint32>(
+            subheader.getNumBlocksPerCol());
+    const size_t imageLength = static_cast<size_t>(
+            segment.getImageEnd() - segment.getImageOffset());
+    if (compression != "C8" || numBlocksPerRow != 3 || numBlocksPerCol != 4 ||
+        imageLength != encoder.getNumCompressedBytes())
+    {
+        std::cerr << "NITF has the wrong layout: IC " << compression << ", "
+                  << numBlocksPerCol << "x" << numBlocksPerRow
+                  << " blocks, " << imageLength << " image bytes\n";
+        return false;
+    }
+    return true;
+}
+
+#ifdef SIX_HAVE_OPENJPEG
+// Closes the NITRO J2K reader and frees its tile buffer
+struct NITROJ2KReader
+{
+    NITROJ2KReader() :
+        reader(NULL),
+        tile(NULL)
+    {
+    }
+
+    ~NITROJ2KReader()
+    {
+        freeTile();
+        if (reader)
+        {
+            j2k_Reader_destruct(&reader);
+        }
+    }
+
+    void freeTile()
+    {
+        if (tile)
+        {
+            J2K_FREE(tile);
+            tile = NULL;
+        }
+    }
+
+    j2k_Reader* reader;
+    nrt_Uint8* tile;
+};
+
+// Decodes the codestream a tile at a time with NITRO's J2K reader, rather
+// than OpenJPEG directly, and checks each tile against the original pixels.
+// NITRO pads partial tiles out to the full tile width.
+bool checkNITRODecode(const six::sidd::DerivedData& data,
+                      const std::vector<sys::ubyte>& image,
+                      const sys::ubyte* codestream,
+                      size_t numBytes)
+{
+    const io::TempFile tempFile;
+    {
+        io::FileOutputStream outStream(tempFile.pathname());
+        outStream.write(reinterpret_cast<const sys::byte*>(codestream),
+                        numBytes);
+    }
+
+    nrt_Error error;
+    NITROJ2KReader j2k;
+    j2k.reader = j2k_Reader_open(tempFile.pathname().c_str(), &error);
+    j2k_Container* const container = j2k.reader ?
+            j2k_Reader_getContainer(j2k.reader, &error) : NULL;
+    if (!container)
+    {
+        std::cerr << "NITRO could not open the J2K codestream: "
+                  << error.message << "\n";
+        return false;
+    }
+
+    const size_t pixelBytes = data.getNumBytesPerPixel();
+    const types::RowCol<size_t> imageDims(data.getNumRows(),
+                                          data.getNumCols());
+    const types::RowCol<size_t> tileDims(
+            j2k_Container_getTileHeight(container, &error),
+            j2k_Container_getTileWidth(container, &error));
+    if (j2k_Container_getHeight(container, &error) != imageDims.row ||
+        j2k_Container_getWidth(container, &error) != imageDims.col ||
+        j2k_Container_getNumComponents(container, &error) != 1)
+    {
+        std::cerr << "NITRO decoded the wrong image size\n";
+        return false;
+    }
+
+    for (size_t tileRow = 0; tileRow * tileDims.row < imageDims.row;
+         ++tileRow)
+    {
+        for (size_t tileCol = 0; tileCol * tileDims.col < imageDims.col;
+             ++tileCol)
+        {
+            j2k.freeTile();
+            if (j2k_Reader_readTile(j2k.reader,
+                                    static_cast<nrt_Uint32>(tileCol),
+                                    static_cast<nrt_Uint32>(tileRow),
+                                    &j2k.tile, &error) == 0)
+            {
+                std::cerr << "NITRO could not decode tile (" << tileRow
+                          << ", " << tileCol << ")\n";
+                return false;
+            }
+
+            const size_t startRow = tileRow * tileDims.row;
+            const size_t startCol = tileCol * tileDims.col;
+            const size_t numRows =
+                    std::min(tileDims.row, imageDims.row - startRow);
+            const size_t rowBytes =
+                    std::min(tileDims.col, imageDims.col - startCol) *
+                    pixelBytes;
+            for (size_t row = 0; row < numRows; ++row)
+            {
+                const sys::ubyte* const expected = &image[
+                        ((startRow + row) * imageDims.col + startCol) *
+                        pixelBytes];
+                if (::memcmp(j2k.tile + row * tileDims.col * pixelBytes,
+                             expected, rowBytes))
+                {
+                    std::cerr << "Tile (" << tileRow << ", " << tileCol
+                              << ") differs on row " << row << "\n";
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+#endif
+
+bool testJ2K(six::PixelType pixelType)
+{
+    const std::auto_ptr<six::sidd::DerivedData> data = createData(
+            types::RowCol<size_t>(300, 200), pixelType);
+
+    if (!six::sidd::J2KBlockCompressor::isAvailable())
+    {
+        try
+        {
+            six::sidd::J2KBlockCompressor compressor(*data, 128, 128);
+            std::cerr << "J2KBlockCompressor should not be constructible\n";
+            return false;
+        }
+        catch (const except::Exception&)
+        {
+            std::cout << "Built without J2K support; skipping J2K test\n";
+            return true;
+        }
+    }
+
+    const std::vector<sys::ubyte> image = createCompressibleImage(*data);
+    const double byterates[] = {0.0, 0.25};
+    for (size_t ii = 0; ii < 2; ++ii)
+    {
+        const six::sidd::J2KBlockCompressor compressor(*data, 128, 128,
+                                                       byterates[ii]);
+        six::sidd::CompressedSIDDEncoder encoder(*data, compressor, 128, 128,
+                                                 2);
+        encoder.encode(&image[0]);
+
+        // Codestream starts with SOC and ends with EOC
+        const sys::ubyte* const compressed = encoder.getCompressedData();
+        const size_t numBytes = encoder.getNumCompressedBytes();
+        if (numBytes < 4 || compressed[0] != 0xFF || compressed[1] != 0x4F ||
+            compressed[numBytes - 2] != 0xFF ||
+            compressed[numBytes - 1] != 0xD9)
+        {
+            std::cerr << "J2K codestream is malformed\n";
+            return false;
+        }
+        std::cout << pixelType.toString() << " J2K with byterate "
+                  << byterates[ii] << ": " << numBytes << " bytes\n";
+
+#ifdef SIX_HAVE_OPENJPEG
+        // The blocks must form one codestream that another decoder reads
+        // back exactly
+        if (compressor.isNumericallyLossless() &&
+            !checkNITRODecode(*data, image, compressed, numBytes))
+        {
+            std::cerr << pixelType.toString()
+                      << " J2K did not round trip losslessly\n";
+            return false;
+        }
+#endif
+    }
+    return true;
+}
+}
+
+int main(int /*argc*/, char** /*argv*/)
+{
+    try
+    {
+        bool success = true;
+        success = testBlocks(six::PixelType::MONO8I) && success;
+        success = testBlocks(six::PixelType::MONO16I) && success;
+        success = testBlocks(six::PixelType::RGB24I) && success;
+        success = testByteProvider() && success;
+        success = testJ2K(six::PixelType::MONO8I) && success;
+        success = testJ2K(six::PixelType::MONO16I) && success;
+
+        if (success)
+        {
+            std::cout << "All tests pass!\n";
+        }
+        else
+        {
+            std::cerr << "Some tests FAIL!\n";
+        }
+
+        return (success ? 0 : 1);
+    }
+    catch (const std::exception& ex)
+    {
+        std::cerr << "Caught std::exception: " << ex.what() << std::endl;
+        return 1;
+    }
+    catch (const except::Exception& ex)
+    {
+        std::cerr << "Caught except::Exception: " << ex.getMessage()
+                  << std::endl;
+        return 1;
+    }
+    catch (...)
+    {
+        std::cerr << "Caught unknown exception\n";
+        return 1;
+    }
+}
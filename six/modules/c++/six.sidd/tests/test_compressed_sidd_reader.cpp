@@ -0,0 +1,400 @@
+/* =========================================================================
+ * This file is part of six.sidd-c++
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2018, MDA Information Systems LLC
+ *
+ * six.sidd-c++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// Test program for CompressedSIDDReader
+// Writes blocked SIDDs compressed with a simple run-length codec, then reads
+// regions back with various thread counts and checks them against the
+// original pixels.  Also checks that cached blocks aren't decompressed again,
+// that J2KBlockDecompressor finds the tile-parts of hand-built codestreams,
+// and, with J2K support, round trips J2K SIDDs.
+
+#include <string.h>
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <except/Exception.h>
+#include <io/TempFile.h>
+#include <mem/ScopedArray.h>
+#include <sys/Conf.h>
+#include <types/Range.h>
+#include <types/RowCol.h>
+#include <six/sidd/CompressedSIDDReader.h>
+#include <six/sidd/J2KBlockCompressor.h>
+#include <six/sidd/J2KBlockDecompressor.h>
+#include <six/sidd/Utilities.h>
+
+#include "TestUtilities.h"
+
+namespace
+{
+bool checkRegion(six::sidd::CompressedSIDDReader& reader,
+                 const std::vector<sys::ubyte>& image,
+                 size_t startRow,
+                 size_t startCol,
+                 sys::SSize_T numRows,
+                 sys::SSize_T numCols)
+{
+    const six::sidd::DerivedData& data = reader.getDerivedData();
+    const size_t pixelBytes = data.getNumBytesPerPixel();
+
+    six::Region region;
+    region.setStartRow(startRow);
+    region.setStartCol(startCol);
+    region.setNumRows(numRows);
+    region.setNumCols(numCols);
+    const mem::ScopedArray<six::UByte> buffer(reader.interleaved(region));
+
+    const size_t rowBytes = region.getNumCols() * pixelBytes;
+    for (sys::SSize_T row = 0; row < region.getNumRows(); ++row)
+    {
+        const sys::ubyte* const expected = &image[
+                ((startRow + row) * data.getNumCols() + startCol) *
+                pixelBytes];
+        if (::memcmp(buffer.get() + row * rowBytes, expected, rowBytes))
+        {
+            std::cerr << "Region at (" << startRow << ", " << startCol
+                      << ") differs on row " << row << "\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+bool testRegions(six::PixelType pixelType,
+                 const types::RowCol<size_t>& blockDims)
+{
+    const std::auto_ptr<six::sidd::DerivedData> data = createData(
+            types::RowCol<size_t>(123, 79), pixelType);
+    const std::vector<sys::ubyte> image = createCompressibleImage(*data);
+    const io::TempFile tempFile;
+    writeCompressedSIDD(*data, image,
+                        RunLengthCompressor(data->getNumBytesPerPixel()),
+                        blockDims, tempFile.pathname());
+
+    for (size_t numThreads = 1; numThreads <= 4; numThreads += 3)
+    {
+        RunLengthDecompressor decompressor(data->getNumBytesPerPixel());
+        six::sidd::CompressedSIDDReader reader(tempFile.pathname(),
+                                               std::vector<std::string>(),
+                                               decompressor,
+                                               0,
+                                               numThreads);
+        if (!checkRegion(reader, image, 0, 0, -1, -1) ||
+            !checkRegion(reader, image, 5, 7, 40, 50) ||
+            !checkRegion(reader, image, 31, 31, 2, 2) ||
+            !checkRegion(reader, image, 100, 60, 23, 19) ||
+            !checkRegion(reader, image, 64, 0, 1, 79))
+        {
+            std::cerr << "Failed for " << pixelType.toString() << " with "
+                      << blockDims.row << "x" << blockDims.col
+                      << " blocks and " << numThreads << " threads\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+bool testCache()
+{
+    const std::auto_ptr<six::sidd::DerivedData> data = createData(
+            types::RowCol<size_t>(128, 128), six::PixelType::MONO8I);
+    const std::vector<sys::ubyte> image = createCompressibleImage(*data);
+    const io::TempFile tempFile;
+    writeCompressedSIDD(*data, image,
+                        RunLengthCompressor(data->getNumBytesPerPixel()),
+                        types::RowCol<size_t>(32, 32), tempFile.pathname());
+
+    RunLengthDecompressor decompressor(data->getNumBytesPerPixel());
+    six::sidd::CompressedSIDDReader reader(tempFile.pathname(),
+                                           std::vector<std::string>(),
+                                           decompressor, 0, 2, 4);
+
+    // 4 blocks, then the same 4 again
+    if (!checkRegion(reader, image, 0, 0, 64, 64) ||
+        !checkRegion(reader, image, 10, 10, 40, 40) ||
+        reader.getNumBlocksDecompressed() != 4)
+    {
+        std::cerr << "Cached blocks were decompressed again\n";
+        return false;
+    }
+
+    // Use block 0 again so that block 1 is the least recently used.  Then
+    // a new block pushes out block 1 but not block 0.
+    if (!checkRegion(reader, image, 0, 0, 32, 32) ||
+        !checkRegion(reader, image, 0, 64, 32, 32) ||
+        reader.getNumBlocksDecompressed() != 5 ||
+        !checkRegion(reader, image, 0, 0, 32, 32) ||
+        reader.getNumBlocksDecompressed() != 5 ||
+        !checkRegion(reader, image, 0, 32, 32, 32) ||
+        reader.getNumBlocksDecompressed() != 6)
+    {
+        std::cerr << "Cache kept the wrong blocks: "
+                  << reader.getNumBlocksDecompressed()
+                  << " blocks decompressed\n";
+        return false;
+    }
+
+    // A region of more blocks than the cache holds keeps the last ones
+    six::sidd::CompressedSIDDReader bigRegionReader(
+            tempFile.pathname(), std::vector<std::string>(), decompressor,
+            0, 2, 4);
+    if (!checkRegion(bigRegionReader, image, 0, 0, 64, 128) ||
+        bigRegionReader.getNumBlocksDecompressed() != 8 ||
+        !checkRegion(bigRegionReader, image, 32, 0, 32, 128) ||
+        bigRegionReader.getNumBlocksDecompressed() != 8 ||
+        !checkRegion(bigRegionReader, image, 0, 0, 32, 128) ||
+        bigRegionReader.getNumBlocksDecompressed() != 12)
+    {
+        std::cerr << "Cache kept the wrong blocks of a big region: "
+                  << bigRegionReader.getNumBlocksDecompressed()
+                  << " blocks decompressed\n";
+        return false;
+    }
+    return true;
+}
+
+// Appends a 16-bit big-endian value
+void appendUint16(size_t value, std::vector<sys::ubyte>& codestream)
+{
+    codestream.push_back(static_cast<sys::ubyte>((value >> 8) & 0xFF));
+    codestream.push_back(static_cast<sys::ubyte>(value & 0xFF));
+}
+
+/*
+ * Appends a tile-part: its SOT marker segment, an SOD and 'numDataBytes' of
+ * filler.  Psot is 0 if 'toEOC' is set.
+ *
+ * \return The tile-part's byte range
+ */
+types::Range appendTilePart(size_t tile,
+                            size_t part,
+                            size_t numParts,
+                            size_t numDataBytes,
+                            bool toEOC,
+                            std::vector<sys::ubyte>& codestream)
+{
+    const size_t start = codestream.size();
+    const size_t length = 12 + 2 + numDataBytes;
+    appendUint16(0xFF90, codestream);
+    appendUint16(10, codestream);
+    appendUint16(tile, codestream);
+    appendUint16(toEOC ? 0 : length >> 16, codestream);
+    appendUint16(toEOC ? 0 : length & 0xFFFF, codestream);
+    codestream.push_back(static_cast<sys::ubyte>(part));
+    codestream.push_back(static_cast<sys::ubyte>(numParts));
+    appendUint16(0xFF93, codestream);
+    codestream.insert(codestream.end(), numDataBytes,
+                      static_cast<sys::ubyte>(tile + 1));
+    return types::Range(start, length);
+}
+
+/*
+ * A codestream with two tiles, each in two tile-parts that are interleaved.
+ * The last tile-part's Psot is 0 if 'lastToEOC' is set.
+ */
+std::vector<sys::ubyte> createCodestream(
+        bool lastToEOC,
+        size_t& mainHeaderLength,
+        std::vector<std::vector<types::Range> >& tileParts)
+{
+    std::vector<sys::ubyte> codestream;
+    appendUint16(0xFF4F, codestream);
+
+    // A comment stands in for the rest of the main header
+    appendUint16(0xFF64, codestream);
+    appendUint16(6, codestream);
+    appendUint16(1, codestream);
+    codestream.push_back('h');
+    codestream.push_back('i');
+    mainHeaderLength = codestream.size();
+
+    tileParts.assign(2, std::vector<types::Range>());
+    tileParts[0].push_back(appendTilePart(0, 0, 2, 5, false, codestream));
+    tileParts[1].push_back(appendTilePart(1, 0, 2, 3, false, codestream));
+    tileParts[0].push_back(appendTilePart(0, 1, 2, 7, false, codestream));
+    tileParts[1].push_back(appendTilePart(1, 1, 2, 4, lastToEOC, codestream));
+    appendUint16(0xFFD9, codestream);
+    return codestream;
+}
+
+bool loadFails(const six::sidd::DerivedData& data,
+               const std::vector<sys::ubyte>& codestream,
+               size_t numBytes,
+               size_t numBlocks)
+{
+    try
+    {
+        six::sidd::J2KBlockDecompressor decompressor;
+        decompressor.load(data, &codestream[0], numBytes, numBlocks);
+        return false;
+    }
+    catch (const except::Exception&)
+    {
+        return true;
+    }
+}
+
+// Walks hand-built codestreams without decoding them, so this runs with or
+// without J2K support
+bool testJ2KParsing()
+{
+    const std::auto_ptr<six::sidd::DerivedData> data = createData(
+            types::RowCol<size_t>(16, 32), six::PixelType::MONO8I);
+
+    for (int lastToEOC = 0; lastToEOC <= 1; ++lastToEOC)
+    {
+        size_t mainHeaderLength;
+        std::vector<std::vector<types::Range> > tileParts;
+        const std::vector<sys::ubyte> codestream =
+                createCodestream(lastToEOC != 0, mainHeaderLength, tileParts);
+
+        six::sidd::J2KBlockDecompressor decompressor;
+        decompressor.load(*data, &codestream[0], codestream.size(), 2);
+        if (decompressor.getMainHeaderLength() != mainHeaderLength ||
+            decompressor.getTileParts(0) != tileParts[0] ||
+            decompressor.getTileParts(1) != tileParts[1])
+        {
+            std::cerr << "Tile-parts were not found correctly with"
+                      << (lastToEOC ? "" : "out") << " Psot of 0\n";
+            return false;
+        }
+
+        // Cut off before the EOC, inside the last tile-part, between
+        // tile-parts, inside a tile-part header and inside the main header.
+        // Also too few or too many tiles.
+        const size_t lastPartStart = tileParts[1][1].mStartElement;
+        const size_t numBytes[] = {
+                codestream.size() - 2,
+                codestream.size() - 4,
+                lastPartStart,
+                lastPartStart + 6,
+                tileParts[0][1].mStartElement + 20,
+                mainHeaderLength - 1};
+        for (size_t ii = 0; ii < sizeof(numBytes) / sizeof(numBytes[0]); ++ii)
+        {
+            if (!loadFails(*data, codestream, numBytes[ii], 2))
+            {
+                std::cerr << "Codestream truncated to " << numBytes[ii]
+                          << " bytes was accepted\n";
+                return false;
+            }
+        }
+        if (!loadFails(*data, codestream, codestream.size(), 1) ||
+            !loadFails(*data, codestream, codestream.size(), 3))
+        {
+            std::cerr << "Wrong number of tiles was accepted\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+bool testJ2K(six::PixelType pixelType,
+             const types::RowCol<size_t>& blockDims)
+{
+    const std::auto_ptr<six::sidd::DerivedData> data = createData(
+            types::RowCol<size_t>(123, 79), pixelType);
+    const std::vector<sys::ubyte> image = createCompressibleImage(*data);
+    const io::TempFile tempFile;
+    writeCompressedSIDD(*data, image,
+                        six::sidd::J2KBlockCompressor(*data,
+                                                      blockDims.row,
+                                                      blockDims.col),
+                        blockDims, tempFile.pathname());
+
+    six::sidd::J2KBlockDecompressor decompressor;
+    six::sidd::CompressedSIDDReader reader(tempFile.pathname(),
+                                           std::vector<std::string>(),
+                                           decompressor,
+                                           0,
+                                           3);
+    if (!checkRegion(reader, image, 0, 0, -1, -1) ||
+        !checkRegion(reader, image, 5, 7, 40, 50) ||
+        !checkRegion(reader, image, 100, 60, 23, 19))
+    {
+        std::cerr << "J2K failed for " << pixelType.toString() << " with "
+                  << blockDims.row << "x" << blockDims.col << " blocks\n";
+        return false;
+    }
+    return true;
+}
+
+bool testJ2K()
+{
+    if (!six::sidd::J2KBlockCompressor::isAvailable())
+    {
+        std::cout << "Built without J2K support; skipping J2K round trip\n";
+        return true;
+    }
+
+    return testJ2K(six::PixelType::MONO8I, types::RowCol<size_t>(32, 32)) &&
+            testJ2K(six::PixelType::MONO16I, types::RowCol<size_t>(64, 40)) &&
+            testJ2K(six::PixelType::RGB24I, types::RowCol<size_t>(50, 30));
+}
+}
+
+int main(int /*argc*/, char** /*argv*/)
+{
+    try
+    {
+        bool success = true;
+        success = testRegions(six::PixelType::MONO8I,
+                              types::RowCol<size_t>(32, 32)) && success;
+        success = testRegions(six::PixelType::MONO16I,
+                              types::RowCol<size_t>(16, 0)) && success;
+        success = testRegions(six::PixelType::RGB24I,
+                              types::RowCol<size_t>(50, 30)) && success;
+        success = testCache() && success;
+        success = testJ2KParsing() && success;
+        success = testJ2K() && success;
+
+        if (success)
+        {
+            std::cout << "All tests pass!\n";
+        }
+        else
+        {
+            std::cerr << "Some tests FAIL!\n";
+        }
+
+        return (success ? 0 : 1);
+    }
+    catch (const std::exception& ex)
+    {
+        std::cerr << "Caught std::exception: " << ex.what() << std::endl;
+        return 1;
+    }
+    catch (const except::Exception& ex)
+    {
+        std::cerr << "Caught except::Exception: " << ex.getMessage()
+                  << std::endl;
+        return 1;
+    }
+    catch (...)
+    {
+        std::cerr << "Caught unknown exception\n";
+        return 1;
+    }
+}
@@ -0,0 +1,410 @@
+/* =========================================================================
+ * This file is part of six.sidd-c++
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2018, MDA Information Systems LLC
+ *
+ * six.sidd-c++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// Test program for DisplayRemapper
+// Remaps a synthetic complex image with each remap type and checks the
+// output against straightforward evaluations of the remap formulas.  Also
+// checks that row blocks, threads and short runs of pixels don't change the
+// results.
+
+#include <math.h>
+#include <string.h>
+
+#include <complex>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <except/Exception.h>
+#include <sys/Conf.h>
+#include <types/RowCol.h>
+#include <six/Init.h>
+#include <six/sidd/DisplayRemapper.h>
+
+namespace
+{
+const types::RowCol<size_t> DIMS(37, 53);
+
+// Amplitudes spread over several orders of magnitude, with some zeros
+std::vector<std::complex<float> > createImage()
+{
+    std::vector<std::complex<float> > image(DIMS.area());
+    for (size_t ii = 0; ii < image.size(); ++ii)
+    {
+        const double amplitude = (ii % 97 == 0) ?
+                0 : ::exp((ii * 7919 % 1000) / 125.0 - 3);
+        const double phase = ii * 0.37;
+        image[ii] = std::complex<float>(
+                static_cast<float>(amplitude * ::cos(phase)),
+                static_cast<float>(amplitude * ::sin(phase)));
+    }
+    return image;
+}
+
+struct Reference
+{
+    Reference(const std::string& remapType) :
+        remapType(remapType),
+        dMin(30),
+        mMult(40),
+        clipMin(0),
+        clipMax(255)
+    {
+    }
+
+    // The remap of one amplitude, on the 8-bit scale
+    double remap(double amplitude,
+                 const std::vector<std::complex<float> >& image) const
+    {
+        double sum(0);
+        double minAmp(1e30);
+        double minNonzero(1e30);
+        double maxAmp(0);
+        for (size_t ii = 0; ii < image.size(); ++ii)
+        {
+            const double value = std::abs(image[ii]);
+            sum += value;
+            minAmp = std::min(minAmp, value);
+            maxAmp = std::max(maxAmp, value);
+            if (value > 0)
+            {
+                minNonzero = std::min(minNonzero, value);
+            }
+        }
+
+        if (remapType == "Linear")
+        {
+            return 255 * (amplitude - minAmp) / (maxAmp - minAmp);
+        }
+        if (remapType == "Log")
+        {
+            return 255 * ::log(std::max(amplitude, minNonzero) / minNonzero) /
+                    ::log(maxAmp / minNonzero);
+        }
+
+        // SIPS density
+        const double lowClip = 0.8 * sum / image.size();
+        const double highClip = mMult * lowClip;
+        const double slope = (255 - dMin) / ::log10(highClip / lowClip);
+        const double intercept = dMin - slope * ::log10(lowClip);
+        double value = slope * ::log10(std::max(amplitude, 1e-5)) + intercept;
+        if (remapType == "PEDF" && value > 127.5)
+        {
+            value = 0.5 * (value + 127.5);
+        }
+        return value;
+    }
+
+    std::string remapType;
+    double dMin;
+    double mMult;
+    double clipMin;
+    double clipMax;
+};
+
+bool checkOutput(const Reference& reference,
+                 const std::vector<std::complex<float> >& image,
+                 six::PixelType pixelType,
+                 const std::vector<six::UByte>& output)
+{
+    const double maxValue = (pixelType == six::PixelType::MONO16I) ?
+            65535 : 255;
+    for (size_t ii = 0; ii < image.size(); ++ii)
+    {
+        double expected = reference.remap(std::abs(image[ii]), image);
+        expected = (expected - reference.clipMin) * maxValue /
+                (reference.clipMax - reference.clipMin);
+        expected = std::min(std::max(expected, 0.0), maxValue);
+
+        const double actual = (pixelType == six::PixelType::MONO16I) ?
+                reinterpret_cast<const sys::Uint16_T*>(&output[0])[ii] :
+                output[ii];
+        if (::fabs(actual - expected) > 1)
+        {
+            std::cerr << reference.remapType << " to "
+                      << pixelType.toString() << " gave " << actual
+                      << " instead of " << expected << " for pixel " << ii
+                      << "\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+std::vector<six::UByte> remapImage(six::sidd::DisplayRemapper& remapper,
+                                   const std::vector<std::complex<float> >& image)
+{
+    const size_t pixelBytes =
+            (remapper.getPixelType() == six::PixelType::MONO16I) ? 2 : 1;
+    std::vector<six::UByte> output(image.size() * pixelBytes);
+    remapper.accumulateStatistics(&image[0], DIMS);
+    remapper.remap(&image[0], DIMS, &output[0]);
+    return output;
+}
+
+bool testRemap(const std::string& remapType, six::PixelType pixelType)
+{
+    const std::vector<std::complex<float> > image = createImage();
+    for (size_t numThreads = 1; numThreads <= 4; numThreads += 3)
+    {
+        six::sidd::DisplayRemapper remapper(remapType, pixelType, numThreads);
+        if (!checkOutput(Reference(remapType), image, pixelType,
+                         remapImage(remapper, image)))
+        {
+            std::cerr << "Failed with " << numThreads << " threads\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+bool testVariations()
+{
+    const std::vector<std::complex<float> > image = createImage();
+
+    six::sidd::DisplayRemapper brighter("brighter", six::PixelType::MONO8I);
+    Reference brighterReference("Density");
+    brighterReference.dMin = 60;
+
+    six::sidd::DisplayRemapper highContrast("High-Contrast",
+                                            six::PixelType::MONO8I);
+    Reference highContrastReference("Density");
+    highContrastReference.mMult = 4;
+
+    return checkOutput(brighterReference, image, six::PixelType::MONO8I,
+                       remapImage(brighter, image)) &&
+            checkOutput(highContrastReference, image, six::PixelType::MONO8I,
+                        remapImage(highContrast, image));
+}
+
+bool testRowBlocks()
+{
+    const std::vector<std::complex<float> > image = createImage();
+    six::sidd::DisplayRemapper whole("PEDF", six::PixelType::MONO16I);
+    const std::vector<six::UByte> expected = remapImage(whole, image);
+
+    // Stream the statistics and then the remap through in two row blocks
+    six::sidd::DisplayRemapper blocked("PEDF", six::PixelType::MONO16I, 3);
+    const types::RowCol<size_t> firstDims(20, DIMS.col);
+    const types::RowCol<size_t> secondDims(DIMS.row - 20, DIMS.col);
+    const std::complex<float>* const secondPixels = &image[firstDims.area()];
+    blocked.accumulateStatistics(&image[0], firstDims);
+    blocked.accumulateStatistics(secondPixels, secondDims);
+
+    const six::SampleStatistics& stats = blocked.getStatistics();
+    const six::SampleStatistics& wholeStats = whole.getStatistics();
+    if (stats.getCount() != wholeStats.getCount() ||
+        stats.getMin() != wholeStats.getMin() ||
+        stats.getMinPositive() != wholeStats.getMinPositive() ||
+        stats.getMax() != wholeStats.getMax() ||
+        ::fabs(stats.getMean() / wholeStats.getMean() - 1) > 1e-6)
+    {
+        std::cerr << "Row block statistics differ\n";
+        return false;
+    }
+
+    std::vector<six::UByte> output(expected.size());
+    blocked.remap(&image[0], firstDims, &output[0]);
+    blocked.remap(secondPixels, secondDims, &output[firstDims.area() * 2]);
+    for (size_t ii = 0; ii < DIMS.area(); ++ii)
+    {
+        const int difference =
+                reinterpret_cast<const sys::Uint16_T*>(&output[0])[ii] -
+                reinterpret_cast<const sys::Uint16_T*>(&expected[0])[ii];
+        if (difference < -1 || difference > 1)
+        {
+            std::cerr << "Row blocks differ at pixel " << ii << "\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+// The SIMD kernels handle pixels in groups, with the leftovers done
+// separately.  Short runs of pixels, at odd offsets, must remap exactly as
+// they do as part of the whole image.
+bool testShortRuns(const std::string& remapType, six::PixelType pixelType)
+{
+    const std::vector<std::complex<float> > image = createImage();
+    six::sidd::DisplayRemapper remapper(remapType, pixelType);
+    const std::vector<six::UByte> expected = remapImage(remapper, image);
+    const size_t pixelBytes = expected.size() / image.size();
+
+    size_t start = 1;
+    for (size_t numPixels = 1; numPixels <= 19; start += numPixels++)
+    {
+        std::vector<six::UByte> output(numPixels * pixelBytes);
+        remapper.remap(&image[start], types::RowCol<size_t>(1, numPixels),
+                       &output[0]);
+        if (::memcmp(&output[0], &expected[start * pixelBytes],
+                     output.size()))
+        {
+            std::cerr << remapType << " to " << pixelType.toString()
+                      << " differs for " << numPixels << " pixels at "
+                      << start << "\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+bool testDisplay()
+{
+    const std::vector<std::complex<float> > image = createImage();
+
+    six::sidd::Display display;
+    display.pixelType = six::PixelType::MONO8LU;
+    six::sidd::MonochromeDisplayRemap* const monoRemap =
+            new six::sidd::MonochromeDisplayRemap("PEDF");
+    six::Parameter dMin;
+    dMin.setName("DMin");
+    dMin.setValue(10);
+    monoRemap->remapParameters.push_back(dMin);
+    display.remapInformation.reset(monoRemap);
+    display.histogramOverrides.reset(new six::sidd::DRAHistogramOverrides());
+    display.histogramOverrides->clipMin = 20;
+    display.histogramOverrides->clipMax = 200;
+
+    six::sidd::DisplayRemapper remapper(display, 2);
+    Reference reference("PEDF");
+    reference.dMin = 10;
+    reference.clipMin = 20;
+    reference.clipMax = 200;
+    if (!checkOutput(reference, image, six::PixelType::MONO8LU,
+                     remapImage(remapper, image)))
+    {
+        return false;
+    }
+
+    // Color products default to Density
+    display.pixelType = six::PixelType::RGB8LU;
+    display.remapInformation.reset(new six::sidd::ColorDisplayRemap());
+    display.histogramOverrides.reset();
+    six::sidd::DisplayRemapper colorRemapper(display);
+    return checkOutput(Reference("Density"), image, six::PixelType::RGB8LU,
+                       remapImage(colorRemapper, image));
+}
+
+bool testLUT()
+{
+    six::LUT lut(256, 3);
+    for (size_t ii = 0; ii < 256; ++ii)
+    {
+        lut[ii][0] = static_cast<six::UByte>(ii);
+        lut[ii][1] = static_cast<six::UByte>(255 - ii);
+        lut[ii][2] = 7;
+    }
+
+    const six::UByte pixels[] = {0, 200, 17};
+    const six::UByte expected[] = {0, 255, 7, 200, 55, 7, 17, 238, 7};
+    six::UByte output[9];
+    six::sidd::DisplayRemapper::applyLUT(lut, pixels, 3, output);
+    if (::memcmp(output, expected, sizeof(expected)))
+    {
+        std::cerr << "Lookup table was applied incorrectly\n";
+        return false;
+    }
+    return true;
+}
+
+bool testErrors()
+{
+    if (six::sidd::DisplayRemapper::isSupported("NRL") ||
+        !six::sidd::DisplayRemapper::isSupported("darker"))
+    {
+        std::cerr << "Wrong remap types supported\n";
+        return false;
+    }
+
+    try
+    {
+        six::sidd::DisplayRemapper remapper("Log", six::PixelType::RGB24I);
+        std::cerr << "RGB24I output should be rejected\n";
+        return false;
+    }
+    catch (const except::Exception&)
+    {
+    }
+
+    try
+    {
+        six::sidd::DisplayRemapper remapper("Log", six::PixelType::MONO8I);
+        six::UByte output;
+        const std::complex<float> pixel(1, 1);
+        remapper.remap(&pixel, types::RowCol<size_t>(1, 1), &output);
+        std::cerr << "Remapping without statistics should fail\n";
+        return false;
+    }
+    catch (const except::Exception&)
+    {
+    }
+    return true;
+}
+}
+
+int main(int /*argc*/, char** /*argv*/)
+{
+    try
+    {
+        bool success = true;
+        success = testRemap("Linear", six::PixelType::MONO8I) && success;
+        success = testRemap("Log", six::PixelType::MONO16I) && success;
+        success = testRemap("Density", six::PixelType::MONO8I) && success;
+        success = testRemap("Density", six::PixelType::MONO16I) && success;
+        success = testRemap("PEDF", six::PixelType::MONO8I) && success;
+        success = testVariations() && success;
+        success = testRowBlocks() && success;
+        success = testShortRuns("Linear", six::PixelType::MONO8I) && success;
+        success = testShortRuns("Log", six::PixelType::MONO16I) && success;
+        success = testShortRuns("PEDF", six::PixelType::MONO8I) && success;
+        success = testDisplay() && success;
+        success = testLUT() && success;
+        success = testErrors() && success;
+
+        if (success)
+        {
+            std::cout << "All tests pass!\n";
+        }
+        else
+        {
+            std::cerr << "Some tests FAIL!\n";
+        }
+
+        return (success ? 0 : 1);
+    }
+    catch (const std::exception& ex)
+    {
+        std::cerr << "Caught std::exception: " << ex.what() << std::endl;
+        return 1;
+    }
+    catch (const except::Exception& ex)
+    {
+        std::cerr << "Caught except::Exception: " << ex.getMessage()
+                  << std::endl;
+        return 1;
+    }
+    catch (...)
+    {
+        std::cerr << "Caught unknown exception\n";
+        return 1;
+    }
+}
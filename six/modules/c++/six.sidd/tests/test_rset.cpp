@@ -0,0 +1,331 @@
+/* =========================================================================
+ * This file is part of six.sidd-c++
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2018, MDA Information Systems LLC
+ *
+ * six.sidd-c++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// Test program for reduced resolution sets
+// Writes SIDDs with several reduced resolution levels, then reads each
+// level back and checks it against straightforward box averages of the
+// full resolution image.
+
+#include <math.h>
+#include <string.h>
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <except/Exception.h>
+#include <io/TempFile.h>
+#include <math/Round.h>
+#include <mem/ScopedArray.h>
+#include <mem/SharedPtr.h>
+#include <sys/Conf.h>
+#include <sys/OS.h>
+#include <types/RowCol.h>
+#include <six/Container.h>
+#include <six/NITFWriteControl.h>
+#include <six/sidd/DerivedXMLControl.h>
+#include <six/sidd/ReducedResolutionSet.h>
+#include <six/sidd/Utilities.h>
+
+#include "TestUtilities.h"
+
+namespace
+{
+// Different values in every sample, in native byte order
+std::vector<sys::ubyte> createImage(const six::sidd::DerivedData& data)
+{
+    const size_t numSamples = data.getNumRows() * data.getNumCols() *
+            ((data.getPixelType() == six::PixelType::RGB24I) ? 3 : 1);
+    std::vector<sys::ubyte> image(data.getNumRows() * data.getNumCols() *
+                                  data.getNumBytesPerPixel());
+    for (size_t ii = 0; ii < numSamples; ++ii)
+    {
+        if (data.getPixelType() == six::PixelType::MONO16I)
+        {
+            reinterpret_cast<sys::Uint16_T*>(&image[0])[ii] =
+                    static_cast<sys::Uint16_T>(ii * 37 % 65521);
+        }
+        else
+        {
+            image[ii] = static_cast<sys::ubyte>(ii * 7 % 251);
+        }
+    }
+    return image;
+}
+
+// Averages each factor x factor box, or what's left of one on the edges
+template <typename T>
+std::vector<T> boxAverage(const T* image,
+                          const types::RowCol<size_t>& dims,
+                          size_t numBands,
+                          size_t factor)
+{
+    const types::RowCol<size_t> outDims(math::ceilingDivide(dims.row, factor),
+                                        math::ceilingDivide(dims.col, factor));
+    std::vector<T> output;
+    for (size_t row = 0; row < outDims.row; ++row)
+    {
+        for (size_t col = 0; col < outDims.col; ++col)
+        {
+            for (size_t band = 0; band < numBands; ++band)
+            {
+                double sum = 0;
+                size_t count = 0;
+                for (size_t ii = row * factor;
+                     ii < std::min(dims.row, (row + 1) * factor);
+                     ++ii)
+                {
+                    for (size_t jj = col * factor;
+                         jj < std::min(dims.col, (col + 1) * factor);
+                         ++jj)
+                    {
+                        sum += image[(ii * dims.col + jj) * numBands + band];
+                        ++count;
+                    }
+                }
+                output.push_back(static_cast<T>(::floor(sum / count + 0.5)));
+            }
+        }
+    }
+    return output;
+}
+
+void writeSIDD(const six::sidd::DerivedData& data,
+               const std::vector<sys::ubyte>& image,
+               const std::string& pathname)
+{
+    mem::SharedPtr<six::Container> container(
+            new six::Container(six::DataType::DERIVED));
+    container->addData(data.clone());
+
+    six::XMLControlRegistry xmlRegistry;
+    xmlRegistry.addCreator(six::DataType::DERIVED,
+                           new six::XMLControlCreatorT<
+                                   six::sidd::DerivedXMLControl>());
+
+    six::NITFWriteControl writer;
+    writer.setXMLControlRegistry(&xmlRegistry);
+    writer.initialize(container);
+
+    six::BufferList buffers(1, &image[0]);
+    writer.save(buffers, pathname, std::vector<std::string>());
+}
+
+bool testPathnames()
+{
+    if (six::sidd::getRSetPathname("foo.nitf", 0, 2) != "foo.0.r2.nitf" ||
+        six::sidd::getRSetPathname("a.b/foo", 1, 1) != "a.b/foo.1.r1" ||
+        six::sidd::getRSetPathname("foo.nitf", 0, 0) != "foo.nitf")
+    {
+        std::cerr << "Wrong R-set pathnames\n";
+        return false;
+    }
+    return true;
+}
+
+bool testReducedData()
+{
+    const std::auto_ptr<six::sidd::DerivedData> data = createData(
+            types::RowCol<size_t>(123, 79), six::PixelType::MONO8I);
+    const std::auto_ptr<six::sidd::DerivedData> reduced =
+            six::sidd::createReducedData(*data, 2);
+
+    // Pixel centers of the 4x4 boxes
+    const six::sidd::GeometricChip* const chip =
+            reduced->downstreamReprocessing.get() ?
+                    reduced->downstreamReprocessing->geometricChip.get() :
+                    NULL;
+    if (reduced->getNumRows() != 31 || reduced->getNumCols() != 20 ||
+        chip == NULL ||
+        chip->originalUpperLeftCoordinate != six::RowColDouble(1.5, 1.5) ||
+        chip->originalLowerRightCoordinate !=
+                six::RowColDouble(121.5, 77.5) ||
+        chip->originalLowerLeftCoordinate != six::RowColDouble(121.5, 1.5))
+    {
+        std::cerr << "Reduced metadata is wrong\n";
+        return false;
+    }
+    return true;
+}
+
+bool testSubsample()
+{
+    const std::auto_ptr<six::sidd::DerivedData> data = createData(
+            types::RowCol<size_t>(5, 3), six::PixelType::MONO8LU);
+    const sys::ubyte input[] = {0, 1, 2,
+                                3, 4, 5,
+                                6, 7, 8,
+                                9, 10, 11,
+                                12, 13, 14};
+    const sys::ubyte expected[] = {0, 2, 6, 8, 12, 14};
+    sys::ubyte output[6];
+    six::sidd::halveResolution(*data, input, output);
+    if (::memcmp(output, expected, sizeof(expected)))
+    {
+        std::cerr << "Lookup table pixels should be subsampled\n";
+        return false;
+    }
+    return true;
+}
+
+template <typename T>
+bool testLevels(six::PixelType pixelType, size_t numBands)
+{
+    const std::auto_ptr<six::sidd::DerivedData> data = createData(
+            types::RowCol<size_t>(123, 79), pixelType);
+    const types::RowCol<size_t> dims(data->getNumRows(), data->getNumCols());
+    const std::vector<sys::ubyte> image = createImage(*data);
+    const size_t numLevels = 3;
+
+    const io::TempFile tempFile;
+    writeSIDD(*data, image, tempFile.pathname());
+    six::sidd::writeRSet(*data, &image[0], tempFile.pathname(),
+                         std::vector<std::string>(), numLevels, 0, 16, 16);
+
+    bool success = true;
+    {
+        six::sidd::RSetReader reader(tempFile.pathname(),
+                                     std::vector<std::string>());
+        if (reader.getNumImages() != 1 ||
+            reader.getNumLevels(0) != numLevels + 1 ||
+            reader.getLevel(0, 1.0) != 0 ||
+            reader.getLevel(0, 3.0) != 1 ||
+            reader.getLevel(0, 4.0) != 2 ||
+            reader.getLevel(0, 100.0) != numLevels)
+        {
+            std::cerr << "Wrong levels\n";
+            success = false;
+        }
+
+        // Each level averages 2x2 boxes of the one before it
+        std::vector<T> expected(reinterpret_cast<const T*>(&image[0]),
+                                reinterpret_cast<const T*>(&image[0]) +
+                                        dims.area() * numBands);
+        types::RowCol<size_t> expectedDims(dims);
+        for (size_t level = 0; success && level <= numLevels; ++level)
+        {
+            if (level > 0)
+            {
+                expected = boxAverage(&expected[0], expectedDims, numBands, 2);
+                expectedDims.row = math::ceilingDivide(expectedDims.row,
+                                                       static_cast<size_t>(2));
+                expectedDims.col = math::ceilingDivide(expectedDims.col,
+                                                       static_cast<size_t>(2));
+            }
+
+            const six::sidd::DerivedData& levelData =
+                    reader.getDerivedData(0, level);
+            const size_t numCols = levelData.getNumCols();
+
+            // All of it, then just the lower right
+            for (size_t start = 0; start < 2; ++start)
+            {
+                const size_t numRows = levelData.getNumRows();
+                six::Region region;
+                region.setStartRow(start * numRows / 2);
+                region.setStartCol(start * numCols / 2);
+                region.setNumRows(numRows - region.getStartRow());
+                region.setNumCols(numCols - region.getStartCol());
+                const mem::ScopedArray<six::UByte> buffer(
+                        reader.interleaved(region, 0, level));
+                const T* const actual =
+                        reinterpret_cast<const T*>(buffer.get());
+
+                for (sys::SSize_T row = 0; row < region.getNumRows(); ++row)
+                {
+                    const size_t rowLength = region.getNumCols() * numBands;
+                    const size_t offset =
+                            ((region.getStartRow() + row) * numCols +
+                             region.getStartCol()) * numBands;
+                    if (!std::equal(actual + row * rowLength,
+                                    actual + (row + 1) * rowLength,
+                                    expected.begin() + offset))
+                    {
+                        std::cerr << pixelType.toString() << " level "
+                                  << level << " differs on row "
+                                  << region.getStartRow() + row << "\n";
+                        success = false;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    const sys::OS os;
+    for (size_t level = 1; level <= numLevels; ++level)
+    {
+        const std::string pathname =
+                six::sidd::getRSetPathname(tempFile.pathname(), 0, level);
+        if (os.exists(pathname))
+        {
+            os.remove(pathname);
+        }
+    }
+    return success;
+}
+}
+
+int main(int /*argc*/, char** /*argv*/)
+{
+    try
+    {
+        bool success = true;
+        success = testPathnames() && success;
+        success = testReducedData() && success;
+        success = testSubsample() && success;
+        success = testLevels<sys::ubyte>(six::PixelType::MONO8I, 1) &&
+                success;
+        success = testLevels<sys::Uint16_T>(six::PixelType::MONO16I, 1) &&
+                success;
+        success = testLevels<sys::ubyte>(six::PixelType::RGB24I, 3) &&
+                success;
+
+        if (success)
+        {
+            std::cout << "All tests pass!\n";
+        }
+        else
+        {
+            std::cerr << "Some tests FAIL!\n";
+        }
+
+        return (success ? 0 : 1);
+    }
+    catch (const std::exception& ex)
+    {
+        std::cerr << "Caught std::exception: " << ex.what() << std::endl;
+        return 1;
+    }
+    catch (const except::Exception& ex)
+    {
+        std::cerr << "Caught except::Exception: " << ex.getMessage()
+                  << std::endl;
+        return 1;
+    }
+    catch (...)
+    {
+        std::cerr << "Caught unknown exception\n";
+        return 1;
+    }
+}
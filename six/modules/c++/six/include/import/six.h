@@ -23,6 +23,7 @@
 #define __IMPORT_SIX_H__
 
 #include "six/Adapters.h"
+#include "six/ByteSwap.h"
 #include "six/Container.h"
 #include "six/Data.h"
 #include "six/Enums.h"
@@ -34,6 +35,8 @@
 #include "six/NITFWriteControl.h"
 #include "six/Options.h"
 #include "six/Init.h"
+#include "six/MemoryMappedFile.h"
+#include "six/PositionalFileWriter.h"
 #include "six/Types.h"
 #include "six/Utilities.h"
 #include "six/Parameter.h"
@@ -43,6 +46,7 @@
 #include "six/ReadControlFactory.h"
 #include "six/WriteControl.h"
 #include "six/XMLControl.h"
+#include "six/ValidatorCache.h"
 #include "six/XMLControlFactory.h"
 
 #endif
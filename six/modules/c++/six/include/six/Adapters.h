@@ -94,10 +94,12 @@ protected:
  *  \class MemoryWriteHandler
  *  \brief Overloaded NITF write handler from memory buffer
  *
- *  This is used to write an image buffer from memory.  Each row is read
- *  one at a time and transferred into the write handle.  It makes use
- *  of NITRO's low-level WriteHandler API, which assumes that you will handle
- *  the heavy lifting.  This is not typically used, since the ImageWriter
+ *  This is used to write an image buffer from memory.  If no byte swapping
+ *  is needed, the segment's rows are written straight out of the buffer in
+ *  one shot.  Otherwise, strips of rows are swapped into a reusable buffer
+ *  (optionally using multiple threads) and each strip is written at once.
+ *  It makes use of NITRO's low-level WriteHandler API, which assumes that
+ *  you will handle the heavy lifting.  This is not typically used, since the ImageWriter
  *  is more general, but in the case of pixel interleaved data, the 
  *  WriteHandler is the most efficient method of data transfer into a NITF.
  *
@@ -113,6 +115,11 @@ protected:
  *  segment. The caller is responsible for dealing with segmentation
  *  beforehand
  *
+ *  If queueDepth is 2 or more, strips are byte swapped on a separate thread
+ *  into one of queueDepth buffers while the previous strips are being
+ *  written, so swapping and I/O overlap.  Otherwise each strip is swapped
+ *  and then written in turn.
+ *
  */
 class MemoryWriteHandler: public nitf::WriteHandler
 {
@@ -123,15 +130,22 @@ public:
                        size_t numCols,
                        size_t numChannels,
                        size_t pixelSize,
-                       bool doByteSwap);
+                       bool doByteSwap,
+                       size_t numThreads = 1,
+                       size_t queueDepth = 0);
 };
 
 /*!
  *  \class StreamWriteHandler
  *  \brief Derived implementation for nitf::WriteHandler
  *
- *  This is used to write an image buffer from a file source.  Each row is read
- *  one at a time and transferred into the write handle.
+ *  This is used to write an image buffer from a file source.  Strips of rows
+ *  are read into a reusable buffer, byte swapped in place if need be
+ *  (optionally using multiple threads), and transferred into the write handle.
+ *
+ *  If queueDepth is 2 or more, strips are read and swapped on a separate
+ *  thread into one of queueDepth buffers while the previous strips are being
+ *  written.  Otherwise each strip is read, swapped and then written in turn.
  *
  *  This class can handle both SIDD and SICD data.  In the current state
  *  of SIDD, data is always 1 or 3 channels and the size of the channel
@@ -150,7 +164,9 @@ public:
                        size_t numCols,
                        size_t numChannels,
                        size_t pixelSize,
-                       bool doByteSwap);
+                       bool doByteSwap,
+                       size_t numThreads = 1,
+                       size_t queueDepth = 0);
 };
 
 }
@@ -0,0 +1,111 @@
+/* =========================================================================
+ * This file is part of six-c++
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2017, MDA Information Systems LLC
+ *
+ * six-c++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+#ifndef __SIX_BYTE_SWAP_H__
+#define __SIX_BYTE_SWAP_H__
+
+#include <stddef.h>
+
+namespace six
+{
+/*
+ * Kernels for byte swapping and converting pixel data
+ *
+ * These use SSE2, SSSE3, or AVX2 instructions, whichever is the best that
+ * the CPU supports (determined at runtime), and fall back to scalar code
+ * otherwise.  They are all single threaded - callers are expected to divide
+ * up large buffers among threads themselves.
+ */
+
+/*
+ * Byte swap elements in place
+ *
+ * \param buffer Buffer to swap (contents will be overridden)
+ * \param elemSize Size of each element in 'buffer'
+ * \param numElements Number of elements in 'buffer'
+ */
+void byteSwap(void* buffer, size_t elemSize, size_t numElements);
+
+/*
+ * Copy elements, byte swapping each one along the way.  This touches the
+ * data once rather than a memcpy() followed by an in-place swap.
+ *
+ * \param input Elements to swap.  This may be the same as 'output' but
+ * otherwise may not overlap it.
+ * \param elemSize Size of each element in 'input'
+ * \param numElements Number of elements in 'input'
+ * \param output Swapped elements
+ */
+void byteSwap(const void* input,
+              size_t elemSize,
+              size_t numElements,
+              void* output);
+
+/*
+ * Convert elements to float
+ *
+ * \param input Elements to convert, in native byte order
+ * \param elemSize Size of each element in 'input'.  Must be 1 (signed
+ * 8-bit integer), 2 (signed 16-bit integer), or 4 (float).
+ * \param numElements Number of elements in 'input'
+ * \param output Converted elements
+ */
+void promote(const void* input,
+             size_t elemSize,
+             size_t numElements,
+             float* output);
+
+/*
+ * Byte swap and convert elements to float in a single pass
+ *
+ * \param input Elements to convert, in the opposite byte order from the
+ * system's
+ * \param elemSize Size of each element in 'input'.  Must be 1 (signed
+ * 8-bit integer), 2 (signed 16-bit integer), or 4 (float).
+ * \param numElements Number of elements in 'input'
+ * \param output Converted elements
+ */
+void byteSwapAndPromote(const void* input,
+                        size_t elemSize,
+                        size_t numElements,
+                        float* output);
+
+/*
+ * Byte swap, convert elements to float, and scale them.  The scaling is
+ * done in double precision, so the result is the same as scaling the
+ * swapped value as a double and then converting it to float.
+ *
+ * \param input Elements to convert, in the opposite byte order from the
+ * system's
+ * \param elemSize Size of each element in 'input'.  Must be 1 (signed
+ * 8-bit integer), 2 (signed 16-bit integer), or 4 (float).
+ * \param numElements Number of elements in 'input'
+ * \param scaleFactor Factor to multiply each element by
+ * \param output Converted elements
+ */
+void byteSwapAndScale(const void* input,
+                      size_t elemSize,
+                      size_t numElements,
+                      double scaleFactor,
+                      float* output);
+}
+
+#endif
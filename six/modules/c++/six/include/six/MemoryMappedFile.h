@@ -0,0 +1,81 @@
+/* =========================================================================
+ * This file is part of six-c++
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2017, MDA Information Systems LLC
+ *
+ * six-c++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+#ifndef __SIX_MEMORY_MAPPED_FILE_H__
+#define __SIX_MEMORY_MAPPED_FILE_H__
+
+#include <string>
+
+#include <sys/Conf.h>
+
+namespace six
+{
+/*!
+ *  \class MemoryMappedFile
+ *  \brief Maps an entire file read-only into the address space
+ *
+ *  The mapping lives as long as this object does.  This class is not
+ *  copyable.
+ */
+class MemoryMappedFile
+{
+public:
+    /*!
+     *  Maps the file
+     *
+     *  \param pathname File to map
+     *
+     *  \throws except::Exception if the file cannot be opened or mapped
+     */
+    MemoryMappedFile(const std::string& pathname);
+
+    //! Unmaps the file
+    ~MemoryMappedFile();
+
+    //! \return The start of the mapped file
+    const sys::ubyte* getData() const
+    {
+        return mData;
+    }
+
+    //! \return The size of the mapped file in bytes
+    sys::Uint64_T getSize() const
+    {
+        return mSize;
+    }
+
+private:
+    // Noncopyable
+    MemoryMappedFile(const MemoryMappedFile& );
+    const MemoryMappedFile& operator=(const MemoryMappedFile& );
+
+private:
+    const sys::ubyte* mData;
+    sys::Uint64_T mSize;
+
+#ifdef WIN32
+    HANDLE mFile;
+    HANDLE mMapping;
+#endif
+};
+}
+
+#endif
@@ -296,6 +296,17 @@ NITFImageInfo::getBandInfoImpl(PixelType pixelType,
         nitf::BandInfo band2;
         band2.getSubcategory().set("Q");
 
+        bands.push_back(band1);
+        bands.push_back(band2);
+    }
+        break;
+    case PixelType::AMP8I_PHS8I:
+    {
+        nitf::BandInfo band1;
+        band1.getSubcategory().set("M");
+        nitf::BandInfo band2;
+        band2.getSubcategory().set("P");
+
         bands.push_back(band1);
         bands.push_back(band2);
     }
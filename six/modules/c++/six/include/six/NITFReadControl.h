@@ -28,6 +28,7 @@
 #include "six/ReadControl.h"
 #include "six/ReadControlFactory.h"
 #include "six/Adapters.h"
+#include "six/MemoryMappedFile.h"
 #include <io/SeekableStreams.h>
 #include <import/nitf.hpp>
 #include <nitf/IOStreamReader.hpp>
@@ -53,6 +54,14 @@ class NITFReadControl : public ReadControl
 {
 public:
 
+    /*!
+     *  If set to true prior to load(), image segments that are uncompressed
+     *  and unblocked are read straight out of a memory map of the file
+     *  rather than through NITRO.  This is only possible when loading by
+     *  pathname.
+     */
+    static const char OPT_MEMORY_MAP[];
+
     //!  Constructor
     NITFReadControl();
 
@@ -154,6 +163,67 @@ public:
      */
     virtual UByte* interleaved(Region& region, size_t imageNumber);
 
+    /*!
+     * Read section of image data specified by region, reading the image
+     * segments that the region spans concurrently.  Each segment is read
+     * through its own handle to the file directly into its portion of the
+     * region's buffer.  These per-segment readers are kept and reused by
+     * subsequent calls until the next load().
+     *
+     * Concurrent reads require a second handle to the file, so they are
+     * only possible when the file was loaded by pathname.  Otherwise, or if
+     * numThreads is 1 or the region lies within a single segment, this is
+     * equivalent to interleaved(region, imageNumber).
+     *
+     * \param region Rows and columns of the image to read (see above)
+     * \param imageNumber Index of the image to read
+     * \param numThreads Maximum number of segments to read at once
+     *
+     * \return Buffer of image data (see above)
+     */
+    UByte* interleaved(Region& region,
+                       size_t imageNumber,
+                       size_t numThreads);
+
+    /*!
+     * Get a view of the pixel data for one image segment straight from the
+     * memory mapped file.  This is only available for segments that can be
+     * read through the memory map (see OPT_MEMORY_MAP).
+     *
+     * Rows are numCols * numBytesPerPixel bytes apart.  Note that the pixels
+     * are in the file's byte order (big endian) and are not swapped.
+     *
+     * \param imageNumber Index of the image
+     * \param segmentNumber Index of the segment within the image
+     *
+     * \return Pointer to the first pixel of the segment, or NULL if the
+     * segment is not memory mapped.  Throws if there is no such image or
+     * segment.
+     */
+    const UByte* getMappedSegment(size_t imageNumber,
+                                  size_t segmentNumber) const;
+
+    /*!
+     * \param imageNumber Index of the image
+     *
+     * \return The layout of the image segments that make up the image
+     */
+    std::vector<NITFSegmentInfo> getImageSegments(size_t imageNumber) const
+    {
+        return mInfos.at(imageNumber)->getImageSegments();
+    }
+
+    /*!
+     * \param imageNumber Index of the image
+     *
+     * \return Index of the image's first segment among all the image
+     * segments in the record
+     */
+    size_t getStartIndex(size_t imageNumber) const
+    {
+        return mInfos.at(imageNumber)->getStartIndex();
+    }
+
     virtual std::string getFileType() const
     {
         return "NITF";
@@ -182,6 +252,10 @@ protected:
 
     std::map<std::string, void*> mCompressionOptions;
 
+    //! Whether createCompressionOptions() has been called since the last
+    //  reset()
+    bool mHaveCompressionOptions;
+
     /*!
      *  This function grabs the IID out of the NITF file.
      *  If the data is Complex, it follows the following convention.
@@ -210,9 +284,28 @@ protected:
     void addSecurityOptions(nitf::FileSecurity security,
             const std::string& prefix, six::Options& options) const;
 
-    //! Resets the object internals
+    //! Resets the object internals, including all cached image readers
     void reset();
 
+    /*!
+     *  Get a reader for an image segment.  Readers (along with the
+     *  compression options used to create them) are created on first use
+     *  and then cached until the next reset(), so repeated reads from the
+     *  same segment don't pay to set up the reader each time.
+     *
+     *  \param segmentIndex NITF image segment index
+     *  \return Image reader for the segment
+     */
+    nitf::ImageReader getImageReader(size_t segmentIndex);
+
+    /*!
+     *  Calls createCompressionOptions() if it hasn't been called since the
+     *  last reset()
+     *
+     *  \return Compression options to create image readers with
+     */
+    std::map<std::string, void*>& getCompressionOptions();
+
     //! All pointers populated within the options need
     //  to be cleaned up elsewhere. There is no access
     //  to deallocation in NITFReadControl directly
@@ -227,6 +320,50 @@ private:
     NITFReadControl& operator=(const NITFReadControl& other);
 
 private:
+    /*!
+     *  \class SegmentReader
+     *  \brief Reads a single image segment through its own handle to the
+     *  file, independent of mReader, so that segments may be read from
+     *  multiple threads at once
+     */
+    class SegmentReader
+    {
+    public:
+        SegmentReader(const std::string& pathname,
+                      size_t segmentIndex,
+                      std::map<std::string, void*>& compressionOptions);
+
+        void read(size_t startRow,
+                  size_t numRows,
+                  size_t startCol,
+                  size_t numCols,
+                  size_t numBands,
+                  nitf::Uint8* buffer);
+
+    private:
+        nitf::IOHandle mHandle;
+        nitf::Reader mReader;
+        nitf::Record mRecord;
+        nitf::ImageReader mImageReader;
+    };
+
+    //! Where an image segment's pixels live in the memory mapped file
+    struct MappedSegment
+    {
+        const UByte* data;
+
+        // Size of each element that needs to be byte swapped
+        size_t elementSize;
+    };
+
+    //! Maps the file and determines which image segments we can read
+    //  directly from the map
+    void mapImageSegments();
+
+    //! \return True if all the image segments the region spans can be
+    //  read from the memory map
+    bool isMapped(const NITFImageInfo& image, const Region& region) const;
+
     std::auto_ptr<Legend> findLegend(size_t productNum);
 
     void readLegendPixelData(nitf::ImageSubheader& subheader,
@@ -247,6 +384,20 @@ private:
     // The issue occurs from the explicit destructor of
     // IOControl
     mem::SharedPtr<nitf::IOInterface> mInterface;
+
+    // Only set when loaded by pathname, in which case we are able to open
+    // additional handles to the file for concurrent segment reads
+    std::string mPathname;
+
+    // Keyed by NITF image segment index
+    std::map<size_t, nitf::ImageReader> mImageReaders;
+    std::map<size_t, mem::SharedPtr<SegmentReader> > mSegmentReaders;
+
+    // Only populated when OPT_MEMORY_MAP is set.  Segments are keyed by
+    // NITF image segment index and only present if they're readable from
+    // the map.
+    std::auto_ptr<MemoryMappedFile> mMappedFile;
+    std::map<size_t, MappedSegment> mMappedSegments;
 };
 
 
@@ -77,6 +77,17 @@ public:
     static const char OPT_NUM_ROWS_PER_BLOCK[];
     static const char OPT_NUM_COLS_PER_BLOCK[];
 
+    //! Number of threads to byte swap pixels with while writing them out of
+    //  memory or streams (defaults to 1)
+    static const char OPT_NUM_THREADS[];
+
+    //! Number of strips of pixels to have in flight while writing out of
+    //  memory or streams.  If this is 2 or more, the next strips are
+    //  prepared (read and byte swapped) on a separate thread while the
+    //  current one is written.  Defaults to 0 (strips are prepared and
+    //  written in turn).
+    static const char OPT_ASYNC_WRITE[];
+
     //!  Buffered IO
     static const size_t DEFAULT_BUFFER_SIZE;
 
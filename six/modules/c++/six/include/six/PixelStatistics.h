@@ -0,0 +1,386 @@
+/* =========================================================================
+ * This file is part of six-c++
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2017, MDA Information Systems LLC
+ *
+ * six-c++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+#ifndef __SIX_PIXEL_STATISTICS_H__
+#define __SIX_PIXEL_STATISTICS_H__
+
+#include <limits>
+#include <vector>
+
+#include <types/RowCol.h>
+#include <six/NITFReadControl.h>
+#include <six/Types.h>
+
+namespace six
+{
+/*!
+ *  \class QuantileDigest
+ *  \brief Approximate quantiles of a stream of values in bounded memory
+ *
+ *  This is a merging t-digest: values are clustered into centroids that
+ *  are small near the tails and larger in the middle, so extreme quantiles
+ *  stay accurate.  The number of centroids is on the order of the
+ *  compression, regardless of how many values are added.  Digests of
+ *  different parts of the data can be merged.
+ *
+ *  Values are buffered and merged into the centroids in bulk: each buffer
+ *  is radix sorted, and repeats of a value become a single weighted
+ *  centroid, so the cost per value is a few passes over the buffer.
+ */
+class QuantileDigest
+{
+public:
+    /*!
+     * \param compression Larger values keep more centroids, which is more
+     * accurate but slower
+     */
+    explicit QuantileDigest(double compression = 100);
+
+    //! Adds values to the digest
+    void add(const float* values, size_t numValues);
+
+    //! Adds the values of another digest to this one
+    void merge(const QuantileDigest& other);
+
+    //! \return The number of values that have been added
+    double getCount() const;
+
+    /*!
+     * \param fraction Fraction of the values, from 0 to 1
+     *
+     * \return Approximately the value that 'fraction' of the values are
+     * below.  Throws if there are no values.
+     */
+    double getQuantile(double fraction) const;
+
+    //! \return Number of centroids, once pending values are merged in
+    size_t getNumCentroids() const;
+
+private:
+    struct Centroid
+    {
+        Centroid(double mean, double weight) :
+            mean(mean),
+            weight(weight)
+        {
+        }
+
+        bool operator<(const Centroid& rhs) const
+        {
+            return mean < rhs.mean;
+        }
+
+        double mean;
+        double weight;
+    };
+
+    //! Merges the buffered values into the centroids
+    void flush() const;
+
+    //! Replaces the centroids with sorted 'centroids', merged where they fit
+    void compress(const std::vector<Centroid>& centroids) const;
+
+private:
+    double mCompression;
+    size_t mBufferSize;
+    mutable double mMin;
+    mutable double mMax;
+    mutable std::vector<Centroid> mCentroids;
+
+    // Buffered values, as keys that sort like the values, and space to
+    // sort them in
+    mutable std::vector<sys::Uint32_T> mKeys;
+    mutable std::vector<sys::Uint32_T> mScratch;
+};
+
+/*!
+ *  \class Histogram
+ *  \brief Exact counts of values in equal width bins
+ */
+class Histogram
+{
+public:
+    //! Constructs a histogram without any bins, which counts nothing
+    Histogram();
+
+    /*!
+     * \param minValue Start of the first bin
+     * \param maxValue End of the last bin
+     * \param numBins Number of bins
+     */
+    Histogram(double minValue, double maxValue, size_t numBins);
+
+    //! Counts values
+    void add(const float* values, size_t numValues);
+
+    //! Adds the counts of a histogram with the same bins
+    void merge(const Histogram& other);
+
+    size_t getNumBins() const
+    {
+        return mCounts.size();
+    }
+
+    double getMinValue() const
+    {
+        return mMinValue;
+    }
+
+    double getMaxValue() const
+    {
+        return mMaxValue;
+    }
+
+    double getBinWidth() const
+    {
+        return mCounts.empty() ?
+                0 : (mMaxValue - mMinValue) / mCounts.size();
+    }
+
+    //! \return Number of values in [min + bin * width, min + (bin + 1) * width)
+    sys::Uint64_T getCount(size_t bin) const
+    {
+        return mCounts.at(bin);
+    }
+
+    const std::vector<sys::Uint64_T>& getCounts() const
+    {
+        return mCounts;
+    }
+
+    //! \return Number of values below the first bin
+    sys::Uint64_T getNumBelow() const
+    {
+        return mNumBelow;
+    }
+
+    //! \return Number of values at or above the end of the last bin
+    sys::Uint64_T getNumAbove() const
+    {
+        return mNumAbove;
+    }
+
+private:
+    double mMinValue;
+    double mMaxValue;
+    double mBinsPerValue;
+    std::vector<sys::Uint64_T> mCounts;
+    sys::Uint64_T mNumBelow;
+    sys::Uint64_T mNumAbove;
+};
+
+/*!
+ *  \class SampleStatistics
+ *  \brief Single pass statistics of a stream of values: extrema, the
+ *  smallest positive value, mean and variance, an exact histogram, and,
+ *  if asked for, approximate quantiles
+ */
+class SampleStatistics
+{
+public:
+    /*!
+     * \param histogram Empty histogram with the bins to count values in
+     * \param compression Compression of the quantile digest, or 0, the
+     * default, for no quantiles.  The digest costs several times more than
+     * the other statistics, so only ask for it if the quantiles are used;
+     * 100 is a reasonable compression.
+     */
+    SampleStatistics(const Histogram& histogram = Histogram(),
+                     double compression = 0);
+
+    //! Adds values
+    void add(const float* values, size_t numValues);
+
+    //! Adds the values of another set of statistics with the same bins
+    void merge(const SampleStatistics& other);
+
+    sys::Uint64_T getCount() const
+    {
+        return mCount;
+    }
+
+    //! \return Minimum value, or 0 if there are none
+    double getMin() const
+    {
+        return (mCount == 0) ? 0 : mMin;
+    }
+
+    //! \return Maximum value, or 0 if there are none
+    double getMax() const
+    {
+        return (mCount == 0) ? 0 : mMax;
+    }
+
+    /*!
+     * \return Smallest value above 0, or 0 if there are none.  For
+     * amplitudes, this is where a log scale can start.
+     */
+    double getMinPositive() const
+    {
+        return (mMinPositive == std::numeric_limits<double>::max()) ?
+                0 : mMinPositive;
+    }
+
+    double getMean() const
+    {
+        return mMean;
+    }
+
+    //! \return Population variance
+    double getVariance() const
+    {
+        return (mCount == 0) ? 0 : mM2 / mCount;
+    }
+
+    double getStandardDeviation() const;
+
+    /*!
+     * \return Mean of the squared values.  For amplitudes, this is the
+     * mean power.
+     */
+    double getMeanSquare() const
+    {
+        return getVariance() + mMean * mMean;
+    }
+
+    /*!
+     * \return See QuantileDigest::getQuantile().  Throws if the quantiles
+     * are turned off.
+     */
+    double getQuantile(double fraction) const;
+
+    const Histogram& getHistogram() const
+    {
+        return mHistogram;
+    }
+
+private:
+    sys::Uint64_T mCount;
+    double mMin;
+    double mMax;
+    double mMinPositive;
+    double mMean;
+    double mM2;
+    Histogram mHistogram;
+    bool mHasQuantiles;
+    QuantileDigest mDigest;
+};
+
+/*!
+ *  \class PixelStatisticsCollector
+ *  \brief Gathers SampleStatistics of SICD or SIDD pixels, a block of rows
+ *  at a time, so that images of any size are processed in bounded memory
+ *
+ *  The values are
+ *    - The amplitude of complex (SICD) pixels.  AMP8I_PHS8I amplitudes go
+ *      through the AmpTable, if there is one.
+ *    - The pixel value of MONO8I, MONO8LU, MONO16I and RGB8LU pixels
+ *    - Each band of RGB24I pixels, separately
+ *
+ *  By default, the histogram has a bin for every value of 8 and 16-bit
+ *  pixels and for every AMP8I_PHS8I amplitude without an AmpTable.  Other
+ *  pixel types have no histogram unless setHistogram() is called.
+ *
+ *  Each thread accumulates its own partial statistics, which are merged
+ *  when they're asked for.
+ */
+class PixelStatisticsCollector
+{
+public:
+    /*!
+     * \param pixelType Pixel type of the image
+     * \param ampTable AmpTable of AMP8I_PHS8I pixels, if there is one
+     * \param numThreads Number of threads to use
+     * \param compression Compression of the quantile digests, or 0, the
+     * default, for no quantiles.  See SampleStatistics.
+     */
+    PixelStatisticsCollector(PixelType pixelType,
+                             const AmplitudeTable* ampTable = NULL,
+                             size_t numThreads = 1,
+                             double compression = 0);
+
+    /*!
+     * Sets the histogram bins, clearing any statistics gathered so far
+     *
+     * \param minValue Start of the first bin
+     * \param maxValue End of the last bin
+     * \param numBins Number of bins.  0 turns off the histogram.
+     */
+    void setHistogram(double minValue, double maxValue, size_t numBins);
+
+    //! Clears the statistics, to start on another image
+    void reset();
+
+    /*!
+     * Adds rows of pixels, splitting the rows across threads
+     *
+     * \param pixels Pixels in native byte order
+     * \param dims Dimensions of 'pixels'
+     */
+    void addPixels(const UByte* pixels, const types::RowCol<size_t>& dims);
+
+    /*!
+     * Reads an image from a NITF and adds its pixels.  Each block of rows
+     * is read while the one before it is processed.
+     *
+     * \param reader Reader with the image loaded
+     * \param imageNumber Index of the image
+     * \param numRowsPerBlock Number of rows to read at a time
+     */
+    void addImage(NITFReadControl& reader,
+                  size_t imageNumber = 0,
+                  size_t numRowsPerBlock = 256);
+
+    //! \return 3 for RGB24I, otherwise 1
+    size_t getNumBands() const
+    {
+        return mNumBands;
+    }
+
+    //! \return Statistics of one band
+    const SampleStatistics& getStatistics(size_t band = 0) const;
+
+private:
+    class StatisticsRunnable;
+    class ReadRunnable;
+
+    //! Adds a run of pixels to one thread's partial statistics
+    void addPixels(const UByte* pixels,
+                   size_t numPixels,
+                   std::vector<SampleStatistics>& statistics) const;
+
+    //! Merges the threads' partial statistics into the totals
+    void mergePartials() const;
+
+private:
+    const PixelType mPixelType;
+    const size_t mNumThreads;
+    const double mCompression;
+    size_t mNumBands;
+    size_t mNumBytesPerPixel;
+    Histogram mHistogram;
+    std::vector<float> mAmplitudes;
+    mutable std::vector<SampleStatistics> mStatistics;
+    mutable std::vector<std::vector<SampleStatistics> > mPartials;
+};
+}
+
+#endif
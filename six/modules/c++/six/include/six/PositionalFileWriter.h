@@ -0,0 +1,84 @@
+/* =========================================================================
+ * This file is part of six-c++
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2017, MDA Information Systems LLC
+ *
+ * six-c++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+#ifndef __SIX_POSITIONAL_FILE_WRITER_H__
+#define __SIX_POSITIONAL_FILE_WRITER_H__
+
+#include <string>
+
+#include <sys/Conf.h>
+
+namespace six
+{
+/*!
+ *  \class PositionalFileWriter
+ *  \brief Writes to explicit offsets in an existing file without any shared
+ *  file position
+ *
+ *  Each write says where it goes (pwrite() on POSIX, an OVERLAPPED offset on
+ *  Windows), so any number of threads may write disjoint parts of the file
+ *  at once.  The file is closed when this object is destroyed.  This class
+ *  is not copyable.
+ */
+class PositionalFileWriter
+{
+public:
+    /*!
+     *  Opens the file for writing.  It is not truncated.
+     *
+     *  \param pathname File to write to.  This must already exist.
+     *
+     *  \throws except::Exception if the file cannot be opened
+     */
+    PositionalFileWriter(const std::string& pathname);
+
+    //! Closes the file
+    ~PositionalFileWriter();
+
+    /*!
+     *  Writes all of the buffer to the file.  This is safe to call from
+     *  multiple threads at once.
+     *
+     *  \param buffer Bytes to write
+     *  \param numBytes Number of bytes to write
+     *  \param offset Offset in bytes from the start of the file to write to
+     *
+     *  \throws except::Exception if the write fails
+     */
+    void writeAt(const void* buffer, size_t numBytes, sys::Off_T offset);
+
+private:
+    // Noncopyable
+    PositionalFileWriter(const PositionalFileWriter& );
+    const PositionalFileWriter& operator=(const PositionalFileWriter& );
+
+private:
+    const std::string mPathname;
+
+#ifdef WIN32
+    HANDLE mFile;
+#else
+    int mFile;
+#endif
+};
+}
+
+#endif
@@ -0,0 +1,133 @@
+/* =========================================================================
+ * This file is part of six-c++
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2017, MDA Information Systems LLC
+ *
+ * six-c++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+#ifndef __SIX_VALIDATOR_CACHE_H__
+#define __SIX_VALIDATOR_CACHE_H__
+
+#include <map>
+#include <string>
+#include <vector>
+#include <utility>
+
+#include <sys/Conf.h>
+#include <sys/Mutex.h>
+#include <mt/Singleton.h>
+#include <mem/SharedPtr.h>
+#include <logging/Logger.h>
+#include <xml/lite/Element.h>
+#include <xml/lite/Validator.h>
+
+namespace six
+{
+/*!
+ *  \class ValidatorRegistry
+ *  \brief Process-wide cache of compiled schema validators
+ *
+ *  Compiling every XSD under a set of schema paths is far more expensive
+ *  than validating a document against them, so validators are compiled once
+ *  per set of schema paths and reused from then on.  A cached validator is
+ *  recompiled if the set of schemas found under its paths, or any of their
+ *  modification times, changes.
+ *
+ *  Validators are not safe to use from multiple threads at once, so each
+ *  thread validating against the same set of paths at the same time borrows
+ *  its own.  These are compiled on demand and kept for later, so the cache
+ *  holds as many validators per set of paths as were ever in use at once.
+ *
+ *  All methods are thread-safe.  Use it through the ValidatorCache
+ *  singleton.
+ */
+class ValidatorRegistry
+{
+public:
+    ValidatorRegistry();
+
+    /*!
+     *  Validates the element against the schemas found under the schema
+     *  paths, compiling them only if there's no up-to-date validator for
+     *  these paths already in the cache
+     *
+     *  \param element Root element to validate
+     *  \param xmlID Identifier for the element in the error log
+     *  \param schemaPaths Directories or files of schema locations.  These
+     *      are searched recursively for *.xsd files.
+     *  \param log Logger for any problems compiling the schemas
+     *  \param errors Validation errors found are appended to this
+     *
+     *  \return True if no validation errors were found
+     */
+    bool validate(const xml::lite::Element* element,
+                  const std::string& xmlID,
+                  const std::vector<std::string>& schemaPaths,
+                  logging::Logger* log,
+                  std::vector<xml::lite::ValidationInfo>& errors);
+
+    //! Discards all cached validators that aren't currently in use
+    void clear();
+
+    //! \return The number of cached validators not currently in use
+    size_t getNumValidators() const;
+
+private:
+    // Each schema file found under a set of paths along with its
+    // modification time
+    typedef std::vector<std::pair<std::string, sys::Off_T> > Schemas;
+
+    struct Entry
+    {
+        Entry() :
+            generation(0)
+        {
+        }
+
+        Schemas schemas;
+
+        // Bumped whenever the schemas change, so that validators compiled
+        // from the old ones aren't put back when they're returned
+        size_t generation;
+
+        std::vector<mem::SharedPtr<xml::lite::Validator> > idle;
+    };
+
+    typedef std::map<std::vector<std::string>, Entry> EntryMap;
+
+    static Schemas findSchemas(const std::vector<std::string>& schemaPaths);
+
+    // Takes an idle validator for these paths if there is one, making sure
+    // it's up to date with 'schemas'.  Returns the entry's generation.
+    size_t checkOut(const std::vector<std::string>& key,
+                    const Schemas& schemas,
+                    mem::SharedPtr<xml::lite::Validator>& validator);
+
+    void checkIn(const std::vector<std::string>& key,
+                 size_t generation,
+                 mem::SharedPtr<xml::lite::Validator> validator);
+
+private:
+    mutable sys::Mutex mMutex;
+    EntryMap mEntries;
+};
+
+//!  Singleton declaration of our ValidatorRegistry
+typedef mt::Singleton<ValidatorRegistry, true> ValidatorCache;
+}
+
+#endif
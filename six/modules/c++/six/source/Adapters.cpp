@@ -19,7 +19,18 @@
  * see <http://www.gnu.org/licenses/>.
  *
  */
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <sys/Conf.h>
+#include <sys/Runnable.h>
+#include <mt/ThreadGroup.h>
+#include <mt/ThreadPlanner.h>
+#include <mt/RequestQueue.h>
 #include "six/Adapters.h"
+#include "six/ByteSwap.h"
 
 using namespace six;
 
@@ -34,6 +45,386 @@ NITF_BOOL __six_MemoryWriteHandler_write(NITF_DATA * data,
         nitf_IOInterface* io, nitf_Error * error);
 }
 
+namespace
+{
+// Rows are swapped and written this many bytes (rounded up to a whole row) at
+// a time
+const size_t STRIP_SIZE = 4 * 1024 * 1024;
+
+size_t getRowsPerStrip(size_t rowSize, size_t numRows)
+{
+    const size_t rowsPerStrip = std::max<size_t>(STRIP_SIZE / rowSize, 1);
+    return std::min(rowsPerStrip, numRows);
+}
+
+class ByteSwapRunnable : public sys::Runnable
+{
+public:
+    ByteSwapRunnable(const UByte* input,
+                     size_t elemSize,
+                     size_t startElement,
+                     size_t numElements,
+                     UByte* output) :
+        mInput(input + startElement * elemSize),
+        mElemSize(elemSize),
+        mNumElements(numElements),
+        mOutput(output + startElement * elemSize)
+    {
+    }
+
+    virtual void run()
+    {
+        six::byteSwap(mInput, mElemSize, mNumElements, mOutput);
+    }
+
+private:
+    const UByte* const mInput;
+    const size_t mElemSize;
+    const size_t mNumElements;
+    UByte* const mOutput;
+};
+
+// Copies the elements into the output buffer, byte swapping them along the
+// way (input may be the same as output)
+void byteSwap(const UByte* input,
+              size_t elemSize,
+              size_t numElements,
+              size_t numThreads,
+              UByte* output)
+{
+    if (numThreads <= 1)
+    {
+        six::byteSwap(input, elemSize, numElements, output);
+    }
+    else
+    {
+        mt::ThreadGroup threads;
+        const mt::ThreadPlanner planner(numElements, numThreads);
+
+        size_t threadNum(0);
+        size_t startElement(0);
+        size_t numElementsThisThread(0);
+        while (planner.getThreadInfo(threadNum++,
+                                     startElement,
+                                     numElementsThisThread))
+        {
+            std::auto_ptr<sys::Runnable> swapper(new ByteSwapRunnable(
+                    input,
+                    elemSize,
+                    startElement,
+                    numElementsThisThread,
+                    output));
+            threads.createThread(swapper);
+        }
+
+        threads.joinAll();
+    }
+}
+
+// Fills in strips of rows to be written out, in order
+class StripSource
+{
+public:
+    StripSource(size_t rowSize, size_t numRows) :
+        mRowSize(rowSize),
+        mNumRows(numRows),
+        mRowsPerStrip(getRowsPerStrip(rowSize, numRows))
+    {
+    }
+
+    virtual ~StripSource()
+    {
+    }
+
+    size_t getNumStrips() const
+    {
+        return (mNumRows + mRowsPerStrip - 1) / mRowsPerStrip;
+    }
+
+    size_t getMaxStripSize() const
+    {
+        return mRowsPerStrip * mRowSize;
+    }
+
+    size_t getStripSize(size_t strip) const
+    {
+        return std::min(mRowsPerStrip, mNumRows - strip * mRowsPerStrip) *
+                mRowSize;
+    }
+
+    virtual void fill(size_t strip, UByte* buffer) = 0;
+
+private:
+    const size_t mRowSize;
+    const size_t mNumRows;
+    const size_t mRowsPerStrip;
+};
+
+// Byte swaps strips out of a buffer in memory
+class MemoryStripSource : public StripSource
+{
+public:
+    MemoryStripSource(const UByte* input,
+                      size_t rowSize,
+                      size_t numRows,
+                      size_t elemSize,
+                      size_t numThreads) :
+        StripSource(rowSize, numRows),
+        mInput(input),
+        mElemSize(elemSize),
+        mNumThreads(numThreads)
+    {
+    }
+
+    virtual void fill(size_t strip, UByte* buffer)
+    {
+        ::byteSwap(mInput + strip * getMaxStripSize(),
+                   mElemSize,
+                   getStripSize(strip) / mElemSize,
+                   mNumThreads,
+                   buffer);
+    }
+
+private:
+    const UByte* const mInput;
+    const size_t mElemSize;
+    const size_t mNumThreads;
+};
+
+// Reads strips from a stream, byte swapping them if need be
+class StreamStripSource : public StripSource
+{
+public:
+    StreamStripSource(io::InputStream& inputStream,
+                      size_t rowSize,
+                      size_t numRows,
+                      size_t elemSize,
+                      bool doByteSwap,
+                      size_t numThreads) :
+        StripSource(rowSize, numRows),
+        mInputStream(inputStream),
+        mElemSize(elemSize),
+        mDoByteSwap(doByteSwap),
+        mNumThreads(numThreads)
+    {
+    }
+
+    virtual void fill(size_t strip, UByte* buffer)
+    {
+        const size_t stripSize = getStripSize(strip);
+        mInputStream.read(buffer, stripSize, true);
+
+        if (mDoByteSwap)
+        {
+            ::byteSwap(buffer, mElemSize, stripSize / mElemSize, mNumThreads,
+                       buffer);
+        }
+    }
+
+private:
+    io::InputStream& mInputStream;
+    const size_t mElemSize;
+    const bool mDoByteSwap;
+    const size_t mNumThreads;
+};
+
+// Aligned buffers to fill strips into.  These are allocated on the first
+// write and reused for the rest.
+class StripBuffers
+{
+public:
+    StripBuffers(size_t numBuffers) :
+        mBuffers(std::max<size_t>(numBuffers, 1), NULL)
+    {
+    }
+
+    ~StripBuffers()
+    {
+        for (size_t ii = 0; ii < mBuffers.size(); ++ii)
+        {
+            if (mBuffers[ii])
+            {
+                sys::alignedFree(mBuffers[ii]);
+            }
+        }
+    }
+
+    size_t size() const
+    {
+        return mBuffers.size();
+    }
+
+    UByte* get(size_t index, size_t bufferSize)
+    {
+        if (mBuffers[index] == NULL)
+        {
+            mBuffers[index] =
+                    static_cast<UByte*>(sys::alignedAlloc(bufferSize));
+        }
+        return mBuffers[index];
+    }
+
+private:
+    std::vector<UByte*> mBuffers;
+};
+
+struct Strip
+{
+    UByte* buffer;
+    size_t size;
+
+    // Set if the strip couldn't be filled
+    std::string error;
+};
+
+// Fills strips on its own thread as buffers are handed back to it
+class FillStripsRunnable : public sys::Runnable
+{
+public:
+    FillStripsRunnable(StripSource& source,
+                       mt::RequestQueue<Strip*>& emptyStrips,
+                       mt::RequestQueue<Strip*>& filledStrips) :
+        mSource(source),
+        mEmptyStrips(emptyStrips),
+        mFilledStrips(filledStrips)
+    {
+    }
+
+    virtual void run()
+    {
+        bool failed = false;
+        for (size_t ii = 0; ii < mSource.getNumStrips(); ++ii)
+        {
+            Strip* strip;
+            mEmptyStrips.dequeue(strip);
+            strip->size = mSource.getStripSize(ii);
+
+            // Once a strip fails there's no point in filling the rest
+            if (!failed)
+            {
+                try
+                {
+                    mSource.fill(ii, strip->buffer);
+                }
+                catch (const except::Exception& ex)
+                {
+                    strip->error = ex.getMessage();
+                }
+                catch (const std::exception& ex)
+                {
+                    strip->error = ex.what();
+                }
+                catch (...)
+                {
+                    strip->error = "Unknown error filling strip";
+                }
+                failed = !strip->error.empty();
+            }
+
+            mFilledStrips.enqueue(strip);
+        }
+    }
+
+private:
+    StripSource& mSource;
+    mt::RequestQueue<Strip*>& mEmptyStrips;
+    mt::RequestQueue<Strip*>& mFilledStrips;
+};
+
+// With a single buffer, fills and writes each strip in turn.  With more,
+// fills strips on another thread while this one writes the strips that are
+// ready, keeping up to one strip per buffer in flight.
+NITF_BOOL writeStrips(StripSource& source,
+                      StripBuffers& buffers,
+                      nitf_IOInterface* io,
+                      nitf_Error* error)
+{
+    const size_t numStrips = source.getNumStrips();
+    const size_t maxStripSize = source.getMaxStripSize();
+
+    try
+    {
+        if (buffers.size() == 1 || numStrips <= 1)
+        {
+            UByte* const buffer = buffers.get(0, maxStripSize);
+            for (size_t ii = 0; ii < numStrips; ++ii)
+            {
+                source.fill(ii, buffer);
+                if (!nitf_IOInterface_write(io, (const char*) buffer,
+                                            source.getStripSize(ii), error))
+                {
+                    return NITF_FAILURE;
+                }
+            }
+            return NITF_SUCCESS;
+        }
+
+        const size_t numBuffers = std::min(buffers.size(), numStrips);
+        std::vector<Strip> strips(numBuffers);
+        mt::RequestQueue<Strip*> emptyStrips;
+        mt::RequestQueue<Strip*> filledStrips;
+        for (size_t ii = 0; ii < numBuffers; ++ii)
+        {
+            strips[ii].buffer = buffers.get(ii, maxStripSize);
+            emptyStrips.enqueue(&strips[ii]);
+        }
+
+        mt::ThreadGroup threads;
+        threads.createThread(new FillStripsRunnable(source,
+                                                    emptyStrips,
+                                                    filledStrips));
+
+        // Even after a failure, keep taking strips so the filling thread
+        // can finish up
+        bool success = true;
+        for (size_t ii = 0; ii < numStrips; ++ii)
+        {
+            Strip* strip;
+            filledStrips.dequeue(strip);
+
+            if (success)
+            {
+                if (!strip->error.empty())
+                {
+                    nitf_Error_init(error, strip->error.c_str(), NITF_CTXT,
+                                    NITF_ERR_UNK);
+                    success = false;
+                }
+                else if (!nitf_IOInterface_write(io,
+                                                 (const char*) strip->buffer,
+                                                 strip->size,
+                                                 error))
+                {
+                    success = false;
+                }
+            }
+
+            emptyStrips.enqueue(strip);
+        }
+
+        threads.joinAll();
+        return success ? NITF_SUCCESS : NITF_FAILURE;
+    }
+    catch (const except::Exception& ex)
+    {
+        nitf_Error_init(error, ex.getMessage().c_str(), NITF_CTXT,
+                        NITF_ERR_UNK);
+        return NITF_FAILURE;
+    }
+    catch (const std::exception& ex)
+    {
+        nitf_Error_init(error, ex.what(), NITF_CTXT, NITF_ERR_UNK);
+        return NITF_FAILURE;
+    }
+    catch (...)
+    {
+        nitf_Error_init(error, "Unknown error writing strips", NITF_CTXT,
+                        NITF_ERR_UNK);
+        return NITF_FAILURE;
+    }
+}
+}
+
 typedef struct _MemoryWriteHandlerImpl
 {
     const UByte* buffer;
@@ -43,53 +434,47 @@ typedef struct _MemoryWriteHandlerImpl
     size_t numChannels;
     size_t pixelSize;
     int doByteSwap;
+    size_t numThreads;
+    StripBuffers* strips;
 } MemoryWriteHandlerImpl;
 
 extern "C" void __six_MemoryWriteHandler_destruct(NITF_DATA * data)
 {
     MemoryWriteHandlerImpl *impl = (MemoryWriteHandlerImpl *) data;
     if (impl)
+    {
+        delete impl->strips;
         NITF_FREE(impl);
+    }
 }
 
 extern "C" NITF_BOOL __six_MemoryWriteHandler_write(NITF_DATA * data,
         nitf_IOInterface* io, nitf_Error * error)
 {
-    size_t rowSize;
-    sys::Uint64_T off;
-    UByte* rowCopy;
-    unsigned int i;
-
     MemoryWriteHandlerImpl *impl = (MemoryWriteHandlerImpl *) data;
 
-    rowSize = impl->pixelSize * impl->numCols;
-    off = impl->firstRow * rowSize;
-    rowCopy = new UByte[rowSize];
+    const size_t rowSize = impl->pixelSize * impl->numCols;
+    const UByte* input = impl->buffer + impl->firstRow * rowSize;
 
-    for (i = 0; i < impl->numRows; i++)
+    // Nothing to swap, so the buffer can go out as is
+    if (!impl->doByteSwap)
     {
-
-        memcpy(rowCopy, (const sys::byte*) &impl->buffer[off], rowSize);
-
-        if (impl->doByteSwap)
-            sys::byteSwap((sys::byte*) rowCopy, impl->pixelSize
-                    / impl->numChannels, impl->numCols * impl->numChannels);
-        // And write it back
-        if (!nitf_IOInterface_write(io, (const sys::byte*) rowCopy, rowSize,
-                                    error))
-            goto CATCH_ERROR;
-        off += rowSize;
+        return nitf_IOInterface_write(io, (const char*) input,
+                                      impl->numRows * rowSize, error);
     }
-    delete[] rowCopy;
-    return NITF_SUCCESS;
 
-    CATCH_ERROR: delete[] rowCopy;
-    return NITF_FAILURE;
+    MemoryStripSource source(input,
+                             rowSize,
+                             impl->numRows,
+                             impl->pixelSize / impl->numChannels,
+                             impl->numThreads);
+    return writeStrips(source, *impl->strips, io, error);
 }
 
 MemoryWriteHandler::MemoryWriteHandler(const NITFSegmentInfo& info,
         const UByte* buffer, size_t firstRow, size_t numCols,
-        size_t numChannels, size_t pixelSize, bool doByteSwap)
+        size_t numChannels, size_t pixelSize, bool doByteSwap,
+        size_t numThreads, size_t queueDepth)
 {
     // Dont do it if we only have a byte!
     if (pixelSize / numChannels == 1)
@@ -111,6 +496,8 @@ MemoryWriteHandler::MemoryWriteHandler(const NITFSegmentInfo& info,
     impl->numChannels = numChannels;
     impl->pixelSize = pixelSize;
     impl->doByteSwap = doByteSwap;
+    impl->numThreads = numThreads;
+    impl->strips = new StripBuffers(queueDepth);
 
     nitf_SegmentWriter *segmentWriter =
             (nitf_SegmentWriter *) NITF_MALLOC(sizeof(nitf_SegmentWriter));
@@ -136,51 +523,38 @@ typedef struct _StreamWriteHandlerImpl
     size_t numChannels;
     size_t pixelSize;
     int doByteSwap;
+    size_t numThreads;
+    StripBuffers* strips;
 } StreamWriteHandlerImpl;
 
 extern "C" void __six_StreamWriteHandler_destruct(NITF_DATA * data)
 {
     StreamWriteHandlerImpl *impl = (StreamWriteHandlerImpl *) data;
     if (impl)
+    {
+        delete impl->strips;
         NITF_FREE(impl);
+    }
 }
 
 extern "C" NITF_BOOL __six_StreamWriteHandler_write(NITF_DATA * data,
         nitf_IOInterface* io, nitf_Error * error)
 {
-    size_t rowSize;
-    UByte* rowCopy;
-    unsigned int i;
-
     StreamWriteHandlerImpl *impl = (StreamWriteHandlerImpl *) data;
 
-    rowSize = impl->pixelSize * impl->numCols;
-    rowCopy = new UByte[rowSize];
-
-    for (i = 0; i < impl->numRows; i++)
-    {
-
-        impl->inputStream->read((sys::byte*) rowCopy, rowSize);
-
-        if (impl->doByteSwap)
-            sys::byteSwap((sys::byte*) rowCopy, impl->pixelSize
-                    / impl->numChannels, impl->numCols * impl->numChannels);
-
-        // And write it back
-        if (!nitf_IOInterface_write(io, (const sys::byte*) rowCopy, rowSize,
-                                    error))
-            goto CATCH_ERROR;
-    }
-    delete[] rowCopy;
-    return NITF_SUCCESS;
-
-    CATCH_ERROR: delete[] rowCopy;
-    return NITF_FAILURE;
+    StreamStripSource source(*impl->inputStream,
+                             impl->pixelSize * impl->numCols,
+                             impl->numRows,
+                             impl->pixelSize / impl->numChannels,
+                             impl->doByteSwap != 0,
+                             impl->numThreads);
+    return writeStrips(source, *impl->strips, io, error);
 }
 
 StreamWriteHandler::StreamWriteHandler(const NITFSegmentInfo& info,
         io::InputStream* is, size_t numCols, size_t numChannels,
-        size_t pixelSize, bool doByteSwap)
+        size_t pixelSize, bool doByteSwap, size_t numThreads,
+        size_t queueDepth)
 {
     // Don't do it if we only have a byte!
     if ((pixelSize / numChannels) == 1)
@@ -203,6 +577,8 @@ StreamWriteHandler::StreamWriteHandler(const NITFSegmentInfo& info,
     impl->numChannels = numChannels;
     impl->pixelSize = pixelSize;
     impl->doByteSwap = doByteSwap;
+    impl->numThreads = numThreads;
+    impl->strips = new StripBuffers(queueDepth);
 
     nitf_SegmentWriter *segmentWriter =
             (nitf_SegmentWriter *) NITF_MALLOC(sizeof(nitf_SegmentWriter));
@@ -216,4 +592,3 @@ StreamWriteHandler::StreamWriteHandler(const NITFSegmentInfo& info,
     setManaged(false);
 }
 
-
@@ -0,0 +1,642 @@
+/* =========================================================================
+ * This file is part of six-c++
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2017, MDA Information Systems LLC
+ *
+ * six-c++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <string.h>
+#include <algorithm>
+
+#include <sys/Conf.h>
+#include <except/Exception.h>
+#include <str/Convert.h>
+#include <six/ByteSwap.h>
+
+// With GCC and Clang we compile each SIMD flavor of the kernels with the
+// appropriate target attribute and pick among them at runtime.  Otherwise
+// we can only count on SSE2 for 64-bit MSVC builds.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SIX_SIMD_X86_GNU
+#define SIX_SIMD_TARGET(isa) __attribute__((target(isa)))
+#include <immintrin.h>
+#elif defined(_MSC_VER) && defined(_M_X64)
+#define SIX_SIMD_X86_MSVC
+#define SIX_SIMD_TARGET(isa)
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+enum InstructionSet
+{
+    SCALAR,
+    SSE2,
+    SSSE3,
+    AVX2
+};
+
+InstructionSet detectInstructionSet()
+{
+#if defined(SIX_SIMD_X86_GNU)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return AVX2;
+    }
+    if (__builtin_cpu_supports("ssse3"))
+    {
+        return SSSE3;
+    }
+    if (__builtin_cpu_supports("sse2"))
+    {
+        return SSE2;
+    }
+    return SCALAR;
+#elif defined(SIX_SIMD_X86_MSVC)
+    return SSE2;
+#else
+    return SCALAR;
+#endif
+}
+
+InstructionSet getInstructionSet()
+{
+    // Detecting this more than once in a race is harmless
+    static const InstructionSet instructionSet = detectInstructionSet();
+    return instructionSet;
+}
+
+void checkElementSize(size_t elemSize)
+{
+    if (elemSize != 1 && elemSize != 2 && elemSize != 4)
+    {
+        throw except::Exception(Ctxt(
+                "Unexpected element size " + str::toString(elemSize)));
+    }
+}
+
+// Reads both bytes of each pair before writing either so that this is safe
+// to do in place
+void byteSwapScalar(const sys::ubyte* input,
+                    size_t elemSize,
+                    size_t numElements,
+                    sys::ubyte* output)
+{
+    for (size_t elem = 0;
+         elem < numElements;
+         ++elem, input += elemSize, output += elemSize)
+    {
+        for (size_t ii = 0, jj = elemSize - 1; ii < jj; ++ii, --jj)
+        {
+            const sys::ubyte first = input[ii];
+            const sys::ubyte last = input[jj];
+            output[ii] = last;
+            output[jj] = first;
+        }
+
+        if (input != output && elemSize % 2 == 1)
+        {
+            output[elemSize / 2] = input[elemSize / 2];
+        }
+    }
+}
+
+template <typename InT>
+void promoteScalar(const InT* input, size_t numElements, float* output)
+{
+    for (size_t ii = 0; ii < numElements; ++ii)
+    {
+        output[ii] = static_cast<float>(input[ii]);
+    }
+}
+
+void byteSwapAndPromoteScalar(const sys::ubyte* input,
+                              size_t elemSize,
+                              size_t numElements,
+                              float* output)
+{
+    switch (elemSize)
+    {
+    case 1:
+        promoteScalar(reinterpret_cast<const sys::Int8_T*>(input),
+                      numElements, output);
+        break;
+    case 2:
+        for (size_t ii = 0; ii < numElements; ++ii, input += 2)
+        {
+            sys::Int16_T value;
+            ::memcpy(&value, input, 2);
+            output[ii] = sys::byteSwap(value);
+        }
+        break;
+    case 4:
+        byteSwapScalar(input, 4, numElements,
+                       reinterpret_cast<sys::ubyte*>(output));
+        break;
+    }
+}
+
+// Scales in double precision so that scaling a promoted integer matches
+// scaling the original integer
+void scaleScalar(float* buffer, size_t numElements, double scaleFactor)
+{
+    for (size_t ii = 0; ii < numElements; ++ii)
+    {
+        buffer[ii] = static_cast<float>(buffer[ii] * scaleFactor);
+    }
+}
+
+#if defined(SIX_SIMD_X86_GNU) || defined(SIX_SIMD_X86_MSVC)
+SIX_SIMD_TARGET("sse2")
+inline __m128i swap16SSE2(__m128i value)
+{
+    return _mm_or_si128(_mm_slli_epi16(value, 8), _mm_srli_epi16(value, 8));
+}
+
+SIX_SIMD_TARGET("sse2")
+inline __m128i swap32SSE2(__m128i value)
+{
+    value = _mm_shufflelo_epi16(value, _MM_SHUFFLE(2, 3, 0, 1));
+    value = _mm_shufflehi_epi16(value, _MM_SHUFFLE(2, 3, 0, 1));
+    return swap16SSE2(value);
+}
+
+SIX_SIMD_TARGET("sse2")
+inline __m128i swap64SSE2(__m128i value)
+{
+    value = _mm_shufflelo_epi16(value, _MM_SHUFFLE(0, 1, 2, 3));
+    value = _mm_shufflehi_epi16(value, _MM_SHUFFLE(0, 1, 2, 3));
+    return swap16SSE2(value);
+}
+
+SIX_SIMD_TARGET("sse2")
+void byteSwapSSE2(const sys::ubyte* input,
+                  size_t elemSize,
+                  size_t numElements,
+                  sys::ubyte* output)
+{
+    const size_t numBytes = elemSize * numElements;
+    size_t ii = 0;
+
+    switch (elemSize)
+    {
+    case 2:
+        for (; ii + 16 <= numBytes; ii += 16)
+        {
+            const __m128i value = _mm_loadu_si128(
+                    reinterpret_cast<const __m128i*>(input + ii));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(output + ii),
+                             swap16SSE2(value));
+        }
+        break;
+    case 4:
+        for (; ii + 16 <= numBytes; ii += 16)
+        {
+            const __m128i value = _mm_loadu_si128(
+                    reinterpret_cast<const __m128i*>(input + ii));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(output + ii),
+                             swap32SSE2(value));
+        }
+        break;
+    case 8:
+        for (; ii + 16 <= numBytes; ii += 16)
+        {
+            const __m128i value = _mm_loadu_si128(
+                    reinterpret_cast<const __m128i*>(input + ii));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(output + ii),
+                             swap64SSE2(value));
+        }
+        break;
+    }
+
+    byteSwapScalar(input + ii, elemSize, (numBytes - ii) / elemSize,
+                   output + ii);
+}
+
+SIX_SIMD_TARGET("sse2")
+void promote16SSE2(const sys::ubyte* input,
+                   bool swap,
+                   size_t numElements,
+                   float* output)
+{
+    size_t ii = 0;
+    for (; ii + 8 <= numElements; ii += 8)
+    {
+        __m128i value = _mm_loadu_si128(
+                reinterpret_cast<const __m128i*>(input + ii * 2));
+        if (swap)
+        {
+            value = swap16SSE2(value);
+        }
+
+        // Sign extend each 16-bit value to 32 bits
+        const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(value, value),
+                                          16);
+        const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(value, value),
+                                          16);
+        _mm_storeu_ps(output + ii, _mm_cvtepi32_ps(lo));
+        _mm_storeu_ps(output + ii + 4, _mm_cvtepi32_ps(hi));
+    }
+
+    if (swap)
+    {
+        byteSwapAndPromoteScalar(input + ii * 2, 2, numElements - ii,
+                                 output + ii);
+    }
+    else
+    {
+        promoteScalar(reinterpret_cast<const sys::Int16_T*>(input) + ii,
+                      numElements - ii, output + ii);
+    }
+}
+
+SIX_SIMD_TARGET("sse2")
+void promote8SSE2(const sys::ubyte* input, size_t numElements, float* output)
+{
+    size_t ii = 0;
+    for (; ii + 16 <= numElements; ii += 16)
+    {
+        const __m128i value = _mm_loadu_si128(
+                reinterpret_cast<const __m128i*>(input + ii));
+
+        // Sign extend each 8-bit value to 32 bits
+        const __m128i lo = _mm_unpacklo_epi8(value, value);
+        const __m128i hi = _mm_unpackhi_epi8(value, value);
+        const __m128i out0 = _mm_srai_epi32(_mm_unpacklo_epi16(lo, lo), 24);
+        const __m128i out1 = _mm_srai_epi32(_mm_unpackhi_epi16(lo, lo), 24);
+        const __m128i out2 = _mm_srai_epi32(_mm_unpacklo_epi16(hi, hi), 24);
+        const __m128i out3 = _mm_srai_epi32(_mm_unpackhi_epi16(hi, hi), 24);
+        _mm_storeu_ps(output + ii, _mm_cvtepi32_ps(out0));
+        _mm_storeu_ps(output + ii + 4, _mm_cvtepi32_ps(out1));
+        _mm_storeu_ps(output + ii + 8, _mm_cvtepi32_ps(out2));
+        _mm_storeu_ps(output + ii + 12, _mm_cvtepi32_ps(out3));
+    }
+
+    promoteScalar(reinterpret_cast<const sys::Int8_T*>(input) + ii,
+                  numElements - ii, output + ii);
+}
+
+SIX_SIMD_TARGET("sse2")
+void scaleSSE2(float* buffer, size_t numElements, double scaleFactor)
+{
+    const __m128d scale = _mm_set1_pd(scaleFactor);
+    size_t ii = 0;
+    for (; ii + 4 <= numElements; ii += 4)
+    {
+        const __m128 value = _mm_loadu_ps(buffer + ii);
+        const __m128d lo = _mm_mul_pd(_mm_cvtps_pd(value), scale);
+        const __m128d hi = _mm_mul_pd(
+                _mm_cvtps_pd(_mm_movehl_ps(value, value)), scale);
+        _mm_storeu_ps(buffer + ii,
+                      _mm_movelh_ps(_mm_cvtpd_ps(lo), _mm_cvtpd_ps(hi)));
+    }
+
+    scaleScalar(buffer + ii, numElements - ii, scaleFactor);
+}
+#endif
+
+#if defined(SIX_SIMD_X86_GNU)
+// pshufb mask that reverses each elemSize-byte element of a 16-byte lane
+void getShuffleMask(size_t elemSize, sys::ubyte* mask, size_t numBytes)
+{
+    for (size_t ii = 0; ii < numBytes; ++ii)
+    {
+        const size_t laneIdx = ii % 16;
+        mask[ii] = static_cast<sys::ubyte>(
+                (laneIdx / elemSize) * elemSize +
+                (elemSize - 1 - laneIdx % elemSize));
+    }
+}
+
+SIX_SIMD_TARGET("ssse3")
+void byteSwapSSSE3(const sys::ubyte* input,
+                   size_t elemSize,
+                   size_t numElements,
+                   sys::ubyte* output)
+{
+    sys::ubyte maskBytes[16];
+    getShuffleMask(elemSize, maskBytes, sizeof(maskBytes));
+    const __m128i mask =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(maskBytes));
+
+    const size_t numBytes = elemSize * numElements;
+    size_t ii = 0;
+    for (; ii + 16 <= numBytes; ii += 16)
+    {
+        const __m128i value = _mm_loadu_si128(
+                reinterpret_cast<const __m128i*>(input + ii));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(output + ii),
+                         _mm_shuffle_epi8(value, mask));
+    }
+
+    byteSwapScalar(input + ii, elemSize, (numBytes - ii) / elemSize,
+                   output + ii);
+}
+
+SIX_SIMD_TARGET("avx2")
+void byteSwapAVX2(const sys::ubyte* input,
+                  size_t elemSize,
+                  size_t numElements,
+                  sys::ubyte* output)
+{
+    sys::ubyte maskBytes[32];
+    getShuffleMask(elemSize, maskBytes, sizeof(maskBytes));
+    const __m256i mask =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(maskBytes));
+
+    const size_t numBytes = elemSize * numElements;
+    size_t ii = 0;
+    for (; ii + 32 <= numBytes; ii += 32)
+    {
+        const __m256i value = _mm256_loadu_si256(
+                reinterpret_cast<const __m256i*>(input + ii));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(output + ii),
+                            _mm256_shuffle_epi8(value, mask));
+    }
+
+    byteSwapScalar(input + ii, elemSize, (numBytes - ii) / elemSize,
+                   output + ii);
+}
+
+SIX_SIMD_TARGET("avx2")
+void promote16AVX2(const sys::ubyte* input,
+                   bool swap,
+                   size_t numElements,
+                   float* output)
+{
+    sys::ubyte maskBytes[32];
+    getShuffleMask(2, maskBytes, sizeof(maskBytes));
+    const __m256i mask =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(maskBytes));
+
+    size_t ii = 0;
+    for (; ii + 16 <= numElements; ii += 16)
+    {
+        __m256i value = _mm256_loadu_si256(
+                reinterpret_cast<const __m256i*>(input + ii * 2));
+        if (swap)
+        {
+            value = _mm256_shuffle_epi8(value, mask);
+        }
+
+        const __m256i lo =
+                _mm256_cvtepi16_epi32(_mm256_castsi256_si128(value));
+        const __m256i hi =
+                _mm256_cvtepi16_epi32(_mm256_extracti128_si256(value, 1));
+        _mm256_storeu_ps(output + ii, _mm256_cvtepi32_ps(lo));
+        _mm256_storeu_ps(output + ii + 8, _mm256_cvtepi32_ps(hi));
+    }
+
+    if (swap)
+    {
+        byteSwapAndPromoteScalar(input + ii * 2, 2, numElements - ii,
+                                 output + ii);
+    }
+    else
+    {
+        promoteScalar(reinterpret_cast<const sys::Int16_T*>(input) + ii,
+                      numElements - ii, output + ii);
+    }
+}
+
+SIX_SIMD_TARGET("avx2")
+void promote8AVX2(const sys::ubyte* input, size_t numElements, float* output)
+{
+    size_t ii = 0;
+    for (; ii + 16 <= numElements; ii += 16)
+    {
+        const __m128i value = _mm_loadu_si128(
+                reinterpret_cast<const __m128i*>(input + ii));
+        const __m256i lo = _mm256_cvtepi8_epi32(value);
+        const __m256i hi = _mm256_cvtepi8_epi32(_mm_srli_si128(value, 8));
+        _mm256_storeu_ps(output + ii, _mm256_cvtepi32_ps(lo));
+        _mm256_storeu_ps(output + ii + 8, _mm256_cvtepi32_ps(hi));
+    }
+
+    promoteScalar(reinterpret_cast<const sys::Int8_T*>(input) + ii,
+                  numElements - ii, output + ii);
+}
+
+SIX_SIMD_TARGET("avx2")
+void scaleAVX2(float* buffer, size_t numElements, double scaleFactor)
+{
+    const __m256d scale = _mm256_set1_pd(scaleFactor);
+    size_t ii = 0;
+    for (; ii + 8 <= numElements; ii += 8)
+    {
+        const __m256d lo = _mm256_mul_pd(
+                _mm256_cvtps_pd(_mm_loadu_ps(buffer + ii)), scale);
+        const __m256d hi = _mm256_mul_pd(
+                _mm256_cvtps_pd(_mm_loadu_ps(buffer + ii + 4)), scale);
+        _mm_storeu_ps(buffer + ii, _mm256_cvtpd_ps(lo));
+        _mm_storeu_ps(buffer + ii + 4, _mm256_cvtpd_ps(hi));
+    }
+
+    scaleScalar(buffer + ii, numElements - ii, scaleFactor);
+}
+#endif
+
+void byteSwapImpl(const sys::ubyte* input,
+                  size_t elemSize,
+                  size_t numElements,
+                  sys::ubyte* output)
+{
+    if (elemSize == 2 || elemSize == 4 || elemSize == 8)
+    {
+        switch (getInstructionSet())
+        {
+#if defined(SIX_SIMD_X86_GNU)
+        case AVX2:
+            byteSwapAVX2(input, elemSize, numElements, output);
+            return;
+        case SSSE3:
+            byteSwapSSSE3(input, elemSize, numElements, output);
+            return;
+#endif
+#if defined(SIX_SIMD_X86_GNU) || defined(SIX_SIMD_X86_MSVC)
+        case SSE2:
+            byteSwapSSE2(input, elemSize, numElements, output);
+            return;
+#endif
+        default:
+            break;
+        }
+    }
+
+    if (elemSize > 1)
+    {
+        byteSwapScalar(input, elemSize, numElements, output);
+    }
+    else if (input != output)
+    {
+        ::memcpy(output, input, numElements);
+    }
+}
+
+void promoteImpl(const sys::ubyte* input,
+                 size_t elemSize,
+                 bool swap,
+                 size_t numElements,
+                 float* output)
+{
+    checkElementSize(elemSize);
+
+    if (elemSize == 4)
+    {
+        // Floats just need to be copied, and potentially swapped, bit for
+        // bit
+        if (swap)
+        {
+            byteSwapImpl(input, 4, numElements,
+                         reinterpret_cast<sys::ubyte*>(output));
+        }
+        else
+        {
+            ::memcpy(output, input, numElements * 4);
+        }
+        return;
+    }
+
+    switch (getInstructionSet())
+    {
+#if defined(SIX_SIMD_X86_GNU)
+    case AVX2:
+        if (elemSize == 1)
+        {
+            promote8AVX2(input, numElements, output);
+        }
+        else
+        {
+            promote16AVX2(input, swap, numElements, output);
+        }
+        return;
+#endif
+#if defined(SIX_SIMD_X86_GNU) || defined(SIX_SIMD_X86_MSVC)
+    case SSSE3:
+    case SSE2:
+        if (elemSize == 1)
+        {
+            promote8SSE2(input, numElements, output);
+        }
+        else
+        {
+            promote16SSE2(input, swap, numElements, output);
+        }
+        return;
+#endif
+    default:
+        break;
+    }
+
+    if (swap)
+    {
+        byteSwapAndPromoteScalar(input, elemSize, numElements, output);
+    }
+    else if (elemSize == 1)
+    {
+        promoteScalar(reinterpret_cast<const sys::Int8_T*>(input),
+                      numElements, output);
+    }
+    else
+    {
+        promoteScalar(reinterpret_cast<const sys::Int16_T*>(input),
+                      numElements, output);
+    }
+}
+
+void scaleImpl(float* buffer, size_t numElements, double scaleFactor)
+{
+    switch (getInstructionSet())
+    {
+#if defined(SIX_SIMD_X86_GNU)
+    case AVX2:
+        scaleAVX2(buffer, numElements, scaleFactor);
+        return;
+#endif
+#if defined(SIX_SIMD_X86_GNU) || defined(SIX_SIMD_X86_MSVC)
+    case SSSE3:
+    case SSE2:
+        scaleSSE2(buffer, numElements, scaleFactor);
+        return;
+#endif
+    default:
+        scaleScalar(buffer, numElements, scaleFactor);
+        return;
+    }
+}
+}
+
+namespace six
+{
+void byteSwap(void* buffer, size_t elemSize, size_t numElements)
+{
+    sys::ubyte* const bufferPtr = static_cast<sys::ubyte*>(buffer);
+    byteSwapImpl(bufferPtr, elemSize, numElements, bufferPtr);
+}
+
+void byteSwap(const void* input,
+              size_t elemSize,
+              size_t numElements,
+              void* output)
+{
+    byteSwapImpl(static_cast<const sys::ubyte*>(input),
+                 elemSize,
+                 numElements,
+                 static_cast<sys::ubyte*>(output));
+}
+
+void promote(const void* input,
+             size_t elemSize,
+             size_t numElements,
+             float* output)
+{
+    promoteImpl(static_cast<const sys::ubyte*>(input), elemSize, false,
+                numElements, output);
+}
+
+void byteSwapAndPromote(const void* input,
+                        size_t elemSize,
+                        size_t numElements,
+                        float* output)
+{
+    promoteImpl(static_cast<const sys::ubyte*>(input), elemSize, true,
+                numElements, output);
+}
+
+void byteSwapAndScale(const void* input,
+                      size_t elemSize,
+                      size_t numElements,
+                      double scaleFactor,
+                      float* output)
+{
+    checkElementSize(elemSize);
+
+    // Scale each chunk while it's still in cache
+    static const size_t CHUNK_SIZE = 2048;
+    const sys::ubyte* const inputPtr = static_cast<const sys::ubyte*>(input);
+    for (size_t ii = 0; ii < numElements; ii += CHUNK_SIZE)
+    {
+        const size_t numElementsThisChunk =
+                std::min(CHUNK_SIZE, numElements - ii);
+        promoteImpl(inputPtr + ii * elemSize, elemSize, true,
+                    numElementsThisChunk, output + ii);
+        scaleImpl(output + ii, numElementsThisChunk, scaleFactor);
+    }
+}
+}
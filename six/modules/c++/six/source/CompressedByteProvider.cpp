@@ -41,9 +41,9 @@ size_t countCompressedBytes(
     }
     return sum;
 }
-size_t countUncompressedPixels(const six::Data& data)
+size_t countUncompressedBytes(const six::Data& data)
 {
-    return data.getNumRows() * data.getNumCols();
+    return data.getNumRows() * data.getNumCols() * data.getNumBytesPerPixel();
 }
 }
 
@@ -62,7 +62,7 @@ void CompressedByteProvider::initialize(
     NITFWriteControl writer;
     const double byterate =
             static_cast<double>(countCompressedBytes(bytesPerBlock)) /
-             countUncompressedPixels(*container->getData(0));
+             countUncompressedBytes(*container->getData(0));
     writer.getOptions().setParameter(
             six::NITFWriteControl::OPT_J2K_COMPRESSION_BYTERATE, byterate);
     writer.getOptions().setParameter(
@@ -0,0 +1,126 @@
+/* =========================================================================
+ * This file is part of six-c++
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2017, MDA Information Systems LLC
+ *
+ * six-c++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <limits>
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <except/Exception.h>
+#include <six/MemoryMappedFile.h>
+
+namespace six
+{
+#ifdef WIN32
+MemoryMappedFile::MemoryMappedFile(const std::string& pathname) :
+    mData(NULL),
+    mSize(0),
+    mFile(INVALID_HANDLE_VALUE),
+    mMapping(NULL)
+{
+    mFile = CreateFile(pathname.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                       OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (mFile == INVALID_HANDLE_VALUE)
+    {
+        throw except::Exception(Ctxt("Unable to open " + pathname));
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(mFile, &size))
+    {
+        CloseHandle(mFile);
+        throw except::Exception(Ctxt("Unable to get size of " + pathname));
+    }
+    mSize = static_cast<sys::Uint64_T>(size.QuadPart);
+
+    mMapping = CreateFileMapping(mFile, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mMapping == NULL)
+    {
+        CloseHandle(mFile);
+        throw except::Exception(Ctxt("Unable to map " + pathname));
+    }
+
+    mData = static_cast<const sys::ubyte*>(
+            MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0));
+    if (mData == NULL)
+    {
+        CloseHandle(mMapping);
+        CloseHandle(mFile);
+        throw except::Exception(Ctxt("Unable to map " + pathname));
+    }
+}
+
+MemoryMappedFile::~MemoryMappedFile()
+{
+    UnmapViewOfFile(mData);
+    CloseHandle(mMapping);
+    CloseHandle(mFile);
+}
+#else
+MemoryMappedFile::MemoryMappedFile(const std::string& pathname) :
+    mData(NULL),
+    mSize(0)
+{
+    const int fd = ::open(pathname.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        throw except::Exception(Ctxt("Unable to open " + pathname));
+    }
+
+    struct stat info;
+    if (::fstat(fd, &info) != 0)
+    {
+        ::close(fd);
+        throw except::Exception(Ctxt("Unable to get size of " + pathname));
+    }
+    mSize = static_cast<sys::Uint64_T>(info.st_size);
+
+    // Can't address the whole file on a 32-bit system
+    if (mSize > std::numeric_limits<size_t>::max())
+    {
+        ::close(fd);
+        throw except::Exception(Ctxt(pathname + " is too large to map"));
+    }
+
+    void* const data = ::mmap(NULL, static_cast<size_t>(mSize), PROT_READ,
+                              MAP_SHARED, fd, 0);
+
+    // The mapping stays valid after the descriptor is closed
+    ::close(fd);
+
+    if (data == MAP_FAILED)
+    {
+        throw except::Exception(Ctxt("Unable to map " + pathname));
+    }
+    mData = static_cast<const sys::ubyte*>(data);
+}
+
+MemoryMappedFile::~MemoryMappedFile()
+{
+    ::munmap(const_cast<sys::ubyte*>(mData), static_cast<size_t>(mSize));
+}
+#endif
+}
@@ -22,6 +22,8 @@
 
 #include <sstream>
 
+#include <mt/ThreadGroup.h>
+#include <mt/ThreadPlanner.h>
 #include <six/NITFReadControl.h>
 #include <six/XMLControlFactory.h>
 #include <six/Utilities.h>
@@ -77,11 +79,269 @@ six::PixelType getPixelType(nitf::ImageSubheader& subheader)
                 "Unexpected image representation '" + iRep + "'"));
     }
 }
+
+// NITRO reads pixel interleaved I/Q and RGB segments as a single band, but
+// AMP8I_PHS8I bands ('M' and 'P') are kept apart, so we have to read both and
+// interleave them ourselves
+size_t getNumBandsToRead(six::PixelType pixelType)
+{
+    return (pixelType == six::PixelType::AMP8I_PHS8I) ? 2 : 1;
+}
+
+// Reads a window of an image segment into a pixel interleaved buffer.  If
+// more than one band is read, each band must be one byte per pixel.
+void readWindow(nitf::ImageReader& imageReader,
+                size_t startRow,
+                size_t numRows,
+                size_t startCol,
+                size_t numCols,
+                size_t numBands,
+                nitf::Uint8* buffer)
+{
+    nitf::SubWindow sw;
+    sw.setStartRow(static_cast<nitf::Uint32>(startRow));
+    sw.setNumRows(static_cast<nitf::Uint32>(numRows));
+    sw.setStartCol(static_cast<nitf::Uint32>(startCol));
+    sw.setNumCols(static_cast<nitf::Uint32>(numCols));
+
+    int padded;
+    if (numBands == 1)
+    {
+        nitf::Uint32 bandList(0);
+        sw.setNumBands(1);
+        sw.setBandList(&bandList);
+        imageReader.read(sw, &buffer, &padded);
+        return;
+    }
+
+    const size_t numPixels = numRows * numCols;
+    std::vector<nitf::Uint32> bandList(numBands);
+    std::vector<nitf::Uint8> bands(numPixels * numBands);
+    std::vector<nitf::Uint8*> bandPtrs(numBands);
+    for (size_t band = 0; band < numBands; ++band)
+    {
+        bandList[band] = static_cast<nitf::Uint32>(band);
+        bandPtrs[band] = &bands[band * numPixels];
+    }
+    sw.setNumBands(static_cast<nitf::Uint32>(numBands));
+    sw.setBandList(&bandList[0]);
+    imageReader.read(sw, &bandPtrs[0], &padded);
+
+    for (size_t band = 0; band < numBands; ++band)
+    {
+        const nitf::Uint8* const bandPtr = bandPtrs[band];
+        for (size_t pixel = 0; pixel < numPixels; ++pixel)
+        {
+            buffer[pixel * numBands + band] = bandPtr[pixel];
+        }
+    }
+}
+
+// The rows of a single image segment that a region covers, and where they
+// belong in the region's buffer
+struct SegmentRead
+{
+    // Index within the image's segments
+    size_t segment;
+    size_t startRow;
+    size_t numRows;
+    size_t bufferOffset;
+};
+
+// Reads a contiguous range of segments, each through its own reader
+template <typename SegmentReaderT>
+class ReadSegmentsRunnable : public sys::Runnable
+{
+public:
+    ReadSegmentsRunnable(const SegmentRead* segmentReads,
+                         SegmentReaderT* const* segmentReaders,
+                         size_t numReads,
+                         size_t startCol,
+                         size_t numCols,
+                         size_t numBands,
+                         nitf::Uint8* buffer) :
+        mSegmentReads(segmentReads),
+        mSegmentReaders(segmentReaders),
+        mNumReads(numReads),
+        mStartCol(startCol),
+        mNumCols(numCols),
+        mNumBands(numBands),
+        mBuffer(buffer)
+    {
+    }
+
+    virtual void run()
+    {
+        for (size_t ii = 0; ii < mNumReads; ++ii)
+        {
+            const SegmentRead& segmentRead(mSegmentReads[ii]);
+            mSegmentReaders[ii]->read(segmentRead.startRow,
+                                      segmentRead.numRows,
+                                      mStartCol,
+                                      mNumCols,
+                                      mNumBands,
+                                      mBuffer + segmentRead.bufferOffset);
+        }
+    }
+
+private:
+    const SegmentRead* const mSegmentReads;
+    SegmentReaderT* const* const mSegmentReaders;
+    const size_t mNumReads;
+    const size_t mStartCol;
+    const size_t mNumCols;
+    const size_t mNumBands;
+    nitf::Uint8* const mBuffer;
+};
+
+// Copies rows of a segment straight out of the memory mapped file, byte
+// swapping as we go
+void copyMappedRows(const sys::ubyte* segmentData,
+                    size_t elementSize,
+                    size_t numColsSegment,
+                    size_t numBytesPerPixel,
+                    size_t startRow,
+                    size_t numRows,
+                    size_t startCol,
+                    size_t numCols,
+                    sys::ubyte* buffer)
+{
+    const size_t inRowSize = numColsSegment * numBytesPerPixel;
+    const size_t outRowSize = numCols * numBytesPerPixel;
+    const size_t numElementsPerRow = outRowSize / elementSize;
+
+    const sys::ubyte* input = segmentData + startRow * inRowSize +
+            startCol * numBytesPerPixel;
+    for (size_t row = 0; row < numRows; ++row)
+    {
+        ::memcpy(buffer, input, outRowSize);
+        if (elementSize > 1)
+        {
+            sys::byteSwap(buffer,
+                          static_cast<unsigned short>(elementSize),
+                          numElementsPerRow);
+        }
+
+        input += inRowSize;
+        buffer += outRowSize;
+    }
+}
+
+// Validates the region against the image, filling in -1 extents and
+// allocating the region's buffer if needed
+nitf::Uint8* prepareRegion(const six::NITFImageInfo& thisImage,
+                           six::Region& region)
+{
+    const size_t numRowsTotal = thisImage.getData()->getNumRows();
+    const size_t numColsTotal = thisImage.getData()->getNumCols();
+
+    if (region.getNumRows() == -1)
+    {
+        region.setNumRows(numRowsTotal);
+    }
+    if (region.getNumCols() == -1)
+    {
+        region.setNumCols(numColsTotal);
+    }
+
+    const size_t numRowsReq = region.getNumRows();
+    const size_t numColsReq = region.getNumCols();
+
+    const size_t startRow = region.getStartRow();
+    const size_t startCol = region.getStartCol();
+
+    const size_t extentRows = startRow + numRowsReq;
+    const size_t extentCols = startCol + numColsReq;
+
+    if (extentRows > numRowsTotal || startRow > numRowsTotal)
+        throw except::Exception(Ctxt(FmtX("Too many rows requested [%d]",
+                                          numRowsReq)));
+
+    if (extentCols > numColsTotal || startCol > numColsTotal)
+        throw except::Exception(Ctxt(FmtX("Too many cols requested [%d]",
+                                          numColsReq)));
+
+    nitf::Uint8* buffer = region.getBuffer();
+
+    if (buffer == NULL)
+    {
+        const size_t subWindowSize = numRowsReq * numColsReq
+                * thisImage.getData()->getNumBytesPerPixel();
+
+        buffer = new nitf::Uint8[subWindowSize];
+        region.setBuffer(buffer);
+    }
+
+    return buffer;
+}
+
+// Determines which rows of which segments need to be read for the region
+void planSegmentReads(const six::NITFImageInfo& thisImage,
+                      const six::Region& region,
+                      std::vector<SegmentRead>& segmentReads)
+{
+    segmentReads.clear();
+
+    const std::vector<six::NITFSegmentInfo> imageSegments
+            = thisImage.getImageSegments();
+    const size_t numIS = imageSegments.size();
+    const size_t startRow = region.getStartRow();
+
+    size_t startOff = 0;
+    size_t i;
+    for (i = 0; i < numIS; i++)
+    {
+        const size_t firstRowSeg = imageSegments[i].firstRow;
+
+        if (firstRowSeg <= startRow)
+        {
+            // It could be in this segment
+            startOff = firstRowSeg;
+        }
+        else
+        {
+            break;
+        }
+    }
+    --i; // Need to get rid of the last one
+
+    const size_t rowSize = region.getNumCols() *
+            thisImage.getData()->getNumBytesPerPixel();
+
+    size_t numRowsLeft = region.getNumRows();
+    size_t startRowSeg = startRow - startOff;
+    size_t bufferOffset = 0;
+#if DEBUG_OFFSETS
+    std::cout << "startRow: " << startRow
+    << " startOff: " << startOff
+    << " sw.startRow: " << startRowSeg
+    << " i: " << i << std::endl;
+#endif
+
+    for (; i < numIS && numRowsLeft > 0; i++)
+    {
+        SegmentRead segmentRead;
+        segmentRead.segment = i;
+        segmentRead.startRow = startRowSeg;
+        segmentRead.numRows =
+                std::min<size_t>(numRowsLeft, imageSegments[i].numRows
+                        - startRowSeg);
+        segmentRead.bufferOffset = bufferOffset;
+        segmentReads.push_back(segmentRead);
+
+        bufferOffset += rowSize * segmentRead.numRows;
+        numRowsLeft -= segmentRead.numRows;
+        startRowSeg = 0;
+    }
+}
 }
 
 namespace six
 {
-NITFReadControl::NITFReadControl()
+const char NITFReadControl::OPT_MEMORY_MAP[] = "MemoryMap";
+
+NITFReadControl::NITFReadControl() :
+    mHaveCompressionOptions(false)
 {
     // Make sure that if we use XML_DATA_CONTENT that we've loaded it into the
     // singleton PluginRegistry
@@ -242,6 +502,138 @@ void NITFReadControl::load(const std::string& fromFile,
 {
     mem::SharedPtr<nitf::IOInterface> handle(new nitf::IOHandle(fromFile));
     load(handle, schemaPaths);
+    mPathname = fromFile;
+
+    if (static_cast<bool>(mOptions.getParameter(OPT_MEMORY_MAP,
+                                                 Parameter(false))))
+    {
+        mapImageSegments();
+    }
+}
+
+void NITFReadControl::mapImageSegments()
+{
+    try
+    {
+        mMappedFile.reset(new MemoryMappedFile(mPathname));
+    }
+    catch (const except::Exception& ex)
+    {
+        mLog->warn(Ctxt("Unable to memory map " + mPathname +
+                        ", reading through NITRO instead: " +
+                        ex.getMessage()));
+        return;
+    }
+
+    nitf::List images = mRecord.getImages();
+    nitf::ListIterator imageIter = images.begin();
+
+    for (size_t nitfSegmentIdx = 0;
+         imageIter != images.end();
+         ++imageIter, ++nitfSegmentIdx)
+    {
+        nitf::ImageSegment segment = (nitf::ImageSegment) *imageIter;
+        nitf::ImageSubheader subheader = segment.getSubheader();
+
+        // We can only read the pixels directly if they're laid out
+        // contiguously, one row after the next
+        std::string compression = subheader.getImageCompression().toString();
+        str::trim(compression);
+        if (compression != "NC")
+        {
+            continue;
+        }
+
+        const size_t numBlocksPerRow =
+                static_cast<nitf::Uint32>(subheader.getNumBlocksPerRow());
+        const size_t numBlocksPerCol =
+                static_cast<nitf::Uint32>(subheader.getNumBlocksPerCol());
+        if (numBlocksPerRow != 1 || numBlocksPerCol != 1)
+        {
+            continue;
+        }
+
+        const size_t numBands =
+                static_cast<nitf::Uint32>(subheader.getNumImageBands());
+        std::string imageMode = subheader.getImageMode().toString();
+        str::trim(imageMode);
+        if (numBands > 1 && imageMode != "P")
+        {
+            continue;
+        }
+
+        const size_t numBitsPerPixel =
+                static_cast<nitf::Uint32>(subheader.getNumBitsPerPixel());
+        if (numBitsPerPixel % 8 != 0)
+        {
+            continue;
+        }
+
+        // This also catches a block that's been padded out beyond the
+        // image
+        const size_t numBytesPerBand = numBitsPerPixel / 8;
+        const sys::Uint64_T numBytes =
+                static_cast<sys::Uint64_T>(
+                        static_cast<nitf::Uint32>(subheader.getNumRows())) *
+                static_cast<nitf::Uint32>(subheader.getNumCols()) *
+                numBands * numBytesPerBand;
+        const sys::Uint64_T offset = segment.getImageOffset();
+        if (numBytes != subheader.getNumBytesOfImageData() ||
+            offset + numBytes > mMappedFile->getSize())
+        {
+            continue;
+        }
+
+        MappedSegment mappedSegment;
+        mappedSegment.data = mMappedFile->getData() + offset;
+        mappedSegment.elementSize =
+                sys::isBigEndianSystem() ? 1 : numBytesPerBand;
+        mMappedSegments[nitfSegmentIdx] = mappedSegment;
+    }
+}
+
+bool NITFReadControl::isMapped(const NITFImageInfo& image,
+                               const Region& region) const
+{
+    if (mMappedSegments.empty())
+    {
+        return false;
+    }
+
+    const std::vector<NITFSegmentInfo> imageSegments =
+            image.getImageSegments();
+    for (size_t ii = 0; ii < imageSegments.size(); ++ii)
+    {
+        size_t firstGlobalRow;
+        size_t numRows;
+        if (imageSegments[ii].isInRange(region.getStartRow(),
+                                        region.getNumRows(),
+                                        firstGlobalRow,
+                                        numRows) &&
+            mMappedSegments.find(image.getStartIndex() + ii) ==
+                    mMappedSegments.end())
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+const UByte* NITFReadControl::getMappedSegment(size_t imageNumber,
+                                               size_t segmentNumber) const
+{
+    const NITFImageInfo& image = *mInfos.at(imageNumber);
+    if (segmentNumber >= image.getImageSegments().size())
+    {
+        throw except::Exception(Ctxt(
+                "Image " + str::toString(imageNumber) + " has no segment " +
+                str::toString(segmentNumber)));
+    }
+
+    const std::map<size_t, MappedSegment>::const_iterator iter =
+            mMappedSegments.find(image.getStartIndex() + segmentNumber);
+    return (iter == mMappedSegments.end()) ? NULL : iter->second.data;
 }
 
 void NITFReadControl::load(io::SeekableInputStream& stream,
@@ -592,114 +984,168 @@ NITFReadControl::getIndices(nitf::ImageSubheader& subheader) const
 
 UByte* NITFReadControl::interleaved(Region& region, size_t imageNumber)
 {
-    NITFImageInfo* thisImage = mInfos[imageNumber];
+    const NITFImageInfo* const thisImage = mInfos[imageNumber];
+    nitf::Uint8* const buffer = prepareRegion(*thisImage, region);
 
-    size_t numRowsTotal = thisImage->getData()->getNumRows();
-    size_t numColsTotal = thisImage->getData()->getNumCols();
+    std::vector<SegmentRead> segmentReads;
+    planSegmentReads(*thisImage, region, segmentReads);
 
-    if (region.getNumRows() == -1)
+    const size_t startIndex = thisImage->getStartIndex();
+    if (isMapped(*thisImage, region))
     {
-        region.setNumRows(numRowsTotal);
+        const size_t numCols = thisImage->getData()->getNumCols();
+        const size_t nbpp = thisImage->getData()->getNumBytesPerPixel();
+        for (size_t ii = 0; ii < segmentReads.size(); ++ii)
+        {
+            const SegmentRead& segmentRead(segmentReads[ii]);
+            const MappedSegment& mappedSegment = mMappedSegments.find(
+                    startIndex + segmentRead.segment)->second;
+            copyMappedRows(mappedSegment.data,
+                           mappedSegment.elementSize,
+                           numCols,
+                           nbpp,
+                           segmentRead.startRow,
+                           segmentRead.numRows,
+                           region.getStartCol(),
+                           region.getNumCols(),
+                           buffer + segmentRead.bufferOffset);
+        }
+
+        return buffer;
     }
-    if (region.getNumCols() == -1)
+
+    const size_t numBands =
+            getNumBandsToRead(thisImage->getData()->getPixelType());
+    for (size_t ii = 0; ii < segmentReads.size(); ++ii)
     {
-        region.setNumCols(numColsTotal);
+        const SegmentRead& segmentRead(segmentReads[ii]);
+        nitf::ImageReader imageReader =
+                getImageReader(startIndex + segmentRead.segment);
+
+        readWindow(imageReader,
+                   segmentRead.startRow,
+                   segmentRead.numRows,
+                   region.getStartCol(),
+                   region.getNumCols(),
+                   numBands,
+                   buffer + segmentRead.bufferOffset);
     }
 
-    size_t numRowsReq = region.getNumRows();
-    size_t numColsReq = region.getNumCols();
-
-    size_t startRow = region.getStartRow();
-    size_t startCol = region.getStartCol();
-
-    size_t extentRows = startRow + numRowsReq;
-    size_t extentCols = startCol + numColsReq;
-
-    if (extentRows > numRowsTotal || startRow > numRowsTotal)
-        throw except::Exception(Ctxt(FmtX("Too many rows requested [%d]",
-                                          numRowsReq)));
+    return buffer;
+}
 
-    if (extentCols > numColsTotal || startCol > numColsTotal)
-        throw except::Exception(Ctxt(FmtX("Too many cols requested [%d]",
-                                          numColsReq)));
+UByte* NITFReadControl::interleaved(Region& region,
+                                    size_t imageNumber,
+                                    size_t numThreads)
+{
+    const NITFImageInfo* const thisImage = mInfos[imageNumber];
+    nitf::Uint8* const buffer = prepareRegion(*thisImage, region);
 
-    // Allocate one band
-    nitf::Uint32 bandList(0);
+    std::vector<SegmentRead> segmentReads;
+    planSegmentReads(*thisImage, region, segmentReads);
 
-    nitf::Uint8* buffer = region.getBuffer();
-
-    size_t subWindowSize = numRowsReq * numColsReq
-            * thisImage->getData()->getNumBytesPerPixel();
+    // Reads from the memory map are just copies, so there's nothing to be
+    // gained from threading them
+    if (numThreads <= 1 || segmentReads.size() <= 1 || mPathname.empty() ||
+        isMapped(*thisImage, region))
+    {
+        return interleaved(region, imageNumber);
+    }
 
-    if (buffer == NULL)
+    // Open any readers we don't already have on this thread since reading
+    // the NITF header isn't something we want to do concurrently
+    const size_t startIndex = thisImage->getStartIndex();
+    std::vector<SegmentReader*> segmentReaders(segmentReads.size());
+    for (size_t ii = 0; ii < segmentReads.size(); ++ii)
     {
-        buffer = new nitf::Uint8[subWindowSize];
-        region.setBuffer(buffer);
+        const size_t segmentIndex = startIndex + segmentReads[ii].segment;
+        mem::SharedPtr<SegmentReader>& segmentReader =
+                mSegmentReaders[segmentIndex];
+        if (segmentReader.get() == NULL)
+        {
+            segmentReader.reset(new SegmentReader(mPathname,
+                                                  segmentIndex,
+                                                  getCompressionOptions()));
+        }
+        segmentReaders[ii] = segmentReader.get();
     }
 
-    // Do segmenting here
-    nitf::SubWindow sw;
-    sw.setStartCol(static_cast<nitf::Uint32>(startCol));
-    sw.setNumCols(static_cast<nitf::Uint32>(numColsReq));
-    sw.setNumBands(1);
-    sw.setBandList(&bandList);
+    const size_t numBands =
+            getNumBandsToRead(thisImage->getData()->getPixelType());
 
-    std::vector < NITFSegmentInfo > imageSegments
-            = thisImage->getImageSegments();
-    size_t numIS = imageSegments.size();
-    size_t startOff = 0;
+    mt::ThreadGroup threads;
+    const mt::ThreadPlanner planner(segmentReads.size(), numThreads);
 
-    size_t i;
-    for (i = 0; i < numIS; i++)
+    size_t threadNum(0);
+    size_t startRead(0);
+    size_t numReadsThisThread(0);
+    while (planner.getThreadInfo(threadNum++,
+                                 startRead,
+                                 numReadsThisThread))
     {
-        size_t firstRowSeg = imageSegments[i].firstRow;
+        std::auto_ptr<sys::Runnable> reader(
+                new ReadSegmentsRunnable<SegmentReader>(
+                        &segmentReads[startRead],
+                        &segmentReaders[startRead],
+                        numReadsThisThread,
+                        region.getStartCol(),
+                        region.getNumCols(),
+                        numBands,
+                        buffer));
+        threads.createThread(reader);
+    }
+    threads.joinAll();
 
-        if (firstRowSeg <= startRow)
-        {
-            // It could be in this segment
-            startOff = firstRowSeg;
-        }
-        else
-        {
-            break;
-        }
+    return buffer;
+}
 
+nitf::ImageReader NITFReadControl::getImageReader(size_t segmentIndex)
+{
+    std::map<size_t, nitf::ImageReader>::iterator iter =
+            mImageReaders.find(segmentIndex);
+    if (iter == mImageReaders.end())
+    {
+        const nitf::ImageReader imageReader = mReader.newImageReader(
+                static_cast<int>(segmentIndex),
+                getCompressionOptions());
+        iter = mImageReaders.insert(
+                std::make_pair(segmentIndex, imageReader)).first;
     }
-    --i; // Need to get rid of the last one
-    size_t totalRead = 0;
-    size_t numRowsLeft = numRowsReq;
-    sw.setStartRow(static_cast<nitf::Uint32>(startRow - startOff));
-#if DEBUG_OFFSETS
-    std::cout << "startRow: " << startRow
-    << " startOff: " << startOff
-    << " sw.startRow: " << sw.getStartRow()
-    << " i: " << i << std::endl;
-#endif
 
-    size_t nbpp = thisImage->getData()->getNumBytesPerPixel();
-    size_t startIndex = thisImage->getStartIndex();
-    createCompressionOptions(mCompressionOptions);
-    for (; i < numIS && totalRead < subWindowSize; i++)
-    {
-        size_t numRowsReqSeg =
-                std::min<size_t>(numRowsLeft, imageSegments[i].numRows
-                        - sw.getStartRow());
+    return iter->second;
+}
 
-        sw.setNumRows(static_cast<nitf::Uint32>(numRowsReqSeg));
-        nitf::ImageReader imageReader = mReader.newImageReader(
-                static_cast<int>(startIndex + i),
-                mCompressionOptions);
+std::map<std::string, void*>& NITFReadControl::getCompressionOptions()
+{
+    if (!mHaveCompressionOptions)
+    {
+        createCompressionOptions(mCompressionOptions);
+        mHaveCompressionOptions = true;
+    }
 
-        nitf::Uint8* bufferPtr = buffer + totalRead;
+    return mCompressionOptions;
+}
 
-        int padded;
-        imageReader.read(sw, &bufferPtr, &padded);
-        totalRead += numColsReq * nbpp * numRowsReqSeg;
-        sw.setStartRow(0);
-        numRowsLeft -= numRowsReqSeg;
-    }
+NITFReadControl::SegmentReader::SegmentReader(
+        const std::string& pathname,
+        size_t segmentIndex,
+        std::map<std::string, void*>& compressionOptions) :
+    mHandle(pathname),
+    mRecord(mReader.read(mHandle)),
+    mImageReader(mReader.newImageReader(static_cast<int>(segmentIndex),
+                                        compressionOptions))
+{
+}
 
-    return buffer;
+void NITFReadControl::SegmentReader::read(size_t startRow,
+                                          size_t numRows,
+                                          size_t startCol,
+                                          size_t numCols,
+                                          size_t numBands,
+                                          nitf::Uint8* buffer)
+{
+    readWindow(mImageReader, startRow, numRows, startCol, numCols, numBands,
+               buffer);
 }
 
 std::auto_ptr<Legend> NITFReadControl::findLegend(size_t productNum)
@@ -779,7 +1225,17 @@ void NITFReadControl::reset()
         delete mInfos[ii];
     }
     mInfos.clear();
+
+    // The image readers refer to the underlying IO, so these need to go
+    // before it does
+    mImageReaders.clear();
+    mSegmentReaders.clear();
+    mHaveCompressionOptions = false;
+    mMappedSegments.clear();
+    mMappedFile.reset();
+
     mInterface.reset();
+    mPathname.clear();
 }
 
 
@@ -95,6 +95,8 @@ const char NITFWriteControl::OPT_J2K_COMPRESSION_BYTERATE[] = "J2KCompressionByt
 const char NITFWriteControl::OPT_J2K_COMPRESSION_LOSSLESS[] = "J2KCompressionLossless";
 const char NITFWriteControl::OPT_NUM_ROWS_PER_BLOCK[] = "NumRowsPerBlock";
 const char NITFWriteControl::OPT_NUM_COLS_PER_BLOCK[] = "NumColsPerBlock";
+const char NITFWriteControl::OPT_NUM_THREADS[] = "NumThreads";
+const char NITFWriteControl::OPT_ASYNC_WRITE[] = "AsyncWrite";
 const size_t NITFWriteControl::DEFAULT_BUFFER_SIZE = 8 * 1024 * 1024;
 
 NITFWriteControl::NITFWriteControl()
@@ -790,6 +792,10 @@ void NITFWriteControl::save(
 {
     mWriter.prepareIO(outputFile, mRecord);
     const bool doByteSwap = shouldByteSwap();
+    const size_t numThreads = static_cast<size_t>(
+            mOptions.getParameter(OPT_NUM_THREADS, Parameter(1)));
+    const size_t queueDepth = static_cast<size_t>(
+            mOptions.getParameter(OPT_ASYNC_WRITE, Parameter(0)));
 
     if (mInfos.size() != imageData.size())
     {
@@ -820,7 +826,8 @@ void NITFWriteControl::save(
 
             mem::SharedPtr< ::nitf::WriteHandler> writeHandler(
                 new StreamWriteHandler (segmentInfo, imageData[i], numCols,
-                                        numChannels, pixelSize, doByteSwap));
+                                        numChannels, pixelSize, doByteSwap,
+                                        numThreads, queueDepth));
 
             mWriter.setImageWriteHandler(
                     static_cast<int>(info.getStartIndex() + j),
@@ -852,6 +859,10 @@ void NITFWriteControl::save(
 {
     mWriter.prepareIO(outputFile, mRecord);
     const bool doByteSwap = shouldByteSwap();
+    const size_t numThreads = static_cast<size_t>(
+            mOptions.getParameter(OPT_NUM_THREADS, Parameter(1)));
+    const size_t queueDepth = static_cast<size_t>(
+            mOptions.getParameter(OPT_ASYNC_WRITE, Parameter(0)));
 
     if (mInfos.size() != imageData.size())
         throw except::Exception(Ctxt("Require " + str::toString(mInfos.size())
@@ -937,7 +948,8 @@ void NITFWriteControl::save(
                 mem::SharedPtr< ::nitf::WriteHandler> writeHandler(
                     new MemoryWriteHandler(segmentInfo, imageData[i],
                                            segmentInfo.firstRow, numCols,
-                                           numChannels, pixelSize, doByteSwap));
+                                           numChannels, pixelSize, doByteSwap,
+                                           numThreads, queueDepth));
                 // Could set start index here
                 mWriter.setImageWriteHandler(
                         static_cast<int>(info.getStartIndex() + jj),
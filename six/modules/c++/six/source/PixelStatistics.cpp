@@ -0,0 +1,781 @@
+/* =========================================================================
+ * This file is part of six-c++
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2017, MDA Information Systems LLC
+ *
+ * six-c++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+
+#include <except/Exception.h>
+#include <mt/ThreadGroup.h>
+#include <mt/ThreadPlanner.h>
+#include <str/Convert.h>
+#include <sys/Runnable.h>
+#include <six/PixelStatistics.h>
+
+namespace
+{
+// Pixels are converted to values this many at a time, so that the values
+// stay in cache while every statistic goes over them
+const size_t CHUNK_SIZE = 1024;
+
+// The t-digest scale function, which maps a quantile to a centroid index
+// (scaled by the compression).  Centroids may only span one unit of it.
+double quantileToScale(double quantile, double compression)
+{
+    return compression / (2 * M_PI) * ::asin(2 * quantile - 1);
+}
+
+double scaleToQuantile(double scale, double compression)
+{
+    const double angle = scale * 2 * M_PI / compression;
+    return (angle >= M_PI / 2) ? 1 : (::sin(angle) + 1) / 2;
+}
+
+// Flips the bits of a float so that the keys sort as unsigned integers in
+// the same order as the values.  Negative values are all below positive
+// ones, and further below the larger their magnitude.
+sys::Uint32_T toSortKey(float value)
+{
+    sys::Uint32_T bits;
+    ::memcpy(&bits, &value, sizeof(bits));
+    return (bits & 0x80000000) ? ~bits : (bits | 0x80000000);
+}
+
+float fromSortKey(sys::Uint32_T key)
+{
+    const sys::Uint32_T bits = (key & 0x80000000) ? (key & 0x7FFFFFFF) : ~key;
+    float value;
+    ::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// Least significant byte first radix sort, which leaves the keys sorted in
+// 'keys'.  Bytes that every key has in common are skipped, which is most of
+// them for pixels of a small range.
+void radixSort(std::vector<sys::Uint32_T>& keys,
+               std::vector<sys::Uint32_T>& scratch)
+{
+    const size_t numKeys = keys.size();
+    scratch.resize(numKeys);
+    for (size_t shift = 0; shift < 32; shift += 8)
+    {
+        size_t counts[256];
+        std::fill(counts, counts + 256, 0);
+        for (size_t ii = 0; ii < numKeys; ++ii)
+        {
+            ++counts[(keys[ii] >> shift) & 0xFF];
+        }
+        if (counts[(keys[0] >> shift) & 0xFF] == numKeys)
+        {
+            continue;
+        }
+
+        size_t offset(0);
+        for (size_t bucket = 0; bucket < 256; ++bucket)
+        {
+            const size_t count = counts[bucket];
+            counts[bucket] = offset;
+            offset += count;
+        }
+        for (size_t ii = 0; ii < numKeys; ++ii)
+        {
+            scratch[counts[(keys[ii] >> shift) & 0xFF]++] = keys[ii];
+        }
+        keys.swap(scratch);
+    }
+}
+}
+
+namespace six
+{
+QuantileDigest::QuantileDigest(double compression) :
+    mCompression(compression),
+    mBufferSize(static_cast<size_t>(compression * 10)),
+    mMin(std::numeric_limits<double>::max()),
+    mMax(-std::numeric_limits<double>::max())
+{
+    if (!(compression >= 1))
+    {
+        throw except::Exception(Ctxt("Invalid compression " +
+                str::toString(compression)));
+    }
+}
+
+void QuantileDigest::add(const float* values, size_t numValues)
+{
+    size_t start = 0;
+    while (start < numValues)
+    {
+        const size_t numToBuffer =
+                std::min(numValues - start, mBufferSize - mKeys.size());
+        for (size_t ii = start; ii < start + numToBuffer; ++ii)
+        {
+            mKeys.push_back(toSortKey(values[ii]));
+        }
+        start += numToBuffer;
+
+        if (mKeys.size() >= mBufferSize)
+        {
+            flush();
+        }
+    }
+}
+
+void QuantileDigest::merge(const QuantileDigest& other)
+{
+    other.flush();
+    if (other.mCentroids.empty())
+    {
+        return;
+    }
+
+    flush();
+    mMin = std::min(mMin, other.mMin);
+    mMax = std::max(mMax, other.mMax);
+    std::vector<Centroid> centroids;
+    centroids.reserve(mCentroids.size() + other.mCentroids.size());
+    std::merge(mCentroids.begin(), mCentroids.end(),
+               other.mCentroids.begin(), other.mCentroids.end(),
+               std::back_inserter(centroids));
+    compress(centroids);
+}
+
+double QuantileDigest::getCount() const
+{
+    flush();
+    double count(0);
+    for (size_t ii = 0; ii < mCentroids.size(); ++ii)
+    {
+        count += mCentroids[ii].weight;
+    }
+    return count;
+}
+
+size_t QuantileDigest::getNumCentroids() const
+{
+    flush();
+    return mCentroids.size();
+}
+
+void QuantileDigest::flush() const
+{
+    if (mKeys.empty())
+    {
+        return;
+    }
+
+    // Sorted values, with repeats as one centroid, then merged with the
+    // centroids, which are already sorted
+    radixSort(mKeys, mScratch);
+    mMin = std::min<double>(mMin, fromSortKey(mKeys.front()));
+    mMax = std::max<double>(mMax, fromSortKey(mKeys.back()));
+
+    std::vector<Centroid> values;
+    for (size_t ii = 0; ii < mKeys.size();)
+    {
+        size_t end = ii + 1;
+        while (end < mKeys.size() && mKeys[end] == mKeys[ii])
+        {
+            ++end;
+        }
+        values.push_back(Centroid(fromSortKey(mKeys[ii]),
+                                  static_cast<double>(end - ii)));
+        ii = end;
+    }
+    mKeys.clear();
+
+    std::vector<Centroid> centroids;
+    centroids.reserve(values.size() + mCentroids.size());
+    std::merge(values.begin(), values.end(),
+               mCentroids.begin(), mCentroids.end(),
+               std::back_inserter(centroids));
+    compress(centroids);
+}
+
+void QuantileDigest::compress(const std::vector<Centroid>& centroids) const
+{
+    double totalWeight(0);
+    for (size_t ii = 0; ii < centroids.size(); ++ii)
+    {
+        totalWeight += centroids[ii].weight;
+    }
+
+    // Greedily merge neighbors for as long as they fit in one unit of
+    // the scale function
+    mCentroids.clear();
+    Centroid current = centroids[0];
+    double weightSoFar(0);
+    double weightLimit = totalWeight * scaleToQuantile(
+            quantileToScale(0, mCompression) + 1, mCompression);
+    for (size_t ii = 1; ii < centroids.size(); ++ii)
+    {
+        const Centroid& next = centroids[ii];
+        if (weightSoFar + current.weight + next.weight <= weightLimit)
+        {
+            current.weight += next.weight;
+            current.mean += (next.mean - current.mean) * next.weight /
+                    current.weight;
+        }
+        else
+        {
+            weightSoFar += current.weight;
+            mCentroids.push_back(current);
+            weightLimit = totalWeight * scaleToQuantile(
+                    quantileToScale(weightSoFar / totalWeight, mCompression) +
+                            1,
+                    mCompression);
+            current = next;
+        }
+    }
+    mCentroids.push_back(current);
+}
+
+double QuantileDigest::getQuantile(double fraction) const
+{
+    flush();
+    if (mCentroids.empty())
+    {
+        throw except::Exception(Ctxt("No values to take a quantile of"));
+    }
+    if (fraction < 0 || fraction > 1)
+    {
+        throw except::Exception(Ctxt("Invalid quantile " +
+                str::toString(fraction)));
+    }
+    if (mCentroids.size() == 1)
+    {
+        return mCentroids[0].mean;
+    }
+
+    double totalWeight(0);
+    for (size_t ii = 0; ii < mCentroids.size(); ++ii)
+    {
+        totalWeight += mCentroids[ii].weight;
+    }
+    const double target = fraction * totalWeight;
+
+    // Interpolate between the centers of the centroids, and out to the
+    // extrema beyond the first and last ones
+    const Centroid& first = mCentroids.front();
+    double position = first.weight / 2;
+    if (target < position)
+    {
+        return mMin + (first.mean - mMin) * target / position;
+    }
+    for (size_t ii = 0; ii + 1 < mCentroids.size(); ++ii)
+    {
+        const double gap = (mCentroids[ii].weight +
+                            mCentroids[ii + 1].weight) / 2;
+        if (target < position + gap)
+        {
+            return mCentroids[ii].mean +
+                    (mCentroids[ii + 1].mean - mCentroids[ii].mean) *
+                            (target - position) / gap;
+        }
+        position += gap;
+    }
+
+    const Centroid& last = mCentroids.back();
+    const double remaining = totalWeight - position;
+    return (remaining > 0) ?
+            std::min(mMax, last.mean + (mMax - last.mean) *
+                    (target - position) / remaining) :
+            mMax;
+}
+
+Histogram::Histogram() :
+    mMinValue(0),
+    mMaxValue(0),
+    mBinsPerValue(0),
+    mNumBelow(0),
+    mNumAbove(0)
+{
+}
+
+Histogram::Histogram(double minValue, double maxValue, size_t numBins) :
+    mMinValue(minValue),
+    mMaxValue(maxValue),
+    mBinsPerValue(0),
+    mCounts(numBins, 0),
+    mNumBelow(0),
+    mNumAbove(0)
+{
+    if (numBins > 0)
+    {
+        if (!(minValue < maxValue))
+        {
+            throw except::Exception(Ctxt("Histogram range " +
+                    str::toString(minValue) + " to " +
+                    str::toString(maxValue) + " is empty"));
+        }
+        mBinsPerValue = numBins / (maxValue - minValue);
+    }
+}
+
+void Histogram::add(const float* values, size_t numValues)
+{
+    if (mCounts.empty())
+    {
+        return;
+    }
+
+    const double numBins = static_cast<double>(mCounts.size());
+    for (size_t ii = 0; ii < numValues; ++ii)
+    {
+        const double position = (values[ii] - mMinValue) * mBinsPerValue;
+        if (position < 0)
+        {
+            ++mNumBelow;
+        }
+        else if (position >= numBins)
+        {
+            ++mNumAbove;
+        }
+        else
+        {
+            ++mCounts[static_cast<size_t>(position)];
+        }
+    }
+}
+
+void Histogram::merge(const Histogram& other)
+{
+    if (other.mCounts.size() != mCounts.size() ||
+        other.mMinValue != mMinValue ||
+        other.mMaxValue != mMaxValue)
+    {
+        throw except::Exception(Ctxt(
+                "Can only merge histograms with the same bins"));
+    }
+
+    for (size_t ii = 0; ii < mCounts.size(); ++ii)
+    {
+        mCounts[ii] += other.mCounts[ii];
+    }
+    mNumBelow += other.mNumBelow;
+    mNumAbove += other.mNumAbove;
+}
+
+SampleStatistics::SampleStatistics(const Histogram& histogram,
+                                   double compression) :
+    mCount(0),
+    mMin(std::numeric_limits<double>::max()),
+    mMax(-std::numeric_limits<double>::max()),
+    mMinPositive(std::numeric_limits<double>::max()),
+    mMean(0),
+    mM2(0),
+    mHistogram(histogram),
+    mHasQuantiles(compression != 0),
+    mDigest(mHasQuantiles ? compression : 100)
+{
+}
+
+void SampleStatistics::add(const float* values, size_t numValues)
+{
+    for (size_t start = 0; start < numValues; start += CHUNK_SIZE)
+    {
+        const size_t numThisChunk = std::min(CHUNK_SIZE, numValues - start);
+        const float* const chunk = values + start;
+
+        // The chunk's own mean and sum of squared deviations, then those
+        // are combined with the running ones (Chan et al.), which stays
+        // accurate no matter how many values there are
+        const float none = std::numeric_limits<float>::max();
+        float minValue(chunk[0]);
+        float maxValue(chunk[0]);
+        float minPositive(none);
+        double sum(0);
+        for (size_t ii = 0; ii < numThisChunk; ++ii)
+        {
+            minValue = std::min(minValue, chunk[ii]);
+            maxValue = std::max(maxValue, chunk[ii]);
+            minPositive = std::min(minPositive,
+                                   (chunk[ii] > 0) ? chunk[ii] : none);
+            sum += chunk[ii];
+        }
+        const double chunkMean = sum / numThisChunk;
+        double chunkM2(0);
+        for (size_t ii = 0; ii < numThisChunk; ++ii)
+        {
+            const double deviation = chunk[ii] - chunkMean;
+            chunkM2 += deviation * deviation;
+        }
+
+        const double count = static_cast<double>(mCount);
+        const double total = count + numThisChunk;
+        const double delta = chunkMean - mMean;
+        mMean += delta * numThisChunk / total;
+        mM2 += chunkM2 + delta * delta * count * numThisChunk / total;
+        mCount += numThisChunk;
+        mMin = std::min<double>(mMin, minValue);
+        mMax = std::max<double>(mMax, maxValue);
+        if (minPositive < none)
+        {
+            mMinPositive = std::min<double>(mMinPositive, minPositive);
+        }
+
+        mHistogram.add(chunk, numThisChunk);
+        if (mHasQuantiles)
+        {
+            mDigest.add(chunk, numThisChunk);
+        }
+    }
+}
+
+void SampleStatistics::merge(const SampleStatistics& other)
+{
+    if (other.mCount == 0)
+    {
+        return;
+    }
+
+    const double count = static_cast<double>(mCount);
+    const double otherCount = static_cast<double>(other.mCount);
+    const double total = count + otherCount;
+    const double delta = other.mMean - mMean;
+    mMean += delta * otherCount / total;
+    mM2 += other.mM2 + delta * delta * count * otherCount / total;
+    mCount += other.mCount;
+    mMin = std::min(mMin, other.mMin);
+    mMax = std::max(mMax, other.mMax);
+    mMinPositive = std::min(mMinPositive, other.mMinPositive);
+
+    mHistogram.merge(other.mHistogram);
+    if (mHasQuantiles)
+    {
+        mDigest.merge(other.mDigest);
+    }
+}
+
+double SampleStatistics::getQuantile(double fraction) const
+{
+    if (!mHasQuantiles)
+    {
+        throw except::Exception(Ctxt("Quantiles are turned off"));
+    }
+    return mDigest.getQuantile(fraction);
+}
+
+double SampleStatistics::getStandardDeviation() const
+{
+    return ::sqrt(getVariance());
+}
+
+class PixelStatisticsCollector::StatisticsRunnable : public sys::Runnable
+{
+public:
+    StatisticsRunnable(const PixelStatisticsCollector& collector,
+                       const UByte* pixels,
+                       size_t numPixels,
+                       std::vector<SampleStatistics>& statistics) :
+        mCollector(collector),
+        mPixels(pixels),
+        mNumPixels(numPixels),
+        mStatistics(statistics)
+    {
+    }
+
+    virtual void run()
+    {
+        mCollector.addPixels(mPixels, mNumPixels, mStatistics);
+    }
+
+private:
+    const PixelStatisticsCollector& mCollector;
+    const UByte* const mPixels;
+    const size_t mNumPixels;
+    std::vector<SampleStatistics>& mStatistics;
+};
+
+// Reads the next block of rows while the current one is processed
+class PixelStatisticsCollector::ReadRunnable : public sys::Runnable
+{
+public:
+    ReadRunnable(NITFReadControl& reader,
+                 size_t imageNumber,
+                 size_t startRow,
+                 size_t numRows,
+                 size_t numCols,
+                 size_t numThreads,
+                 UByte* buffer) :
+        mReader(reader),
+        mImageNumber(imageNumber),
+        mNumThreads(numThreads)
+    {
+        mRegion.setStartRow(startRow);
+        mRegion.setNumRows(numRows);
+        mRegion.setNumCols(numCols);
+        mRegion.setBuffer(buffer);
+    }
+
+    virtual void run()
+    {
+        mReader.interleaved(mRegion, mImageNumber, mNumThreads);
+    }
+
+private:
+    NITFReadControl& mReader;
+    const size_t mImageNumber;
+    const size_t mNumThreads;
+    Region mRegion;
+};
+
+PixelStatisticsCollector::PixelStatisticsCollector(
+        PixelType pixelType,
+        const AmplitudeTable* ampTable,
+        size_t numThreads,
+        double compression) :
+    mPixelType(pixelType),
+    mNumThreads(std::max<size_t>(numThreads, 1)),
+    mCompression(compression),
+    mNumBands(1)
+{
+    switch (pixelType)
+    {
+    case PixelType::RE32F_IM32F:
+        mNumBytesPerPixel = 8;
+        break;
+    case PixelType::RE16I_IM16I:
+        mNumBytesPerPixel = 4;
+        break;
+    case PixelType::AMP8I_PHS8I:
+        mNumBytesPerPixel = 2;
+        mAmplitudes.resize(256);
+        for (size_t ii = 0; ii < mAmplitudes.size(); ++ii)
+        {
+            mAmplitudes[ii] = ampTable ?
+                    static_cast<float>(*reinterpret_cast<const double*>(
+                            (*ampTable)[ii])) :
+                    static_cast<float>(ii);
+        }
+        if (!ampTable)
+        {
+            mHistogram = Histogram(0, 256, 256);
+        }
+        break;
+    case PixelType::MONO8I:
+    case PixelType::MONO8LU:
+    case PixelType::RGB8LU:
+        mNumBytesPerPixel = 1;
+        mHistogram = Histogram(0, 256, 256);
+        break;
+    case PixelType::MONO16I:
+        mNumBytesPerPixel = 2;
+        mHistogram = Histogram(0, 65536, 65536);
+        break;
+    case PixelType::RGB24I:
+        mNumBytesPerPixel = 3;
+        mNumBands = 3;
+        mHistogram = Histogram(0, 256, 256);
+        break;
+    default:
+        throw except::Exception(Ctxt("Can't gather statistics of " +
+                pixelType.toString() + " pixels"));
+    }
+
+    reset();
+}
+
+void PixelStatisticsCollector::setHistogram(double minValue,
+                                            double maxValue,
+                                            size_t numBins)
+{
+    mHistogram = Histogram(minValue, maxValue, numBins);
+    reset();
+}
+
+void PixelStatisticsCollector::reset()
+{
+    const SampleStatistics empty(mHistogram, mCompression);
+    mStatistics.assign(mNumBands, empty);
+    mPartials.assign(mNumThreads, mStatistics);
+}
+
+void PixelStatisticsCollector::addPixels(const UByte* pixels,
+                                         const types::RowCol<size_t>& dims)
+{
+    const mt::ThreadPlanner planner(dims.row, mNumThreads);
+    if (planner.getNumThreadsThatWillBeUsed() <= 1)
+    {
+        addPixels(pixels, dims.area(), mPartials[0]);
+        return;
+    }
+
+    mt::ThreadGroup threads;
+    size_t threadNum(0);
+    size_t startRow(0);
+    size_t numRowsThisThread(0);
+    while (planner.getThreadInfo(threadNum, startRow, numRowsThisThread))
+    {
+        threads.createThread(new StatisticsRunnable(
+                *this,
+                pixels + startRow * dims.col * mNumBytesPerPixel,
+                numRowsThisThread * dims.col,
+                mPartials[threadNum]));
+        ++threadNum;
+    }
+    threads.joinAll();
+}
+
+void PixelStatisticsCollector::addPixels(
+        const UByte* pixels,
+        size_t numPixels,
+        std::vector<SampleStatistics>& statistics) const
+{
+    float values[CHUNK_SIZE];
+    for (size_t start = 0; start < numPixels; start += CHUNK_SIZE)
+    {
+        const size_t numThisChunk = std::min(CHUNK_SIZE, numPixels - start);
+        const UByte* const chunk = pixels + start * mNumBytesPerPixel;
+
+        for (size_t band = 0; band < mNumBands; ++band)
+        {
+            switch (mPixelType)
+            {
+            case PixelType::RE32F_IM32F:
+            {
+                const float* const iq = reinterpret_cast<const float*>(chunk);
+                for (size_t ii = 0; ii < numThisChunk; ++ii)
+                {
+                    values[ii] = ::sqrtf(iq[2 * ii] * iq[2 * ii] +
+                                         iq[2 * ii + 1] * iq[2 * ii + 1]);
+                }
+                break;
+            }
+            case PixelType::RE16I_IM16I:
+            {
+                const sys::Int16_T* const iq =
+                        reinterpret_cast<const sys::Int16_T*>(chunk);
+                for (size_t ii = 0; ii < numThisChunk; ++ii)
+                {
+                    const float re = iq[2 * ii];
+                    const float im = iq[2 * ii + 1];
+                    values[ii] = ::sqrtf(re * re + im * im);
+                }
+                break;
+            }
+            case PixelType::AMP8I_PHS8I:
+                for (size_t ii = 0; ii < numThisChunk; ++ii)
+                {
+                    values[ii] = mAmplitudes[chunk[2 * ii]];
+                }
+                break;
+            case PixelType::MONO16I:
+            {
+                const sys::Uint16_T* const samples =
+                        reinterpret_cast<const sys::Uint16_T*>(chunk);
+                for (size_t ii = 0; ii < numThisChunk; ++ii)
+                {
+                    values[ii] = samples[ii];
+                }
+                break;
+            }
+            default:
+                // One byte per band
+                for (size_t ii = 0; ii < numThisChunk; ++ii)
+                {
+                    values[ii] = chunk[ii * mNumBands + band];
+                }
+                break;
+            }
+
+            statistics[band].add(values, numThisChunk);
+        }
+    }
+}
+
+void PixelStatisticsCollector::addImage(NITFReadControl& reader,
+                                        size_t imageNumber,
+                                        size_t numRowsPerBlock)
+{
+    const Data* const data = reader.getContainer()->getData(imageNumber);
+    if (data == NULL || data->getPixelType() != mPixelType)
+    {
+        throw except::Exception(Ctxt("Image " + str::toString(imageNumber) +
+                " doesn't have " + mPixelType.toString() + " pixels"));
+    }
+    if (numRowsPerBlock == 0)
+    {
+        throw except::Exception(Ctxt("Need at least one row per block"));
+    }
+
+    const size_t numRows = data->getNumRows();
+    const size_t numCols = data->getNumCols();
+    const size_t rowsPerBlock = std::min(numRowsPerBlock, numRows);
+    std::vector<UByte> buffers[2];
+    buffers[0].resize(rowsPerBlock * numCols * mNumBytesPerPixel);
+    buffers[1].resize(buffers[0].size());
+
+    if (numRows > 0)
+    {
+        ReadRunnable(reader, imageNumber, 0, rowsPerBlock, numCols,
+                     mNumThreads, &buffers[0][0]).run();
+    }
+
+    for (size_t startRow = 0, block = 0;
+         startRow < numRows;
+         startRow += rowsPerBlock, ++block)
+    {
+        const size_t numRowsThisBlock =
+                std::min(rowsPerBlock, numRows - startRow);
+
+        mt::ThreadGroup readThread;
+        const size_t nextRow = startRow + numRowsThisBlock;
+        if (nextRow < numRows)
+        {
+            readThread.createThread(new ReadRunnable(
+                    reader, imageNumber, nextRow,
+                    std::min(rowsPerBlock, numRows - nextRow), numCols,
+                    mNumThreads, &buffers[(block + 1) % 2][0]));
+        }
+
+        addPixels(&buffers[block % 2][0],
+                  types::RowCol<size_t>(numRowsThisBlock, numCols));
+        readThread.joinAll();
+    }
+}
+
+const SampleStatistics&
+PixelStatisticsCollector::getStatistics(size_t band) const
+{
+    mergePartials();
+    return mStatistics.at(band);
+}
+
+void PixelStatisticsCollector::mergePartials() const
+{
+    const SampleStatistics empty(mHistogram, mCompression);
+    for (size_t thread = 0; thread < mPartials.size(); ++thread)
+    {
+        for (size_t band = 0; band < mNumBands; ++band)
+        {
+            if (mPartials[thread][band].getCount() > 0)
+            {
+                mStatistics[band].merge(mPartials[thread][band]);
+                mPartials[thread][band] = empty;
+            }
+        }
+    }
+}
+}
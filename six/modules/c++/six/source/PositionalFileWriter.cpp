@@ -0,0 +1,122 @@
+/* =========================================================================
+ * This file is part of six-c++
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2017, MDA Information Systems LLC
+ *
+ * six-c++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <algorithm>
+
+#ifndef WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <except/Exception.h>
+#include <six/PositionalFileWriter.h>
+
+namespace six
+{
+#ifdef WIN32
+PositionalFileWriter::PositionalFileWriter(const std::string& pathname) :
+    mPathname(pathname)
+{
+    mFile = CreateFile(pathname.c_str(), GENERIC_WRITE,
+                       FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                       OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (mFile == INVALID_HANDLE_VALUE)
+    {
+        throw except::Exception(Ctxt("Unable to open " + pathname));
+    }
+}
+
+PositionalFileWriter::~PositionalFileWriter()
+{
+    CloseHandle(mFile);
+}
+
+void PositionalFileWriter::writeAt(const void* buffer,
+                                   size_t numBytes,
+                                   sys::Off_T offset)
+{
+    const sys::byte* bufferPtr = static_cast<const sys::byte*>(buffer);
+    while (numBytes > 0)
+    {
+        // WriteFile() can only take 32 bits worth of bytes at a time
+        const DWORD numBytesThisWrite = static_cast<DWORD>(
+                std::min<size_t>(numBytes, 0x40000000));
+
+        OVERLAPPED overlapped;
+        memset(&overlapped, 0, sizeof(overlapped));
+        overlapped.Offset = static_cast<DWORD>(offset & 0xFFFFFFFF);
+        overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+
+        DWORD numBytesWritten;
+        if (!WriteFile(mFile, bufferPtr, numBytesThisWrite, &numBytesWritten,
+                       &overlapped))
+        {
+            throw except::Exception(Ctxt("Unable to write to " + mPathname));
+        }
+
+        bufferPtr += numBytesWritten;
+        numBytes -= numBytesWritten;
+        offset += numBytesWritten;
+    }
+}
+#else
+PositionalFileWriter::PositionalFileWriter(const std::string& pathname) :
+    mPathname(pathname),
+    mFile(::open(pathname.c_str(), O_WRONLY))
+{
+    if (mFile < 0)
+    {
+        throw except::Exception(Ctxt("Unable to open " + pathname));
+    }
+}
+
+PositionalFileWriter::~PositionalFileWriter()
+{
+    ::close(mFile);
+}
+
+void PositionalFileWriter::writeAt(const void* buffer,
+                                   size_t numBytes,
+                                   sys::Off_T offset)
+{
+    const sys::byte* bufferPtr = static_cast<const sys::byte*>(buffer);
+    while (numBytes > 0)
+    {
+        const ssize_t numBytesWritten =
+                ::pwrite(mFile, bufferPtr, numBytes, offset);
+        if (numBytesWritten < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            throw except::Exception(Ctxt("Unable to write to " + mPathname));
+        }
+
+        bufferPtr += numBytesWritten;
+        numBytes -= numBytesWritten;
+        offset += numBytesWritten;
+    }
+}
+#endif
+}
@@ -0,0 +1,145 @@
+/* =========================================================================
+ * This file is part of six-c++
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2017, MDA Information Systems LLC
+ *
+ * six-c++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <algorithm>
+
+#include <sys/OS.h>
+#include <mt/CriticalSection.h>
+#include <six/ValidatorCache.h>
+
+namespace six
+{
+ValidatorRegistry::ValidatorRegistry()
+{
+}
+
+ValidatorRegistry::Schemas
+ValidatorRegistry::findSchemas(const std::vector<std::string>& schemaPaths)
+{
+    // This is the same search the validator does when it's compiled
+    const sys::OS os;
+    std::vector<std::string> pathnames =
+            os.search(schemaPaths, "", ".xsd", true);
+    std::sort(pathnames.begin(), pathnames.end());
+
+    Schemas schemas(pathnames.size());
+    for (size_t ii = 0; ii < pathnames.size(); ++ii)
+    {
+        schemas[ii].first = pathnames[ii];
+        schemas[ii].second = os.getLastModifiedTime(pathnames[ii]);
+    }
+    return schemas;
+}
+
+size_t ValidatorRegistry::checkOut(
+        const std::vector<std::string>& key,
+        const Schemas& schemas,
+        mem::SharedPtr<xml::lite::Validator>& validator)
+{
+    mt::CriticalSection<sys::Mutex> crit(&mMutex);
+
+    Entry& entry = mEntries[key];
+    if (entry.schemas != schemas)
+    {
+        // Schemas have been added, removed, or modified since we compiled
+        // the idle validators (or this is the first time through)
+        entry.schemas = schemas;
+        entry.idle.clear();
+        ++entry.generation;
+    }
+
+    if (!entry.idle.empty())
+    {
+        validator = entry.idle.back();
+        entry.idle.pop_back();
+    }
+    return entry.generation;
+}
+
+void ValidatorRegistry::checkIn(
+        const std::vector<std::string>& key,
+        size_t generation,
+        mem::SharedPtr<xml::lite::Validator> validator)
+{
+    mt::CriticalSection<sys::Mutex> crit(&mMutex);
+
+    const EntryMap::iterator iter = mEntries.find(key);
+    if (iter != mEntries.end() && iter->second.generation == generation)
+    {
+        iter->second.idle.push_back(validator);
+    }
+}
+
+bool ValidatorRegistry::validate(
+        const xml::lite::Element* element,
+        const std::string& xmlID,
+        const std::vector<std::string>& schemaPaths,
+        logging::Logger* log,
+        std::vector<xml::lite::ValidationInfo>& errors)
+{
+    // The order the paths come in doesn't change what gets compiled
+    std::vector<std::string> key(schemaPaths);
+    std::sort(key.begin(), key.end());
+    key.erase(std::unique(key.begin(), key.end()), key.end());
+
+    const Schemas schemas = findSchemas(key);
+
+    mem::SharedPtr<xml::lite::Validator> validator;
+    const size_t generation = checkOut(key, schemas, validator);
+
+    // Compile outside of the lock so we don't hold up validation against
+    // other sets of paths
+    if (validator.get() == NULL)
+    {
+        validator.reset(new xml::lite::Validator(key, log, true));
+    }
+
+    // Validators don't agree on what their return value means, so go by
+    // whether any errors were added
+    const size_t numErrors = errors.size();
+    validator->validate(element, xmlID, errors);
+
+    // If validation threw, the validator is simply not returned to the cache
+    checkIn(key, generation, validator);
+    return errors.size() == numErrors;
+}
+
+void ValidatorRegistry::clear()
+{
+    mt::CriticalSection<sys::Mutex> crit(&mMutex);
+    mEntries.clear();
+}
+
+size_t ValidatorRegistry::getNumValidators() const
+{
+    mt::CriticalSection<sys::Mutex> crit(&mMutex);
+
+    size_t numValidators(0);
+    for (EntryMap::const_iterator iter = mEntries.begin();
+         iter != mEntries.end();
+         ++iter)
+    {
+        numValidators += iter->second.idle.size();
+    }
+    return numValidators;
+}
+}
@@ -22,6 +22,7 @@
 
 #include <logging/NullLogger.h>
 #include <six/XMLControl.h>
+#include <six/ValidatorCache.h>
 
 //! Validate the xml and log any errors
 //  NOTE: Errors are treated as detriments to valid processing
@@ -54,8 +55,6 @@ void validate(const xml::lite::Document* doc,
     // validate against any specified schemas
     if (!paths.empty())
     {
-        xml::lite::Validator validator(paths, log, true);
-
         std::vector<xml::lite::ValidationInfo> errors;
 
         if (doc->getRootElement()->getUri().empty())
@@ -65,9 +64,14 @@ void validate(const xml::lite::Document* doc,
                 "determined to use for validation"));
         }
 
-        validator.validate(doc->getRootElement(),
-                           doc->getRootElement()->getUri(),
-                           errors);
+        // the schemas are only compiled the first time through for these
+        // paths, and again whenever they change
+        six::ValidatorCache::getInstance().validate(
+                doc->getRootElement(),
+                doc->getRootElement()->getUri(),
+                paths,
+                log,
+                errors);
 
         // log any error found and throw
         if (!errors.empty())
@@ -0,0 +1,190 @@
+/* =========================================================================
+ * This file is part of six-c++
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2017, MDA Information Systems LLC
+ *
+ * six-c++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <vector>
+
+#include <sys/Conf.h>
+#include <six/ByteSwap.h>
+#include "TestCase.h"
+
+namespace
+{
+// Odd so that we exercise the scalar tail after the SIMD loops
+const size_t NUM_ELEMENTS = 1029;
+
+std::vector<sys::ubyte> createInput(size_t numBytes)
+{
+    std::vector<sys::ubyte> input(numBytes);
+    for (size_t ii = 0; ii < numBytes; ++ii)
+    {
+        input[ii] = static_cast<sys::ubyte>(ii * 7 + 3);
+    }
+    return input;
+}
+
+bool isSwapped(const std::vector<sys::ubyte>& input,
+               const std::vector<sys::ubyte>& output,
+               size_t elemSize)
+{
+    for (size_t ii = 0; ii < input.size(); ++ii)
+    {
+        const size_t elem = ii / elemSize;
+        const size_t byte = ii % elemSize;
+        if (output[elem * elemSize + elemSize - 1 - byte] != input[ii])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+TEST_CASE(testByteSwapCopy)
+{
+    for (size_t elemSize = 2; elemSize <= 8; elemSize *= 2)
+    {
+        const std::vector<sys::ubyte> input =
+                createInput(NUM_ELEMENTS * elemSize);
+        std::vector<sys::ubyte> output(input.size());
+        six::byteSwap(&input[0], elemSize, NUM_ELEMENTS, &output[0]);
+        TEST_ASSERT(isSwapped(input, output, elemSize));
+    }
+}
+
+TEST_CASE(testByteSwapInPlace)
+{
+    for (size_t elemSize = 2; elemSize <= 8; elemSize *= 2)
+    {
+        const std::vector<sys::ubyte> input =
+                createInput(NUM_ELEMENTS * elemSize);
+        std::vector<sys::ubyte> buffer(input);
+        six::byteSwap(&buffer[0], elemSize, NUM_ELEMENTS);
+        TEST_ASSERT(isSwapped(input, buffer, elemSize));
+    }
+}
+
+TEST_CASE(testPromote)
+{
+    std::vector<sys::Int8_T> input8(NUM_ELEMENTS);
+    std::vector<sys::Int16_T> input16(NUM_ELEMENTS);
+    for (size_t ii = 0; ii < NUM_ELEMENTS; ++ii)
+    {
+        input8[ii] = static_cast<sys::Int8_T>(ii * 13);
+        input16[ii] = static_cast<sys::Int16_T>(ii * 1031);
+    }
+
+    std::vector<float> output(NUM_ELEMENTS);
+    six::promote(&input8[0], 1, NUM_ELEMENTS, &output[0]);
+    for (size_t ii = 0; ii < NUM_ELEMENTS; ++ii)
+    {
+        TEST_ASSERT_EQ(output[ii], static_cast<float>(input8[ii]));
+    }
+
+    six::promote(&input16[0], 2, NUM_ELEMENTS, &output[0]);
+    for (size_t ii = 0; ii < NUM_ELEMENTS; ++ii)
+    {
+        TEST_ASSERT_EQ(output[ii], static_cast<float>(input16[ii]));
+    }
+}
+
+TEST_CASE(testByteSwapAndPromote)
+{
+    std::vector<sys::Int16_T> input16(NUM_ELEMENTS);
+    std::vector<float> inputFloat(NUM_ELEMENTS);
+    for (size_t ii = 0; ii < NUM_ELEMENTS; ++ii)
+    {
+        input16[ii] = static_cast<sys::Int16_T>(ii * 1031);
+        inputFloat[ii] = ii * -1.5f;
+    }
+
+    std::vector<sys::Int16_T> swapped16(input16);
+    sys::byteSwap(&swapped16[0], 2, NUM_ELEMENTS);
+    std::vector<float> swappedFloat(inputFloat);
+    sys::byteSwap(&swappedFloat[0], 4, NUM_ELEMENTS);
+
+    std::vector<float> output(NUM_ELEMENTS);
+    six::byteSwapAndPromote(&swapped16[0], 2, NUM_ELEMENTS, &output[0]);
+    for (size_t ii = 0; ii < NUM_ELEMENTS; ++ii)
+    {
+        TEST_ASSERT_EQ(output[ii], static_cast<float>(input16[ii]));
+    }
+
+    six::byteSwapAndPromote(&swappedFloat[0], 4, NUM_ELEMENTS, &output[0]);
+    for (size_t ii = 0; ii < NUM_ELEMENTS; ++ii)
+    {
+        TEST_ASSERT_EQ(output[ii], inputFloat[ii]);
+    }
+}
+
+TEST_CASE(testByteSwapAndScale)
+{
+    const double scaleFactor = 0.3;
+    std::vector<sys::Int8_T> input8(NUM_ELEMENTS);
+    std::vector<sys::Int16_T> input16(NUM_ELEMENTS);
+    std::vector<float> inputFloat(NUM_ELEMENTS);
+    for (size_t ii = 0; ii < NUM_ELEMENTS; ++ii)
+    {
+        input8[ii] = static_cast<sys::Int8_T>(ii * 13);
+        input16[ii] = static_cast<sys::Int16_T>(ii * 1031);
+        inputFloat[ii] = ii * -1.5f;
+    }
+
+    std::vector<sys::Int16_T> swapped16(input16);
+    sys::byteSwap(&swapped16[0], 2, NUM_ELEMENTS);
+    std::vector<float> swappedFloat(inputFloat);
+    sys::byteSwap(&swappedFloat[0], 4, NUM_ELEMENTS);
+
+    std::vector<float> output(NUM_ELEMENTS);
+    six::byteSwapAndScale(&input8[0], 1, NUM_ELEMENTS, scaleFactor,
+                          &output[0]);
+    for (size_t ii = 0; ii < NUM_ELEMENTS; ++ii)
+    {
+        TEST_ASSERT_EQ(output[ii],
+                       static_cast<float>(input8[ii] * scaleFactor));
+    }
+
+    six::byteSwapAndScale(&swapped16[0], 2, NUM_ELEMENTS, scaleFactor,
+                          &output[0]);
+    for (size_t ii = 0; ii < NUM_ELEMENTS; ++ii)
+    {
+        TEST_ASSERT_EQ(output[ii],
+                       static_cast<float>(input16[ii] * scaleFactor));
+    }
+
+    six::byteSwapAndScale(&swappedFloat[0], 4, NUM_ELEMENTS, scaleFactor,
+                          &output[0]);
+    for (size_t ii = 0; ii < NUM_ELEMENTS; ++ii)
+    {
+        TEST_ASSERT_EQ(output[ii],
+                       static_cast<float>(inputFloat[ii] * scaleFactor));
+    }
+}
+}
+
+int main(int , char** )
+{
+    TEST_CHECK(testByteSwapCopy);
+    TEST_CHECK(testByteSwapInPlace);
+    TEST_CHECK(testPromote);
+    TEST_CHECK(testByteSwapAndPromote);
+    TEST_CHECK(testByteSwapAndScale);
+    return 0;
+}
@@ -0,0 +1,301 @@
+/* =========================================================================
+ * This file is part of six-c++
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2017, MDA Information Systems LLC
+ *
+ * six-c++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <math.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <sys/Conf.h>
+#include <six/PixelStatistics.h>
+#include "TestCase.h"
+
+namespace
+{
+// 0 to 9999 in a scrambled order
+std::vector<float> createValues()
+{
+    std::vector<float> values(10000);
+    for (size_t ii = 0; ii < values.size(); ++ii)
+    {
+        values[ii] = static_cast<float>(ii * 7919 % values.size());
+    }
+    return values;
+}
+
+TEST_CASE(testQuantileDigest)
+{
+    const std::vector<float> values = createValues();
+    six::QuantileDigest digest;
+    digest.add(&values[0], values.size());
+
+    TEST_ASSERT_EQ(digest.getCount(), 10000.0);
+    TEST_ASSERT_LESSER(digest.getNumCentroids(), static_cast<size_t>(200));
+    TEST_ASSERT_EQ(digest.getQuantile(0), 0.0);
+    TEST_ASSERT_EQ(digest.getQuantile(1), 9999.0);
+    const double fractions[] = {0.001, 0.01, 0.25, 0.5, 0.9, 0.99, 0.999};
+    for (size_t ii = 0; ii < sizeof(fractions) / sizeof(fractions[0]); ++ii)
+    {
+        TEST_ASSERT_ALMOST_EQ_EPS(digest.getQuantile(fractions[ii]),
+                                  fractions[ii] * 10000, 10.0);
+    }
+
+    // Digests of the halves, merged, are just as good
+    six::QuantileDigest first;
+    six::QuantileDigest second;
+    first.add(&values[0], 3000);
+    second.add(&values[3000], 7000);
+    first.merge(second);
+    TEST_ASSERT_EQ(first.getCount(), 10000.0);
+    TEST_ASSERT_ALMOST_EQ_EPS(first.getQuantile(0.5), 5000.0, 10.0);
+    TEST_ASSERT_ALMOST_EQ_EPS(first.getQuantile(0.99), 9900.0, 10.0);
+
+    TEST_EXCEPTION(six::QuantileDigest().getQuantile(0.5));
+}
+
+TEST_CASE(testQuantileDigestRepeats)
+{
+    // Few distinct values, many times each, and negatives, which sort by
+    // flipping their bits
+    std::vector<float> values(100000);
+    for (size_t ii = 0; ii < values.size(); ++ii)
+    {
+        values[ii] = static_cast<float>(ii * 7919 % 10) - 4.5f;
+    }
+    six::QuantileDigest digest;
+    digest.add(&values[0], values.size());
+
+    TEST_ASSERT_EQ(digest.getCount(), 100000.0);
+    TEST_ASSERT_EQ(digest.getQuantile(0), -4.5);
+    TEST_ASSERT_EQ(digest.getQuantile(1), 4.5);
+    TEST_ASSERT_ALMOST_EQ_EPS(digest.getQuantile(0.05), -4.5, 0.5);
+    TEST_ASSERT_ALMOST_EQ_EPS(digest.getQuantile(0.25), -2.5, 0.5);
+    TEST_ASSERT_ALMOST_EQ_EPS(digest.getQuantile(0.75), 2.5, 0.5);
+}
+
+TEST_CASE(testHistogram)
+{
+    const std::vector<float> values = createValues();
+    six::Histogram histogram(-100, 9900, 100);
+    histogram.add(&values[0], values.size());
+
+    TEST_ASSERT_EQ(histogram.getBinWidth(), 100.0);
+    TEST_ASSERT_EQ(histogram.getCount(0), static_cast<sys::Uint64_T>(0));
+    TEST_ASSERT_EQ(histogram.getCount(1), static_cast<sys::Uint64_T>(100));
+    TEST_ASSERT_EQ(histogram.getCount(99), static_cast<sys::Uint64_T>(100));
+    TEST_ASSERT_EQ(histogram.getNumBelow(), static_cast<sys::Uint64_T>(0));
+    TEST_ASSERT_EQ(histogram.getNumAbove(), static_cast<sys::Uint64_T>(100));
+
+    six::Histogram other(-100, 9900, 100);
+    other.add(&values[0], 10);
+    histogram.merge(other);
+    TEST_ASSERT_EQ(histogram.getCount(1), static_cast<sys::Uint64_T>(101));
+    TEST_EXCEPTION(histogram.merge(six::Histogram(0, 1, 100)));
+}
+
+TEST_CASE(testSampleStatistics)
+{
+    // Big offset so that a naive sum of squares would lose the variance
+    std::vector<float> values = createValues();
+    for (size_t ii = 0; ii < values.size(); ++ii)
+    {
+        values[ii] = 1e6f + values[ii] / 100;
+    }
+
+    double mean(0);
+    for (size_t ii = 0; ii < values.size(); ++ii)
+    {
+        mean += values[ii];
+    }
+    mean /= values.size();
+    double variance(0);
+    for (size_t ii = 0; ii < values.size(); ++ii)
+    {
+        variance += (values[ii] - mean) * (values[ii] - mean);
+    }
+    variance /= values.size();
+
+    six::SampleStatistics stats;
+    six::SampleStatistics first;
+    six::SampleStatistics second;
+    stats.add(&values[0], values.size());
+    first.add(&values[0], 2500);
+    second.add(&values[2500], 7500);
+    first.merge(second);
+
+    TEST_ASSERT_EQ(stats.getCount(), static_cast<sys::Uint64_T>(10000));
+    TEST_ASSERT_EQ(stats.getMin(), 1e6);
+    TEST_ASSERT_EQ(stats.getMinPositive(), 1e6);
+    TEST_ASSERT_EQ(stats.getMax(),
+                   static_cast<double>(*std::max_element(values.begin(),
+                                                         values.end())));
+    TEST_ASSERT_ALMOST_EQ_EPS(stats.getMean(), mean, 1e-6);
+    TEST_ASSERT_ALMOST_EQ_EPS(stats.getVariance(), variance, 1e-3);
+    TEST_ASSERT_EQ(first.getCount(), stats.getCount());
+    TEST_ASSERT_ALMOST_EQ_EPS(first.getMean(), mean, 1e-6);
+    TEST_ASSERT_ALMOST_EQ_EPS(first.getVariance(), variance, 1e-3);
+
+    // Quantiles are only there if asked for, and change nothing else
+    TEST_EXCEPTION(stats.getQuantile(0.5));
+    six::SampleStatistics withQuantiles(six::Histogram(), 100);
+    withQuantiles.add(&values[0], values.size());
+    TEST_ASSERT_EQ(withQuantiles.getMax(), stats.getMax());
+    TEST_ASSERT_EQ(withQuantiles.getMean(), stats.getMean());
+    TEST_ASSERT_EQ(withQuantiles.getQuantile(0), stats.getMin());
+    TEST_ASSERT_ALMOST_EQ_EPS(withQuantiles.getQuantile(0.5),
+                              1e6 + 50.0, 0.5);
+}
+
+TEST_CASE(testMinPositive)
+{
+    // Zeros and negatives don't count, and all of them leave it at 0
+    const float values[] = {0, -3, 7, 0.5f, 0, 2};
+    six::SampleStatistics first;
+    six::SampleStatistics second;
+    first.add(values, 3);
+    second.add(values + 3, 3);
+    TEST_ASSERT_EQ(first.getMinPositive(), 7.0);
+    TEST_ASSERT_EQ(second.getMinPositive(), 0.5);
+    first.merge(second);
+    TEST_ASSERT_EQ(first.getMin(), -3.0);
+    TEST_ASSERT_EQ(first.getMinPositive(), 0.5);
+
+    six::SampleStatistics none;
+    none.add(values, 2);
+    TEST_ASSERT_EQ(none.getMinPositive(), 0.0);
+    TEST_ASSERT_EQ(six::SampleStatistics().getMinPositive(), 0.0);
+}
+
+TEST_CASE(testComplexPixels)
+{
+    // Amplitudes 0 to 99, with sqrt(2) phases
+    std::vector<float> iq(2 * 33 * 40);
+    for (size_t ii = 0; ii < iq.size() / 2; ++ii)
+    {
+        const float amplitude = static_cast<float>(ii % 100);
+        iq[2 * ii] = amplitude * ::cosf(ii * 1.414f);
+        iq[2 * ii + 1] = amplitude * ::sinf(ii * 1.414f);
+    }
+
+    six::PixelStatisticsCollector single(six::PixelType::RE32F_IM32F,
+                                         NULL, 1, 100);
+    six::PixelStatisticsCollector threaded(six::PixelType::RE32F_IM32F,
+                                           NULL, 3, 100);
+    single.setHistogram(0, 100, 100);
+    threaded.setHistogram(0, 100, 100);
+    const types::RowCol<size_t> dims(33, 40);
+    single.addPixels(reinterpret_cast<const six::UByte*>(&iq[0]), dims);
+    threaded.addPixels(reinterpret_cast<const six::UByte*>(&iq[0]), dims);
+
+    const six::SampleStatistics& stats = single.getStatistics();
+    const six::SampleStatistics& threadedStats = threaded.getStatistics();
+    TEST_ASSERT_EQ(stats.getCount(), static_cast<sys::Uint64_T>(1320));
+    TEST_ASSERT_EQ(threadedStats.getCount(), stats.getCount());
+    TEST_ASSERT_ALMOST_EQ_EPS(stats.getMean(),
+                              (1300 * 49.5 + 20 * 9.5) / 1320, 0.01);
+    TEST_ASSERT_ALMOST_EQ_EPS(threadedStats.getMean(), stats.getMean(), 1e-9);
+    TEST_ASSERT_ALMOST_EQ_EPS(threadedStats.getVariance(),
+                              stats.getVariance(), 1e-6);
+    TEST_ASSERT_ALMOST_EQ_EPS(stats.getMax(), 99.0, 1e-4);
+    TEST_ASSERT(stats.getHistogram().getCounts() ==
+                threadedStats.getHistogram().getCounts());
+    TEST_ASSERT_ALMOST_EQ_EPS(stats.getQuantile(0.5),
+                              threadedStats.getQuantile(0.5), 1.0);
+}
+
+TEST_CASE(testAmpPhasePixels)
+{
+    six::AmplitudeTable ampTable;
+    for (size_t ii = 0; ii < 256; ++ii)
+    {
+        *reinterpret_cast<double*>(ampTable[ii]) = ii * 0.5;
+    }
+
+    std::vector<six::UByte> pixels(2 * 512);
+    for (size_t ii = 0; ii < 512; ++ii)
+    {
+        pixels[2 * ii] = static_cast<six::UByte>(ii);
+        pixels[2 * ii + 1] = static_cast<six::UByte>(ii * 3);
+    }
+
+    six::PixelStatisticsCollector withTable(six::PixelType::AMP8I_PHS8I,
+                                            &ampTable);
+    six::PixelStatisticsCollector withoutTable(six::PixelType::AMP8I_PHS8I);
+    withTable.addPixels(&pixels[0], types::RowCol<size_t>(2, 256));
+    withoutTable.addPixels(&pixels[0], types::RowCol<size_t>(2, 256));
+
+    TEST_ASSERT_EQ(withTable.getStatistics().getMax(), 127.5);
+    TEST_ASSERT_EQ(withTable.getStatistics().getHistogram().getNumBins(),
+                   static_cast<size_t>(0));
+    TEST_ASSERT_EQ(withoutTable.getStatistics().getMax(), 255.0);
+    TEST_ASSERT_EQ(withoutTable.getStatistics().getMean(), 127.5);
+    for (size_t ii = 0; ii < 256; ++ii)
+    {
+        TEST_ASSERT_EQ(
+                withoutTable.getStatistics().getHistogram().getCount(ii),
+                static_cast<sys::Uint64_T>(2));
+    }
+}
+
+TEST_CASE(testColorPixels)
+{
+    std::vector<six::UByte> pixels(3 * 100);
+    for (size_t ii = 0; ii < 100; ++ii)
+    {
+        pixels[3 * ii] = 10;
+        pixels[3 * ii + 1] = static_cast<six::UByte>(ii);
+        pixels[3 * ii + 2] = static_cast<six::UByte>(255 - ii);
+    }
+
+    six::PixelStatisticsCollector collector(six::PixelType::RGB24I, NULL, 2);
+    collector.addPixels(&pixels[0], types::RowCol<size_t>(10, 10));
+    TEST_ASSERT_EQ(collector.getNumBands(), static_cast<size_t>(3));
+    TEST_ASSERT_EQ(collector.getStatistics(0).getVariance(), 0.0);
+    TEST_ASSERT_EQ(collector.getStatistics(0).getHistogram().getCount(10),
+                   static_cast<sys::Uint64_T>(100));
+    TEST_ASSERT_EQ(collector.getStatistics(1).getMean(), 49.5);
+    TEST_ASSERT_EQ(collector.getStatistics(2).getMin(), 156.0);
+
+    // More pixels keep adding to the same statistics until reset()
+    collector.addPixels(&pixels[0], types::RowCol<size_t>(10, 10));
+    TEST_ASSERT_EQ(collector.getStatistics(1).getCount(),
+                   static_cast<sys::Uint64_T>(200));
+    collector.reset();
+    TEST_ASSERT_EQ(collector.getStatistics(1).getCount(),
+                   static_cast<sys::Uint64_T>(0));
+
+    TEST_EXCEPTION(six::PixelStatisticsCollector(six::PixelType::NOT_SET));
+}
+}
+
+int main(int , char** )
+{
+    TEST_CHECK(testQuantileDigest);
+    TEST_CHECK(testQuantileDigestRepeats);
+    TEST_CHECK(testHistogram);
+    TEST_CHECK(testSampleStatistics);
+    TEST_CHECK(testMinPositive);
+    TEST_CHECK(testComplexPixels);
+    TEST_CHECK(testAmpPhasePixels);
+    TEST_CHECK(testColorPixels);
+    return 0;
+}
@@ -0,0 +1,142 @@
+/* =========================================================================
+ * This file is part of six-c++
+ * =========================================================================
+ *
+ * (C) Copyright 2004 - 2017, MDA Information Systems LLC
+ *
+ * six-c++ is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not,
+ * see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <string>
+#include <vector>
+
+#include <io/FileOutputStream.h>
+#include <io/StringStream.h>
+#include <logging/NullLogger.h>
+#include <sys/OS.h>
+#include <xml/lite/MinidomParser.h>
+#include <xml/lite/xml_lite_config.h>
+#include <six/ValidatorCache.h>
+#include "TestCase.h"
+
+namespace
+{
+const char SCHEMA[] =
+    "<?xml version=\"1.0\"?>\n"
+    "<xs:schema xmlns:xs=\"http://www.w3.org/2001/XMLSchema\"\n"
+    "           targetNamespace=\"urn:test:validator-cache\"\n"
+    "           xmlns=\"urn:test:validator-cache\"\n"
+    "           elementFormDefault=\"qualified\">\n"
+    "  <xs:element name=\"Root\">\n"
+    "    <xs:complexType>\n"
+    "      <xs:sequence>\n"
+    "        <xs:element name=\"Count\" type=\"xs:int\"/>\n"
+    "      </xs:sequence>\n"
+    "    </xs:complexType>\n"
+    "  </xs:element>\n"
+    "</xs:schema>\n";
+
+// Writes the schema for the duration of a test
+class SchemaFile
+{
+public:
+    SchemaFile() :
+        mPathname("test_validator_cache.xsd")
+    {
+        io::FileOutputStream stream(mPathname);
+        stream.write(SCHEMA);
+        stream.close();
+    }
+
+    ~SchemaFile()
+    {
+        try
+        {
+            sys::OS().remove(mPathname);
+        }
+        catch (...)
+        {
+        }
+    }
+
+    std::vector<std::string> getPaths() const
+    {
+        return std::vector<std::string>(1, mPathname);
+    }
+
+private:
+    const std::string mPathname;
+};
+
+struct ParsedXML
+{
+    explicit ParsedXML(const std::string& count)
+    {
+        const std::string xml =
+                "<Root xmlns=\"urn:test:validator-cache\"><Count>" + count +
+                "</Count></Root>";
+        io::StringStream stream;
+        stream.write(xml);
+        parser.parse(stream);
+    }
+
+    const xml::lite::Element* getRootElement()
+    {
+        return parser.getDocument()->getRootElement();
+    }
+
+    xml::lite::MinidomParser parser;
+};
+
+TEST_CASE(testValidate)
+{
+    const SchemaFile schema;
+    logging::NullLogger log;
+    six::ValidatorRegistry registry;
+    ParsedXML valid("12");
+    ParsedXML invalid("twelve");
+    std::vector<xml::lite::ValidationInfo> errors;
+
+#if defined(USE_XERCES)
+    TEST_ASSERT(registry.validate(valid.getRootElement(), "valid",
+                                  schema.getPaths(), &log, errors));
+    TEST_ASSERT(errors.empty());
+    TEST_ASSERT(!registry.validate(invalid.getRootElement(), "invalid",
+                                   schema.getPaths(), &log, errors));
+    TEST_ASSERT(!errors.empty());
+
+    // Errors from before don't make a valid element invalid
+    TEST_ASSERT(registry.validate(valid.getRootElement(), "valid",
+                                  schema.getPaths(), &log, errors));
+    TEST_ASSERT_EQ(registry.getNumValidators(), static_cast<size_t>(1));
+#else
+    // Without Xerces there's no schema validation at all, and nothing
+    // should be left in the cache
+    TEST_EXCEPTION(registry.validate(valid.getRootElement(), "valid",
+                                     schema.getPaths(), &log, errors));
+    TEST_EXCEPTION(registry.validate(invalid.getRootElement(), "invalid",
+                                     schema.getPaths(), &log, errors));
+    TEST_ASSERT_EQ(registry.getNumValidators(), static_cast<size_t>(0));
+#endif
+}
+}
+
+int main(int , char** )
+{
+    TEST_CHECK(testValidate);
+    return 0;
+}